@@ -65,6 +65,8 @@ BuildRequires: libnotify-devel
 BuildRequires: make
 BuildRequires: gettext
 BuildRequires: libxml2-devel
+BuildRequires: libarchive-devel
+BuildRequires: libzstd-devel
 BuildRequires: intltool
 BuildRequires: libtool
 BuildRequires: libsoup3-devel
@@ -503,6 +505,7 @@ find %{buildroot} -name "*.py[co]" -delete
 # remove all .la and .a files
 find %{buildroot} -name '*.la' -or -name '*.a' | xargs rm -f
 mkdir -p %{buildroot}%{_localstatedir}/cache/abrt-di
+mkdir -p %{buildroot}%{_localstatedir}/cache/abrt/backtrace
 mkdir -p %{buildroot}%{_localstatedir}/lib/abrt
 mkdir -p %{buildroot}%{_localstatedir}/run/abrt
 mkdir -p %{buildroot}%{_localstatedir}/spool/abrt-upload
@@ -540,6 +543,7 @@ exit 0
 %post
 # $1 == 1 if install; 2 if upgrade
 %systemd_post abrtd.service
+%systemd_post abrt-event-runner.service
 
 %post addon-ccpp
 # migration from 2.14.1.18
@@ -549,10 +553,12 @@ if [ ! -e "%{_localstatedir}/cache/abrt-di/.migration-group-add" ]; then
 fi
 
 %systemd_post abrt-journal-core.service
+%systemd_post abrt-journal-watcher.service
 %journal_catalog_update
 
 %post addon-kerneloops
 %systemd_post abrt-oops.service
+%systemd_post abrt-kmsg-oops.service
 %journal_catalog_update
 
 %post addon-xorg
@@ -576,12 +582,15 @@ fi
 
 %preun
 %systemd_preun abrtd.service
+%systemd_preun abrt-event-runner.service
 
 %preun addon-ccpp
 %systemd_preun abrt-journal-core.service
+%systemd_preun abrt-journal-watcher.service
 
 %preun addon-kerneloops
 %systemd_preun abrt-oops.service
+%systemd_preun abrt-kmsg-oops.service
 
 %preun addon-xorg
 %systemd_preun abrt-xorg.service
@@ -597,12 +606,15 @@ fi
 
 %postun
 %systemd_postun_with_restart abrtd.service
+%systemd_postun_with_restart abrt-event-runner.service
 
 %postun addon-ccpp
 %systemd_postun_with_restart abrt-journal-core.service
+%systemd_postun_with_restart abrt-journal-watcher.service
 
 %postun addon-kerneloops
 %systemd_postun_with_restart abrt-oops.service
+%systemd_postun_with_restart abrt-kmsg-oops.service
 
 %postun addon-xorg
 %systemd_postun_with_restart abrt-xorg.service
@@ -696,6 +708,7 @@ killall abrt-dbus >/dev/null 2>&1 || :
 %files -f %{name}.lang
 %doc README.md COPYING
 %{_unitdir}/abrtd.service
+%{_unitdir}/abrt-event-runner.service
 %{_tmpfilesdir}/abrt.conf
 %{_sbindir}/abrtd
 %{_sbindir}/abrt-server
@@ -781,18 +794,27 @@ killall abrt-dbus >/dev/null 2>&1 || :
 
 %files addon-ccpp
 %dir %attr(0775, abrt, abrt) %{_localstatedir}/cache/abrt-di
+%dir %attr(0700, root, root) %{_localstatedir}/cache/abrt
+%dir %attr(0700, root, root) %{_localstatedir}/cache/abrt/backtrace
 %config(noreplace) %{_sysconfdir}/%{name}/plugins/CCpp.conf
 %{_mandir}/man5/abrt-CCpp.conf.5*
 %{_libexecdir}/abrt-gdb-exploitable
+%{_libexecdir}/abrt-gdb-backtrace
+%{_libexecdir}/abrt-gdb-broker
+%{_libexecdir}/abrt-gdb-session
 %{_libexecdir}/abrt-action-coredump
 %config(noreplace) %{_sysconfdir}/libreport/plugins/catalog_journal_ccpp_format.conf
 %{_unitdir}/abrt-journal-core.service
+%{_unitdir}/abrt-journal-watcher.service
 %{_journalcatalogdir}/abrt_ccpp.catalog
 
 %dir %{_localstatedir}/lib/abrt
 
 %{_bindir}/abrt-action-analyze-c
 %{_bindir}/abrt-action-trim-files
+%{_bindir}/abrt-action-cache-backtrace
+%{_bindir}/abrt-action-compress-coredump
+%{_bindir}/abrt-action-check-ccpp
 %{_bindir}/abrt-action-analyze-vulnerability
 %{_bindir}/abrt-action-generate-backtrace
 %{_bindir}/abrt-action-generate-core-backtrace
@@ -800,6 +822,7 @@ killall abrt-dbus >/dev/null 2>&1 || :
 %{_bindir}/abrt-action-list-dsos
 %{_bindir}/abrt-action-analyze-ccpp-local
 %{_bindir}/abrt-dump-journal-core
+%{_bindir}/abrt-journal-watcher
 %config(noreplace) %{_sysconfdir}/libreport/events.d/ccpp_event.conf
 %{_mandir}/man5/ccpp_event.conf.5*
 %config(noreplace) %{_sysconfdir}/libreport/events.d/gconf_event.conf
@@ -815,6 +838,9 @@ killall abrt-dbus >/dev/null 2>&1 || :
 %{_datadir}/libreport/events/post_report.xml
 %{_mandir}/man*/abrt-action-analyze-c.*
 %{_mandir}/man*/abrt-action-trim-files.*
+%{_mandir}/man*/abrt-action-cache-backtrace.*
+%{_mandir}/man*/abrt-action-compress-coredump.*
+%{_mandir}/man*/abrt-action-check-ccpp.*
 %{_mandir}/man*/abrt-action-generate-backtrace.*
 %{_mandir}/man*/abrt-action-generate-core-backtrace.*
 %{_mandir}/man*/abrt-action-analyze-backtrace.*
@@ -822,6 +848,7 @@ killall abrt-dbus >/dev/null 2>&1 || :
 %{_mandir}/man*/abrt-action-analyze-ccpp-local.*
 %{_mandir}/man*/abrt-action-analyze-vulnerability.*
 %{_mandir}/man1/abrt-dump-journal-core.1*
+%{_mandir}/man1/abrt-journal-watcher.1*
 
 %files addon-upload-watch
 %{_sbindir}/abrt-upload-watch
@@ -836,13 +863,16 @@ killall abrt-dbus >/dev/null 2>&1 || :
 %{_mandir}/man5/koops_event.conf.5*
 %config(noreplace) %{_sysconfdir}/%{name}/plugins/oops.conf
 %{_unitdir}/abrt-oops.service
+%{_unitdir}/abrt-kmsg-oops.service
 
 %dir %{_localstatedir}/lib/abrt
 
 %{_bindir}/abrt-dump-oops
 %{_bindir}/abrt-dump-journal-oops
+%{_bindir}/abrt-dump-kmsg-oops
 %{_bindir}/abrt-action-analyze-oops
 %{_mandir}/man1/abrt-dump-oops.1*
+%{_mandir}/man1/abrt-dump-kmsg-oops.1*
 %{_mandir}/man1/abrt-dump-journal-oops.1*
 %{_mandir}/man1/abrt-action-analyze-oops.1*
 %{_mandir}/man5/abrt-oops.conf.5*
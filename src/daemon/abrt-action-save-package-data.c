@@ -63,7 +63,6 @@
     "tclsh ([[:digit:]][.][[:digit:]])?)$"
 
 static bool   settings_bOpenGPGCheck = true;
-static GList *settings_setOpenGPGPublicKeys = NULL;
 static GList *settings_setBlackListedPkgs = NULL;
 static GList *settings_setBlackListedPaths = NULL;
 static bool   settings_bProcessUnpackaged = false;
@@ -121,9 +120,10 @@ static void ParseCommon(GHashTable *settings, const char *conf_filename)
     }
 }
 
+/* Loads the trusted keys into the rpm library, rpm_init() must be called first */
 static void load_gpg_keys(void)
 {
-    GHashTable *settings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    g_autoptr(GHashTable) settings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
     if (!abrt_load_abrt_conf_file(GPG_CONF, settings))
     {
         error_msg("Can't load '%s'", GPG_CONF);
@@ -148,8 +148,8 @@ static void load_gpg_keys(void)
                 continue;
 
             g_hash_table_insert(done_set, (gpointer)key_path, NULL);
-            log_debug("Loading gpg key '%s'", key_path);
-            settings_setOpenGPGPublicKeys = g_list_append(settings_setOpenGPGPublicKeys, g_strdup(key_path));
+            log_notice("Loading GPG key '%s'", key_path);
+            rpm_load_gpgkey(key_path);
         }
 
         g_list_free_full(gpg_files, (GDestroyNotify)libreport_free_file_obj);
@@ -173,8 +173,6 @@ static int load_conf(const char *conf_filename)
 
     ParseCommon(settings, conf_filename);
 
-    load_gpg_keys();
-
     return 0;
 }
 
@@ -507,12 +505,9 @@ int main(int argc, char **argv)
     log_notice("Initializing rpm library");
     rpm_init();
 
-    GList *li;
-    for (li = settings_setOpenGPGPublicKeys; li != NULL; li = g_list_next(li))
-    {
-        log_notice("Loading GPG key '%s'", (char*)li->data);
-        rpm_load_gpgkey((char*)li->data);
-    }
+    /* The keys are needed only to check the signatures */
+    if (settings_bOpenGPGCheck)
+        load_gpg_keys();
 
     int r = SavePackageDescriptionToDebugDump(dump_dir_name, chroot);
 
@@ -16,6 +16,8 @@
     with this program; if not, write to the Free Software Foundation, Inc.,
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <satyr/thread.h>
 #include <satyr/stacktrace.h>
 #include <satyr/distance.h>
@@ -27,6 +29,19 @@
 /* 70 % similarity */
 #define BACKTRACE_DUP_THRESHOLD 0.3
 
+/* We give up on clients which don't send the request in this many seconds */
+#define REQUEST_TIMEOUT 10
+
+/*
+Unix socket of the event runner (abrt-handle-event --serve).
+
+abrt-server runs post-create and notify[-dup] on every new problem. The runner
+keeps the event rules loaded, so they are not parsed again for every run. The
+rules are reloaded when a file they were loaded from changes.
+
+Only root may request a run. The protocol is described in lib/event_runner.c.
+*/
+
 static char *uid = NULL;
 static char *uuid = NULL;
 static struct sr_stacktrace *corebt = NULL;
@@ -342,40 +357,8 @@ static char *do_log(char *log_line, void *param)
     return log_line;
 }
 
-int main(int argc, char **argv)
+static void increment_nice(int nice_incr)
 {
-    /* I18n */
-    setlocale(LC_ALL, "");
-#if ENABLE_NLS
-    bindtextdomain(PACKAGE, LOCALEDIR);
-    textdomain(PACKAGE);
-#endif
-
-    abrt_init(argv);
-
-    const char *program_usage_string = _(
-        "& [-v -i -n INCREMENT] -e|--event EVENT DIR..."
-        );
-
-    char *event_name = NULL;
-    int interactive = 0; /* must be _int_, OPT_BOOL expects that! */
-    int nice_incr = 0;
-
-    struct options program_options[] = {
-        OPT__VERBOSE(&libreport_g_verbose),
-        OPT_STRING('e', "event" , &event_name, "EVENT",  _("Run EVENT on DIR")),
-        OPT_BOOL('i', "interactive" , &interactive, _("Communicate directly to the user")),
-        OPT_INTEGER('n',     "nice" , &nice_incr,   _("Increment the nice value by INCREMENT")),
-        OPT_END()
-    };
-
-    libreport_parse_opts(argc, argv, program_options, program_usage_string);
-    argv += optind;
-    if (!*argv || !event_name)
-        libreport_show_usage_and_die(program_usage_string, program_options);
-
-    abrt_load_abrt_conf();
-
     const char *const opt_env_nice = getenv("ABRT_EVENT_NICE");
     if (opt_env_nice != NULL && opt_env_nice[0] != '\0')
     {
@@ -395,25 +378,49 @@ int main(int argc, char **argv)
         if (ret == -1)
             perror_msg_and_die("Failed to increment the nice value");
     }
+}
 
+/* Independent steps run concurrently only if some rule of the event
+ * declares its elements, otherwise libreport runs the event */
+static bool use_event_steps(struct abrt_event_rules *rules, const char *event_name)
+{
+    return abrt_g_settings_event_step_workers > 1
+        && abrt_event_rules_have_declared_step(rules, event_name);
+}
+
+/* Returns the exit code of the event. Dies if the problem is a dup or if
+ * there are no actions for the event.
+ */
+static int handle_event_on_dir(struct abrt_event_rules *rules, const char *dump_dir_name,
+                               const char *event_name, bool interactive)
+{
     bool post_create = (strcmp(event_name, "post-create") == 0);
-    g_autofree char *dump_dir_name = NULL;
-    while (*argv)
-    {
-        dump_dir_name = g_strdup(*argv++);
-        int i = strlen(dump_dir_name);
-        while (--i >= 0)
-            if (dump_dir_name[i] != '/')
-                break;
-        dump_dir_name[++i] = '\0';
 
-        struct dump_dir *dd = dd_opendir(dump_dir_name, /*flags:*/ DD_OPEN_READONLY);
-        if (!dd)
-            return 1;
+    struct dump_dir *dd = dd_opendir(dump_dir_name, /*flags:*/ DD_OPEN_READONLY);
+    if (!dd)
+        return 1;
 
-        uid = dd_load_text_ext(dd, FILENAME_UID, DD_FAIL_QUIETLY_ENOENT);
-        dd_close(dd);
+    free(uid);
+    uid = dd_load_text_ext(dd, FILENAME_UID, DD_FAIL_QUIETLY_ENOENT);
+    dd_close(dd);
+
+    int r;
+    bool no_action_for_event;
+    if (rules)
+    {
+        struct abrt_event_run_state step_state = {
+            .max_workers = abrt_g_settings_event_step_workers,
+            .logging_callback = do_log,
+        };
+        if (post_create)
+            step_state.post_run_callback = is_crash_a_dup;
+
+        r = abrt_run_event_steps(rules, &step_state, dump_dir_name, event_name);
 
+        no_action_for_event = (r == 0 && step_state.children_count == 0);
+    }
+    else
+    {
         struct run_event_state *run_state = new_run_event_state();
         if (!interactive)
             make_run_event_state_forwarding(run_state);
@@ -421,19 +428,20 @@ int main(int argc, char **argv)
         if (post_create)
             run_state->post_run_callback = is_crash_a_dup;
 
-        int r = run_event_on_dir_name(run_state, dump_dir_name, event_name);
+        r = run_event_on_dir_name(run_state, dump_dir_name, event_name);
 
-        const bool no_action_for_event = (r == 0 && run_state->children_count == 0);
+        no_action_for_event = (r == 0 && run_state->children_count == 0);
 
         free_run_event_state(run_state);
-        /* Needed only if is_crash_a_dup() was called, but harmless
-         * even if it wasn't:
-         */
-        dup_uuid_fini();
-        dup_corebt_fini();
+    }
+    /* Needed only if is_crash_a_dup() was called, but harmless
+     * even if it wasn't:
+     */
+    dup_uuid_fini();
+    dup_corebt_fini();
 
-        if (no_action_for_event)
-            error_msg_and_die("No actions are found for event '%s'", event_name);
+    if (no_action_for_event)
+        error_msg_and_die("No actions are found for event '%s'", event_name);
 
 //TODO: consider this case:
 // new dump is created, post-create detects that it is a dup,
@@ -441,21 +449,176 @@ int main(int argc, char **argv)
 // In this case, we later delete damaged dup_name (right?)
 // but new dump never gets its FILENAME_COUNT set!
 
-        /* Is crash a dup? (In this case, is_crash_a_dup() should have
-         * aborted "post-create" event processing as soon as it saw uuid
-         * and determined that there is another crash with same uuid.
-         * In this case it sets crash_dump_dup_name)
-         */
-        if (crash_dump_dup_name)
-            error_msg_and_die("DUP_OF_DIR: %s", crash_dump_dup_name);
+    /* Is crash a dup? (In this case, is_crash_a_dup() should have
+     * aborted "post-create" event processing as soon as it saw uuid
+     * and determined that there is another crash with same uuid.
+     * In this case it sets crash_dump_dup_name)
+     */
+    if (crash_dump_dup_name)
+        error_msg_and_die("DUP_OF_DIR: %s", crash_dump_dup_name);
+
+    /* Was there error on one of processing steps in run_event? */
+    return r;
+}
 
-        /* Was there error on one of processing steps in run_event? */
-        if (r != 0)
-            return r; /* yes */
+/* Runs in a grandchild of the runner, the child reports its exit status */
+static int run_request(const struct abrt_event_run_request *request, void *param)
+{
+    /* abrt_init() of abrt-handle-event started by abrt-server does the same */
+    const char *verbose = getenv("ABRT_VERBOSE");
+    if (verbose)
+        libreport_g_verbose = atoi(verbose);
+    const char *prog_prefix = getenv("ABRT_PROG_PREFIX");
+    if (prog_prefix && libreport_string_to_bool(prog_prefix))
+        libreport_msg_prefix = libreport_g_progname;
+
+    increment_nice(request->nice);
+
+    struct abrt_event_rules *rules = param;
+    return handle_event_on_dir(use_event_steps(rules, request->event) ? rules : NULL,
+                               request->dump_dir_name, request->event, /*interactive:*/ true);
+}
 
-        dump_dir_name = NULL;
+static void reload_config(struct abrt_event_rules **rules)
+{
+    if (abrt_abrt_conf_changed())
+    {
+        log_notice("Reloading abrt.conf");
+        abrt_load_abrt_conf();
     }
 
+    if (*rules == NULL || abrt_event_rules_changed(*rules))
+    {
+        log_notice("Loading event rules from '%s'", REPORT_EVENT_CONF);
+        abrt_event_rules_free(*rules);
+        *rules = abrt_event_rules_load(REPORT_EVENT_CONF);
+    }
+}
+
+static int serve(void)
+{
+    unlink(EVENT_RUNNER_SOCKET); /* not caring about the result */
+
+    int socketfd = libreport_xsocket(AF_UNIX, SOCK_STREAM, 0);
+    libreport_close_on_exec_on(socketfd);
+
+    struct sockaddr_un local;
+    memset(&local, 0, sizeof(local));
+    local.sun_family = AF_UNIX;
+    strcpy(local.sun_path, EVENT_RUNNER_SOCKET);
+    libreport_xbind(socketfd, (struct sockaddr*)&local, sizeof(local));
+    libreport_xlisten(socketfd, 16);
+
+    if (chmod(EVENT_RUNNER_SOCKET, 0600) != 0)
+        perror_msg_and_die("chmod '%s'", EVENT_RUNNER_SOCKET);
+
+    /* The children are not waited for */
+    signal(SIGCHLD, SIG_IGN);
+
+    struct abrt_event_rules *rules = NULL;
+    reload_config(&rules);
+
+    log_info("Accepting run requests on '%s'", EVENT_RUNNER_SOCKET);
+    for (;;)
+    {
+        int fd = accept(socketfd, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            perror_msg_and_die("accept");
+        }
+        libreport_close_on_exec_on(fd);
+
+        /* Loaded before fork, so the children don't parse the rules again */
+        reload_config(&rules);
+
+        pid_t pid = fork();
+        if (pid < 0)
+            perror_msg("fork");
+        else if (pid == 0)
+        {
+            close(socketfd);
+            signal(SIGCHLD, SIG_DFL);
+            exit(abrt_event_runner_handle_request(fd, /*root:*/ 0, REQUEST_TIMEOUT, run_request, rules));
+        }
+        close(fd);
+    }
+
+    /* not reached */
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    const char *program_usage_string = _(
+        "& [-v -i -n INCREMENT] -e|--event EVENT DIR...\n"
+        "or:\n"
+        "& [-v] --serve"
+        );
+
+    char *event_name = NULL;
+    int interactive = 0; /* must be _int_, OPT_BOOL expects that! */
+    int nice_incr = 0;
+    int serve_requests = 0;
+
+    struct options program_options[] = {
+        OPT__VERBOSE(&libreport_g_verbose),
+        OPT_STRING('e', "event" , &event_name, "EVENT",  _("Run EVENT on DIR")),
+        OPT_BOOL('i', "interactive" , &interactive, _("Communicate directly to the user")),
+        OPT_INTEGER('n',     "nice" , &nice_incr,   _("Increment the nice value by INCREMENT")),
+        OPT_BOOL('s', "serve" , &serve_requests, _("Run the events abrt-server requests")),
+        OPT_END()
+    };
+
+    libreport_parse_opts(argc, argv, program_options, program_usage_string);
+    argv += optind;
+    if (serve_requests ? (*argv || event_name) : (!*argv || !event_name))
+        libreport_show_usage_and_die(program_usage_string, program_options);
+
+    abrt_load_abrt_conf();
+
+    if (serve_requests)
+        return serve();
+
+    increment_nice(nice_incr);
+
+    struct abrt_event_rules *rules = NULL;
+    if (interactive && abrt_g_settings_event_step_workers > 1)
+    {
+        rules = abrt_event_rules_load(REPORT_EVENT_CONF);
+        if (!use_event_steps(rules, event_name))
+        {
+            abrt_event_rules_free(rules);
+            rules = NULL;
+        }
+    }
+
+    while (*argv)
+    {
+        g_autofree char *dump_dir_name = g_strdup(*argv++);
+        int i = strlen(dump_dir_name);
+        while (--i >= 0)
+            if (dump_dir_name[i] != '/')
+                break;
+        dump_dir_name[++i] = '\0';
+
+        int r = handle_event_on_dir(rules, dump_dir_name, event_name, interactive);
+        if (r != 0)
+            return r;
+    }
+
+    abrt_event_rules_free(rules);
+
     /* exit 0 means, that there is no duplicate of dump-dir */
     return 0;
 }
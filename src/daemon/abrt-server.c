@@ -30,6 +30,8 @@
 #define TIMEOUT 10
 
 #define ABRT_SERVER_EVENT_ENV "ABRT_SERVER_PID"
+/* The nice value increment of the events */
+#define EVENT_NICE "10"
 
 /*
 Unix socket in ABRT daemon for creating new dump directories.
@@ -198,14 +200,51 @@ static int delete_path(const char *dump_dir_name)
     return 0; /* success */
 }
 
+/* Returns the PID of abrt-handle-event or 0 if the event runner runs
+ * the event. In the latter case, the output ends with the wait status.
+ */
 static pid_t spawn_event_handler_child(const char *dump_dir_name, const char *event_name, int *fdp)
 {
+    char *env_vec[3];
+    /* Intercept ASK_* messages in Client API -> don't wait for user response */
+    env_vec[0] = g_strdup("REPORT_CLIENT_NONINTERACTIVE=1");
+    env_vec[1] = g_strdup_printf("%s=%d", ABRT_SERVER_EVENT_ENV, getpid());
+    env_vec[2] = NULL;
+
+    /* The runner has the event rules loaded already. abrt-handle-event
+     * started below inherits the variables of libreport_export_abrt_envvars(),
+     * the runner gets them in the request. */
+    g_autoptr(GPtrArray) runner_env = g_ptr_array_new_with_free_func(g_free);
+    g_ptr_array_add(runner_env, g_strdup(env_vec[0]));
+    g_ptr_array_add(runner_env, g_strdup(env_vec[1]));
+    static const char *const abrt_envvars[] = { "ABRT_VERBOSE", "ABRT_PROG_PREFIX" };
+    for (size_t i = 0; i < G_N_ELEMENTS(abrt_envvars); ++i)
+    {
+        const char *value = getenv(abrt_envvars[i]);
+        if (value)
+            g_ptr_array_add(runner_env, g_strdup_printf("%s=%s", abrt_envvars[i], value));
+    }
+    g_ptr_array_add(runner_env, NULL);
+
+    int fd = abrt_event_runner_request(EVENT_RUNNER_SOCKET, event_name, dump_dir_name, EVENT_NICE,
+                                       (char **)runner_env->pdata);
+    if (fd >= 0)
+    {
+        g_free(env_vec[0]);
+        g_free(env_vec[1]);
+        if (fdp)
+            *fdp = fd;
+        else
+            close(fd);
+        return 0;
+    }
+
     char *args[9];
     args[0] = (char *) LIBEXEC_DIR"/abrt-handle-event";
     /* Do not forward ASK_* messages to parent*/
     args[1] = (char *) "-i";
     args[2] = (char *) "--nice";
-    args[3] = (char *) "10";
+    args[3] = (char *) EVENT_NICE;
     args[4] = (char *) "-e";
     args[5] = (char *) event_name;
     args[6] = (char *) "--";
@@ -216,12 +255,6 @@ static pid_t spawn_event_handler_child(const char *dump_dir_name, const char *ev
     int flags = EXECFLG_INPUT_NUL | EXECFLG_OUTPUT | EXECFLG_QUIET | EXECFLG_ERR2OUT;
     VERB1 flags &= ~EXECFLG_QUIET;
 
-    char *env_vec[3];
-    /* Intercept ASK_* messages in Client API -> don't wait for user response */
-    env_vec[0] = g_strdup("REPORT_CLIENT_NONINTERACTIVE=1");
-    env_vec[1] = g_strdup_printf("%s=%d", ABRT_SERVER_EVENT_ENV, getpid());
-    env_vec[2] = NULL;
-
     pid_t child = libreport_fork_execv_on_steroids(flags, args, pipeout,
                                          env_vec, /*dir:*/ NULL,
                                          /*uid(unused):*/ 0);
@@ -245,6 +278,31 @@ static int problem_dump_dir_was_provoked_by_abrt_event(struct dump_dir *dd, char
     return env_var != NULL;
 }
 
+/* Returns the number of occurrences which the problem creator did not save
+ * due to throttling (the new dump directory may be a dup of dd) */
+static unsigned long load_suppressed_count(struct dump_dir *dd, const char *dirname)
+{
+    struct dump_dir *new_dd = dd;
+    /* We must not call dd_opendir() to locked dd otherwise we go into a deadlock. */
+    if (strcmp(dd->dd_dirname, dirname) != 0)
+    {
+        new_dd = dd_opendir(dirname, DD_OPEN_READONLY | DD_FAIL_QUIETLY_ENOENT);
+        if (!new_dd)
+            return 0;
+    }
+
+    g_autofree char *suppressed_str = dd_load_text_ext(new_dd, FILENAME_SUPPRESSED_COUNT,
+                DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE | DD_FAIL_QUIETLY_ENOENT);
+
+    if (new_dd != dd)
+        dd_close(new_dd);
+
+    if (!suppressed_str)
+        return 0;
+
+    return strtoul(suppressed_str, NULL, 10);
+}
+
 static int
 emit_new_problem_signal(gpointer data)
 {
@@ -386,8 +444,11 @@ static int run_post_create(const char *dirname, struct response *resp)
     g_autoptr(GString) cmd_output = g_string_new(NULL);
 
     bool child_is_post_create = 1; /* else it is a notify child */
+    /* The wait status sent by the event runner, -1 if none was */
+    int runner_status;
 
  read_child_output:
+    runner_status = -1;
     //log_warning("Reading from event fd %d", child_stdout_fd);
 
     /* Read streamed data and split lines */
@@ -415,6 +476,11 @@ static int run_post_create(const char *dirname, struct response *resp)
                 free(dup_of_dir);
                 dup_of_dir = g_strdup(msg + strlen("DUP_OF_DIR: "));
             }
+            else if (child_pid == 0
+                  && g_str_has_prefix(msg, "EXIT_STATUS: "))
+            {
+                runner_status = atoi(msg + strlen("EXIT_STATUS: "));
+            }
             else
                 log_warning("%s", msg);
 
@@ -431,7 +497,16 @@ static int run_post_create(const char *dirname, struct response *resp)
 
     /* Wait for child to actually exit, collect status */
     int status = 0;
-    if (libreport_safe_waitpid(child_pid, &status, 0) <= 0)
+    if (child_pid == 0)
+    {
+        status = runner_status;
+        if (status == -1)
+        {
+            error_msg("The event runner didn't finish the event on '%s'", dirname);
+            status = W_EXITCODE(1, 0);
+        }
+    }
+    else if (libreport_safe_waitpid(child_pid, &status, 0) <= 0)
     /* should not happen */
         perror_msg("waitpid(%d)", child_pid);
 
@@ -475,7 +550,7 @@ static int run_post_create(const char *dirname, struct response *resp)
      */
     if ((status != 0 && dup_of_dir) || count == 0)
     {
-        count++;
+        count += 1 + load_suppressed_count(dd, dirname);
         char new_count_str[sizeof(long)*3 + 2];
         sprintf(new_count_str, "%lu", count);
         dd_save_text(dd, FILENAME_COUNT, new_count_str);
@@ -517,6 +592,12 @@ static int run_post_create(const char *dirname, struct response *resp)
     /* Reset mode/uig/gid to correct values for all files created by event run */
     dd_sanitize_mode_and_owner(dd);
 
+    if (!dup_of_dir && abrt_g_settings_share_elements)
+    {
+        g_autofree char *blob_store = g_build_filename(abrt_g_settings_dump_location, ABRT_BLOB_STORE_DIR, NULL);
+        abrt_share_problem_elements(dd, blob_store);
+    }
+
     dd_close(dd);
 
     if (!dup_of_dir)
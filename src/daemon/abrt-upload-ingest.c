@@ -0,0 +1,1036 @@
+/*
+    Copyright (C) 2026  ABRT Team
+    Copyright (C) 2026  Red Hat, Inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#include <archive.h>
+#include <archive_entry.h>
+#include <grp.h>
+#include "abrt-upload-ingest.h"
+#include "libabrt.h"
+
+#define INGEST_READ_BLOCK_SIZE (64 * 1024)
+
+/* An archive contains either elements of one problem directory or problem
+ * directories with elements, nothing deeper is unpacked */
+#define INGEST_MAX_DEPTH 2
+
+#define FILENAME_REMOTE_COUNT "remote_count"
+
+static const char *const s_archive_suffixes[] = {
+    ".tar.gz",
+    ".tgz",
+    ".tar.bz2",
+    ".tar.xz",
+};
+
+/* Makes names of problem directories unique among the worker threads */
+static gint s_problem_dir_seq;
+
+/* Number of unique names tried if the name of an uploaded problem directory
+ * is taken */
+#define MAX_PUBLISH_ATTEMPTS 16
+
+static bool
+archive_name_is_valid(const char *name)
+{
+    if (name[0] == '/')
+        error_msg(_("Skipping: '%s' (starts with slash)"), name);
+    else if (name[0] == '.')
+        error_msg(_("Skipping: '%s' (starts with dot)"), name);
+    else if (strstr(name, "..") != NULL)
+        error_msg(_("Skipping: '%s' (contains ..)"), name);
+    else if (strchr(name, ' ') != NULL)
+        error_msg(_("Skipping: '%s' (contains space)"), name);
+    else if (strchr(name, '\t') != NULL)
+        error_msg(_("Skipping: '%s' (contains tab)"), name);
+    else
+    {
+        for (unsigned i = 0; i < ARRAY_SIZE(s_archive_suffixes); ++i)
+            if (g_str_has_suffix(name, s_archive_suffixes[i]))
+                return true;
+
+        error_msg(_("Unknown file type: '%s'"), name);
+    }
+
+    return false;
+}
+
+static void
+remove_tree_at(int dir_fd, const char *name)
+{
+    if (unlinkat(dir_fd, name, 0) == 0 || errno == ENOENT)
+        return;
+
+    int fd = openat(dir_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    DIR *dir = fd >= 0 ? fdopendir(fd) : NULL;
+    if (dir == NULL)
+    {
+        perror_msg("Can't remove '%s'", name);
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        if (!libreport_dot_or_dotdot(dent->d_name))
+            remove_tree_at(dirfd(dir), dent->d_name);
+    }
+    closedir(dir);
+
+    if (unlinkat(dir_fd, name, AT_REMOVEDIR) != 0)
+        perror_msg("Can't remove '%s'", name);
+}
+
+/*
+ * Returns the components of the path of an archive entry without empty and
+ * "." components or NULL if the entry must not be unpacked.
+ */
+static char **
+entry_path_components(const char *path)
+{
+    if (path == NULL || path[0] == '/')
+        return NULL;
+
+    char **components = g_strsplit(path, "/", -1);
+    unsigned depth = 0;
+    for (char **c = components; *c != NULL; ++c)
+    {
+        if ((*c)[0] == '\0' || strcmp(*c, ".") == 0)
+        {
+            g_free(*c);
+            continue;
+        }
+
+        if (strcmp(*c, "..") == 0 || depth == INGEST_MAX_DEPTH)
+        {
+            components[depth] = NULL;
+            for (; *c != NULL; ++c)
+                g_free(*c);
+            g_strfreev(components);
+            return NULL;
+        }
+
+        components[depth++] = *c;
+    }
+    components[depth] = NULL;
+
+    if (depth == 0)
+    {
+        g_strfreev(components);
+        return NULL;
+    }
+
+    return components;
+}
+
+/* Adds size to the unpacked bytes, fails if they exceed the budget */
+static bool
+charge_unpacked(off_t size, off_t budget, off_t *unpacked)
+{
+    *unpacked += size;
+    return budget == 0 || *unpacked <= budget;
+}
+
+static int
+unpack_file(struct archive *archive, struct archive_entry *entry, int dest_fd, char **components,
+            off_t budget, off_t *unpacked)
+{
+    int parent_fd = dest_fd;
+    const char *file_name = components[0];
+    if (components[1] != NULL)
+    {
+        if (mkdirat(dest_fd, components[0], 0700) != 0 && errno != EEXIST)
+        {
+            perror_msg("Can't create directory '%s'", components[0]);
+            return -1;
+        }
+
+        parent_fd = openat(dest_fd, components[0], O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (parent_fd < 0)
+        {
+            perror_msg("Can't open directory '%s'", components[0]);
+            return -1;
+        }
+        file_name = components[1];
+    }
+
+    int retval = -1;
+    int fd = -1;
+    /* Reject tar bombs before a byte is written */
+    if (archive_entry_size_is_set(entry)
+        && !charge_unpacked(archive_entry_size(entry), budget, unpacked))
+    {
+        error_msg(_("Unpacking '%s' exceeds the limit of %llu bytes"), file_name, (unsigned long long)budget);
+        goto close_parent;
+    }
+
+    fd = openat(parent_fd, file_name, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        perror_msg("Can't create '%s'", file_name);
+        goto close_parent;
+    }
+
+    const void *buffer;
+    size_t size;
+    la_int64_t offset;
+    int r;
+    off_t end = 0;
+    while ((r = archive_read_data_block(archive, &buffer, &size, &offset)) == ARCHIVE_OK)
+    {
+        /* Entries without the size in the header are charged as they grow */
+        if (!archive_entry_size_is_set(entry) && offset + (off_t)size > end)
+        {
+            if (!charge_unpacked(offset + size - end, budget, unpacked))
+            {
+                error_msg(_("Unpacking '%s' exceeds the limit of %llu bytes"), file_name, (unsigned long long)budget);
+                goto close_file;
+            }
+            end = offset + size;
+        }
+
+        /* Sparse files have holes between the blocks */
+        if (lseek(fd, offset, SEEK_SET) < 0
+            || libreport_full_write(fd, buffer, size) != size)
+        {
+            perror_msg("Can't write '%s'", file_name);
+            goto close_file;
+        }
+    }
+
+    if (r != ARCHIVE_EOF)
+    {
+        error_msg("Can't read '%s': %s", file_name, archive_error_string(archive));
+        goto close_file;
+    }
+
+    /* Restore the size of a file ending with a hole */
+    if (archive_entry_size_is_set(entry) && ftruncate(fd, archive_entry_size(entry)) != 0)
+    {
+        perror_msg("Can't write '%s'", file_name);
+        goto close_file;
+    }
+
+    retval = 0;
+
+ close_file:
+    close(fd);
+ close_parent:
+    if (parent_fd != dest_fd)
+        close(parent_fd);
+    return retval;
+}
+
+/*
+ * Streams the archive into dest_fd. Only regular files and directories are
+ * unpacked.
+ */
+static int
+unpack_archive(int archive_fd, const char *name, int dest_fd, off_t budget)
+{
+    off_t unpacked = 0;
+    struct archive *archive = archive_read_new();
+    archive_read_support_filter_gzip(archive);
+    archive_read_support_filter_bzip2(archive);
+    archive_read_support_filter_xz(archive);
+    archive_read_support_format_tar(archive);
+
+    int retval = 0;
+    int r = archive_read_open_fd(archive, archive_fd, INGEST_READ_BLOCK_SIZE);
+    struct archive_entry *entry;
+    while (r == ARCHIVE_OK && (r = archive_read_next_header(archive, &entry)) == ARCHIVE_OK)
+    {
+        const char *path = archive_entry_pathname(entry);
+        char **components = entry_path_components(path);
+        if (components == NULL)
+        {
+            log_info("Skipping '%s' in '%s'", path, name);
+            continue;
+        }
+
+        switch (archive_entry_filetype(entry))
+        {
+            case AE_IFDIR:
+                /* The directories of problem elements are removed anyway */
+                if (components[1] == NULL && mkdirat(dest_fd, components[0], 0700) != 0 && errno != EEXIST)
+                {
+                    perror_msg("Can't create directory '%s'", components[0]);
+                    retval = -1;
+                }
+                break;
+            case AE_IFREG:
+                retval = unpack_file(archive, entry, dest_fd, components, budget, &unpacked);
+                break;
+            default:
+                log_info("Skipping '%s' in '%s' (not a regular file)", path, name);
+                break;
+        }
+
+        g_strfreev(components);
+
+        if (retval != 0)
+            break;
+    }
+
+    if (retval == 0 && r != ARCHIVE_EOF)
+    {
+        error_msg(_("Can't unpack '%s': %s"), name, archive_error_string(archive));
+        retval = -1;
+    }
+
+    archive_read_free(archive);
+    return retval;
+}
+
+static int
+copy_element(int src_dir_fd, int dest_dir_fd, const char *name, gid_t abrt_gid)
+{
+    int src_fd = openat(src_dir_fd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (src_fd < 0)
+    {
+        perror_msg("Can't open '%s'", name);
+        return -1;
+    }
+
+    int retval = -1;
+    int dest_fd = openat(dest_dir_fd, name, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, DEFAULT_DUMP_DIR_MODE);
+    if (dest_fd < 0)
+        perror_msg("Can't create '%s'", name);
+    else
+    {
+        if (libreport_copyfd_eof(src_fd, dest_fd, 0) < 0
+            || fchown(dest_fd, 0, abrt_gid) != 0
+            || fchmod(dest_fd, DEFAULT_DUMP_DIR_MODE) != 0)
+            perror_msg("Can't copy '%s'", name);
+        else
+            retval = 0;
+        close(dest_fd);
+    }
+
+    close(src_fd);
+    return retval;
+}
+
+/* Renames a directory unless dest exists */
+static int
+rename_noreplace(int old_dir_fd, const char *old_name, const char *dest)
+{
+    if (renameat2(old_dir_fd, old_name, AT_FDCWD, dest, RENAME_NOREPLACE) == 0)
+        return 0;
+
+    if (errno != EINVAL && errno != ENOSYS)
+        return -1;
+
+    /* The file system doesn't support RENAME_NOREPLACE; renaming over an
+     * empty directory would succeed */
+    if (access(dest, F_OK) == 0)
+    {
+        errno = EEXIST;
+        return -1;
+    }
+
+    return renameat(old_dir_fd, old_name, AT_FDCWD, dest);
+}
+
+/*
+ * Moves a directory to dump_location under name or, if a directory of that
+ * name exists, under name.PID.SEQ. Returns the new path or NULL with errno
+ * set.
+ */
+static char *
+publish_problem_dir(int old_dir_fd, const char *old_name, const char *dump_location, const char *name)
+{
+    char *dest = g_build_filename(dump_location, name, NULL);
+    for (unsigned attempt = 0; ; ++attempt)
+    {
+        if (rename_noreplace(old_dir_fd, old_name, dest) == 0)
+            return dest;
+
+        const int err = errno;
+        g_free(dest);
+        if ((err != EEXIST && err != ENOTEMPTY) || attempt == MAX_PUBLISH_ATTEMPTS)
+        {
+            errno = err;
+            return NULL;
+        }
+
+        g_autofree char *unique = g_strdup_printf("%s.%d.%d", name, getpid(), g_atomic_int_add(&s_problem_dir_seq, 1));
+        dest = g_build_filename(dump_location, unique, NULL);
+    }
+}
+
+/*
+ * Copies the elements to a hidden directory in dump_location and renames it
+ * to a unique name, so the problem directory never appears incomplete.
+ */
+static char *
+copy_problem_dir(int src_dir_fd, const char *dump_location, const char *name, gid_t abrt_gid)
+{
+    g_autofree char *tmp_dir = g_strdup_printf("%s/.%s.XXXXXX", dump_location, name);
+    if (mkdtemp(tmp_dir) == NULL)
+    {
+        perror_msg("Can't create '%s'", tmp_dir);
+        return NULL;
+    }
+
+    char *dest = NULL;
+    int tmp_fd = open(tmp_dir, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (tmp_fd < 0)
+    {
+        perror_msg("Can't open '%s'", tmp_dir);
+        goto remove_tmp;
+    }
+
+    int dup_fd = dup(src_dir_fd);
+    DIR *dir = dup_fd >= 0 ? fdopendir(dup_fd) : NULL;
+    if (dir == NULL)
+    {
+        perror_msg("Can't read problem directory");
+        if (dup_fd >= 0)
+            close(dup_fd);
+        goto close_tmp;
+    }
+    rewinddir(dir);
+
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        if (!libreport_dot_or_dotdot(dent->d_name)
+            && copy_element(src_dir_fd, tmp_fd, dent->d_name, abrt_gid) != 0)
+            break;
+    }
+
+    if (dent == NULL
+        && fchown(tmp_fd, 0, abrt_gid) == 0
+        && fchmod(tmp_fd, DEFAULT_DUMP_DIR_MODE | S_IXUSR | S_IXGRP) == 0)
+    {
+        dest = publish_problem_dir(AT_FDCWD, tmp_dir, dump_location, name);
+    }
+
+    if (dent == NULL && dest == NULL)
+        perror_msg("Can't move problem directory '%s' to '%s'", name, dump_location);
+
+    closedir(dir);
+ close_tmp:
+    close(tmp_fd);
+ remove_tmp:
+    if (dest == NULL)
+        remove_tree_at(AT_FDCWD, tmp_dir);
+    return dest;
+}
+
+/*
+ * Gives the problem directory and its elements to root:abrt, removes
+ * everything which isn't a regular file, marks the problem as remote and
+ * moves it to dump_location under a unique name.
+ */
+static int
+move_problem_dir(int parent_fd, const char *name, const char *dump_location, gid_t abrt_gid)
+{
+    int dir_fd = openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (dir_fd < 0)
+    {
+        perror_msg("Can't open '%s'", name);
+        return -1;
+    }
+
+    int retval = -1;
+    g_autofree char *dest = NULL;
+    /* Allow the owner and the group to access problem elements, the default
+     * dump dir mode lacks x bit for both */
+    if (fchown(dir_fd, 0, abrt_gid) != 0
+        || fchmod(dir_fd, DEFAULT_DUMP_DIR_MODE | S_IXUSR | S_IXGRP) != 0)
+    {
+        perror_msg("Can't change ownership of '%s'", name);
+        goto close_dir;
+    }
+
+    int dup_fd = dup(dir_fd);
+    DIR *dir = dup_fd >= 0 ? fdopendir(dup_fd) : NULL;
+    if (dir == NULL)
+    {
+        perror_msg("Can't read '%s'", name);
+        if (dup_fd >= 0)
+            close(dup_fd);
+        goto close_dir;
+    }
+
+    bool sanitized = true;
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        if (libreport_dot_or_dotdot(dent->d_name))
+            continue;
+
+        struct stat st;
+        if (fstatat(dir_fd, dent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            sanitized = false;
+        else if (!S_ISREG(st.st_mode))
+            remove_tree_at(dir_fd, dent->d_name);
+        else if (fchownat(dir_fd, dent->d_name, 0, abrt_gid, AT_SYMLINK_NOFOLLOW) != 0
+                 || fchmodat(dir_fd, dent->d_name, DEFAULT_DUMP_DIR_MODE, 0) != 0)
+            sanitized = false;
+    }
+    closedir(dir);
+
+    if (!sanitized)
+    {
+        perror_msg("Can't sanitize problem directory '%s'", name);
+        goto close_dir;
+    }
+
+    /* Overwrite remote if it exists */
+    int remote_fd = openat(dir_fd, FILENAME_REMOTE, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, DEFAULT_DUMP_DIR_MODE);
+    if (remote_fd < 0
+        || fchown(remote_fd, 0, abrt_gid) != 0
+        || libreport_full_write_str(remote_fd, "1") != 1)
+    {
+        perror_msg("Can't write '%s'", FILENAME_REMOTE);
+        if (remote_fd >= 0)
+            close(remote_fd);
+        goto close_dir;
+    }
+    close(remote_fd);
+
+    /* abrtd would increment count value and abrt-server refuses to process
+     * problem directories containing 'count' element when PrivateReports is on. */
+    if (renameat(dir_fd, FILENAME_COUNT, dir_fd, FILENAME_REMOTE_COUNT) != 0 && errno != ENOENT)
+    {
+        perror_msg("Can't rename '%s'", FILENAME_COUNT);
+        goto close_dir;
+    }
+
+    dest = publish_problem_dir(parent_fd, name, dump_location, name);
+    if (dest == NULL && errno == EXDEV)
+        dest = copy_problem_dir(dir_fd, dump_location, name, abrt_gid);
+    else if (dest == NULL)
+        perror_msg("Can't move '%s' to '%s'", name, dump_location);
+
+    if (dest != NULL)
+    {
+        abrt_notify_new_path(dest);
+        retval = 0;
+    }
+
+ close_dir:
+    close(dir_fd);
+    if (retval != 0)
+        remove_tree_at(parent_fd, name);
+    return retval;
+}
+
+static bool
+is_problem_dir(int dir_fd)
+{
+    return (faccessat(dir_fd, FILENAME_ANALYZER, F_OK, AT_SYMLINK_NOFOLLOW) == 0
+            || faccessat(dir_fd, FILENAME_TYPE, F_OK, AT_SYMLINK_NOFOLLOW) == 0)
+        && faccessat(dir_fd, FILENAME_TIME, F_OK, AT_SYMLINK_NOFOLLOW) == 0;
+}
+
+static int
+move_problem_dirs(const struct abrt_upload_ingest_settings *settings, gid_t abrt_gid,
+                  int work_fd, const char *unpack_name, int unpack_fd)
+{
+    /* The archive can contain either plain dump files or one or more
+     * complete problem data directories. */
+    if (is_problem_dir(unpack_fd))
+    {
+        return move_problem_dir(work_fd, unpack_name, settings->dump_location, abrt_gid);
+    }
+
+    int dup_fd = dup(unpack_fd);
+    DIR *dir = dup_fd >= 0 ? fdopendir(dup_fd) : NULL;
+    if (dir == NULL)
+    {
+        perror_msg("Can't read '%s'", unpack_name);
+        if (dup_fd >= 0)
+            close(dup_fd);
+        return -1;
+    }
+
+    int retval = 0;
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        struct stat st;
+        if (libreport_dot_or_dotdot(dent->d_name)
+            || fstatat(unpack_fd, dent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0
+            || !S_ISDIR(st.st_mode))
+            continue;
+
+        if (move_problem_dir(unpack_fd, dent->d_name, settings->dump_location, abrt_gid) != 0)
+            retval = -1;
+    }
+    closedir(dir);
+
+    return retval;
+}
+
+int
+abrt_upload_ingest_archive(const struct abrt_upload_ingest_settings *settings,
+                           gid_t abrt_gid,
+                           const char *name)
+{
+    if (!archive_name_is_valid(name))
+        return -1;
+
+    g_autofree char *path = g_build_filename(settings->upload_directory, name, NULL);
+    int archive_fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (archive_fd < 0)
+    {
+        perror_msg(_("Can't open '%s'"), path);
+        return -1;
+    }
+
+    /* The opened archive can be read after it is deleted */
+    if (settings->delete_uploaded && unlink(path) != 0)
+        perror_msg("Can't delete '%s'", path);
+
+    int retval = -1;
+    g_autofree char *work_dir = g_build_filename(settings->work_directory, "abrt_handle_upload.XXXXXX", NULL);
+    if (mkdtemp(work_dir) == NULL)
+    {
+        perror_msg(_("Can't create working directory in '%s'"), settings->work_directory);
+        goto close_archive;
+    }
+
+    int work_fd = open(work_dir, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (work_fd < 0)
+    {
+        perror_msg("Can't open '%s'", work_dir);
+        goto remove_work_dir;
+    }
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    struct tm tm;
+    char date[sizeof("YYYY-MM-DD-hh:mm:ss")];
+    strftime(date, sizeof(date), "%Y-%m-%d-%H:%M:%S", localtime_r(&tv.tv_sec, &tm));
+    g_autofree char *unpack_name = g_strdup_printf("remote.%s.%06ld.%d", date, (long)tv.tv_usec, getpid());
+
+    int unpack_fd = -1;
+    if (mkdirat(work_fd, unpack_name, 0700) != 0
+        || (unpack_fd = openat(work_fd, unpack_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)) < 0)
+    {
+        perror_msg(_("Can't create '%s' directory"), unpack_name);
+        goto close_work_dir;
+    }
+
+    log_warning(_("Unpacking '%s'"), name);
+    retval = unpack_archive(archive_fd, name, unpack_fd, settings->worker_budget);
+    if (retval == 0)
+        retval = move_problem_dirs(settings, abrt_gid, work_fd, unpack_name, unpack_fd);
+
+    close(unpack_fd);
+ close_work_dir:
+    close(work_fd);
+ remove_work_dir:
+    remove_tree_at(AT_FDCWD, work_dir);
+ close_archive:
+    close(archive_fd);
+
+    if (retval == 0)
+        log_warning(_("'%s' processed successfully"), name);
+
+    return retval;
+}
+
+/*
+ * Worker pool
+ */
+struct upload
+{
+    char *name;
+    off_t size;
+    /* g_get_real_time() of the detection, survives spilling to disk */
+    gint64 queued_at;
+};
+
+static void
+upload_free(struct upload *upload)
+{
+    if (upload == NULL)
+        return;
+
+    g_free(upload->name);
+    g_free(upload);
+}
+
+struct ingest_lane
+{
+    GQueue queue;
+    struct abrt_upload_ingest_lane_stats stats;
+};
+
+struct abrt_upload_ingest
+{
+    struct abrt_upload_ingest_settings settings;
+    gid_t abrt_gid;
+
+    GMutex lock;
+    GCond cond;
+    /* Archives waiting in memory */
+    struct ingest_lane lanes[ABRT_UPLOAD_INGEST_LANE_COUNT];
+    /* Number of archives in the spill file */
+    unsigned spilled;
+    bool quit;
+
+    GThread **workers;
+};
+
+static const char *const s_lane_names[] = {
+    [ABRT_UPLOAD_INGEST_LANE_SMALL] = "small",
+    [ABRT_UPLOAD_INGEST_LANE_LARGE] = "large",
+};
+
+const char *
+abrt_upload_ingest_lane_name(enum abrt_upload_ingest_lane lane)
+{
+    return s_lane_names[lane];
+}
+
+static unsigned
+ingest_queued(struct abrt_upload_ingest *ingest)
+{
+    unsigned queued = 0;
+    for (unsigned i = 0; i < ABRT_UPLOAD_INGEST_LANE_COUNT; ++i)
+        queued += g_queue_get_length(&ingest->lanes[i].queue);
+    return queued;
+}
+
+static void
+ingest_enqueue(struct abrt_upload_ingest *ingest, struct upload *upload)
+{
+    const enum abrt_upload_ingest_lane lane = upload->size >= ingest->settings.large_size
+                                              ? ABRT_UPLOAD_INGEST_LANE_LARGE
+                                              : ABRT_UPLOAD_INGEST_LANE_SMALL;
+
+    g_queue_push_tail(&ingest->lanes[lane].queue, upload);
+    ingest->lanes[lane].stats.queued = g_queue_get_length(&ingest->lanes[lane].queue);
+}
+
+static struct upload *
+upload_new(struct abrt_upload_ingest *ingest, const char *name, gint64 queued_at)
+{
+    struct upload *upload = g_new0(struct upload, 1);
+    upload->name = g_strdup(name);
+    upload->queued_at = queued_at;
+
+    /* A vanished archive is reported by the worker */
+    g_autofree char *path = g_build_filename(ingest->settings.upload_directory, name, NULL);
+    struct stat st;
+    if (stat(path, &st) == 0)
+        upload->size = st.st_size;
+
+    return upload;
+}
+
+/*
+ * The spill file has a line "QUEUED_AT NAME" for every archive.
+ */
+static unsigned
+spill_load_count(const char *spill_file)
+{
+    g_autofree char *contents = NULL;
+    if (!g_file_get_contents(spill_file, &contents, NULL, NULL))
+        return 0;
+
+    unsigned count = 0;
+    for (const char *c = contents; (c = strchr(c, '\n')) != NULL; ++c)
+        ++count;
+    return count;
+}
+
+static void
+spill_append(const char *spill_file, const struct upload *upload)
+{
+    int fd = open(spill_file, O_WRONLY | O_CREAT | O_APPEND | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        perror_msg("Can't open '%s'", spill_file);
+        return;
+    }
+
+    g_autofree char *line = g_strdup_printf("%lld %s\n", (long long)upload->queued_at, upload->name);
+    if (libreport_full_write_str(fd, line) < 0)
+        perror_msg("Can't write '%s'", spill_file);
+    close(fd);
+}
+
+static void
+spill_save(const char *spill_file, const char *contents, size_t size)
+{
+    if (size == 0)
+    {
+        if (unlink(spill_file) != 0 && errno != ENOENT)
+            perror_msg("Can't remove '%s'", spill_file);
+        return;
+    }
+
+    g_autofree char *tmp_name = g_strdup_printf("%s.new", spill_file);
+    int fd = open(tmp_name, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        perror_msg("Can't open '%s'", tmp_name);
+        return;
+    }
+
+    const bool written = libreport_full_write(fd, contents, size) == size;
+    close(fd);
+
+    if (!written || rename(tmp_name, spill_file) < 0)
+    {
+        perror_msg("Can't save '%s'", spill_file);
+        unlink(tmp_name);
+    }
+}
+
+/* Moves the oldest spilled archives to the in-memory queue, called locked */
+static void
+ingest_refill(struct abrt_upload_ingest *ingest)
+{
+    g_autofree char *contents = NULL;
+    gsize size = 0;
+    if (!g_file_get_contents(ingest->settings.spill_file, &contents, &size, NULL))
+    {
+        ingest->spilled = 0;
+        return;
+    }
+
+    char *line = contents;
+    char *eol;
+    while (ingest_queued(ingest) < ingest->settings.capacity
+           && (eol = strchr(line, '\n')) != NULL)
+    {
+        *eol = '\0';
+
+        long long queued_at;
+        int name_pos = 0;
+        if (sscanf(line, "%lld %n", &queued_at, &name_pos) != 1 || line[name_pos] == '\0')
+            log_notice("Ignoring malformed line in '%s': %s", ingest->settings.spill_file, line);
+        else
+            ingest_enqueue(ingest, upload_new(ingest, line + name_pos, queued_at));
+
+        line = eol + 1;
+    }
+
+    spill_save(ingest->settings.spill_file, line, size - (line - contents));
+    ingest->spilled = spill_load_count(ingest->settings.spill_file);
+
+    log_debug("Loaded spilled archives, %u archives in memory, %u spilled",
+            ingest_queued(ingest), ingest->spilled);
+}
+
+static bool
+lane_admits(const struct ingest_lane *lane, off_t budget, off_t size)
+{
+    return lane->stats.active == 0 || budget == 0 || lane->stats.active_bytes + size <= budget;
+}
+
+/*
+ * Takes the next archive the budgets allow, called locked. Large archives
+ * never occupy more than large_workers workers, so the rest of the workers
+ * keep up with the small ones.
+ */
+static struct upload *
+ingest_pick(struct abrt_upload_ingest *ingest, enum abrt_upload_ingest_lane *picked)
+{
+    static const enum abrt_upload_ingest_lane order[] = {
+        ABRT_UPLOAD_INGEST_LANE_LARGE,
+        ABRT_UPLOAD_INGEST_LANE_SMALL,
+    };
+
+    for (unsigned i = 0; i < ARRAY_SIZE(order); ++i)
+    {
+        struct ingest_lane *lane = &ingest->lanes[order[i]];
+        const struct upload *head = g_queue_peek_head(&lane->queue);
+        if (head == NULL
+            || (order[i] == ABRT_UPLOAD_INGEST_LANE_LARGE && lane->stats.active >= ingest->settings.large_workers)
+            || !lane_admits(lane, ingest->settings.lane_budget[order[i]], head->size))
+            continue;
+
+        struct upload *upload = g_queue_pop_head(&lane->queue);
+        const gint64 wait = MAX(0, g_get_real_time() - upload->queued_at);
+
+        lane->stats.queued = g_queue_get_length(&lane->queue);
+        lane->stats.active++;
+        lane->stats.active_bytes += upload->size;
+        lane->stats.processed++;
+        lane->stats.wait_total += wait;
+        lane->stats.wait_max = MAX(lane->stats.wait_max, wait);
+
+        log_debug("Taking '%s' (%llu bytes) from %s lane after %lld ms",
+                upload->name, (unsigned long long)upload->size, abrt_upload_ingest_lane_name(order[i]), (long long)(wait / 1000));
+
+        *picked = order[i];
+        return upload;
+    }
+
+    return NULL;
+}
+
+static gpointer
+ingest_worker(gpointer user_data)
+{
+    struct abrt_upload_ingest *ingest = user_data;
+
+    g_mutex_lock(&ingest->lock);
+    while (!ingest->quit)
+    {
+        if (ingest->spilled > 0 && ingest_queued(ingest) <= ingest->settings.capacity / 2)
+            ingest_refill(ingest);
+
+        enum abrt_upload_ingest_lane lane;
+        struct upload *upload = ingest_pick(ingest, &lane);
+        if (upload == NULL)
+        {
+            g_cond_wait(&ingest->cond, &ingest->lock);
+            continue;
+        }
+        g_mutex_unlock(&ingest->lock);
+
+        log_info("Processing file '%s' in directory '%s'", upload->name, ingest->settings.upload_directory);
+        abrt_upload_ingest_archive(&ingest->settings, ingest->abrt_gid, upload->name);
+
+        g_mutex_lock(&ingest->lock);
+        ingest->lanes[lane].stats.active--;
+        ingest->lanes[lane].stats.active_bytes -= upload->size;
+        upload_free(upload);
+        /* The freed budget can admit archives other workers wait for */
+        g_cond_broadcast(&ingest->cond);
+    }
+    g_mutex_unlock(&ingest->lock);
+
+    return NULL;
+}
+
+struct abrt_upload_ingest *
+abrt_upload_ingest_new(const struct abrt_upload_ingest_settings *settings)
+{
+    struct abrt_upload_ingest *ingest = g_new0(struct abrt_upload_ingest, 1);
+    ingest->settings = *settings;
+    if (ingest->settings.large_workers == 0)
+        ingest->settings.large_workers = 1;
+
+    struct group *gr = getgrnam("abrt");
+    if (gr != NULL)
+        ingest->abrt_gid = gr->gr_gid;
+    else
+        error_msg("Failed to get GID of 'abrt' (using 0 instead)");
+
+    g_mutex_init(&ingest->lock);
+    g_cond_init(&ingest->cond);
+    for (unsigned i = 0; i < ABRT_UPLOAD_INGEST_LANE_COUNT; ++i)
+        g_queue_init(&ingest->lanes[i].queue);
+
+    ingest->spilled = spill_load_count(settings->spill_file);
+    if (ingest->spilled > 0)
+        log_notice("%u archives left by the previous run in '%s'", ingest->spilled, settings->spill_file);
+
+    ingest->workers = g_new0(GThread *, settings->workers);
+    for (unsigned i = 0; i < settings->workers; ++i)
+        ingest->workers[i] = g_thread_new("upload-ingest", ingest_worker, ingest);
+
+    return ingest;
+}
+
+void
+abrt_upload_ingest_push(struct abrt_upload_ingest *ingest, const char *name)
+{
+    struct upload *upload = upload_new(ingest, name, g_get_real_time());
+
+    g_mutex_lock(&ingest->lock);
+
+    /* Keep the order: nothing overtakes the spilled archives */
+    if (ingest->spilled > 0 || ingest_queued(ingest) >= ingest->settings.capacity)
+    {
+        log_debug("Spilling '%s' to '%s'", name, ingest->settings.spill_file);
+        spill_append(ingest->settings.spill_file, upload);
+        ++ingest->spilled;
+        upload_free(upload);
+    }
+    else
+        ingest_enqueue(ingest, upload);
+
+    g_cond_broadcast(&ingest->cond);
+    g_mutex_unlock(&ingest->lock);
+}
+
+void
+abrt_upload_ingest_get_stats(struct abrt_upload_ingest *ingest, struct abrt_upload_ingest_stats *stats)
+{
+    g_mutex_lock(&ingest->lock);
+    for (unsigned i = 0; i < ABRT_UPLOAD_INGEST_LANE_COUNT; ++i)
+        stats->lanes[i] = ingest->lanes[i].stats;
+    stats->spilled = ingest->spilled;
+    g_mutex_unlock(&ingest->lock);
+}
+
+void
+abrt_upload_ingest_free(struct abrt_upload_ingest *ingest)
+{
+    if (ingest == NULL)
+        return;
+
+    g_mutex_lock(&ingest->lock);
+    ingest->quit = true;
+    g_cond_broadcast(&ingest->cond);
+    g_mutex_unlock(&ingest->lock);
+
+    for (unsigned i = 0; i < ingest->settings.workers; ++i)
+        g_thread_join(ingest->workers[i]);
+    g_free(ingest->workers);
+
+    /* The waiting archives go before the spilled ones, merged by the time
+     * of detection */
+    GString *contents = g_string_new(NULL);
+    for (;;)
+    {
+        struct ingest_lane *oldest = NULL;
+        for (unsigned i = 0; i < ABRT_UPLOAD_INGEST_LANE_COUNT; ++i)
+        {
+            const struct upload *head = g_queue_peek_head(&ingest->lanes[i].queue);
+            if (head != NULL
+                && (oldest == NULL || head->queued_at < ((struct upload *)g_queue_peek_head(&oldest->queue))->queued_at))
+                oldest = &ingest->lanes[i];
+        }
+        if (oldest == NULL)
+            break;
+
+        struct upload *upload = g_queue_pop_head(&oldest->queue);
+        g_string_append_printf(contents, "%lld %s\n", (long long)upload->queued_at, upload->name);
+        upload_free(upload);
+    }
+
+    if (contents->len > 0)
+    {
+        g_autofree char *spilled = NULL;
+        if (g_file_get_contents(ingest->settings.spill_file, &spilled, NULL, NULL))
+            g_string_append(contents, spilled);
+
+        spill_save(ingest->settings.spill_file, contents->str, contents->len);
+        log_notice("Saved %u waiting archives to '%s'",
+                spill_load_count(ingest->settings.spill_file), ingest->settings.spill_file);
+    }
+    g_string_free(contents, TRUE);
+
+    g_cond_clear(&ingest->cond);
+    g_mutex_clear(&ingest->lock);
+    g_free(ingest);
+}
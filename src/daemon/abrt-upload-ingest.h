@@ -0,0 +1,115 @@
+/*
+    Copyright (C) 2026  ABRT Team
+    Copyright (C) 2026  Red Hat, Inc.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef ABRT_UPLOAD_INGEST_H
+#define ABRT_UPLOAD_INGEST_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <glib.h>
+
+/*
+ * Archives are scheduled in two lanes by their size, so a few large
+ * uploads can't hold up the small ones.
+ */
+enum abrt_upload_ingest_lane
+{
+    ABRT_UPLOAD_INGEST_LANE_SMALL,
+    ABRT_UPLOAD_INGEST_LANE_LARGE,
+    ABRT_UPLOAD_INGEST_LANE_COUNT,
+};
+
+struct abrt_upload_ingest_settings
+{
+    /* Directory of the uploaded archives */
+    const char *upload_directory;
+    /* Where the problem directories are moved to */
+    const char *dump_location;
+    /* Where the archives are unpacked */
+    const char *work_directory;
+    /* Archives which don't fit into the in-memory queue */
+    const char *spill_file;
+    bool delete_uploaded;
+    unsigned workers;
+    /* Maximal number of archives waiting in memory */
+    unsigned capacity;
+    /* Archives of at least this size go to the large lane */
+    off_t large_size;
+    /* Maximal number of workers unpacking large archives */
+    unsigned large_workers;
+    /* Maximal sum of sizes of archives being unpacked in a lane, the first
+     * archive of an idle lane is always admitted; 0 means unlimited */
+    off_t lane_budget[ABRT_UPLOAD_INGEST_LANE_COUNT];
+    /* Maximal number of bytes a worker unpacks from one archive, 0 means
+     * unlimited */
+    off_t worker_budget;
+};
+
+struct abrt_upload_ingest_lane_stats
+{
+    unsigned queued;
+    unsigned active;
+    off_t active_bytes;
+    unsigned long processed;
+    /* Time the processed archives waited for a worker in microseconds */
+    gint64 wait_total;
+    gint64 wait_max;
+};
+
+struct abrt_upload_ingest_stats
+{
+    struct abrt_upload_ingest_lane_stats lanes[ABRT_UPLOAD_INGEST_LANE_COUNT];
+    unsigned spilled;
+};
+
+struct abrt_upload_ingest;
+
+const char *abrt_upload_ingest_lane_name(enum abrt_upload_ingest_lane lane);
+
+/*
+ * Starts the worker threads. Archives spilled by the previous run are
+ * processed first.
+ */
+struct abrt_upload_ingest *abrt_upload_ingest_new(const struct abrt_upload_ingest_settings *settings);
+
+/*
+ * Queues the archive for processing. If the in-memory queue is full, the
+ * archive is appended to the spill file and it is processed later.
+ */
+void abrt_upload_ingest_push(struct abrt_upload_ingest *ingest, const char *name);
+
+void abrt_upload_ingest_get_stats(struct abrt_upload_ingest *ingest, struct abrt_upload_ingest_stats *stats);
+
+/*
+ * Waits for the archives being processed and saves the waiting ones to the
+ * spill file.
+ */
+void abrt_upload_ingest_free(struct abrt_upload_ingest *ingest);
+
+/*
+ * Unpacks the archive in the calling thread, validates the problem
+ * directories found in it and moves them to the dump location.
+ *
+ * @param abrt_gid the group of the problem directories
+ * @returns 0 on success, -1 if the archive was rejected
+ */
+int abrt_upload_ingest_archive(const struct abrt_upload_ingest_settings *settings,
+                               gid_t abrt_gid,
+                               const char *name);
+
+#endif /* ABRT_UPLOAD_INGEST_H */
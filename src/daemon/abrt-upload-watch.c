@@ -19,6 +19,7 @@
 #include <glib/gstdio.h>
 #include <glib-unix.h>
 #include "abrt-inotify.h"
+#include "abrt-upload-ingest.h"
 #include "abrt_glib.h"
 #include "libabrt.h"
 
@@ -27,42 +28,19 @@
 
 #define DEFAULT_COUNT_OF_WORKERS 10
 #define DEFAULT_CACHE_MIB_SIZE 4
+#define DEFAULT_LARGE_ARCHIVE_MIB_SIZE 32
+#define DEFAULT_SMALL_LANE_MIB_BUDGET 256
+#define DEFAULT_LARGE_LANE_MIB_BUDGET 2048
 
-static int g_signal_pipe[2];
-
-struct queue
-{
-    unsigned capacity;
-    GQueue q;
-};
-
-static int
-queue_push(struct queue *queue, char *value)
-{
-    if (g_queue_get_length(&queue->q) >= queue->capacity)
-        return 0;
+#define ABRT_UPLOAD_WATCH_SPILL_FILE VAR_STATE"/abrt-upload-watch.queue"
 
-    g_queue_push_head(&queue->q, value);
-
-    return 1;
-}
-
-static char *
-queue_pop(struct queue *queue)
-{
-    if (g_queue_is_empty(&queue->q))
-        return NULL;
-
-    return (char *)g_queue_pop_tail(&queue->q);
-}
+static int g_signal_pipe[2];
 
 struct process
 {
     GMainLoop *main_loop;
     const char *upload_directory;
-    unsigned children;
-    unsigned max_children;
-    struct queue queue;
+    struct abrt_upload_ingest *ingest;
 };
 
 static void
@@ -72,76 +50,40 @@ process_quit(struct process *proc)
 }
 
 static void
-run_abrt_handle_upload(struct process *proc, const char *name)
+handle_new_path(struct process *proc, const char *name)
 {
-    log_info("Processing file '%s' in directory '%s'", name, proc->upload_directory);
-
-    ++proc->children;
-    log_debug("Running workers: %d", proc->children);
-
-    fflush(NULL); /* paranoia */
-    pid_t pid = fork();
-    if (pid < 0)
-    {
-        --proc->children;
-        perror_msg("fork");
-        return;
-    }
+    log_warning("Detected creation of file '%s' in upload directory '%s'", name, proc->upload_directory);
 
-    if (pid == 0)
-    {
-        /* child */
-        if (g_chdir(proc->upload_directory) != 0)
-            perror_msg_and_die("Could not change working directory to ‘%s’", proc->upload_directory);
-        if (abrt_g_settings_delete_uploaded)
-            execlp("abrt-handle-upload", "abrt-handle-upload", "-d",
-                           abrt_g_settings_dump_location, proc->upload_directory, name, (char*)NULL);
-        else
-            execlp("abrt-handle-upload", "abrt-handle-upload",
-                           abrt_g_settings_dump_location, proc->upload_directory, name, (char*)NULL);
-        perror_msg_and_die("Can't execute '%s'", "abrt-handle-upload");
-    }
+    abrt_upload_ingest_push(proc->ingest, name);
 }
 
 static void
-handle_new_path(struct process *proc, char *name)
+print_stats(struct process *proc)
 {
-    log_warning("Detected creation of file '%s' in upload directory '%s'", name, proc->upload_directory);
-
-    if (proc->children < proc->max_children)
-    {
-        run_abrt_handle_upload(proc, name);
-        g_free(name);
-        return;
-    }
+    struct abrt_upload_ingest_stats stats;
+    abrt_upload_ingest_get_stats(proc->ingest, &stats);
 
-    log_debug("Pushing '%s' to deferred queue", name);
-    if (!queue_push(&proc->queue, name))
+    unsigned queued = stats.spilled;
+    unsigned active = 0;
+    for (unsigned i = 0; i < ABRT_UPLOAD_INGEST_LANE_COUNT; ++i)
     {
-        error_msg(_("No free workers and full buffer. Omitting archive '%s'"), name);
-        g_free(name);
-        return;
+        queued += stats.lanes[i].queued;
+        active += stats.lanes[i].active;
     }
-}
 
-static void
-print_stats(struct process *proc)
-{
     /* this is meant only for debugging, so not marking it as translatable */
-    fprintf(stderr, "%i archives to process, %i active workers\n", g_queue_get_length(&proc->queue.q), proc->children);
-}
+    fprintf(stderr, "%u archives to process, %u active workers, %u spilled to disk\n",
+            queued, active, stats.spilled);
 
-static void
-process_next_in_queue(struct process *proc)
-{
-    g_autofree char *name = queue_pop(&proc->queue);
-    if (!name)
+    for (unsigned i = 0; i < ABRT_UPLOAD_INGEST_LANE_COUNT; ++i)
     {
-        log_debug("Deferred queue is empty. Running workers: %d", proc->children);
-        return;
+        const struct abrt_upload_ingest_lane_stats *lane = &stats.lanes[i];
+        fprintf(stderr, "%s lane: %u waiting, %u active (%llu bytes), %lu taken, wait avg %lld ms, max %lld ms\n",
+                abrt_upload_ingest_lane_name(i), lane->queued, lane->active, (unsigned long long)lane->active_bytes,
+                lane->processed,
+                (long long)(lane->processed ? lane->wait_total / lane->processed / 1000 : 0),
+                (long long)(lane->wait_max / 1000));
     }
-
-    run_abrt_handle_upload(proc, name);
 }
 
 static void
@@ -185,20 +127,11 @@ handle_signal_pipe_cb(GIOChannel *gio, GIOCondition condition, gpointer user_dat
             {
                 print_stats(proc);
             }
-            else if (signals[signo] != SIGCHLD)
+            else
             {
                 process_quit(proc);
                 return FALSE; /* remove this event */
             }
-            else
-            {
-                while (libreport_safe_waitpid(-1, NULL, WNOHANG) > 0)
-                {
-                    --proc->children;
-                    process_next_in_queue(proc);
-                    print_stats(proc);
-                }
-            }
         }
     }
 
@@ -216,7 +149,7 @@ handle_inotify_cb(struct abrt_inotify_watch *watch, struct inotify_event *event,
         if (ext && strcmp(ext + 1, "working") == 0)
             return;
 
-        handle_new_path((struct process *)user_data, g_strdup(event->name));
+        handle_new_path((struct process *)user_data, event->name);
     }
 }
 
@@ -258,11 +191,16 @@ main(int argc, char **argv)
     abrt_init(argv);
     /* Can't keep these strings/structs static: _() doesn't support that */
     const char *program_usage_string = _(
-        "& [-vs] [-w NUM] [-c MiB] [UPLOAD_DIRECTORY]\n"
+        "& [-vs] [-w NUM] [-c MiB] [-L MiB] [-W NUM] [-b MiB] [-B MiB] [-u MiB] [UPLOAD_DIRECTORY]\n"
         "\n"
         "\nWatches UPLOAD_DIRECTORY and unpacks incoming archives into DumpLocation"
         "\nspecified in abrt.conf"
         "\n"
+        "\nArchives of at least -L MiB are unpacked by at most -W workers, so the"
+        "\nrest of the workers keep up with the small ones. The archives being"
+        "\nunpacked at once take at most -b MiB (small) and -B MiB (large); 0 means"
+        "\nno limit"
+        "\n"
         "\nIf UPLOAD_DIRECTORY is not provided, uses a value of"
         "\nWatchCrashdumpArchiveDir option from abrt.conf"
     );
@@ -272,10 +210,20 @@ main(int argc, char **argv)
         OPT_d = 1 << 2,
         OPT_w = 1 << 3,
         OPT_c = 1 << 4,
+        OPT_L = 1 << 5,
+        OPT_W = 1 << 6,
+        OPT_b = 1 << 7,
+        OPT_B = 1 << 8,
+        OPT_u = 1 << 9,
     };
 
     int concurrent_workers = DEFAULT_COUNT_OF_WORKERS;
     int cache_size_mib = DEFAULT_CACHE_MIB_SIZE;
+    int large_archive_mib = DEFAULT_LARGE_ARCHIVE_MIB_SIZE;
+    int large_workers = -1;
+    int small_lane_mib = DEFAULT_SMALL_LANE_MIB_BUDGET;
+    int large_lane_mib = DEFAULT_LARGE_LANE_MIB_BUDGET;
+    int worker_mib = 0;
 
     /* Keep enum above and order of options below in sync! */
     struct options program_options[] = {
@@ -284,6 +232,11 @@ main(int argc, char **argv)
         OPT_BOOL('d', NULL, NULL              , _("Daemonize")),
         OPT_INTEGER('w', NULL, &concurrent_workers, _("Number of concurrent workers. Default is "STRINGIZE(DEFAULT_COUNT_OF_WORKERS))),
         OPT_INTEGER('c', NULL, &cache_size_mib, _("Maximal cache size in MiB. Default is "STRINGIZE(DEFAULT_CACHE_MIB_SIZE))),
+        OPT_INTEGER('L', NULL, &large_archive_mib, _("Size of a large archive in MiB. Default is "STRINGIZE(DEFAULT_LARGE_ARCHIVE_MIB_SIZE))),
+        OPT_INTEGER('W', NULL, &large_workers, _("Number of workers for large archives. Default is a quarter of workers")),
+        OPT_INTEGER('b', NULL, &small_lane_mib, _("Byte budget of small archives being unpacked in MiB. Default is "STRINGIZE(DEFAULT_SMALL_LANE_MIB_BUDGET))),
+        OPT_INTEGER('B', NULL, &large_lane_mib, _("Byte budget of large archives being unpacked in MiB. Default is "STRINGIZE(DEFAULT_LARGE_LANE_MIB_BUDGET))),
+        OPT_INTEGER('u', NULL, &worker_mib, _("Maximal unpacked size of an archive in MiB, 0 means no limit. Default is 0")),
         OPT_END()
     };
     unsigned opts = libreport_parse_opts(argc, argv, program_options, program_usage_string);
@@ -297,12 +250,31 @@ main(int argc, char **argv)
     if (cache_size_mib > UINT_MAX / (1024 * 1024 / FILENAME_MAX))
         error_msg_and_die("Too big cache size. Maximum is : %u MiB", UINT_MAX / (1024 * 1024 / FILENAME_MAX));
 
+    if (large_workers < 0)
+        large_workers = MAX(1, concurrent_workers / 4);
+
+    if (large_workers == 0 || large_workers > concurrent_workers)
+        error_msg_and_die("Invalid number of workers for large archives: %d", large_workers);
+
+    if (large_archive_mib < 0 || small_lane_mib < 0 || large_lane_mib < 0 || worker_mib < 0)
+        error_msg_and_die("Sizes in MiB must not be negative");
+
     struct process proc = {0};
-    proc.max_children = concurrent_workers;
-    /* By default it is about 1024 entries */
-    g_queue_init(&proc.queue.q);
-    proc.queue.capacity = cache_size_mib * (1024 * 1024 / FILENAME_MAX);
-    log_debug("Max queue size %u", proc.queue.capacity);
+    struct abrt_upload_ingest_settings settings = {
+        .work_directory = LARGE_DATA_TMP_DIR,
+        .spill_file = ABRT_UPLOAD_WATCH_SPILL_FILE,
+        .workers = concurrent_workers,
+        /* By default it is about 1024 entries */
+        .capacity = cache_size_mib * (1024 * 1024 / FILENAME_MAX),
+        .large_size = (off_t)large_archive_mib * 1024 * 1024,
+        .large_workers = large_workers,
+        .lane_budget = {
+            [ABRT_UPLOAD_INGEST_LANE_SMALL] = (off_t)small_lane_mib * 1024 * 1024,
+            [ABRT_UPLOAD_INGEST_LANE_LARGE] = (off_t)large_lane_mib * 1024 * 1024,
+        },
+        .worker_budget = (off_t)worker_mib * 1024 * 1024,
+    };
+    log_debug("Max queue size %u", settings.capacity);
 
     argv += optind;
     if (argv[0])
@@ -324,6 +296,10 @@ main(int argc, char **argv)
     if (!proc.upload_directory)
         error_msg_and_die("Neither UPLOAD_DIRECTORY nor WatchCrashdumpArchiveDir was specified");
 
+    settings.upload_directory = proc.upload_directory;
+    settings.dump_location = abrt_g_settings_dump_location;
+    settings.delete_uploaded = abrt_g_settings_delete_uploaded;
+
     if (opts & OPT_d)
         daemonize();
 
@@ -333,6 +309,9 @@ main(int argc, char **argv)
         libreport_logmode = LOGMODE_JOURNAL;
     }
 
+    log_info("Starting %u workers", settings.workers);
+    proc.ingest = abrt_upload_ingest_new(&settings);
+
     log_info("Creating glib main loop");
     proc.main_loop = g_main_loop_new(NULL, FALSE);
 
@@ -352,7 +331,6 @@ main(int argc, char **argv)
     signal(SIGUSR1, handle_signal);
     signal(SIGTERM, handle_signal);
     signal(SIGINT, handle_signal);
-    signal(SIGCHLD, handle_signal);
     GIOChannel *channel_signal = abrt_gio_channel_unix_new(g_signal_pipe[0]);
     guint channel_signal_source_id = g_io_add_watch(channel_signal,
                 G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP | G_IO_NVAL,
@@ -379,6 +357,9 @@ main(int argc, char **argv)
 
     abrt_inotify_watch_destroy(aiw);
 
+    log_info("Waiting for workers");
+    abrt_upload_ingest_free(proc.ingest);
+
     if (proc.main_loop)
         g_main_loop_unref(proc.main_loop);
 
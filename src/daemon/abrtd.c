@@ -172,11 +172,21 @@ static void queue_post_create_process(struct abrt_server_proc *proc)
         /* Move behind '/' */
         ++ignored;
 
+    char *blob_store = g_build_filename(abrt_g_settings_dump_location, ABRT_BLOB_STORE_DIR, NULL);
     char *worst_dir = NULL;
     const double max_size = (double) abrt_g_settings_nMaxCrashReportsSize * (1024 * 1024);
-    while (libreport_get_dirsize_find_largest_dir(abrt_g_settings_dump_location, &worst_dir, ignored, proc->dirname) >= max_size
-           && worst_dir)
+    for (;;)
     {
+        /* Blobs of the deleted directories */
+        abrt_delete_unused_blobs(blob_store);
+
+        if (abrt_get_dirsize_find_largest_dir(abrt_g_settings_dump_location, &worst_dir, ignored, proc->dirname) < max_size
+            || !worst_dir)
+        {
+            g_clear_pointer(&worst_dir, free);
+            break;
+        }
+
         const char *kind = "old";
 
         GList *proc_of_deleted_item = NULL;
@@ -199,6 +209,7 @@ static void queue_post_create_process(struct abrt_server_proc *proc)
         if (dd != NULL)
             dd_delete(dd);
     }
+    g_free(blob_store);
 
 consider_processing:
     /* If the process survived cleaning up the dump location, append it to the
@@ -647,6 +658,8 @@ static void mark_unprocessed_dump_dirs_not_reportable(const char *path)
     {
         if (libreport_dot_or_dotdot(dent->d_name))
             continue; /* skip "." and ".." */
+        if (strcmp(dent->d_name, ABRT_BLOB_STORE_DIR) == 0)
+            continue;
 
         g_autofree char *full_name = g_build_filename(path, dent->d_name, NULL);
 
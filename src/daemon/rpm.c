@@ -43,7 +43,52 @@ typedef struct rpmPubkey_s * rpmPubkey;
 * A set, which contains finger prints.
 */
 
-static GList *list_fingerprints = NULL;
+static GHashTable *trusted_fingerprints = NULL;
+
+/* The packages owning the queried files survive between runs in a cache
+ * shared with abrt-action-list-dsos. Each line holds tab separated fields:
+ * the path followed by CACHE_PACKAGE_FIELDS fields of every package owning
+ * the file, i.e. just the path if no package owns it. The first line
+ * identifies the state of the rpm database the cache was built from, the
+ * whole cache is dropped once the database changes.
+ */
+#define RPM_CACHE_FILE LOCALSTATEDIR"/cache/abrt/rpm_packages"
+#define RPM_CACHE_MAGIC "abrt-rpm-cache 1"
+#define RPM_CACHE_MAX_ENTRIES (64 * 1024)
+
+enum {
+    CACHE_NEVRA,
+    CACHE_NAME,
+    CACHE_EPOCH,
+    CACHE_VERSION,
+    CACHE_RELEASE,
+    CACHE_ARCH,
+    CACHE_VENDOR,
+    CACHE_INSTALLTIME,
+    CACHE_COMPONENT,
+    CACHE_FINGERPRINT,
+    CACHE_PACKAGE_FIELDS,
+};
+
+/* Path -> NULL terminated array of its fields without the path */
+static GHashTable *rpm_cache;
+/* Package name -> fingerprint, "" if the package isn't signed */
+static GHashTable *rpm_cache_fingerprints;
+static char *rpm_cache_stamp;
+static bool rpm_cache_dirty;
+
+/* The signing key of a package doesn't change while its header stays the
+ * same, the cache of the keys survives updates of other packages. Each line
+ * holds the SHA256 digest of a header and the key, empty if the package isn't
+ * signed.
+ */
+#define FINGERPRINT_CACHE_FILE LOCALSTATEDIR"/cache/abrt/rpm_fingerprints"
+#define FINGERPRINT_CACHE_MAGIC "abrt-rpm-fingerprints 1"
+#define FINGERPRINT_CACHE_MAX_ENTRIES (16 * 1024)
+
+/* Header digest -> fingerprint */
+static GHashTable *fingerprint_cache;
+static bool fingerprint_cache_dirty;
 
 /* cuts the name from the NVR format: foo-1.2.3-1.el6
    returns a newly allocated string
@@ -76,21 +121,339 @@ void rpm_init()
         error_msg("Can't read RPM rc files");
 #endif
 
-    g_list_free_full(list_fingerprints, free);
-    /* Huh? Why do we start the list with an element with NULL string? */
-    list_fingerprints = g_list_alloc();
+    if (trusted_fingerprints)
+        g_hash_table_destroy(trusted_fingerprints);
+    trusted_fingerprints = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+}
+
+#ifdef HAVE_LIBRPM
+/* The modification time of the newest file of the rpm database */
+static char *get_rpmdb_stamp(void)
+{
+    g_autofree char *dbpath = rpmGetPath("%{_dbpath}", NULL);
+    DIR *d = opendir(dbpath);
+    if (!d)
+        return NULL;
+
+    struct stat st;
+    struct timespec newest = { 0 };
+    if (fstat(dirfd(d), &st) == 0)
+        newest = st.st_mtim;
+
+    struct dirent *dent;
+    while ((dent = readdir(d)) != NULL)
+    {
+        if (libreport_dot_or_dotdot(dent->d_name)
+         || fstatat(dirfd(d), dent->d_name, &st, 0) != 0)
+            continue;
+        if (st.st_mtim.tv_sec > newest.tv_sec
+         || (st.st_mtim.tv_sec == newest.tv_sec && st.st_mtim.tv_nsec > newest.tv_nsec))
+            newest = st.st_mtim;
+    }
+    closedir(d);
+
+    return g_strdup_printf("%s %lld.%09ld", dbpath, (long long)newest.tv_sec, (long)newest.tv_nsec);
+}
+
+static bool is_cacheable(const char *str)
+{
+    return strpbrk(str, "\t\n") == NULL;
+}
+
+static void cache_add_fingerprint(char **fields)
+{
+    if (fields[0] != NULL)
+        g_hash_table_insert(rpm_cache_fingerprints, g_strdup(fields[CACHE_NAME]), g_strdup(fields[CACHE_FINGERPRINT]));
+}
+
+/* Opens a cache and checks its first line is HEADER. The caches decide
+ * which package is blamed, only our own ones are trusted.
+ */
+static FILE *open_cache(const char *file_name, const char *header)
+{
+    FILE *fp = fopen(file_name, "r");
+    if (!fp)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fileno(fp), &st) != 0 || st.st_uid != geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH)))
+    {
+        log_notice("Ignoring '%s' with wrong owner or mode", file_name);
+        fclose(fp);
+        return NULL;
+    }
+
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len = getline(&line, &size, fp);
+    if (len > 0 && line[len - 1] == '\n')
+        line[--len] = '\0';
+    bool valid = len > 0 && strcmp(line, header) == 0;
+    free(line);
+    if (!valid)
+    {
+        log_info("Dropping outdated '%s'", file_name);
+        fclose(fp);
+        return NULL;
+    }
+
+    return fp;
+}
+
+/* Calls ADD_LINE for every line of the cache split to tab separated fields */
+static void read_cache(FILE *fp, void (*add_line)(char **fields))
+{
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    while ((len = getline(&line, &size, fp)) > 0)
+    {
+        if (line[len - 1] != '\n')
+            break;
+        line[len - 1] = '\0';
+        add_line(g_strsplit(line, "\t", -1));
+    }
+    free(line);
+    fclose(fp);
+}
+
+/* Atomically replaces the cache by HEADER and the lines of TABLE, a key and
+ * the NULL terminated array of fields or a single string each.
+ */
+static void save_cache(const char *file_name, const char *header, GHashTable *table, bool strv_values)
+{
+    g_autofree char *dir = g_path_get_dirname(file_name);
+    if (g_mkdir_with_parents(dir, 0755) != 0)
+    {
+        log_info("Can't create '%s': %s", dir, strerror(errno));
+        return;
+    }
+
+    g_autofree char *tmp_name = g_strdup_printf("%s.XXXXXX", file_name);
+    int fd = mkstemp(tmp_name);
+    if (fd < 0)
+    {
+        log_info("Can't create '%s': %s", tmp_name, strerror(errno));
+        return;
+    }
+
+    FILE *fp = fdopen(fd, "w");
+    fprintf(fp, "%s\n", header);
+
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, table);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        fputs(key, fp);
+        if (strv_values)
+        {
+            for (char **field = value; *field; ++field)
+                fprintf(fp, "\t%s", *field);
+        }
+        else
+            fprintf(fp, "\t%s", (char *)value);
+        fputc('\n', fp);
+    }
+
+    if (fchmod(fd, 0644) != 0 || fclose(fp) != 0 || rename(tmp_name, file_name) != 0)
+    {
+        perror_msg("Can't save '%s'", file_name);
+        unlink(tmp_name);
+    }
+}
+
+static void add_package_line(char **fields)
+{
+    if ((g_strv_length(fields) - 1) % CACHE_PACKAGE_FIELDS != 0)
+    {
+        g_strfreev(fields);
+        return;
+    }
+    /* Steal the path, the table maps it to the package fields */
+    char *path = fields[0];
+    memmove(fields, fields + 1, g_strv_length(fields) * sizeof(*fields));
+    cache_add_fingerprint(fields);
+    g_hash_table_replace(rpm_cache, path, fields);
+}
+
+static char *rpm_cache_header(void)
+{
+    return g_strdup_printf("%s\t%s", RPM_CACHE_MAGIC, rpm_cache_stamp);
+}
+
+static void load_rpm_cache(void)
+{
+    rpm_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_strfreev);
+    rpm_cache_fingerprints = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    rpm_cache_stamp = get_rpmdb_stamp();
+    if (!rpm_cache_stamp)
+        return;
+
+    g_autofree char *header = rpm_cache_header();
+    FILE *fp = open_cache(RPM_CACHE_FILE, header);
+    if (!fp)
+    {
+        /* Replace the outdated one */
+        rpm_cache_dirty = true;
+        return;
+    }
+    read_cache(fp, add_package_line);
+
+    if (g_hash_table_size(rpm_cache) >= RPM_CACHE_MAX_ENTRIES)
+    {
+        log_info("The package cache is full, dropping it");
+        g_hash_table_remove_all(rpm_cache);
+        rpm_cache_dirty = true;
+    }
+}
+
+static void add_fingerprint_line(char **fields)
+{
+    if (g_strv_length(fields) == 2)
+        g_hash_table_replace(fingerprint_cache, g_strdup(fields[0]), g_strdup(fields[1]));
+    g_strfreev(fields);
+}
+
+static void load_fingerprint_cache(void)
+{
+    fingerprint_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    FILE *fp = open_cache(FINGERPRINT_CACHE_FILE, FINGERPRINT_CACHE_MAGIC);
+    if (fp)
+        read_cache(fp, add_fingerprint_line);
+
+    if (g_hash_table_size(fingerprint_cache) >= FINGERPRINT_CACHE_MAX_ENTRIES)
+    {
+        log_info("The fingerprint cache is full, dropping it");
+        g_hash_table_remove_all(fingerprint_cache);
+        fingerprint_cache_dirty = true;
+    }
+}
+
+static char *get_header_fingerprint(Header header)
+{
+    const char *errmsg = NULL;
+    /* Packages built by ancient rpm have no digest */
+    g_autofree char *digest = headerFormat(header, "%|SHA256HEADER?{%{SHA256HEADER}}|", &errmsg);
+    if (digest && digest[0] && is_cacheable(digest))
+    {
+        if (!fingerprint_cache)
+            load_fingerprint_cache();
+
+        const char *cached = g_hash_table_lookup(fingerprint_cache, digest);
+        if (cached)
+            return cached[0] ? g_strdup(cached) : NULL;
+    }
+    else
+        g_clear_pointer(&digest, free);
+
+    char *fingerprint = NULL;
+    g_autofree char *pgpsig = headerFormat(header, "%|SIGGPG?{%{SIGGPG:pgpsig}}:{%{SIGPGP:pgpsig}}|", &errmsg);
+    if (!pgpsig)
+    {
+        log_notice("cannot get siggpg:pgpsig. reason: %s",
+                   errmsg ? errmsg : "unknown");
+        return NULL;
+    }
+
+    char *pgpsig_tmp = strstr(pgpsig, " Key ID ");
+    if (pgpsig_tmp)
+        fingerprint = g_strdup(pgpsig_tmp + sizeof(" Key ID ") - 1);
+
+    if (digest && (!fingerprint || is_cacheable(fingerprint)))
+    {
+        g_hash_table_replace(fingerprint_cache, g_steal_pointer(&digest), g_strdup(fingerprint ? fingerprint : ""));
+        fingerprint_cache_dirty = true;
+    }
+
+    return fingerprint;
+}
+
+/* Returns the fields of the package HEADER owning FILENAME, which are stored
+ * in the cache if CACHE is set. HEADER is NULL if no package owns the file.
+ */
+static char **get_header_fields(const char *filename, Header header, bool cache)
+{
+    char **fields = g_new0(char *, CACHE_PACKAGE_FIELDS + 1);
+    if (header)
+    {
+        static const char *const formats[] = {
+            [CACHE_NEVRA] = "%{NEVRA}",
+            [CACHE_NAME] = "%{NAME}",
+            [CACHE_EPOCH] = "%{EPOCH}",
+            [CACHE_VERSION] = "%{VERSION}",
+            [CACHE_RELEASE] = "%{RELEASE}",
+            [CACHE_ARCH] = "%{ARCH}",
+            [CACHE_VENDOR] = "%{VENDOR}",
+            [CACHE_INSTALLTIME] = "%{INSTALLTIME}",
+            [CACHE_COMPONENT] = "%{SOURCERPM}",
+        };
+        for (int i = 0; i < CACHE_FINGERPRINT; ++i)
+        {
+            const char *errmsg = NULL;
+            fields[i] = headerFormat(header, formats[i], &errmsg);
+            if (!fields[i])
+            {
+                error_msg("cannot get %s: %s", formats[i], errmsg ? errmsg : "unknown");
+                g_strfreev(fields);
+                return NULL;
+            }
+        }
+        char *srpm = fields[CACHE_COMPONENT];
+        fields[CACHE_COMPONENT] = get_package_name_from_NVR_or_NULL(srpm);
+        free(srpm);
+        fields[CACHE_FINGERPRINT] = get_header_fingerprint(header);
+        if (!fields[CACHE_FINGERPRINT])
+            fields[CACHE_FINGERPRINT] = g_strdup("");
+
+        for (int i = 0; i < CACHE_PACKAGE_FIELDS; ++i)
+        {
+            if (!is_cacheable(fields[i]))
+                return fields;
+        }
+    }
+
+    if (cache && is_cacheable(filename))
+    {
+        char **cached = g_strdupv(fields);
+        cache_add_fingerprint(cached);
+        g_hash_table_replace(rpm_cache, g_strdup(filename), cached);
+        rpm_cache_dirty = true;
+    }
+
+    return fields;
 }
+#endif
 
 void rpm_destroy()
 {
 #ifdef HAVE_LIBRPM
+    if (rpm_cache)
+    {
+        if (rpm_cache_dirty && rpm_cache_stamp)
+        {
+            g_autofree char *header = rpm_cache_header();
+            save_cache(RPM_CACHE_FILE, header, rpm_cache, /*strv_values:*/ true);
+        }
+        g_clear_pointer(&rpm_cache, g_hash_table_destroy);
+        g_clear_pointer(&rpm_cache_fingerprints, g_hash_table_destroy);
+        g_clear_pointer(&rpm_cache_stamp, g_free);
+    }
+    if (fingerprint_cache)
+    {
+        if (fingerprint_cache_dirty)
+            save_cache(FINGERPRINT_CACHE_FILE, FINGERPRINT_CACHE_MAGIC, fingerprint_cache, /*strv_values:*/ false);
+        g_clear_pointer(&fingerprint_cache, g_hash_table_destroy);
+    }
+
     /* Mirroring the order of deinit calls in rpm-4.11.1/lib/poptALL.c::rpmcliFini() */
     rpmFreeCrypto();
     rpmFreeMacros(NULL);
     rpmFreeRpmrc();
 #endif
 
-    g_list_free_full(g_steal_pointer(&list_fingerprints), free);
+    g_clear_pointer(&trusted_fingerprints, g_hash_table_destroy);
 }
 
 
@@ -115,7 +478,7 @@ void rpm_load_gpgkey(const char* filename)
     {
         fingerprint = rpmhex(pubkey->keyid, sizeof(pubkey->keyid));
         if (fingerprint != NULL)
-            list_fingerprints = g_list_append(list_fingerprints, fingerprint);
+            g_hash_table_add(trusted_fingerprints, fingerprint);
 
         subkeys = rpmGetSubkeys(pubkey, &subkeysCount);
         for (int i = 0; i < subkeysCount; i++)
@@ -125,7 +488,7 @@ void rpm_load_gpgkey(const char* filename)
             {
                 fingerprint = rpmhex(subkey->keyid, sizeof(subkey->keyid));
                 if (fingerprint != NULL)
-                    list_fingerprints = g_list_append(list_fingerprints, fingerprint);
+                    g_hash_table_add(trusted_fingerprints, fingerprint);
             }
             rpmPubkeyFree(subkey);
         }
@@ -147,36 +510,26 @@ int rpm_chk_fingerprint(const char* pkg)
 
 int rpm_fingerprint_is_imported(const char* fingerprint)
 {
-    return !!g_list_find_custom(list_fingerprints, fingerprint, (GCompareFunc)g_strcmp0);
+    return trusted_fingerprints && g_hash_table_contains(trusted_fingerprints, fingerprint);
 }
 
 char *rpm_get_fingerprint(const char *pkg)
 {
 #ifdef HAVE_LIBRPM
+    /* Known from the package of a cached file */
+    const char *cached;
+    if (rpm_cache_fingerprints && (cached = g_hash_table_lookup(rpm_cache_fingerprints, pkg)))
+        return cached[0] ? g_strdup(cached) : NULL;
+
     char *fingerprint = NULL;
-    g_autofree char *pgpsig = NULL;
-    const char *errmsg = NULL;
 
     rpmts ts = rpmtsCreate();
     rpmdbMatchIterator iter = rpmtsInitIterator(ts, RPMTAG_NAME, pkg, 0);
     Header header = rpmdbNextIterator(iter);
 
-    if (!header)
-        goto error;
+    if (header)
+        fingerprint = get_header_fingerprint(header);
 
-    pgpsig = headerFormat(header, "%|SIGGPG?{%{SIGGPG:pgpsig}}:{%{SIGPGP:pgpsig}}|", &errmsg);
-    if (!pgpsig)
-    {
-        log_notice("cannot get siggpg:pgpsig. reason: %s",
-                   errmsg ? errmsg : "unknown");
-        goto error;
-    }
-
-    char *pgpsig_tmp = strstr(pgpsig, " Key ID ");
-    if (pgpsig_tmp)
-        fingerprint = g_strdup(pgpsig_tmp + sizeof(" Key ID ") - 1);
-
-error:
     rpmdbFreeIterator(iter);
     rpmtsFree(ts);
     return fingerprint;
@@ -261,11 +614,26 @@ static int rpm_query_file(rpmts *ts, rpmdbMatchIterator *iter, Header *header,
 }
 #endif
 
-char* rpm_get_component(const char *filename, const char *rootdir_or_NULL)
-{
 #ifdef HAVE_LIBRPM
-    char *ret = NULL;
-    g_autofree char *srpm = NULL;
+/* Returns the fields of the package owning FILENAME, an empty array if no
+ * package owns it or NULL on error. Files of the host are looked up in
+ * the cache first.
+ */
+static char **rpm_get_package_fields(const char *filename, const char *rootdir_or_NULL)
+{
+    if (!rootdir_or_NULL)
+    {
+        if (!rpm_cache)
+            load_rpm_cache();
+
+        char **cached = g_hash_table_lookup(rpm_cache, filename);
+        if (cached)
+        {
+            log_debug("Package of '%s' found in the cache", filename);
+            return g_strdupv(cached);
+        }
+    }
+
     rpmts ts;
     rpmdbMatchIterator iter;
     Header header;
@@ -273,76 +641,38 @@ char* rpm_get_component(const char *filename, const char *rootdir_or_NULL)
     if (rpm_query_file(&ts, &iter, &header, filename, rootdir_or_NULL) < 0)
         return NULL;
 
-    if (!header)
-        goto error;
+    char **fields = get_header_fields(filename, header, /*cache:*/ !rootdir_or_NULL);
 
-    const char *errmsg = NULL;
-    srpm = headerFormat(header, "%{SOURCERPM}", &errmsg);
-    if (!srpm && errmsg)
-    {
-        error_msg("cannot get srpm. reason: %s", errmsg);
-        goto error;
-    }
-
-    ret = get_package_name_from_NVR_or_NULL(srpm);
-
- error:
     rpmdbFreeIterator(iter);
     rpmtsFree(ts);
-    return ret;
-#else
-    return NULL;
-#endif
+    return fields;
 }
+#endif
 
+char* rpm_get_component(const char *filename, const char *rootdir_or_NULL)
+{
 #ifdef HAVE_LIBRPM
-#define pkg_add_id(name)                                                \
-    static inline int pkg_add_##name(Header header, struct pkg_nevra *p) \
-    {                                                                   \
-        const char *errmsg = NULL;                                      \
-        p->p_##name = headerFormat(header, "%{"#name"}", &errmsg);      \
-        if (p->p_##name || !errmsg)                                     \
-            return 0;                                                   \
-                                                                        \
-        error_msg("cannot get "#name": %s", errmsg);                    \
-                                                                        \
-        return -1;                                                      \
-    }                                                                   \
-
-pkg_add_id(name);
-pkg_add_id(epoch);
-pkg_add_id(version);
-pkg_add_id(release);
-pkg_add_id(arch);
-pkg_add_id(vendor);
+    g_auto(GStrv) fields = rpm_get_package_fields(filename, rootdir_or_NULL);
+    if (!fields || !fields[0])
+        return NULL;
+
+    return g_strdup(fields[CACHE_COMPONENT]);
+#else
+    return NULL;
 #endif
+}
 
 // caller is responsible to free returned value
 struct pkg_nevra *rpm_get_package_nvr(const char *filename, const char *rootdir_or_NULL)
 {
 #ifdef HAVE_LIBRPM
-    rpmts ts;
-    rpmdbMatchIterator iter;
-    Header header;
-
-    struct pkg_nevra *p = NULL;
-
-    if (rpm_query_file(&ts, &iter, &header, filename, rootdir_or_NULL) < 0)
+    g_auto(GStrv) fields = rpm_get_package_fields(filename, rootdir_or_NULL);
+    if (!fields || !fields[0])
         return NULL;
 
-    if (!header)
-        goto error;
-
-    p = g_new0(struct pkg_nevra, 1);
-    int r;
-
-    r = pkg_add_name(header, p);
-    if (r)
-        goto error;
-
-    r = pkg_add_epoch(header, p);
-    if (r)
-        goto error;
+    struct pkg_nevra *p = g_new0(struct pkg_nevra, 1);
+    p->p_name = g_strdup(fields[CACHE_NAME]);
+    p->p_epoch = g_strdup(fields[CACHE_EPOCH]);
    /*
     * <npajkovs> hello, what's the difference between epoch '0' and  '(none)'?
     * <Panu> nothing really, a missing epoch is considered equal to zero epoch
@@ -352,38 +682,17 @@ struct pkg_nevra *rpm_get_package_nvr(const char *filename, const char *rootdir_
         free(p->p_epoch);
         p->p_epoch = g_strdup("0");
     }
-
-    r = pkg_add_version(header, p);
-    if (r)
-        goto error;
-
-    r = pkg_add_release(header, p);
-    if (r)
-        goto error;
-
-    r = pkg_add_arch(header, p);
-    if (r)
-        goto error;
-
-    r = pkg_add_vendor(header, p);
-    if (r)
-        goto error;
+    p->p_version = g_strdup(fields[CACHE_VERSION]);
+    p->p_release = g_strdup(fields[CACHE_RELEASE]);
+    p->p_arch = g_strdup(fields[CACHE_ARCH]);
+    p->p_vendor = g_strdup(fields[CACHE_VENDOR]);
 
     if (strcmp(p->p_epoch, "0") == 0)
         p->p_nvr = g_strdup_printf("%s-%s-%s", p->p_name, p->p_version, p->p_release);
     else
         p->p_nvr = g_strdup_printf("%s-%s:%s-%s", p->p_name, p->p_epoch, p->p_version, p->p_release);
 
-    rpmdbFreeIterator(iter);
-    rpmtsFree(ts);
     return p;
-
- error:
-    free_pkg_nevra(p);
-
-    rpmdbFreeIterator(iter);
-    rpmtsFree(ts);
-    return NULL;
 #else
     return NULL;
 #endif
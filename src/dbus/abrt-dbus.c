@@ -491,7 +491,10 @@ static void handle_method_call(GDBusConnection *connection,
             return;
         }
 
-        int chown_res = dd_chown(dd, caller_uid);
+        /* The new owner must not get the copies shared with other problems */
+        int chown_res = abrt_unshare_problem_elements(dd);
+        if (chown_res == 0)
+            chown_res = dd_chown(dd, caller_uid);
         if (chown_res != 0)
             g_dbus_method_invocation_return_dbus_error(invocation,
                                               "org.freedesktop.problems.ChownError",
@@ -633,7 +636,7 @@ static void handle_method_call(GDBusConnection *connection,
         const double requested_size = (double)strlen(value) - item_size;
         /* Don't want to check the size limit in case of reducing of size */
         if (requested_size > 0
-            && requested_size > (max_dir_size - libreport_get_dirsize(abrt_g_settings_dump_location)))
+            && requested_size > (max_dir_size - abrt_get_dirsize_find_largest_dir(abrt_g_settings_dump_location, NULL, NULL, NULL)))
         {
             log_notice("No problem space left in '%s' (requested Bytes %f)", problem_id, requested_size);
             g_dbus_method_invocation_return_dbus_error(invocation,
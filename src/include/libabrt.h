@@ -20,6 +20,10 @@
 #undef ARRAY_SIZE
 #define ARRAY_SIZE(x) ((unsigned)(sizeof(x) / sizeof((x)[0])))
 
+/* Number of occurrences which were not saved due to throttling; abrt-server
+ * adds it to FILENAME_COUNT */
+#define FILENAME_SUPPRESSED_COUNT "suppressed_count"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -43,11 +47,149 @@ void abrt_trim_problem_dirs(const char *dirname, double cap_size, const char *ex
 void abrt_ensure_writable_dir_uid_gid(const char *dir, mode_t mode, uid_t uid, gid_t gid);
 void abrt_ensure_writable_dir(const char *dir, mode_t mode, const char *user);
 void abrt_ensure_writable_dir_group(const char *dir, mode_t mode, const char *user, const char *group);
+/* Lists the modules of the core in the format of eu-unstrip -n --core */
 char *abrt_run_unstrip_n(const char *dump_dir_name, unsigned timeout_sec);
+
+/* Random access to the core of a problem directory without unpacking it */
+struct abrt_core_file;
+/* Opens coredump or, if it wasn't unpacked, coredump.zst in the seekable
+ * format. Returns NULL if there is neither.
+ */
+struct abrt_core_file *abrt_core_file_open(const char *dump_dir_name);
+/* Takes ownership of FD, whose contents are read as they are */
+struct abrt_core_file *abrt_core_file_open_fd(int fd);
+void abrt_core_file_close(struct abrt_core_file *core);
+/* Tells whether FD is a zstd compressed core in the seekable format */
+bool abrt_core_file_is_seekable(int fd);
+/* Reads exactly SIZE bytes at OFFSET of the uncompressed core */
+bool abrt_core_file_read(struct abrt_core_file *core, void *buf, size_t size, unsigned long long offset);
+enum {
+    /* The core read by abrt_core_file_compress_seekable() is zstd compressed */
+    ABRT_CORE_SOURCE_ZSTD = 1 << 0,
+};
+/* Compresses the core read from SRC_FD into DST_FD in the seekable format
+ * abrt_core_file_open() reads, at zstd LEVEL (0 is the default of zstd)
+ * using THREADS threads. Returns 0 on success.
+ */
+int abrt_core_file_compress_seekable(int src_fd, int dst_fd, int flags, int level, unsigned threads);
+
+struct abrt_core_module
+{
+    unsigned long long start;
+    unsigned long long size;
+    /* Hexadecimal, NULL if the module has none */
+    char *build_id;
+    unsigned long long build_id_addr;
+    /* NULL for the vdso */
+    char *file_name;
+    bool is_executable;
+};
+void abrt_core_module_free(struct abrt_core_module *module);
+/* Reads the modules of the core from its NT_FILE and NT_AUXV notes and
+ * the ELF headers of the modules, which are taken from the core or from
+ * the mapped files if the core doesn't have them. Returns an array of
+ * struct abrt_core_module in the order eu-unstrip -n prints them (the order
+ * of the dynamic linker's link map) or NULL if the file isn't a core of this
+ * machine.
+ */
+GPtrArray *abrt_core_get_modules(struct abrt_core_file *core);
 char *abrt_get_backtrace(struct dump_dir *dd, unsigned timeout_sec, const char *debuginfo_dirs);
+/* Runs gdb commands in the gdb session shared by the analyzers of the problem
+ * directory, starting the session if needed. Returns NULL if the event didn't
+ * ask for a session (ABRT_GDB_SESSION is not set) or if it can't be used.
+ */
+char *abrt_gdb_session_execute(struct dump_dir *dd, const char *const *commands, unsigned timeout_sec);
 
 bool abrt_dir_is_in_dump_location(const char *dir_name);
 
+/* Directory of the dump location holding the element files shared by problem
+ * directories. It isn't a problem directory.
+ */
+#define ABRT_BLOB_STORE_DIR ".blobs"
+/* Replaces the elements of DD which are usually identical in many problem
+ * directories (os_release, dso_list, ...) by hard links to single copies kept
+ * in BLOB_STORE. The last link of a copy is removed by
+ * abrt_delete_unused_blobs().
+ */
+void abrt_share_problem_elements(struct dump_dir *dd, const char *blob_store);
+/* Gives DD private copies of its shared elements, e.g. before changing their
+ * owner. Returns 0 on success.
+ */
+int abrt_unshare_problem_elements(struct dump_dir *dd);
+void abrt_delete_unused_blobs(const char *blob_store);
+/* Same as libreport_get_dirsize_find_largest_dir() but a shared file is
+ * counted only once and the blob store is never the worst directory.
+ */
+double abrt_get_dirsize_find_largest_dir(const char *path, char **worst_dir,
+                                         const char *excluded, const char *excluded2);
+
+/* Rules of libreport's report_event.conf, loaded by abrt to run independent
+ * steps of an event concurrently. A rule declares the elements its command
+ * reads and writes by lines of the command:
+ *
+ *     #@reads ELEMENT...
+ *     #@writes ELEMENT...
+ *
+ * The rules which don't declare their elements run alone.
+ */
+struct abrt_event_rules;
+struct abrt_event_rules *abrt_event_rules_load(const char *conf_file);
+void abrt_event_rules_free(struct abrt_event_rules *rules);
+/* Returns true if a rule of EVENT declares its elements */
+bool abrt_event_rules_have_declared_step(struct abrt_event_rules *rules, const char *event);
+/* Returns true if a file the rules were loaded from was changed, added
+ * or removed since the load */
+bool abrt_event_rules_changed(struct abrt_event_rules *rules);
+
+/* The callbacks have the meaning of those of libreport's run_event_state */
+struct abrt_event_run_state
+{
+    /* The maximum number of steps running at once */
+    unsigned max_workers;
+    /* The number of started steps */
+    int children_count;
+    /* Called after a step succeeded when no other step runs */
+    int (*post_run_callback)(const char *dump_dir_name, void *param);
+    void *post_run_param;
+    char *(*logging_callback)(char *log_line, void *param);
+    void *logging_param;
+};
+/* Runs the steps of EVENT in the order of the rules, starting a declared step
+ * while the previous ones run if they don't touch its elements. Returns
+ * the exit code of the first failed step or the first nonzero return value
+ * of post_run_callback, 0 if all steps succeeded. No step is started after
+ * a failure.
+ */
+int abrt_run_event_steps(struct abrt_event_rules *rules, struct abrt_event_run_state *state,
+                         const char *dump_dir_name, const char *event);
+
+/* The event runner, abrt-handle-event --serve, runs the events abrt-server
+ * requests over a unix socket */
+struct abrt_event_run_request
+{
+    const char *event;
+    const char *dump_dir_name;
+    /* The increment of the nice value */
+    int nice;
+    /* NAME=VALUE strings, exported already when the callback runs */
+    GPtrArray *env;
+};
+/* Returns the exit code of the event */
+typedef int (*abrt_event_runner_callback)(const struct abrt_event_run_request *request, void *param);
+/* Sends a request to the runner listening on SOCKET_PATH. NICE and ENV_VEC
+ * may be NULL. Returns the socket the output of the event and its wait status
+ * are read from, or -1 if the runner can't be reached.
+ */
+int abrt_event_runner_request(const char *socket_path, const char *event, const char *dump_dir_name,
+                              const char *nice, char **env_vec);
+/* Reads a request from FD, refusing it unless it comes from ALLOWED_UID
+ * within TIMEOUT_SEC seconds. RUN runs the event in a child with its output
+ * going to FD, then the wait status of the child is sent. Returns 0 if
+ * the event was run.
+ */
+int abrt_event_runner_handle_request(int fd, uid_t allowed_uid, unsigned timeout_sec,
+                                     abrt_event_runner_callback run, void *param);
+
 enum {
     DD_PERM_EVENTS  = 1 << 0,
     DD_PERM_DAEMONS = 1 << 1,
@@ -63,10 +205,14 @@ extern bool          abrt_g_settings_autoreporting;
 extern char *        abrt_g_settings_autoreporting_event;
 extern bool          abrt_g_settings_shortenedreporting;
 extern bool          abrt_g_settings_explorechroots;
+extern bool          abrt_g_settings_share_elements;
+extern unsigned int  abrt_g_settings_event_step_workers;
 extern unsigned int  abrt_g_settings_debug_level;
 
 
 int abrt_load_abrt_conf(void);
+/* Returns true if abrt.conf was changed since abrt_load_abrt_conf() */
+bool abrt_abrt_conf_changed(void);
 void abrt_free_abrt_conf_data(void);
 
 int abrt_load_abrt_conf_file(const char *file, GHashTable *settings);
@@ -122,6 +268,44 @@ struct abrt_koops_line_info {
 };
 
 void abrt_koops_extract_oopses_from_lines(GList **oops_list, const struct abrt_koops_line_info *lines_info, int lines_info_size);
+/* The state of the oops parser at the first line it looks at which is not
+ * before a given line */
+struct abrt_koops_parser_state {
+    int line;
+    int oopsstart;
+    int inbacktrace;
+    char prevlevel;
+};
+/**
+ * Same as abrt_koops_extract_oopses_from_lines() but records only oopses
+ * starting at a line from the half-open range [begin, end). An oops starting
+ * in the range is followed past 'end' until its last line.
+ *
+ * The parser state at 'begin' is rebuilt by replaying a bounded number of
+ * preceding lines. That is usually, but not always, the state a single
+ * abrt_koops_extract_oopses_from_lines() call would have there: a chain of
+ * oopses longer than the replayed lines can be parsed differently.
+ *
+ * The states at 'begin' and 'end' are stored in begin_state and end_state if
+ * they are not NULL. Consecutive ranges are parsed as a single call would
+ * parse them if the end_state of each range equals the begin_state of the
+ * following one (see abrt_koops_parser_states_equal()).
+ */
+void abrt_koops_extract_oopses_from_lines_range(GList **oops_list, const struct abrt_koops_line_info *lines_info, int lines_info_size,
+                                                int begin, int end,
+                                                struct abrt_koops_parser_state *begin_state,
+                                                struct abrt_koops_parser_state *end_state);
+bool abrt_koops_parser_states_equal(const struct abrt_koops_parser_state *a, const struct abrt_koops_parser_state *b);
+/**
+ * Splits buffer into lines and returns the number of kernel lines stored in
+ * *lines_info (the caller frees it). Syslog lines from other programs and
+ * other hosts are skipped, the log level prefix and the jiffies time stamp
+ * are removed. The buffer is modified and lines_info points into it.
+ *
+ * If abrt's own "kernel oopses to Abrt" marker is found, the lines preceding
+ * the marker are discarded and *marker_seen is set to true.
+ */
+int abrt_koops_split_lines(char *buffer, size_t buflen, struct abrt_koops_line_info **lines_info, bool *marker_seen);
 void abrt_koops_extract_oopses(GList **oops_list, char *buffer, size_t buflen);
 GList *abrt_koops_suspicious_strings_list(void);
 GList *abrt_koops_suspicious_strings_blacklist(void);
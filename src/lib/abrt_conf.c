@@ -28,8 +28,13 @@ bool          abrt_g_settings_autoreporting = 0;
 char *        abrt_g_settings_autoreporting_event = NULL;
 bool          abrt_g_settings_shortenedreporting = 0;
 bool          abrt_g_settings_explorechroots = 0;
+bool          abrt_g_settings_share_elements = 0;
+unsigned int  abrt_g_settings_event_step_workers = 4;
 unsigned int  abrt_g_settings_debug_level = 0;
 
+/* The modification time of abrt.conf at the last load */
+static struct timespec abrt_conf_mtime;
+
 void abrt_free_abrt_conf_data()
 {
     free(abrt_g_settings_sWatchCrashdumpArchiveDir);
@@ -143,6 +148,30 @@ static void ParseCommon(GHashTable *settings, const char *conf_filename)
     else
         abrt_g_settings_explorechroots = false;
 
+    value = g_hash_table_lookup(settings, "ShareProblemElements");
+    if (value)
+    {
+        abrt_g_settings_share_elements = libreport_string_to_bool((char *)value);
+        g_hash_table_remove(settings, "ShareProblemElements");
+    }
+    else
+        abrt_g_settings_share_elements = false;
+
+    value = g_hash_table_lookup(settings, "EventStepWorkers");
+    if (value)
+    {
+        char *end;
+        errno = 0;
+        unsigned long ul = strtoul((char *)value, &end, 10);
+        if (errno || end == value || *end != '\0' || ul < 1 || ul > 64)
+            error_msg("Error parsing %s setting: '%s'", "EventStepWorkers", (char *)value);
+        else
+            abrt_g_settings_event_step_workers = ul;
+        g_hash_table_remove(settings, "EventStepWorkers");
+    }
+    else
+        abrt_g_settings_event_step_workers = 4;
+
     value = g_hash_table_lookup(settings, "DebugLevel");
     if (value)
     {
@@ -171,10 +200,27 @@ static const char *get_abrt_conf_file_name(void)
     return abrt_conf == NULL ? ABRT_CONF : abrt_conf;
 }
 
+static const char *get_abrt_conf_dir(void)
+{
+    const char *const env_conf_dir = getenv("ABRT_CONF_DIR");
+    return env_conf_dir == NULL ? CONF_DIR : env_conf_dir;
+}
+
+static struct timespec get_abrt_conf_mtime(void)
+{
+    struct timespec mtime = { 0, 0 };
+    g_autofree char *path = g_build_filename(get_abrt_conf_dir(), get_abrt_conf_file_name(), NULL);
+    struct stat st;
+    if (stat(path, &st) == 0)
+        mtime = st.st_mtim;
+    return mtime;
+}
+
 int abrt_load_abrt_conf()
 {
     abrt_free_abrt_conf_data();
 
+    abrt_conf_mtime = get_abrt_conf_mtime();
     const char *const abrt_conf = get_abrt_conf_file_name();
     g_autoptr(GHashTable) settings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
     if (!abrt_load_abrt_conf_file(abrt_conf, settings))
@@ -185,11 +231,16 @@ int abrt_load_abrt_conf()
     return 0;
 }
 
+bool abrt_abrt_conf_changed(void)
+{
+    const struct timespec mtime = get_abrt_conf_mtime();
+    return mtime.tv_sec != abrt_conf_mtime.tv_sec || mtime.tv_nsec != abrt_conf_mtime.tv_nsec;
+}
+
 int abrt_load_abrt_conf_file(const char *file, GHashTable *settings)
 {
-    const char *env_conf_dir = getenv("ABRT_CONF_DIR");
     const char *const conf_directories[] = {
-        env_conf_dir ? env_conf_dir : CONF_DIR,
+        get_abrt_conf_dir(),
         NULL
     };
 
@@ -0,0 +1,351 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include "libabrt.h"
+
+/* Elements describing the system rather than the crash. They are identical
+ * in most problem directories of a host and nothing rewrites them in place:
+ * dd_save_text() and friends unlink the old file before creating the new one,
+ * so updating an element of one directory never changes the shared copy.
+ */
+static const char *const shared_elements[] = {
+    FILENAME_CMDLINE,
+    "dso_list",
+    "os_info",
+    "os_release",
+    "proc_modules",
+    "suspend_stats",
+    NULL
+};
+
+/* The blob name is the SHA-256 of the owner, the mode and the contents.
+ * Files of different owners are never shared, so they can't get access to
+ * each other's copies.
+ */
+static char *blob_name(int fd, const struct stat *st)
+{
+    g_autoptr(GChecksum) checksum = g_checksum_new(G_CHECKSUM_SHA256);
+
+    char owner[sizeof(long) * 3 * 3 + 4];
+    sprintf(owner, "%ld:%ld:%o\n", (long)st->st_uid, (long)st->st_gid, (unsigned)(st->st_mode & 07777));
+    g_checksum_update(checksum, (const guchar *)owner, strlen(owner));
+
+    char buf[64 * 1024];
+    off_t total = 0;
+    ssize_t r;
+    while ((r = libreport_safe_read(fd, buf, sizeof(buf))) > 0)
+    {
+        g_checksum_update(checksum, (const guchar *)buf, r);
+        total += r;
+    }
+    /* The file must not have changed since fstat() */
+    if (r < 0 || total != st->st_size)
+        return NULL;
+
+    return g_strdup(g_checksum_get_string(checksum));
+}
+
+/* Atomically replaces NAME in DIR_FD by a hard link to SRC_NAME in SRC_FD.
+ * If the blob has too many links already, a reflink is tried instead.
+ */
+static int replace_by_blob(int dir_fd, const char *name, int src_fd, const char *src_name)
+{
+    g_autofree char *tmp_name = g_strdup_printf(".%s.tmp", name);
+    unlinkat(dir_fd, tmp_name, 0);
+
+    if (linkat(src_fd, src_name, dir_fd, tmp_name, 0) != 0)
+    {
+        if (errno != EMLINK)
+            return -errno;
+
+        int blob_fd = openat(src_fd, src_name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        if (blob_fd < 0)
+            return -errno;
+
+        struct stat st;
+        int tmp_fd = -1;
+        if (fstat(blob_fd, &st) == 0)
+            tmp_fd = openat(dir_fd, tmp_name, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, st.st_mode & 07777);
+
+        int err = tmp_fd < 0 ? -errno : 0;
+        if (err == 0
+         && (ioctl(tmp_fd, FICLONE, blob_fd) != 0
+             || fchown(tmp_fd, st.st_uid, st.st_gid) != 0
+             || fchmod(tmp_fd, st.st_mode & 07777) != 0))
+        {
+            err = -errno;
+            unlinkat(dir_fd, tmp_name, 0);
+        }
+        close(blob_fd);
+        if (tmp_fd >= 0)
+            close(tmp_fd);
+        if (err != 0)
+            return err;
+    }
+
+    if (renameat(dir_fd, tmp_name, dir_fd, name) != 0)
+    {
+        int err = -errno;
+        unlinkat(dir_fd, tmp_name, 0);
+        return err;
+    }
+
+    return 0;
+}
+
+static void share_element(struct dump_dir *dd, int store_fd, const char *name)
+{
+    int fd = openat(dd->dd_fd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    struct stat st;
+    g_autofree char *blob = NULL;
+    /* Already shared or empty, nothing to save */
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_nlink == 1 && st.st_size > 0)
+        blob = blob_name(fd, &st);
+    close(fd);
+    if (blob == NULL)
+        return;
+
+    /* The blob doesn't exist yet, the element becomes it */
+    if (linkat(dd->dd_fd, name, store_fd, blob, 0) == 0)
+    {
+        log_debug("Stored '%s/%s' as blob %s", dd->dd_dirname, name, blob);
+        return;
+    }
+    if (errno != EEXIST)
+    {
+        perror_msg("Can't store '%s/%s' in the blob store", dd->dd_dirname, name);
+        return;
+    }
+
+    struct stat blob_st;
+    if (fstatat(store_fd, blob, &blob_st, AT_SYMLINK_NOFOLLOW) != 0
+     || !S_ISREG(blob_st.st_mode)
+     || blob_st.st_size != st.st_size
+     || blob_st.st_uid != st.st_uid
+     || blob_st.st_gid != st.st_gid
+     || (blob_st.st_mode & 07777) != (st.st_mode & 07777))
+    {
+        log_notice("Blob %s doesn't match '%s/%s'", blob, dd->dd_dirname, name);
+        return;
+    }
+
+    int r = replace_by_blob(dd->dd_fd, name, store_fd, blob);
+    if (r == 0)
+        log_debug("Replaced '%s/%s' by blob %s", dd->dd_dirname, name, blob);
+    else
+        log_notice("Can't replace '%s/%s' by blob %s: %s", dd->dd_dirname, name, blob, strerror(-r));
+}
+
+void abrt_share_problem_elements(struct dump_dir *dd, const char *blob_store)
+{
+    if (mkdir(blob_store, 0700) != 0 && errno != EEXIST)
+    {
+        perror_msg("Can't create blob store '%s'", blob_store);
+        return;
+    }
+
+    int store_fd = open(blob_store, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (store_fd < 0)
+    {
+        perror_msg("Can't open blob store '%s'", blob_store);
+        return;
+    }
+
+    for (const char *const *name = shared_elements; *name; ++name)
+        share_element(dd, store_fd, *name);
+
+    close(store_fd);
+}
+
+int abrt_unshare_problem_elements(struct dump_dir *dd)
+{
+    DIR *d = fdopendir(dup(dd->dd_fd));
+    if (!d)
+    {
+        perror_msg("Can't open directory '%s'", dd->dd_dirname);
+        return -1;
+    }
+
+    int ret = 0;
+    struct dirent *dent;
+    while ((dent = readdir(d)) != NULL)
+    {
+        struct stat st;
+        if (fstatat(dd->dd_fd, dent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0
+         || !S_ISREG(st.st_mode) || st.st_nlink == 1)
+            continue;
+
+        int src_fd = openat(dd->dd_fd, dent->d_name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        if (src_fd < 0)
+        {
+            perror_msg("Can't open '%s/%s'", dd->dd_dirname, dent->d_name);
+            ret = -1;
+            continue;
+        }
+
+        g_autofree char *tmp_name = g_strdup_printf(".%s.tmp", dent->d_name);
+        unlinkat(dd->dd_fd, tmp_name, 0);
+        int dst_fd = openat(dd->dd_fd, tmp_name, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, st.st_mode & 07777);
+        bool copied = dst_fd >= 0
+                   && libreport_copyfd_eof(src_fd, dst_fd, 0) >= 0
+                   && fchown(dst_fd, st.st_uid, st.st_gid) == 0
+                   && fchmod(dst_fd, st.st_mode & 07777) == 0;
+        if (dst_fd >= 0 && close(dst_fd) != 0)
+            copied = false;
+        close(src_fd);
+
+        if (!copied || renameat(dd->dd_fd, tmp_name, dd->dd_fd, dent->d_name) != 0)
+        {
+            perror_msg("Can't make a private copy of '%s/%s'", dd->dd_dirname, dent->d_name);
+            unlinkat(dd->dd_fd, tmp_name, 0);
+            ret = -1;
+        }
+    }
+    closedir(d);
+
+    return ret;
+}
+
+void abrt_delete_unused_blobs(const char *blob_store)
+{
+    DIR *d = opendir(blob_store);
+    if (!d)
+        return;
+
+    struct dirent *dent;
+    while ((dent = readdir(d)) != NULL)
+    {
+        struct stat st;
+        /* The store holds the last link, no problem directory uses the blob */
+        if (fstatat(dirfd(d), dent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0
+         && S_ISREG(st.st_mode) && st.st_nlink == 1)
+        {
+            log_debug("Deleting unused blob %s", dent->d_name);
+            unlinkat(dirfd(d), dent->d_name, 0);
+        }
+    }
+    closedir(d);
+}
+
+/* A file shared by N links is charged 1/N of its size to each of them, so the
+ * sum over the dump location is the space really used and deleting
+ * a directory is charged the space it frees.
+ */
+static double get_dirsize(int dir_fd)
+{
+    DIR *d = fdopendir(dir_fd);
+    if (!d)
+    {
+        close(dir_fd);
+        return 0;
+    }
+
+    double size = 0;
+    struct dirent *dent;
+    while ((dent = readdir(d)) != NULL)
+    {
+        if (libreport_dot_or_dotdot(dent->d_name))
+            continue;
+
+        struct stat st;
+        if (fstatat(dirfd(d), dent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            continue;
+
+        if (S_ISDIR(st.st_mode))
+        {
+            int fd = openat(dirfd(d), dent->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (fd >= 0)
+                size += get_dirsize(fd);
+        }
+        else if (S_ISREG(st.st_mode))
+            size += (double)st.st_size / (st.st_nlink > 0 ? st.st_nlink : 1);
+    }
+    closedir(d);
+
+    return size;
+}
+
+double abrt_get_dirsize_find_largest_dir(const char *path, char **worst_dir,
+                                         const char *excluded, const char *excluded2)
+{
+    if (worst_dir)
+        *worst_dir = NULL;
+
+    DIR *d = opendir(path);
+    if (!d)
+        return 0;
+
+    /* "now" is used only if caller wants to know worst_dir */
+    time_t cur_time = worst_dir ? time(NULL) : 0;
+
+    double size = 0;
+    double maxsz = 0;
+    struct dirent *dent;
+    while ((dent = readdir(d)) != NULL)
+    {
+        if (libreport_dot_or_dotdot(dent->d_name))
+            continue;
+
+        struct stat st;
+        if (fstatat(dirfd(d), dent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            continue;
+
+        if (S_ISREG(st.st_mode))
+        {
+            size += st.st_size;
+            continue;
+        }
+        if (!S_ISDIR(st.st_mode))
+            continue;
+
+        int fd = openat(dirfd(d), dent->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        double sz = get_dirsize(fd);
+        size += sz;
+
+        /* The blob store is freed by deleting the problem directories */
+        if (worst_dir
+         && strcmp(dent->d_name, ABRT_BLOB_STORE_DIR) != 0
+         && (!excluded || strcmp(excluded, dent->d_name) != 0)
+         && (!excluded2 || strcmp(excluded2, dent->d_name) != 0))
+        {
+            /* Calculate "weighted" size and age
+             * w = sz_kbytes * age_mins */
+            sz /= 1024;
+            long age = (cur_time - st.st_mtime) / 60;
+            if (age > 1)
+                sz *= age;
+
+            if (sz > maxsz)
+            {
+                maxsz = sz;
+                g_free(*worst_dir);
+                *worst_dir = g_strdup(dent->d_name);
+            }
+        }
+    }
+    closedir(d);
+
+    return size;
+}
@@ -0,0 +1,550 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <zstd.h>
+#include "libabrt.h"
+
+/* coredump.zst is stored in the seekable format of zstd: the core is split
+ * into independently compressed frames followed by a skippable frame listing
+ * their sizes. Reading a part of the core decompresses only the frames it
+ * spans. Plain zstd tools decompress such a file as usual.
+ *
+ * https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+ */
+#define SEEKABLE_MAGIC 0x8F92EAB1
+#define SEEK_TABLE_MAGIC 0x184D2A5E
+#define SEEK_TABLE_HEADER_SIZE 8
+#define SEEK_TABLE_FOOTER_SIZE 9
+#define SEEK_TABLE_CHECKSUM_FLAG 0x80
+#define SEEK_TABLE_RESERVED_BITS 0x7c
+
+/* The decompressed size of the frames we write */
+#define FRAME_SIZE (1024 * 1024)
+/* Limits protecting us from corrupted seek tables */
+#define MAX_FRAME_SIZE (64 * 1024 * 1024)
+#define MAX_FRAMES (16 * 1024 * 1024)
+/* The notes and the module headers are read repeatedly, keep a few frames */
+#define CACHED_FRAMES 8
+
+struct cached_frame
+{
+    unsigned index;
+    char *data;
+    unsigned long long last_use;
+};
+
+struct abrt_core_file
+{
+    int fd;
+
+    /* The rest is used only if the core is compressed */
+    ZSTD_DCtx *dctx;
+    unsigned frame_count;
+    /* Where the frames start in the compressed and in the decompressed core,
+     * frame_count + 1 entries, the last one is the end.
+     */
+    unsigned long long *compressed_offsets;
+    unsigned long long *offsets;
+    struct cached_frame cache[CACHED_FRAMES];
+    unsigned long long use_counter;
+};
+
+static bool read_at(int fd, void *buf, size_t size, off_t offset)
+{
+    while (size)
+    {
+        ssize_t r = pread(fd, buf, size, offset);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return false;
+        buf = (char *)buf + r;
+        size -= r;
+        offset += r;
+    }
+    return true;
+}
+
+static guint32 get_le32(const unsigned char *data)
+{
+    guint32 value;
+    memcpy(&value, data, sizeof(value));
+    return GUINT32_FROM_LE(value);
+}
+
+static void append_le32(GByteArray *array, guint32 value)
+{
+    value = GUINT32_TO_LE(value);
+    g_byte_array_append(array, (const guint8 *)&value, sizeof(value));
+}
+
+static bool read_seek_table(struct abrt_core_file *core)
+{
+    struct stat stb;
+    if (fstat(core->fd, &stb) != 0
+     || stb.st_size < SEEK_TABLE_HEADER_SIZE + SEEK_TABLE_FOOTER_SIZE)
+        return false;
+
+    unsigned char footer[SEEK_TABLE_FOOTER_SIZE];
+    if (!read_at(core->fd, footer, sizeof(footer), stb.st_size - sizeof(footer))
+     || get_le32(footer + 5) != SEEKABLE_MAGIC
+     || (footer[4] & SEEK_TABLE_RESERVED_BITS) != 0)
+        return false;
+
+    unsigned long long frame_count = get_le32(footer);
+    size_t entry_size = (footer[4] & SEEK_TABLE_CHECKSUM_FLAG) ? 12 : 8;
+    unsigned long long table_size = frame_count * entry_size;
+    if (frame_count > MAX_FRAMES
+     || table_size > stb.st_size - SEEK_TABLE_HEADER_SIZE - SEEK_TABLE_FOOTER_SIZE)
+        return false;
+
+    /* The frames fill the file up to the seek table */
+    off_t table_start = stb.st_size - SEEK_TABLE_FOOTER_SIZE - table_size;
+    unsigned char header[SEEK_TABLE_HEADER_SIZE];
+    if (!read_at(core->fd, header, sizeof(header), table_start - sizeof(header))
+     || get_le32(header) != SEEK_TABLE_MAGIC
+     || get_le32(header + 4) != table_size + SEEK_TABLE_FOOTER_SIZE)
+        return false;
+
+    g_autofree unsigned char *table = g_malloc(table_size);
+    if (!read_at(core->fd, table, table_size, table_start))
+        return false;
+
+    core->frame_count = frame_count;
+    core->compressed_offsets = g_new(unsigned long long, frame_count + 1);
+    core->offsets = g_new(unsigned long long, frame_count + 1);
+    core->compressed_offsets[0] = core->offsets[0] = 0;
+    for (unsigned i = 0; i < frame_count; ++i)
+    {
+        const unsigned char *entry = table + i * entry_size;
+        if (get_le32(entry + 4) > MAX_FRAME_SIZE)
+            return false;
+        core->compressed_offsets[i + 1] = core->compressed_offsets[i] + get_le32(entry);
+        core->offsets[i + 1] = core->offsets[i] + get_le32(entry + 4);
+    }
+
+    return core->compressed_offsets[frame_count] == table_start - sizeof(header);
+}
+
+/* Returns the frame containing OFFSET, which must be less than the size of
+ * the decompressed core.
+ */
+static unsigned find_frame(const struct abrt_core_file *core, unsigned long long offset)
+{
+    unsigned lo = 0;
+    unsigned hi = core->frame_count;
+    while (hi - lo > 1)
+    {
+        unsigned mid = lo + (hi - lo) / 2;
+        if (offset < core->offsets[mid])
+            hi = mid;
+        else
+            lo = mid;
+    }
+    return lo;
+}
+
+static const char *get_frame(struct abrt_core_file *core, unsigned index)
+{
+    struct cached_frame *victim = &core->cache[0];
+    for (unsigned i = 0; i < CACHED_FRAMES; ++i)
+    {
+        struct cached_frame *frame = &core->cache[i];
+        if (frame->data && frame->index == index)
+        {
+            frame->last_use = ++core->use_counter;
+            return frame->data;
+        }
+        if (!frame->data || (victim->data && frame->last_use < victim->last_use))
+            victim = frame;
+    }
+
+    size_t compressed_size = core->compressed_offsets[index + 1] - core->compressed_offsets[index];
+    size_t size = core->offsets[index + 1] - core->offsets[index];
+    if (compressed_size > ZSTD_compressBound(MAX_FRAME_SIZE))
+        return NULL;
+
+    g_autofree char *compressed = g_malloc(compressed_size);
+    if (!read_at(core->fd, compressed, compressed_size, core->compressed_offsets[index]))
+        return NULL;
+
+    g_free(victim->data);
+    victim->data = g_malloc(size);
+    size_t r = ZSTD_decompressDCtx(core->dctx, victim->data, size, compressed, compressed_size);
+    if (ZSTD_isError(r) || r != size)
+    {
+        log_info("Can't decompress frame %u of the core: %s", index,
+                 ZSTD_isError(r) ? ZSTD_getErrorName(r) : "wrong size");
+        g_free(victim->data);
+        victim->data = NULL;
+        return NULL;
+    }
+
+    victim->index = index;
+    victim->last_use = ++core->use_counter;
+    return victim->data;
+}
+
+struct abrt_core_file *abrt_core_file_open_fd(int fd)
+{
+    struct abrt_core_file *core = g_new0(struct abrt_core_file, 1);
+    core->fd = fd;
+    return core;
+}
+
+struct abrt_core_file *abrt_core_file_open(const char *dump_dir_name)
+{
+    g_autofree char *path = g_build_filename(dump_dir_name, FILENAME_COREDUMP, NULL);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+        return abrt_core_file_open_fd(fd);
+    if (errno != ENOENT)
+    {
+        log_info("Can't open '%s': %s", path, strerror(errno));
+        return NULL;
+    }
+
+    g_autofree char *compressed_path = g_strconcat(path, ".zst", NULL);
+    fd = open(compressed_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        log_info("Can't open '%s': %s", compressed_path, strerror(errno));
+        return NULL;
+    }
+
+    struct abrt_core_file *core = abrt_core_file_open_fd(fd);
+    if (!read_seek_table(core))
+    {
+        log_info("'%s' has no seek table, it must be unpacked", compressed_path);
+        abrt_core_file_close(core);
+        return NULL;
+    }
+
+    core->dctx = ZSTD_createDCtx();
+    if (!core->dctx)
+    {
+        abrt_core_file_close(core);
+        return NULL;
+    }
+
+    return core;
+}
+
+bool abrt_core_file_is_seekable(int fd)
+{
+    struct abrt_core_file core = { .fd = fd };
+    bool seekable = read_seek_table(&core);
+    g_free(core.compressed_offsets);
+    g_free(core.offsets);
+    return seekable;
+}
+
+void abrt_core_file_close(struct abrt_core_file *core)
+{
+    if (!core)
+        return;
+
+    close(core->fd);
+    ZSTD_freeDCtx(core->dctx);
+    g_free(core->compressed_offsets);
+    g_free(core->offsets);
+    for (unsigned i = 0; i < CACHED_FRAMES; ++i)
+        g_free(core->cache[i].data);
+    g_free(core);
+}
+
+bool abrt_core_file_read(struct abrt_core_file *core, void *buf, size_t size, unsigned long long offset)
+{
+    if (!core->dctx)
+        return offset <= LLONG_MAX && read_at(core->fd, buf, size, offset);
+
+    while (size)
+    {
+        if (offset >= core->offsets[core->frame_count])
+            return false;
+
+        unsigned index = find_frame(core, offset);
+        const char *frame = get_frame(core, index);
+        if (!frame)
+            return false;
+
+        size_t len = MIN(size, core->offsets[index + 1] - offset);
+        memcpy(buf, frame + (offset - core->offsets[index]), len);
+        buf = (char *)buf + len;
+        size -= len;
+        offset += len;
+    }
+    return true;
+}
+
+/* The core being compressed */
+struct core_source
+{
+    int fd;
+    /* NULL if the source is not compressed */
+    ZSTD_DCtx *dctx;
+    char *in_data;
+    size_t in_data_size;
+    ZSTD_inBuffer in;
+    bool eof;
+    /* ZSTD_decompressStream() returns 0 at the end of a frame */
+    size_t hint;
+};
+
+/* Reads SIZE bytes of the uncompressed core, less only at its end.
+ * Returns -1 on errors.
+ */
+static ssize_t source_read(struct core_source *source, char *buf, size_t size)
+{
+    if (!source->dctx)
+    {
+        ssize_t r = libreport_full_read(source->fd, buf, size);
+        if (r < 0)
+            perror_msg("Can't read the core");
+        return r;
+    }
+
+    ZSTD_outBuffer out = { buf, size, 0 };
+    while (out.pos < out.size)
+    {
+        if (source->in.pos == source->in.size && !source->eof)
+        {
+            ssize_t r = libreport_safe_read(source->fd, source->in_data, source->in_data_size);
+            if (r < 0)
+            {
+                perror_msg("Can't read the core");
+                return -1;
+            }
+            source->eof = (r == 0);
+            source->in.size = r;
+            source->in.pos = 0;
+        }
+
+        size_t out_pos = out.pos;
+        size_t r = ZSTD_decompressStream(source->dctx, &out, &source->in);
+        if (ZSTD_isError(r))
+        {
+            error_msg("Can't decompress the core: %s", ZSTD_getErrorName(r));
+            return -1;
+        }
+        /* Without input and anything to flush, it asks for another frame */
+        if (source->in.size > 0 || out.pos != out_pos)
+            source->hint = r;
+        /* The decompressor had room for all it held */
+        if (source->eof && out.pos < out.size)
+            break;
+    }
+
+    if (out.pos < out.size && source->hint != 0)
+    {
+        error_msg("The compressed core is truncated");
+        return -1;
+    }
+    return out.pos;
+}
+
+struct frame
+{
+    ZSTD_CCtx *cctx;
+    char *data;
+    size_t size;
+    char *compressed;
+    /* Or a zstd error code */
+    size_t compressed_size;
+};
+
+struct frame_pool
+{
+    GThreadPool *pool;
+    GMutex lock;
+    GCond done;
+    unsigned pending;
+};
+
+static void compress_frame(struct frame *frame)
+{
+    frame->compressed_size = ZSTD_compress2(frame->cctx, frame->compressed, ZSTD_compressBound(FRAME_SIZE),
+                                            frame->data, frame->size);
+}
+
+static void compress_frame_task(gpointer data, gpointer user_data)
+{
+    struct frame_pool *pool = user_data;
+    compress_frame(data);
+
+    g_mutex_lock(&pool->lock);
+    if (--pool->pending == 0)
+        g_cond_signal(&pool->done);
+    g_mutex_unlock(&pool->lock);
+}
+
+static void compress_frames(struct frame_pool *pool, struct frame *frames, unsigned count)
+{
+    if (!pool->pool || count == 1)
+    {
+        for (unsigned i = 0; i < count; ++i)
+            compress_frame(&frames[i]);
+        return;
+    }
+
+    pool->pending = count;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        GError *error = NULL;
+        if (!g_thread_pool_push(pool->pool, &frames[i], &error))
+        {
+            log_info("Can't compress in a thread: %s", error->message);
+            g_error_free(error);
+            compress_frame_task(&frames[i], pool);
+        }
+    }
+
+    g_mutex_lock(&pool->lock);
+    while (pool->pending > 0)
+        g_cond_wait(&pool->done, &pool->lock);
+    g_mutex_unlock(&pool->lock);
+}
+
+static bool write_frame(int fd, const struct frame *frame, GByteArray *seek_table)
+{
+    if (ZSTD_isError(frame->compressed_size))
+    {
+        error_msg("Can't compress the core: %s", ZSTD_getErrorName(frame->compressed_size));
+        return false;
+    }
+    if (libreport_full_write(fd, frame->compressed, frame->compressed_size) != frame->compressed_size)
+    {
+        perror_msg("Can't write the core");
+        return false;
+    }
+
+    append_le32(seek_table, frame->compressed_size);
+    append_le32(seek_table, frame->size);
+    return true;
+}
+
+static bool write_seek_table(int fd, GByteArray *seek_table, unsigned frame_count)
+{
+    g_autoptr(GByteArray) frame = g_byte_array_new();
+    append_le32(frame, SEEK_TABLE_MAGIC);
+    append_le32(frame, seek_table->len + SEEK_TABLE_FOOTER_SIZE);
+    g_byte_array_append(frame, seek_table->data, seek_table->len);
+    append_le32(frame, frame_count);
+    const guint8 descriptor = 0;
+    g_byte_array_append(frame, &descriptor, sizeof(descriptor));
+    append_le32(frame, SEEKABLE_MAGIC);
+
+    if (libreport_full_write(fd, frame->data, frame->len) != frame->len)
+    {
+        perror_msg("Can't write the core");
+        return false;
+    }
+    return true;
+}
+
+int abrt_core_file_compress_seekable(int src_fd, int dst_fd, int flags, int level, unsigned threads)
+{
+    int result = -1;
+    struct core_source source = { .fd = src_fd };
+    struct frame_pool pool = { 0 };
+    g_mutex_init(&pool.lock);
+    g_cond_init(&pool.done);
+    /* Each thread compresses one frame of a batch */
+    unsigned batch_size = MAX(threads, 1);
+    struct frame *frames = g_new0(struct frame, batch_size);
+    g_autoptr(GByteArray) seek_table = g_byte_array_new();
+    unsigned frame_count = 0;
+
+    if (flags & ABRT_CORE_SOURCE_ZSTD)
+    {
+        source.dctx = ZSTD_createDCtx();
+        if (!source.dctx)
+            goto ret;
+        source.in_data_size = ZSTD_DStreamInSize();
+        source.in_data = g_malloc(source.in_data_size);
+        source.in.src = source.in_data;
+    }
+
+    for (unsigned i = 0; i < batch_size; ++i)
+    {
+        frames[i].cctx = ZSTD_createCCtx();
+        if (!frames[i].cctx)
+            goto ret;
+        ZSTD_CCtx_setParameter(frames[i].cctx, ZSTD_c_compressionLevel, level);
+        /* Each frame carries a checksum of its contents */
+        ZSTD_CCtx_setParameter(frames[i].cctx, ZSTD_c_checksumFlag, 1);
+        frames[i].data = g_malloc(FRAME_SIZE);
+        frames[i].compressed = g_malloc(ZSTD_compressBound(FRAME_SIZE));
+    }
+
+    if (batch_size > 1)
+    {
+        GError *error = NULL;
+        pool.pool = g_thread_pool_new(compress_frame_task, &pool, batch_size, /*exclusive*/TRUE, &error);
+        if (!pool.pool)
+        {
+            log_info("Can't start compression threads: %s", error->message);
+            g_error_free(error);
+        }
+    }
+
+    bool end = false;
+    while (!end)
+    {
+        unsigned count = 0;
+        while (count < batch_size && !end)
+        {
+            ssize_t r = source_read(&source, frames[count].data, FRAME_SIZE);
+            if (r < 0)
+                goto ret;
+            end = (r < FRAME_SIZE);
+            if (r > 0)
+                frames[count++].size = r;
+        }
+
+        compress_frames(&pool, frames, count);
+
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (!write_frame(dst_fd, &frames[i], seek_table))
+                goto ret;
+        }
+        frame_count += count;
+    }
+
+    if (!write_seek_table(dst_fd, seek_table, frame_count))
+        goto ret;
+
+    log_info("Compressed the core into %u frames", frame_count);
+    result = 0;
+ ret:
+    if (pool.pool)
+        g_thread_pool_free(pool.pool, /*immediate*/FALSE, /*wait*/TRUE);
+    g_mutex_clear(&pool.lock);
+    g_cond_clear(&pool.done);
+    ZSTD_freeDCtx(source.dctx);
+    g_free(source.in_data);
+    for (unsigned i = 0; i < batch_size; ++i)
+    {
+        ZSTD_freeCCtx(frames[i].cctx);
+        g_free(frames[i].data);
+        g_free(frames[i].compressed);
+    }
+    g_free(frames);
+    return result;
+}
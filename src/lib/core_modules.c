@@ -0,0 +1,601 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <elf.h>
+#include "libabrt.h"
+
+/* Limits protecting us from corrupted cores */
+#define MAX_CORE_NOTES_SIZE (64 * 1024 * 1024)
+#define MAX_MODULE_NOTES_SIZE (64 * 1024)
+#define MAX_PHNUM 4096
+#define MAX_BUILD_ID_SIZE 64
+#define MAX_DYNAMIC_ENTRIES 1024
+#define MAX_LINK_MAP_ENTRIES 4096
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+# define ELFDATA_NATIVE ELFDATA2LSB
+#else
+# define ELFDATA_NATIVE ELFDATA2MSB
+#endif
+
+/* An ELF file: the core itself, an image of a module in the core's memory
+ * or a module's file on the disk. Headers of both classes are read into
+ * their 64-bit variants.
+ */
+struct elf_source
+{
+    struct abrt_core_file *file;
+    /* Non-NULL if the ELF is an image in the memory of this core */
+    const struct elf_source *core;
+    unsigned long long base;
+
+    unsigned char elf_class;
+    Elf64_Ehdr ehdr;
+    Elf64_Phdr *phdrs;
+};
+
+/* Reads SIZE bytes at ADDR of the crashed process' memory. Fails if they
+ * weren't dumped.
+ */
+static bool core_read_memory(const struct elf_source *core, unsigned long long addr, void *buf, size_t size)
+{
+    for (unsigned i = 0; i < core->ehdr.e_phnum; ++i)
+    {
+        const Elf64_Phdr *phdr = &core->phdrs[i];
+        if (phdr->p_type == PT_LOAD
+         && addr >= phdr->p_vaddr
+         && addr - phdr->p_vaddr < phdr->p_filesz
+         && size <= phdr->p_filesz - (addr - phdr->p_vaddr))
+        {
+            return abrt_core_file_read(core->file, buf, size, phdr->p_offset + (addr - phdr->p_vaddr));
+        }
+    }
+    return false;
+}
+
+static bool elf_read(const struct elf_source *elf, unsigned long long offset, void *buf, size_t size)
+{
+    if (elf->core)
+        return core_read_memory(elf->core, elf->base + offset, buf, size);
+    return abrt_core_file_read(elf->file, buf, size, offset);
+}
+
+static unsigned long long min_load_vaddr(const struct elf_source *elf)
+{
+    unsigned long long min = ULLONG_MAX;
+    for (unsigned i = 0; i < elf->ehdr.e_phnum; ++i)
+    {
+        if (elf->phdrs[i].p_type == PT_LOAD && elf->phdrs[i].p_vaddr < min)
+            min = elf->phdrs[i].p_vaddr;
+    }
+    return min;
+}
+
+/* Reads the contents of a segment, which is found by its address in
+ * a memory image and by its offset in a file.
+ */
+static void *elf_read_segment(const struct elf_source *elf, const Elf64_Phdr *phdr,
+                              unsigned long long page_size, size_t max_size)
+{
+    if (phdr->p_filesz > max_size)
+        return NULL;
+
+    unsigned long long offset = phdr->p_offset;
+    if (elf->core)
+        offset = phdr->p_vaddr - (min_load_vaddr(elf) & ~(page_size - 1));
+
+    void *data = g_malloc(phdr->p_filesz);
+    if (!elf_read(elf, offset, data, phdr->p_filesz))
+    {
+        g_free(data);
+        return NULL;
+    }
+    return data;
+}
+
+static bool elf_read_headers(struct elf_source *elf)
+{
+    unsigned char ident[EI_NIDENT];
+    if (!elf_read(elf, 0, ident, sizeof(ident))
+     || memcmp(ident, ELFMAG, SELFMAG) != 0
+     || ident[EI_DATA] != ELFDATA_NATIVE)
+        return false;
+
+    elf->elf_class = ident[EI_CLASS];
+    if (elf->elf_class == ELFCLASS64)
+    {
+        if (!elf_read(elf, 0, &elf->ehdr, sizeof(elf->ehdr))
+         || elf->ehdr.e_phentsize != sizeof(Elf64_Phdr))
+            return false;
+    }
+    else if (elf->elf_class == ELFCLASS32)
+    {
+        Elf32_Ehdr ehdr;
+        if (!elf_read(elf, 0, &ehdr, sizeof(ehdr))
+         || ehdr.e_phentsize != sizeof(Elf32_Phdr))
+            return false;
+        memcpy(elf->ehdr.e_ident, ehdr.e_ident, EI_NIDENT);
+        elf->ehdr.e_type = ehdr.e_type;
+        elf->ehdr.e_machine = ehdr.e_machine;
+        elf->ehdr.e_entry = ehdr.e_entry;
+        elf->ehdr.e_phoff = ehdr.e_phoff;
+        elf->ehdr.e_phnum = ehdr.e_phnum;
+    }
+    else
+        return false;
+
+    if (elf->ehdr.e_phnum == 0 || elf->ehdr.e_phnum > MAX_PHNUM)
+        return false;
+
+    elf->phdrs = g_new(Elf64_Phdr, elf->ehdr.e_phnum);
+    if (elf->elf_class == ELFCLASS64)
+        return elf_read(elf, elf->ehdr.e_phoff, elf->phdrs, elf->ehdr.e_phnum * sizeof(Elf64_Phdr));
+
+    g_autofree Elf32_Phdr *phdrs = g_new(Elf32_Phdr, elf->ehdr.e_phnum);
+    if (!elf_read(elf, elf->ehdr.e_phoff, phdrs, elf->ehdr.e_phnum * sizeof(Elf32_Phdr)))
+        return false;
+    for (unsigned i = 0; i < elf->ehdr.e_phnum; ++i)
+    {
+        elf->phdrs[i].p_type = phdrs[i].p_type;
+        elf->phdrs[i].p_flags = phdrs[i].p_flags;
+        elf->phdrs[i].p_offset = phdrs[i].p_offset;
+        elf->phdrs[i].p_vaddr = phdrs[i].p_vaddr;
+        elf->phdrs[i].p_paddr = phdrs[i].p_paddr;
+        elf->phdrs[i].p_filesz = phdrs[i].p_filesz;
+        elf->phdrs[i].p_memsz = phdrs[i].p_memsz;
+        elf->phdrs[i].p_align = phdrs[i].p_align;
+    }
+    return true;
+}
+
+/* Calls FUNC for each note in DATA, stops when it returns true */
+static bool foreach_note(const char *data, size_t size,
+                         bool (*func)(const char *name, Elf64_Word type, const char *desc,
+                                      size_t desc_offset, Elf64_Word desc_size, void *param),
+                         void *param)
+{
+    size_t pos = 0;
+    /* Elf32_Nhdr and Elf64_Nhdr are the same */
+    while (pos <= size && size - pos >= sizeof(Elf32_Nhdr))
+    {
+        Elf32_Nhdr nhdr;
+        memcpy(&nhdr, data + pos, sizeof(nhdr));
+        pos += sizeof(nhdr);
+
+        const char *name = data + pos;
+        if (nhdr.n_namesz > size - pos)
+            break;
+        pos += (nhdr.n_namesz + 3) & ~3ul;
+
+        size_t desc_offset = pos;
+        if (pos > size || nhdr.n_descsz > size - pos)
+            break;
+        pos += (nhdr.n_descsz + 3) & ~3ul;
+
+        /* The name must be NUL terminated */
+        if (nhdr.n_namesz == 0 || name[nhdr.n_namesz - 1] != '\0')
+            continue;
+
+        if (func(name, nhdr.n_type, data + desc_offset, desc_offset, nhdr.n_descsz, param))
+            return true;
+    }
+    return false;
+}
+
+struct build_id_note
+{
+    char *build_id;
+    size_t desc_offset;
+};
+
+static bool find_build_id(const char *name, Elf64_Word type, const char *desc,
+                          size_t desc_offset, Elf64_Word desc_size, void *param)
+{
+    if (type != NT_GNU_BUILD_ID || strcmp(name, "GNU") != 0
+     || desc_size == 0 || desc_size > MAX_BUILD_ID_SIZE)
+        return false;
+
+    struct build_id_note *note = param;
+    note->build_id = g_malloc(desc_size * 2 + 1);
+    for (unsigned i = 0; i < desc_size; ++i)
+        sprintf(note->build_id + i * 2, "%02x", (unsigned char)desc[i]);
+    note->desc_offset = desc_offset;
+    return true;
+}
+
+/* Fills in the address range and the build-id of a module mapped at START */
+static bool module_read_elf(struct abrt_core_module *module, const struct elf_source *elf,
+                            unsigned long long page_size)
+{
+    unsigned long long min_vaddr = ULLONG_MAX;
+    unsigned long long max_vaddr = 0;
+    for (unsigned i = 0; i < elf->ehdr.e_phnum; ++i)
+    {
+        const Elf64_Phdr *phdr = &elf->phdrs[i];
+        if (phdr->p_type != PT_LOAD)
+            continue;
+        if (phdr->p_vaddr < min_vaddr)
+            min_vaddr = phdr->p_vaddr;
+        if (phdr->p_vaddr + phdr->p_memsz > max_vaddr)
+            max_vaddr = phdr->p_vaddr + phdr->p_memsz;
+    }
+    if (min_vaddr >= max_vaddr)
+        return false;
+
+    min_vaddr &= ~(page_size - 1);
+    max_vaddr = (max_vaddr + page_size - 1) & ~(page_size - 1);
+    module->size = max_vaddr - min_vaddr;
+    /* The module was loaded with this bias */
+    unsigned long long bias = module->start - min_vaddr;
+
+    for (unsigned i = 0; i < elf->ehdr.e_phnum && !module->build_id; ++i)
+    {
+        const Elf64_Phdr *phdr = &elf->phdrs[i];
+        if (phdr->p_type != PT_NOTE)
+            continue;
+
+        g_autofree char *notes = elf_read_segment(elf, phdr, page_size, MAX_MODULE_NOTES_SIZE);
+        if (!notes)
+            continue;
+
+        struct build_id_note note = { NULL };
+        if (foreach_note(notes, phdr->p_filesz, find_build_id, &note))
+        {
+            module->build_id = note.build_id;
+            module->build_id_addr = bias + phdr->p_vaddr + note.desc_offset;
+        }
+    }
+
+    return true;
+}
+
+/* Prefers the image in the core's memory, which is the version of the module
+ * that crashed. Falls back to the file, which might have been updated since,
+ * if the image wasn't dumped.
+ */
+static bool module_read(struct abrt_core_module *module, const struct elf_source *core,
+                        unsigned long long page_size)
+{
+    struct elf_source image = { .core = core, .base = module->start };
+    bool found = elf_read_headers(&image) && module_read_elf(module, &image, page_size);
+    g_free(image.phdrs);
+    if ((found && module->build_id) || !module->file_name)
+        return found;
+
+    /* O_NONBLOCK: the path may be a fifo or a device now, we don't want to hang */
+    int fd = open(module->file_name, O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+    if (fd < 0)
+        return found;
+
+    struct elf_source file = { .file = abrt_core_file_open_fd(fd) };
+    struct stat stb;
+    if (fstat(fd, &stb) == 0 && S_ISREG(stb.st_mode)
+     && elf_read_headers(&file)
+     && (file.elf_class == core->elf_class))
+    {
+        if (found)
+        {
+            /* The image gave us the size, use only the build-id of the file */
+            struct abrt_core_module from_file = { .start = module->start };
+            if (module_read_elf(&from_file, &file, page_size) && from_file.size == module->size)
+            {
+                module->build_id = from_file.build_id;
+                module->build_id_addr = from_file.build_id_addr;
+            }
+            else
+                free(from_file.build_id);
+        }
+        else
+            found = module_read_elf(module, &file, page_size);
+    }
+
+    g_free(file.phdrs);
+    abrt_core_file_close(file.file);
+    return found;
+}
+
+struct core_notes
+{
+    unsigned char elf_class;
+    /* NT_FILE */
+    const char *files;
+    size_t files_size;
+    /* AT_ENTRY and AT_SYSINFO_EHDR from NT_AUXV */
+    unsigned long long entry;
+    unsigned long long vdso;
+};
+
+static unsigned long long read_word(const char *data, unsigned char elf_class)
+{
+    if (elf_class == ELFCLASS64)
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        return word;
+    }
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+static bool read_core_note(const char *name, Elf64_Word type, const char *desc,
+                           size_t desc_offset, Elf64_Word desc_size, void *param)
+{
+    struct core_notes *notes = param;
+    if (strcmp(name, "CORE") != 0)
+        return false;
+
+    if (type == NT_FILE && !notes->files)
+    {
+        notes->files = desc;
+        notes->files_size = desc_size;
+    }
+    else if (type == NT_AUXV)
+    {
+        const size_t word_size = notes->elf_class == ELFCLASS64 ? 8 : 4;
+        for (size_t pos = 0; pos + 2 * word_size <= desc_size; pos += 2 * word_size)
+        {
+            unsigned long long key = read_word(desc + pos, notes->elf_class);
+            unsigned long long value = read_word(desc + pos + word_size, notes->elf_class);
+            if (key == AT_ENTRY)
+                notes->entry = value;
+            else if (key == AT_SYSINFO_EHDR)
+                notes->vdso = value;
+        }
+    }
+    return false;
+}
+
+static bool core_read_word(const struct elf_source *core, unsigned long long addr, unsigned long long *word)
+{
+    char data[sizeof(uint64_t)];
+    if (!core_read_memory(core, addr, data, core->elf_class == ELFCLASS64 ? 8 : 4))
+        return false;
+    *word = read_word(data, core->elf_class);
+    return true;
+}
+
+/* Returns the address of the dynamic linker's struct r_debug, which
+ * the DT_DEBUG entry of the executable's dynamic section points to, or 0 if
+ * the executable is static or the section wasn't dumped.
+ */
+static unsigned long long find_r_debug(const struct elf_source *core, const struct abrt_core_module *exe,
+                                       unsigned long long page_size)
+{
+    struct elf_source image = { .core = core, .base = exe->start };
+    unsigned long long r_debug = 0;
+    if (!elf_read_headers(&image))
+        goto ret;
+
+    const unsigned long long word_size = core->elf_class == ELFCLASS64 ? 8 : 4;
+    const unsigned long long bias = exe->start - (min_load_vaddr(&image) & ~(page_size - 1));
+    for (unsigned i = 0; i < image.ehdr.e_phnum; ++i)
+    {
+        if (image.phdrs[i].p_type != PT_DYNAMIC)
+            continue;
+
+        /* Elf*_Dyn is a pair of words: the tag and the value */
+        unsigned long long addr = bias + image.phdrs[i].p_vaddr;
+        for (unsigned n = 0; n < MAX_DYNAMIC_ENTRIES; ++n, addr += 2 * word_size)
+        {
+            unsigned long long tag;
+            unsigned long long value;
+            if (!core_read_word(core, addr, &tag)
+             || tag == DT_NULL
+             || !core_read_word(core, addr + word_size, &value))
+                break;
+            if (tag == DT_DEBUG)
+            {
+                r_debug = value;
+                goto ret;
+            }
+        }
+    }
+
+ ret:
+    g_free(image.phdrs);
+    return r_debug;
+}
+
+/* Reorders MODULES sorted by address to the order eu-unstrip -n prints them
+ * in, which is the order of the dynamic linker's link map: the executable,
+ * the vdso and the libraries in the order they were loaded. The modules
+ * missing in the link map (or all of them if it can't be read) follow in
+ * the address order. The order matters, abrt-action-analyze-c hashes
+ * the modules in it.
+ */
+static void order_modules_by_link_map(GPtrArray *modules, const struct elf_source *core,
+                                      unsigned long long page_size)
+{
+    const struct abrt_core_module *exe = NULL;
+    for (unsigned i = 0; i < modules->len && !exe; ++i)
+    {
+        const struct abrt_core_module *module = modules->pdata[i];
+        if (module->is_executable)
+            exe = module;
+    }
+    if (!exe)
+        return;
+
+    const unsigned long long r_debug = find_r_debug(core, exe, page_size);
+    if (!r_debug)
+        return;
+
+    const unsigned long long word_size = core->elf_class == ELFCLASS64 ? 8 : 4;
+    g_autofree gpointer *ordered = g_new(gpointer, modules->len);
+    g_autofree bool *placed = g_new0(bool, modules->len);
+    unsigned count = 0;
+
+    /* struct r_debug { int r_version; struct link_map *r_map; ... },
+     * struct link_map { l_addr; l_name; l_ld; l_next; ... } */
+    unsigned long long map = 0;
+    core_read_word(core, r_debug + word_size, &map);
+    for (unsigned n = 0; map && n < MAX_LINK_MAP_ENTRIES && count < modules->len; ++n)
+    {
+        unsigned long long l_ld;
+        if (!core_read_word(core, map + 2 * word_size, &l_ld))
+            break;
+
+        /* The dynamic section of the object lies in its module */
+        for (unsigned i = 0; i < modules->len; ++i)
+        {
+            const struct abrt_core_module *module = modules->pdata[i];
+            if (!placed[i] && l_ld >= module->start && l_ld - module->start < module->size)
+            {
+                placed[i] = true;
+                ordered[count++] = modules->pdata[i];
+                break;
+            }
+        }
+
+        if (!core_read_word(core, map + 3 * word_size, &map))
+            break;
+    }
+
+    for (unsigned i = 0; i < modules->len; ++i)
+    {
+        if (!placed[i])
+            ordered[count++] = modules->pdata[i];
+    }
+    memcpy(modules->pdata, ordered, modules->len * sizeof(gpointer));
+}
+
+static int module_cmp(gconstpointer a, gconstpointer b)
+{
+    const struct abrt_core_module *ma = *(const struct abrt_core_module **)a;
+    const struct abrt_core_module *mb = *(const struct abrt_core_module **)b;
+    return ma->start < mb->start ? -1 : ma->start > mb->start;
+}
+
+void abrt_core_module_free(struct abrt_core_module *module)
+{
+    if (!module)
+        return;
+    free(module->build_id);
+    free(module->file_name);
+    free(module);
+}
+
+/* Adds the modules the NT_FILE note lists, each is mapped at offset 0 of
+ * its file. The note is:
+ *   count, page size,
+ *   count * (start, end, file offset in pages),
+ *   count * NUL terminated file name
+ */
+static void add_file_modules(GPtrArray *modules, const struct elf_source *core,
+                             const struct core_notes *notes, unsigned long long *page_size)
+{
+    const size_t word_size = notes->elf_class == ELFCLASS64 ? 8 : 4;
+    if (notes->files_size < 2 * word_size)
+        return;
+
+    unsigned long long count = read_word(notes->files, notes->elf_class);
+    unsigned long long note_page_size = read_word(notes->files + word_size, notes->elf_class);
+    if (note_page_size && (note_page_size & (note_page_size - 1)) == 0)
+        *page_size = note_page_size;
+
+    if (count > (notes->files_size - 2 * word_size) / (3 * word_size))
+        return;
+    const char *ranges = notes->files + 2 * word_size;
+    const char *name = ranges + count * 3 * word_size;
+    const char *end = notes->files + notes->files_size;
+
+    for (unsigned long long i = 0; i < count && name < end; ++i)
+    {
+        const char *name_end = memchr(name, '\0', end - name);
+        if (!name_end)
+            break;
+
+        const char *range = ranges + i * 3 * word_size;
+        unsigned long long start = read_word(range, notes->elf_class);
+        unsigned long long file_offset = read_word(range + 2 * word_size, notes->elf_class);
+
+        if (file_offset == 0)
+        {
+            struct abrt_core_module *module = g_new0(struct abrt_core_module, 1);
+            module->start = start;
+            module->file_name = g_strdup(name);
+            if (module_read(module, core, *page_size))
+                g_ptr_array_add(modules, module);
+            else
+                abrt_core_module_free(module);
+        }
+
+        name = name_end + 1;
+    }
+}
+
+GPtrArray *abrt_core_get_modules(struct abrt_core_file *core_file)
+{
+    struct elf_source core = { .file = core_file };
+    GPtrArray *modules = NULL;
+    g_autofree char *notes_data = NULL;
+
+    if (!elf_read_headers(&core) || core.ehdr.e_type != ET_CORE)
+    {
+        log_info("Not a core file of this machine");
+        goto ret;
+    }
+
+    struct core_notes notes = { .elf_class = core.elf_class };
+    for (unsigned i = 0; i < core.ehdr.e_phnum && !notes_data; ++i)
+    {
+        const Elf64_Phdr *phdr = &core.phdrs[i];
+        if (phdr->p_type != PT_NOTE)
+            continue;
+        notes_data = elf_read_segment(&core, phdr, /*page_size, unused:*/ 0, MAX_CORE_NOTES_SIZE);
+        if (!notes_data)
+        {
+            log_info("Can't read notes of the core");
+            goto ret;
+        }
+        foreach_note(notes_data, phdr->p_filesz, read_core_note, &notes);
+    }
+    if (!notes.files)
+    {
+        log_info("The core has no NT_FILE note");
+        goto ret;
+    }
+
+    unsigned long long page_size = 4096;
+    modules = g_ptr_array_new_with_free_func((GDestroyNotify)abrt_core_module_free);
+    add_file_modules(modules, &core, &notes, &page_size);
+
+    if (notes.vdso)
+    {
+        struct abrt_core_module *module = g_new0(struct abrt_core_module, 1);
+        module->start = notes.vdso;
+        if (module_read(module, &core, page_size))
+            g_ptr_array_add(modules, module);
+        else
+            abrt_core_module_free(module);
+    }
+
+    g_ptr_array_sort(modules, module_cmp);
+    for (unsigned i = 0; i < modules->len; ++i)
+    {
+        struct abrt_core_module *module = modules->pdata[i];
+        module->is_executable = notes.entry >= module->start
+                             && notes.entry - module->start < module->size;
+    }
+    order_modules_by_link_map(modules, &core, page_size);
+
+ ret:
+    g_free(core.phdrs);
+    return modules;
+}
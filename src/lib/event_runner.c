@@ -0,0 +1,218 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "libabrt.h"
+
+/* Maximal size of a run request */
+#define MAX_REQUEST_SIZE (64*1024)
+
+/*
+The protocol of the event runner (abrt-handle-event --serve).
+
+The client writes NUL terminated items and shuts down its side for writing:
+-> "EVENT="
+   the event to run
+-> "DUMP_DIR="
+   the problem directory
+-> "NICE="
+   increment of the nice value, optional
+-> "ENV="
+   NAME=VALUE exported to the event, optional, may repeat
+
+The runner streams the output of the event and ends with:
+<- "EXIT_STATUS: "
+   the wait status of the run as returned by waitpid()
+   \n
+*/
+
+static void dummy_handler(int sig_unused) {}
+
+static void add_item(GString *request, const char *name, const char *value)
+{
+    g_string_append_printf(request, "%s=%s", name, value);
+    g_string_append_c(request, '\0');
+}
+
+int abrt_event_runner_request(const char *socket_path, const char *event, const char *dump_dir_name,
+                              const char *nice, char **env_vec)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    struct sockaddr_un remote;
+    memset(&remote, 0, sizeof(remote));
+    remote.sun_family = AF_UNIX;
+    g_strlcpy(remote.sun_path, socket_path, sizeof(remote.sun_path));
+    if (connect(fd, (struct sockaddr *)&remote, sizeof(remote)) != 0)
+    {
+        log_debug("Can't connect to '%s': %s", socket_path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    g_autoptr(GString) request = g_string_new(NULL);
+    add_item(request, "EVENT", event);
+    add_item(request, "DUMP_DIR", dump_dir_name);
+    if (nice)
+        add_item(request, "NICE", nice);
+    for (char **env = env_vec; env && *env; ++env)
+        add_item(request, "ENV", *env);
+
+    /* The runner may have just exited, don't die of SIGPIPE */
+    if (send(fd, request->str, request->len, MSG_NOSIGNAL) != (ssize_t)request->len
+     || shutdown(fd, SHUT_WR) != 0)
+    {
+        log_debug("Can't send the request to '%s': %s", socket_path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static GString *read_request(int fd, unsigned timeout_sec)
+{
+    /* sa.sa_flags.SA_RESTART bit is clear: make SIGALRM interrupt read */
+    struct sigaction sa, old_sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = dummy_handler;
+    sigaction(SIGALRM, &sa, &old_sa);
+    alarm(timeout_sec);
+
+    GString *request = g_string_new(NULL);
+    for (;;)
+    {
+        char buf[4 * 1024];
+        ssize_t r = read(fd, buf, sizeof(buf));
+        if (r == 0)
+            break;
+        if (r < 0)
+        {
+            perror_msg("Can't read run request");
+            g_string_free(request, TRUE);
+            request = NULL;
+            break;
+        }
+        g_string_append_len(request, buf, r);
+        if (request->len > MAX_REQUEST_SIZE)
+        {
+            error_msg("Run request is too long");
+            g_string_free(request, TRUE);
+            request = NULL;
+            break;
+        }
+    }
+
+    alarm(0);
+    sigaction(SIGALRM, &old_sa, NULL);
+    return request;
+}
+
+static bool parse_request(GString *data, struct abrt_event_run_request *request)
+{
+    /* An unterminated item at the end is ignored */
+    const char *const end = data->str + data->len;
+    for (const char *item = data->str;
+         item < end && memchr(item, '\0', end - item) != NULL;
+         item += strlen(item) + 1)
+    {
+        if (g_str_has_prefix(item, "EVENT="))
+            request->event = item + strlen("EVENT=");
+        else if (g_str_has_prefix(item, "DUMP_DIR="))
+            request->dump_dir_name = item + strlen("DUMP_DIR=");
+        else if (g_str_has_prefix(item, "NICE="))
+            request->nice = atoi(item + strlen("NICE="));
+        else if (g_str_has_prefix(item, "ENV=") && strchr(item + strlen("ENV="), '=') != NULL)
+            g_ptr_array_add(request->env, (gpointer)(item + strlen("ENV=")));
+        else
+        {
+            error_msg("Invalid item in run request: '%s'", item);
+            return false;
+        }
+    }
+
+    if (request->event == NULL || request->dump_dir_name == NULL)
+    {
+        error_msg("Run request lacks the event or the problem directory");
+        return false;
+    }
+
+    return true;
+}
+
+int abrt_event_runner_handle_request(int fd, uid_t allowed_uid, unsigned timeout_sec,
+                                     abrt_event_runner_callback run, void *param)
+{
+    struct ucred cr;
+    socklen_t crlen = sizeof(cr);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cr, &crlen) != 0 || crlen != sizeof(cr))
+    {
+        perror_msg("getsockopt(SO_PEERCRED)");
+        return 1;
+    }
+    if (cr.uid != allowed_uid)
+    {
+        error_msg("Refusing run request of uid %lu", (long unsigned)cr.uid);
+        return 1;
+    }
+
+    g_autoptr(GString) data = read_request(fd, timeout_sec);
+    if (data == NULL)
+        return 1;
+
+    g_autoptr(GPtrArray) env = g_ptr_array_new();
+    struct abrt_event_run_request request = { .env = env };
+    if (!parse_request(data, &request))
+        return 1;
+
+    log_info("Running '%s' on '%s'", request.event, request.dump_dir_name);
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror_msg("fork");
+        return 1;
+    }
+    if (pid == 0)
+    {
+        libreport_xmove_fd(libreport_xopen("/dev/null", O_RDONLY), STDIN_FILENO);
+        libreport_xdup2(fd, STDOUT_FILENO);
+        libreport_xdup2(fd, STDERR_FILENO);
+        close(fd);
+
+        for (unsigned i = 0; i < env->len; ++i)
+            putenv(g_ptr_array_index(env, i));
+
+        exit(run(&request, param));
+    }
+
+    int status;
+    if (libreport_safe_waitpid(pid, &status, 0) <= 0)
+    {
+        perror_msg("waitpid(%d)", pid);
+        return 1;
+    }
+
+    g_autofree char *reply = g_strdup_printf("EXIT_STATUS: %d\n", status);
+    libreport_full_write_str(fd, reply);
+
+    return 0;
+}
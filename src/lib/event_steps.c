@@ -0,0 +1,711 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <glob.h>
+#include <poll.h>
+#include "libabrt.h"
+
+/* The same limit libreport has */
+#define MAX_INCLUDE_DEPTH 32
+
+#define DIRECTIVE_READS "#@reads"
+#define DIRECTIVE_WRITES "#@writes"
+
+enum condition_op
+{
+    COND_EQ,
+    COND_NE,
+    COND_REGEX,
+    COND_NOT_REGEX,
+};
+
+struct condition
+{
+    char *name;
+    char *value;
+    enum condition_op op;
+    /* Compiled only for COND_REGEX and COND_NOT_REGEX */
+    regex_t regex;
+};
+
+struct event_rule
+{
+    GPtrArray *conditions;
+    char *command;
+    /* The rule has at least one #@reads or #@writes line */
+    bool declared;
+    /* Elements read by the command and by the conditions */
+    GHashTable *reads;
+    GHashTable *writes;
+};
+
+struct abrt_event_rules
+{
+    /* struct event_rule in the order of the configuration */
+    GPtrArray *rules;
+    /* Loaded files and directories of includes -> struct source_stamp */
+    GHashTable *sources;
+};
+
+/* The rules are reloaded if any of the stamps changes */
+struct source_stamp
+{
+    bool exists;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+};
+
+struct event_step
+{
+    const struct event_rule *rule;
+    pid_t pid;
+    int fd;
+    GString *output;
+};
+
+static void condition_free(struct condition *cond)
+{
+    if (cond->op == COND_REGEX || cond->op == COND_NOT_REGEX)
+        regfree(&cond->regex);
+    g_free(cond->name);
+    g_free(cond->value);
+    g_free(cond);
+}
+
+static void event_rule_free(struct event_rule *rule)
+{
+    g_ptr_array_free(rule->conditions, TRUE);
+    g_free(rule->command);
+    g_hash_table_destroy(rule->reads);
+    g_hash_table_destroy(rule->writes);
+    g_free(rule);
+}
+
+/* NAME=VALUE, NAME!=VALUE, NAME~=REGEX or NAME!~=REGEX */
+static struct condition *parse_condition(const char *word)
+{
+    const char *eq = strchr(word, '=');
+    if (eq == NULL || eq == word)
+        return NULL;
+
+    const char *name_end = eq;
+    enum condition_op op = COND_EQ;
+    if (name_end[-1] == '~')
+    {
+        op = COND_REGEX;
+        --name_end;
+    }
+    if (name_end > word && name_end[-1] == '!')
+    {
+        op = op == COND_REGEX ? COND_NOT_REGEX : COND_NE;
+        --name_end;
+    }
+    if (name_end == word)
+        return NULL;
+
+    for (const char *c = word; c < name_end; ++c)
+        if (!isalnum(*c) && *c != '_' && *c != '-' && *c != '.')
+            return NULL;
+
+    struct condition *cond = g_new0(struct condition, 1);
+    cond->name = g_strndup(word, name_end - word);
+    cond->value = g_strdup(eq + 1);
+    cond->op = op;
+    if ((op == COND_REGEX || op == COND_NOT_REGEX)
+     && regcomp(&cond->regex, cond->value, REG_NOSUB) != 0)
+    {
+        error_msg("Invalid regular expression in condition '%s'", word);
+        cond->op = COND_EQ;
+        condition_free(cond);
+        return NULL;
+    }
+
+    return cond;
+}
+
+static void add_declared_elements(GHashTable *set, const char *list)
+{
+    g_auto(GStrv) names = g_strsplit_set(list, " \t", -1);
+    for (char **name = names; *name; ++name)
+        if ((*name)[0] != '\0')
+            g_hash_table_add(set, g_strdup(*name));
+}
+
+static void parse_declarations(struct event_rule *rule)
+{
+    g_auto(GStrv) lines = g_strsplit(rule->command, "\n", -1);
+    for (char **l = lines; *l; ++l)
+    {
+        const char *line = *l;
+        while (isspace(*line))
+            ++line;
+
+        if (g_str_has_prefix(line, DIRECTIVE_READS)
+         && (line[strlen(DIRECTIVE_READS)] == '\0' || isspace(line[strlen(DIRECTIVE_READS)])))
+        {
+            rule->declared = true;
+            add_declared_elements(rule->reads, line + strlen(DIRECTIVE_READS));
+        }
+        else if (g_str_has_prefix(line, DIRECTIVE_WRITES)
+              && (line[strlen(DIRECTIVE_WRITES)] == '\0' || isspace(line[strlen(DIRECTIVE_WRITES)])))
+        {
+            rule->declared = true;
+            add_declared_elements(rule->writes, line + strlen(DIRECTIVE_WRITES));
+        }
+    }
+
+    /* Conditions are evaluated when the step starts */
+    for (unsigned i = 0; i < rule->conditions->len; ++i)
+    {
+        const struct condition *cond = g_ptr_array_index(rule->conditions, i);
+        if (strcmp(cond->name, "EVENT") != 0)
+            g_hash_table_add(rule->reads, g_strdup(cond->name));
+    }
+}
+
+static void get_source_stamp(const char *path, struct source_stamp *stamp)
+{
+    struct stat st;
+    memset(stamp, 0, sizeof(*stamp));
+    if (stat(path, &st) != 0)
+        return;
+
+    stamp->exists = true;
+    stamp->dev = st.st_dev;
+    stamp->ino = st.st_ino;
+    stamp->size = st.st_size;
+    stamp->mtime = st.st_mtim;
+}
+
+static void add_source(struct abrt_event_rules *rules, const char *path)
+{
+    if (g_hash_table_contains(rules->sources, path))
+        return;
+
+    struct source_stamp *stamp = g_new(struct source_stamp, 1);
+    get_source_stamp(path, stamp);
+    g_hash_table_insert(rules->sources, g_strdup(path), stamp);
+}
+
+static void load_rules_file(struct abrt_event_rules *rules, const char *conf_file, unsigned depth);
+
+static void include_files(struct abrt_event_rules *rules, const char *conf_file, const char *pattern, unsigned depth)
+{
+    g_autofree char *path = NULL;
+    if (pattern[0] == '/')
+        path = g_strdup(pattern);
+    else
+    {
+        g_autofree char *dir = g_path_get_dirname(conf_file);
+        path = g_build_filename(dir, pattern, NULL);
+    }
+
+    /* Adding or removing a file changes the directory */
+    g_autofree char *include_dir = g_path_get_dirname(path);
+    add_source(rules, include_dir);
+
+    glob_t globbuf;
+    memset(&globbuf, 0, sizeof(globbuf));
+    if (glob(path, 0, NULL, &globbuf) == 0)
+    {
+        for (size_t i = 0; i < globbuf.gl_pathc; ++i)
+            load_rules_file(rules, globbuf.gl_pathv[i], depth + 1);
+    }
+    globfree(&globbuf);
+}
+
+/* Reads the format of libreport's report_event.conf: a line starting with
+ * conditions begins a rule, the command may follow them and continues on
+ * the following indented lines.
+ */
+static void load_rules_file(struct abrt_event_rules *rules, const char *conf_file, unsigned depth)
+{
+    if (depth > MAX_INCLUDE_DEPTH)
+    {
+        error_msg("Too deep include nesting in '%s'", conf_file);
+        return;
+    }
+
+    add_source(rules, conf_file);
+
+    FILE *fp = fopen(conf_file, "r");
+    if (!fp)
+    {
+        if (depth == 0)
+            perror_msg("Can't open '%s'", conf_file);
+        return;
+    }
+
+    struct event_rule *rule = NULL;
+    GString *command = g_string_new(NULL);
+    char *line;
+    while ((line = libreport_xmalloc_fgetline(fp)) != NULL)
+    {
+        if (line[0] == '\0')
+        {
+            free(line);
+            continue;
+        }
+
+        if (isspace(line[0]))
+        {
+            /* Continuation of the command of the current rule */
+            if (rule != NULL && line[strspn(line, " \t")] != '\0')
+            {
+                if (command->len > 0)
+                    g_string_append_c(command, '\n');
+                g_string_append(command, line);
+            }
+            free(line);
+            continue;
+        }
+
+        if (rule != NULL)
+        {
+            rule->command = g_string_free(command, FALSE);
+            command = g_string_new(NULL);
+            parse_declarations(rule);
+            g_ptr_array_add(rules->rules, rule);
+            rule = NULL;
+        }
+
+        /* One # comments out a whole rule, its indented lines are skipped */
+        if (line[0] == '#')
+        {
+            free(line);
+            continue;
+        }
+
+        if (g_str_has_prefix(line, "include") && isspace(line[strlen("include")]))
+        {
+            g_autofree char *pattern = g_strstrip(g_strdup(line + strlen("include")));
+            include_files(rules, conf_file, pattern, depth);
+            free(line);
+            continue;
+        }
+
+        rule = g_new0(struct event_rule, 1);
+        rule->conditions = g_ptr_array_new_with_free_func((GDestroyNotify)condition_free);
+        rule->reads = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        rule->writes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+        /* Leading NAME[!~]=VALUE words are conditions, the rest is the command */
+        char *p = line;
+        while (*p != '\0')
+        {
+            char *end = p + strcspn(p, " \t");
+            g_autofree char *word = g_strndup(p, end - p);
+            struct condition *cond = parse_condition(word);
+            if (cond == NULL)
+                break;
+            g_ptr_array_add(rule->conditions, cond);
+            p = end + strspn(end, " \t");
+        }
+        g_string_append(command, p);
+        free(line);
+    }
+
+    if (rule != NULL)
+    {
+        rule->command = g_string_free(command, FALSE);
+        command = NULL;
+        parse_declarations(rule);
+        g_ptr_array_add(rules->rules, rule);
+    }
+    if (command != NULL)
+        g_string_free(command, TRUE);
+    fclose(fp);
+}
+
+struct abrt_event_rules *abrt_event_rules_load(const char *conf_file)
+{
+    struct abrt_event_rules *rules = g_new0(struct abrt_event_rules, 1);
+    rules->rules = g_ptr_array_new_with_free_func((GDestroyNotify)event_rule_free);
+    rules->sources = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    load_rules_file(rules, conf_file, 0);
+    log_debug("Loaded %u event rules from '%s'", rules->rules->len, conf_file);
+    return rules;
+}
+
+void abrt_event_rules_free(struct abrt_event_rules *rules)
+{
+    if (rules == NULL)
+        return;
+
+    g_ptr_array_free(rules->rules, TRUE);
+    g_hash_table_destroy(rules->sources);
+    g_free(rules);
+}
+
+bool abrt_event_rules_changed(struct abrt_event_rules *rules)
+{
+    GHashTableIter iter;
+    gpointer path, value;
+    g_hash_table_iter_init(&iter, rules->sources);
+    while (g_hash_table_iter_next(&iter, &path, &value))
+    {
+        const struct source_stamp *stamp = value;
+        struct source_stamp current;
+        get_source_stamp(path, &current);
+        if (current.exists != stamp->exists
+         || current.dev != stamp->dev
+         || current.ino != stamp->ino
+         || current.size != stamp->size
+         || current.mtime.tv_sec != stamp->mtime.tv_sec
+         || current.mtime.tv_nsec != stamp->mtime.tv_nsec)
+        {
+            log_debug("'%s' has changed", (char *)path);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* As in libreport, a regular expression matches if it matches a line */
+static bool regex_matches_line(const regex_t *regex, const char *value)
+{
+    g_auto(GStrv) lines = g_strsplit(value, "\n", -1);
+    for (char **line = lines; *line; ++line)
+        if (regexec(regex, *line, 0, NULL, 0) == 0)
+            return true;
+
+    return false;
+}
+
+static bool condition_matches(const struct condition *cond, const char *value)
+{
+    switch (cond->op)
+    {
+        case COND_EQ:
+            return strcmp(value, cond->value) == 0;
+        case COND_NE:
+            return strcmp(value, cond->value) != 0;
+        case COND_REGEX:
+            return regex_matches_line(&cond->regex, value);
+        case COND_NOT_REGEX:
+            return !regex_matches_line(&cond->regex, value);
+    }
+
+    return false;
+}
+
+static bool rule_is_for_event(const struct event_rule *rule, const char *event)
+{
+    bool has_event = false;
+    for (unsigned i = 0; i < rule->conditions->len; ++i)
+    {
+        const struct condition *cond = g_ptr_array_index(rule->conditions, i);
+        if (strcmp(cond->name, "EVENT") != 0)
+            continue;
+
+        if (!condition_matches(cond, event))
+            return false;
+        has_event = true;
+    }
+
+    return has_event;
+}
+
+/* A missing element is an empty string, so NAME= matches if there is none */
+static bool rule_matches(const struct event_rule *rule, struct dump_dir *dd)
+{
+    for (unsigned i = 0; i < rule->conditions->len; ++i)
+    {
+        const struct condition *cond = g_ptr_array_index(rule->conditions, i);
+        if (strcmp(cond->name, "EVENT") == 0)
+            continue;
+
+        g_autofree char *value = dd_load_text_ext(dd, cond->name,
+                                                  DD_FAIL_QUIETLY_ENOENT | DD_FAIL_QUIETLY_EACCES
+                                                  | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
+        if (!condition_matches(cond, value ? value : ""))
+            return false;
+    }
+
+    return true;
+}
+
+bool abrt_event_rules_have_declared_step(struct abrt_event_rules *rules, const char *event)
+{
+    for (unsigned i = 0; i < rules->rules->len; ++i)
+    {
+        const struct event_rule *rule = g_ptr_array_index(rules->rules, i);
+        if (rule->declared && rule_is_for_event(rule, event))
+            return true;
+    }
+
+    return false;
+}
+
+static bool sets_intersect(GHashTable *a, GHashTable *b)
+{
+    GHashTableIter iter;
+    gpointer name;
+    g_hash_table_iter_init(&iter, a);
+    while (g_hash_table_iter_next(&iter, &name, NULL))
+        if (g_hash_table_contains(b, name))
+            return true;
+
+    return false;
+}
+
+/* The conditions of a rule can be evaluated when no running step can change
+ * the elements they check */
+static bool rule_conditions_are_stable(const struct event_rule *rule, GPtrArray *running)
+{
+    for (unsigned i = 0; i < running->len; ++i)
+    {
+        const struct event_step *step = g_ptr_array_index(running, i);
+        if (!step->rule->declared)
+            return false;
+
+        for (unsigned j = 0; j < rule->conditions->len; ++j)
+        {
+            const struct condition *cond = g_ptr_array_index(rule->conditions, j);
+            if (g_hash_table_contains(step->rule->writes, cond->name))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/* A rule which doesn't declare its elements runs alone. A declared rule waits
+ * for the running steps writing what it reads or touching what it writes.
+ */
+static bool rule_can_start(const struct event_rule *rule, GPtrArray *running)
+{
+    if (running->len == 0)
+        return true;
+    if (!rule->declared)
+        return false;
+
+    for (unsigned i = 0; i < running->len; ++i)
+    {
+        const struct event_step *step = g_ptr_array_index(running, i);
+        if (!step->rule->declared
+         || sets_intersect(rule->reads, step->rule->writes)
+         || sets_intersect(rule->writes, step->rule->writes)
+         || sets_intersect(rule->writes, step->rule->reads))
+            return false;
+    }
+
+    return true;
+}
+
+static struct event_step *start_step(const struct event_rule *rule, const char *dump_dir_name, const char *event)
+{
+    char *argv[4];
+    argv[0] = (char *) "/bin/sh";
+    argv[1] = (char *) "-c";
+    argv[2] = rule->command;
+    argv[3] = NULL;
+
+    /* Absolute like libreport exports it, the commands may change
+     * the working directory */
+    g_autofree char *full_name = realpath(dump_dir_name, NULL);
+    char *env_vec[3];
+    env_vec[0] = g_strdup_printf("DUMP_DIR=%s", full_name ? full_name : dump_dir_name);
+    env_vec[1] = g_strdup_printf("EVENT=%s", event);
+    env_vec[2] = NULL;
+
+    log_debug("Executing '%s'", rule->command);
+
+    int pipeout[2];
+    struct event_step *step = g_new0(struct event_step, 1);
+    step->rule = rule;
+    step->pid = libreport_fork_execv_on_steroids(EXECFLG_INPUT_NUL | EXECFLG_OUTPUT | EXECFLG_ERR2OUT | EXECFLG_SETPGID,
+                                                 argv, pipeout, env_vec, (char *)dump_dir_name,
+                                                 /*uid(unused):*/ 0);
+    step->fd = pipeout[0];
+    step->output = g_string_new(NULL);
+
+    g_free(env_vec[0]);
+    g_free(env_vec[1]);
+
+    return step;
+}
+
+static void log_step_line(struct abrt_event_run_state *state, const char *line)
+{
+    if (state->logging_callback == NULL)
+        return;
+
+    char *log_line = state->logging_callback(g_strdup(line), state->logging_param);
+    g_free(log_line);
+}
+
+/* Passes the complete lines of the step's output to the logging callback.
+ * Returns false at the end of the output.
+ */
+static bool read_step_output(struct abrt_event_run_state *state, struct event_step *step)
+{
+    char buf[4096];
+    const ssize_t r = libreport_safe_read(step->fd, buf, sizeof(buf));
+    if (r > 0)
+        g_string_append_len(step->output, buf, r);
+
+    char *newline;
+    while ((newline = memchr(step->output->str, '\n', step->output->len)) != NULL)
+    {
+        *newline = '\0';
+        log_step_line(state, step->output->str);
+        g_string_erase(step->output, 0, newline - step->output->str + 1);
+    }
+
+    if (r > 0)
+        return true;
+
+    /* The last line without a newline */
+    if (step->output->len > 0)
+        log_step_line(state, step->output->str);
+    return false;
+}
+
+/* The return value has the meaning of the exit code of the step */
+static int finish_step(struct event_step *step)
+{
+    close(step->fd);
+
+    int status = 0;
+    if (libreport_safe_waitpid(step->pid, &status, 0) <= 0)
+    {
+        perror_msg("waitpid(%d)", (int)step->pid);
+        status = 1 << 8;
+    }
+
+    g_string_free(step->output, TRUE);
+    g_free(step);
+
+    if (WIFSIGNALED(status))
+        return WTERMSIG(status) + 128;
+    return WEXITSTATUS(status);
+}
+
+int abrt_run_event_steps(struct abrt_event_rules *rules, struct abrt_event_run_state *state,
+                         const char *dump_dir_name, const char *event)
+{
+    const unsigned max_workers = state->max_workers > 0 ? state->max_workers : 1;
+    g_autoptr(GPtrArray) running = g_ptr_array_new();
+    unsigned next = 0;
+    /* The conditions of the next rule matched, it waits for a worker */
+    bool next_matches = false;
+    bool stop = false;
+    int retval = 0;
+
+    state->children_count = 0;
+
+    for (;;)
+    {
+        /* Start the following steps in the order of the rules */
+        while (!stop && next < rules->rules->len && running->len < max_workers)
+        {
+            const struct event_rule *rule = g_ptr_array_index(rules->rules, next);
+            if (!rule_is_for_event(rule, event))
+            {
+                ++next;
+                continue;
+            }
+
+            if (!next_matches)
+            {
+                if (!rule_conditions_are_stable(rule, running))
+                    break;
+
+                struct dump_dir *dd = dd_opendir(dump_dir_name, DD_OPEN_READONLY | DD_FAIL_QUIETLY_EACCES);
+                if (!dd)
+                {
+                    retval = 1;
+                    stop = true;
+                    break;
+                }
+                next_matches = rule_matches(rule, dd);
+                dd_close(dd);
+                if (!next_matches)
+                {
+                    ++next;
+                    continue;
+                }
+            }
+
+            if (!rule_can_start(rule, running))
+                break;
+
+            g_ptr_array_add(running, start_step(rule, dump_dir_name, event));
+            state->children_count++;
+            ++next;
+            next_matches = false;
+        }
+
+        if (running->len == 0)
+            break;
+
+        g_autofree struct pollfd *pfds = g_new0(struct pollfd, running->len);
+        for (unsigned i = 0; i < running->len; ++i)
+        {
+            const struct event_step *step = g_ptr_array_index(running, i);
+            pfds[i].fd = step->fd;
+            pfds[i].events = POLLIN;
+        }
+        if (poll(pfds, running->len, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror_msg_and_die("poll");
+        }
+
+        /* Walk backwards, finished steps are removed */
+        for (unsigned i = running->len; i-- > 0;)
+        {
+            if (pfds[i].revents == 0)
+                continue;
+
+            struct event_step *step = g_ptr_array_index(running, i);
+            if (read_step_output(state, step))
+                continue;
+
+            g_ptr_array_remove_index(running, i);
+            const int r = finish_step(step);
+            if (r != 0 && retval == 0)
+            {
+                retval = r;
+                stop = true;
+                /* The event failed, the results of the other steps are useless */
+                for (unsigned j = 0; j < running->len; ++j)
+                {
+                    const struct event_step *other = g_ptr_array_index(running, j);
+                    log_info("Terminating '%s'", other->rule->command);
+                    kill(-other->pid, SIGTERM);
+                }
+            }
+        }
+
+        /* The directory doesn't change while no step runs */
+        if (!stop && running->len == 0 && state->post_run_callback)
+        {
+            retval = state->post_run_callback(dump_dir_name, state->post_run_param);
+            if (retval != 0)
+                stop = true;
+        }
+    }
+
+    return retval;
+}
@@ -15,7 +15,9 @@
     with this program; if not, write to the Free Software Foundation, Inc.,
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
+#include <sys/socket.h>
 #include <sys/statvfs.h>
+#include <sys/un.h>
 #include "internal_libabrt.h"
 
 int abrt_low_free_space(unsigned setting_MaxCrashReportsSize, const char *dump_location)
@@ -63,12 +65,16 @@ void abrt_trim_problem_dirs(const char *dirname, double cap_size, const char *ex
     }
     log_debug("excluded_basename:'%s'", excluded_basename);
 
+    g_autofree char *blob_store = g_build_filename(dirname ? dirname : "", ABRT_BLOB_STORE_DIR, NULL);
     int count = 20;
     while (--count >= 0)
     {
+        /* Blobs of the deleted directories */
+        abrt_delete_unused_blobs(blob_store);
+
         /* We exclude our own dir from candidates for deletion (3rd param): */
         g_autofree char *worst_basename = NULL;
-        double cur_size = libreport_get_dirsize_find_largest_dir(dirname, &worst_basename, excluded_basename, NULL);
+        double cur_size = abrt_get_dirsize_find_largest_dir(dirname, &worst_basename, excluded_basename, NULL);
         if (cur_size <= cap_size || !worst_basename)
         {
             log_info("cur_size:%.0f cap_size:%.0f, no (more) trimming", cur_size, cap_size);
@@ -81,6 +87,26 @@ void abrt_trim_problem_dirs(const char *dirname, double cap_size, const char *ex
     }
 }
 
+/* Nuke everything which may make setlocale() switch to non-POSIX locale:
+ * we need to avoid having gdb output in some obscure language.
+ */
+static const char *const gdb_env_vec[] = {
+    "LANG",
+    "LC_ALL",
+    "LC_COLLATE",
+    "LC_CTYPE",
+    "LC_MESSAGES",
+    "LC_MONETARY",
+    "LC_NUMERIC",
+    "LC_TIME",
+    /* Workaround for
+     * http://sourceware.org/bugzilla/show_bug.cgi?id=9622
+     * (gdb emitting ESC sequences even with -batch)
+     */
+    "TERM",
+    NULL
+};
+
 /**
  *
  * @param[out] status See `man 2 wait` for status information.
@@ -88,33 +114,13 @@ void abrt_trim_problem_dirs(const char *dirname, double cap_size, const char *ex
  */
 static char* exec_vp(char **args, int redirect_stderr, int exec_timeout_sec, int *status)
 {
-    /* Nuke everything which may make setlocale() switch to non-POSIX locale:
-     * we need to avoid having gdb output in some obscure language.
-     */
-    static const char *const env_vec[] = {
-        "LANG",
-        "LC_ALL",
-        "LC_COLLATE",
-        "LC_CTYPE",
-        "LC_MESSAGES",
-        "LC_MONETARY",
-        "LC_NUMERIC",
-        "LC_TIME",
-        /* Workaround for
-         * http://sourceware.org/bugzilla/show_bug.cgi?id=9622
-         * (gdb emitting ESC sequences even with -batch)
-         */
-        "TERM",
-        NULL
-    };
-
     int flags = EXECFLG_INPUT_NUL | EXECFLG_OUTPUT | EXECFLG_SETSID | EXECFLG_QUIET;
     if (redirect_stderr)
         flags |= EXECFLG_ERR2OUT;
     VERB1 flags &= ~EXECFLG_QUIET;
 
     int pipeout[2];
-    pid_t child = libreport_fork_execv_on_steroids(flags, args, pipeout, (char**)env_vec, /*dir:*/ NULL, /*uid(unused):*/ 0);
+    pid_t child = libreport_fork_execv_on_steroids(flags, args, pipeout, (char**)gdb_env_vec, /*dir:*/ NULL, /*uid(unused):*/ 0);
 
     /* We use this function to run gdb and unstrip. Bugs in gdb or corrupted
      * coredumps were observed to cause gdb to enter infinite loop.
@@ -169,7 +175,8 @@ static char* exec_vp(char **args, int redirect_stderr, int exec_timeout_sec, int
     return g_string_free(buf_out, FALSE);
 }
 
-char *abrt_run_unstrip_n(const char *dump_dir_name, unsigned timeout_sec)
+/* For the cores abrt_core_get_modules() doesn't understand */
+static char *run_eu_unstrip_n(const char *dump_dir_name, unsigned timeout_sec)
 {
     int flags = EXECFLG_INPUT_NUL | EXECFLG_OUTPUT | EXECFLG_SETSID | EXECFLG_QUIET;
     VERB1 flags &= ~EXECFLG_QUIET;
@@ -236,25 +243,69 @@ char *abrt_run_unstrip_n(const char *dump_dir_name, unsigned timeout_sec)
     return g_string_free(buf_out, FALSE);
 }
 
-char *abrt_get_backtrace(struct dump_dir *dd, unsigned timeout_sec, const char *debuginfo_dirs)
+char *abrt_run_unstrip_n(const char *dump_dir_name, unsigned timeout_sec)
 {
-    INITIALIZE_LIBABRT();
+    struct abrt_core_file *core = abrt_core_file_open(dump_dir_name);
+    if (!core)
+        return NULL;
+    g_autoptr(GPtrArray) modules = abrt_core_get_modules(core);
+    abrt_core_file_close(core);
+    if (!modules)
+        return run_eu_unstrip_n(dump_dir_name, timeout_sec);
+
+    // lines look like this:
+    // 0x400000+0x209000 23c77451cf6adff77fc1f5ee2a01d75de6511dda@0x40024c /usr/bin/sleep - [exe]
+    // 0x7f2b5a1d3000+0x3c4000 - /usr/lib64/libfoo.so.1 - /usr/lib64/libfoo.so.1
+    // 0x7fff313ff000+0x1000 389c7475e3d5401c55953a425a2042ef62c4c7df@0x7fff313ff2f8 . - linux-vdso.so.1
+    GString *result = g_string_new(NULL);
+    for (unsigned i = 0; i < modules->len; ++i)
+    {
+        const struct abrt_core_module *module = modules->pdata[i];
+        g_string_append_printf(result, "0x%llx+0x%llx ", module->start, module->size);
+        if (module->build_id)
+            g_string_append_printf(result, "%s@0x%llx", module->build_id, module->build_id_addr);
+        else
+            g_string_append_c(result, '-');
+        g_string_append_printf(result, " %s - %s\n",
+                module->file_name ? module->file_name : ".",
+                module->is_executable ? "[exe]" : module->file_name ? module->file_name : "linux-vdso.so.1");
+    }
 
-    char *executable = NULL;
-    if (dd_exist(dd, FILENAME_BINARY))
-        executable = g_build_filename(dd->dd_dirname ? dd->dd_dirname : "", FILENAME_BINARY, NULL);
-    else
-        executable = dd_load_text(dd, FILENAME_EXECUTABLE);
+    return g_string_free(result, FALSE);
+}
 
-    /* Let user know what's going on */
-    log_warning(_("Generating backtrace"));
+/* Larger backtraces are generated again with fewer frames */
+#define BACKTRACE_MAX_SIZE (256*1024)
+#define GDB_BACKTRACE_PLUGIN LIBEXEC_DIR"/abrt-gdb-backtrace"
+#define GDB_EXPLOITABLE_PLUGIN LIBEXEC_DIR"/abrt-gdb-exploitable"
+#define GDB_BROKER_PLUGIN LIBEXEC_DIR"/abrt-gdb-broker"
+/* Must match what the broker writes once it listens */
+#define GDB_BROKER_READY "abrt-broker: ready\n"
+/* The broker exits if no analyzer came for this long */
+#define GDB_SESSION_IDLE_SEC (10*60)
+
+static void gdb_args_add_command(GPtrArray *args, char *command)
+{
+    g_ptr_array_add(args, g_strdup("-ex"));
+    g_ptr_array_add(args, command);
+}
+
+static void gdb_args_add_plugin(GPtrArray *args, const char *plugin)
+{
+    gdb_args_add_command(args, g_strdup_printf("python exec(open(\"%s\").read())", plugin));
+}
+
+/* Returns arguments of gdb -batch loading the executable and, if load_core
+ * is true, the core of the problem directory. The caller adds its commands
+ * and the terminating NULL.
+ */
+static GPtrArray *gdb_args_new(struct dump_dir *dd, const char *debuginfo_dirs, bool load_core)
+{
+    GPtrArray *args = g_ptr_array_new_with_free_func(g_free);
+    g_ptr_array_add(args, g_strdup(GDB));
+    g_ptr_array_add(args, g_strdup("-batch"));
 
-    unsigned i = 0;
-    char *args[25];
-    args[i++] = (char*)GDB;
-    args[i++] = (char*)"-batch";
     GString *set_debug_file_directory = g_string_new(NULL);
-    unsigned auto_load_base_index = 0;
     if(debuginfo_dirs != NULL)
     {
         g_string_append(set_debug_file_directory, "set debug-file-directory /usr/lib/debug:/usr/lib");
@@ -278,19 +329,25 @@ char *abrt_get_backtrace(struct dump_dir *dd, unsigned timeout_sec, const char *
 
         g_string_append_printf(set_debug_file_directory, ":%s", debug_directories->str);
 
-        args[i++] = (char*)"-iex";
-        auto_load_base_index = i;
-        args[i++] = g_strdup_printf("add-auto-load-safe-path %s", debug_directories->str);
-        args[i++] = (char*)"-iex";
-        args[i++] = g_strdup_printf("add-auto-load-scripts-directory %s", debug_directories->str);
+        g_ptr_array_add(args, g_strdup("-iex"));
+        g_ptr_array_add(args, g_strdup_printf("add-auto-load-safe-path %s", debug_directories->str));
+        g_ptr_array_add(args, g_strdup("-iex"));
+        g_ptr_array_add(args, g_strdup_printf("add-auto-load-scripts-directory %s", debug_directories->str));
 
         g_string_free(debug_directories, TRUE);
     }
 
-    args[i++] = (char*)"-ex";
-    args[i++] = (char*)"set debuginfod enabled on";
-    const unsigned debug_dir_cmd_index = i++;
-    args[debug_dir_cmd_index] = g_string_free(set_debug_file_directory, FALSE);
+    gdb_args_add_command(args, g_strdup("set debuginfod enabled on"));
+    if (set_debug_file_directory->len > 0)
+        gdb_args_add_command(args, g_string_free(set_debug_file_directory, FALSE));
+    else
+        g_string_free(set_debug_file_directory, TRUE);
+
+    char *executable = NULL;
+    if (dd_exist(dd, FILENAME_BINARY))
+        executable = g_build_filename(dd->dd_dirname ? dd->dd_dirname : "", FILENAME_BINARY, NULL);
+    else
+        executable = dd_load_text(dd, FILENAME_EXECUTABLE);
 
     /* "file BINARY_FILE" is needed, without it gdb cannot properly
      * unwind the stack. Currently the unwind information is located
@@ -312,96 +369,325 @@ char *abrt_get_backtrace(struct dump_dir *dd, unsigned timeout_sec, const char *
      * TODO: check mtimes on COREFILE and BINARY_FILE and not supply
      * BINARY_FILE if it is newer (to at least avoid gdb complaining).
      */
-    args[i++] = (char*)"-ex";
-    const unsigned file_cmd_index = i++;
-    args[file_cmd_index] = g_strdup_printf("file %s", executable);
+    gdb_args_add_command(args, g_strdup_printf("file %s", executable));
     g_free(executable);
 
-    args[i++] = (char*)"-ex";
-    const unsigned core_cmd_index = i++;
-    args[core_cmd_index] = g_strdup_printf("core-file %s/"FILENAME_COREDUMP, dd->dd_dirname);
-
-    args[i++] = (char*)"-ex";
-    const unsigned bt_cmd_index = i++;
-    /*args[9] = ... see below */
-    args[i++] = (char*)"-ex";
-    args[i++] = (char*)"info sharedlib";
-    /* glibc's abort() stores its message in __abort_msg variable */
-    args[i++] = (char*)"-ex";
-    args[i++] = (char*)"print (char*)__abort_msg";
-    args[i++] = (char*)"-ex";
-    args[i++] = (char*)"print (char*)__glib_assert_msg";
-    args[i++] = (char*)"-ex";
-    args[i++] = (char*)"info all-registers";
-    args[i++] = (char*)"-ex";
-    const unsigned dis_cmd_index = i++;
-    args[dis_cmd_index] = (char*)"disassemble";
-    args[i++] = NULL;
-
-    /* Get the backtrace, but try to cap its size */
-    /* Limit bt depth. With no limit, gdb sometimes OOMs the machine */
-    unsigned bt_depth = 1024;
-    const char *thread_apply_all = "thread apply all -ascending";
-    const char *full = "full ";
-    char *bt = NULL;
+    if (load_core)
+        gdb_args_add_command(args, g_strdup_printf("core-file %s/"FILENAME_COREDUMP, dd->dd_dirname));
+
+    return args;
+}
+
+/* The session of an event is shared by the analyzers of one problem
+ * directory run by the same user. The event script exports
+ * ABRT_GDB_SESSION=$$ and the broker exits together with the script.
+ *
+ * The broker listens on an abstract socket, so there is no file another user
+ * could create in advance or replace; a socket of another user with the same
+ * name is refused by gdb_session_connect() and the analyzers run their own
+ * gdb then.
+ */
+static char *gdb_session_socket_name(const char *owner, const struct stat *dir_stat)
+{
+    return g_strdup_printf("abrt-gdb-%lu-%s-%llu-%llu",
+            (unsigned long)geteuid(), owner,
+            (unsigned long long)dir_stat->st_dev, (unsigned long long)dir_stat->st_ino);
+}
+
+/* Only a broker running as our user is trusted */
+static int gdb_session_connect(const char *socket_name, pid_t *broker_pid)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    const size_t name_len = strlen(socket_name);
+    if (name_len >= sizeof(addr.sun_path) - 1)
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    /* sun_path[0] == '\0' makes the socket abstract */
+    memcpy(addr.sun_path + 1, socket_name, name_len);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    if (connect(fd, (struct sockaddr *)&addr, offsetof(struct sockaddr_un, sun_path) + 1 + name_len) != 0)
+    {
+        const int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    struct ucred cred;
+    socklen_t cred_len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) != 0 || cred.uid != geteuid())
+    {
+        log_notice("Not using gdb session '%s' of another user", socket_name);
+        close(fd);
+        errno = EPERM;
+        return -1;
+    }
+
+    *broker_pid = cred.pid;
+    return fd;
+}
+
+/* Reads from the non-blocking fd until EOF or the deadline.
+ * Returns false on timeout.
+ */
+static bool read_until(int fd, GString *buf, time_t endtime, const char *stop_at)
+{
     while (1)
     {
-        args[bt_cmd_index] = g_strdup_printf("%s backtrace %s%u", thread_apply_all, full, bt_depth);
-        bt = exec_vp(args, /*redirect_stderr:*/ 1, timeout_sec, NULL);
-        free(args[bt_cmd_index]);
-        if ((bt && strnlen(bt, 256*1024) < 256*1024) || bt_depth <= 32)
+        const time_t now = time(NULL);
+        if (now > endtime)
+            return false;
+
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, (endtime - now + 1) * 1000) < 0 && errno != EINTR)
+            return false;
+
+        char buff[4096];
+        const ssize_t r = read(fd, buff, sizeof(buff));
+        if (r < 0 && (errno == EAGAIN || errno == EINTR))
+            continue;
+        if (r <= 0)
+            return true;
+
+        g_string_append_len(buf, buff, r);
+        if (stop_at && strstr(buf->str, stop_at))
+            return true;
+    }
+}
+
+/* Runs gdb with the broker plugin in the background and waits until it
+ * listens. The broker loads the core itself, so it can prepend the output of
+ * loading it (the signal, the crashed frame) to its replies.
+ */
+static bool gdb_session_start(struct dump_dir *dd, const char *dir_path,
+                              const char *socket_name, const char *owner,
+                              unsigned timeout_sec)
+{
+    if (access(GDB_BROKER_PLUGIN, R_OK) != 0)
+        return false;
+
+    log_info("Starting gdb session for '%s'", dir_path);
+
+    GPtrArray *args = gdb_args_new(dd, NULL, /*load_core:*/ false);
+    gdb_args_add_plugin(args, GDB_BACKTRACE_PLUGIN);
+    if (access(GDB_EXPLOITABLE_PLUGIN, R_OK) == 0)
+        gdb_args_add_plugin(args, GDB_EXPLOITABLE_PLUGIN);
+    gdb_args_add_plugin(args, GDB_BROKER_PLUGIN);
+    gdb_args_add_command(args, g_strdup_printf("abrt-broker %s %s %u "FILENAME_COREDUMP,
+                         socket_name, owner, GDB_SESSION_IDLE_SEC));
+    g_ptr_array_add(args, NULL);
+
+    /* The broker outlives us; it is reaped by init once we exit */
+    int pipeout[2];
+    pid_t child = libreport_fork_execv_on_steroids(
+                EXECFLG_INPUT_NUL | EXECFLG_OUTPUT | EXECFLG_ERR2OUT | EXECFLG_SETSID,
+                (char **)args->pdata, pipeout, (char**)gdb_env_vec, (char *)dir_path, /*uid(unused):*/ 0);
+    g_ptr_array_free(args, TRUE);
+
+    libreport_ndelay_on(pipeout[0]);
+    GString *output = g_string_new(NULL);
+    const bool finished = read_until(pipeout[0], output, time(NULL) + timeout_sec, GDB_BROKER_READY);
+    close(pipeout[0]);
+
+    const bool ready = finished && strstr(output->str, GDB_BROKER_READY) != NULL;
+    if (!ready)
+    {
+        log_notice("gdb session didn't start: %s", output->str);
+        kill(child, SIGKILL);
+        libreport_safe_waitpid(child, NULL, 0);
+    }
+
+    g_string_free(output, TRUE);
+    return ready;
+}
+
+char *abrt_gdb_session_execute(struct dump_dir *dd, const char *const *commands, unsigned timeout_sec)
+{
+    INITIALIZE_LIBABRT();
+
+    const char *owner = getenv("ABRT_GDB_SESSION");
+    if (owner == NULL || owner[0] == '\0' || owner[strspn(owner, "0123456789")] != '\0')
+        return NULL;
+
+    g_autofree char *dir_path = realpath(dd->dd_dirname, NULL);
+    struct stat dir_stat;
+    if (dir_path == NULL || strchr(dir_path, '\n') || stat(dir_path, &dir_stat) != 0)
+        return NULL;
+
+    g_autofree char *socket_name = gdb_session_socket_name(owner, &dir_stat);
+    pid_t broker_pid;
+    int fd = gdb_session_connect(socket_name, &broker_pid);
+    /* An abstract socket disappears with its broker */
+    if (fd < 0 && errno == ECONNREFUSED)
+    {
+        if (gdb_session_start(dd, dir_path, socket_name, owner, timeout_sec))
+            fd = gdb_session_connect(socket_name, &broker_pid);
+    }
+    if (fd < 0)
+        return NULL;
+
+    GString *request = g_string_new(dir_path);
+    g_string_append_c(request, '\n');
+    for (; *commands; ++commands)
+    {
+        /* Commands are sent one per line */
+        if (strchr(*commands, '\n'))
         {
-            break;
+            error_msg("gdb command can't contain a newline: '%s'", *commands);
+            g_string_free(request, TRUE);
+            close(fd);
+            return NULL;
         }
+        g_string_append_printf(request, "%s\n", *commands);
+    }
+    const bool sent = libreport_full_write(fd, request->str, request->len) == request->len;
+    g_string_free(request, TRUE);
+    shutdown(fd, SHUT_WR);
+
+    GString *reply = g_string_new(NULL);
+    libreport_ndelay_on(fd);
+    if (!sent || !read_until(fd, reply, time(NULL) + timeout_sec, NULL))
+    {
+        /* Bugs in gdb or corrupted coredumps can cause gdb to enter infinite
+         * loop, don't let the next analyzer wait for it */
+        log_warning("gdb session didn't reply in %u seconds, killing it", timeout_sec);
+        kill(broker_pid, SIGKILL);
+        close(fd);
+        g_string_free(reply, TRUE);
+        return NULL;
+    }
+    close(fd);
 
-        bt_depth /= 2;
+    if (strncmp(reply->str, "OK\n", 3) != 0)
+    {
+        log_notice("gdb session refused the request: %s", reply->str);
+        g_string_free(reply, TRUE);
+        return NULL;
+    }
+
+    g_string_erase(reply, 0, 3);
+    return g_string_free(reply, FALSE);
+}
+
+char *abrt_get_backtrace(struct dump_dir *dd, unsigned timeout_sec, const char *debuginfo_dirs)
+{
+    INITIALIZE_LIBABRT();
+
+    /* Let user know what's going on */
+    log_warning(_("Generating backtrace"));
+
+    g_autofree char *bt_cmd = g_strdup_printf("abrt-backtrace %u", BACKTRACE_MAX_SIZE);
+
+    /* The session doesn't know about the extra debuginfo directories */
+    if (debuginfo_dirs == NULL)
+    {
+        const char *const commands[] = { bt_cmd, NULL };
+        char *bt = abrt_gdb_session_execute(dd, commands, timeout_sec);
         if (bt)
-        {
-            log_warning("Backtrace is too big (%u bytes), reducing depth to %u",
-                        (unsigned)strlen(bt), bt_depth);
-        }
-        else
-        {
-            /* (NB: in fact, current impl. of exec_vp() never returns NULL) */
-            log_warning("Failed to generate backtrace, reducing depth to %u",
-                        bt_depth);
-            g_clear_pointer(&bt, free);
-        }
+            return bt;
+    }
 
-        /* Replace -ex disassemble (which disasms entire function $pc points to)
-         * to a version which analyzes limited, small patch of code around $pc.
-         * (Users reported a case where bare "disassemble" attempted to process
-         * entire .bss).
-         * TODO: what if "$pc-N" underflows? in my test, this happens:
-         * Dump of assembler code from 0xfffffffffffffff0 to 0x30:
-         * End of assembler dump.
-         * (IOW: "empty" dump)
-         */
-        args[dis_cmd_index] = (char*)"disassemble $pc-20, $pc+64";
-
-        if (bt_depth <= 64 && thread_apply_all[0] != '\0')
-        {
-            /* This program likely has gazillion threads, dont try to bt them all */
-            bt_depth = 128;
-            thread_apply_all = "";
-        }
-        if (bt_depth <= 64 && full[0] != '\0')
+    GPtrArray *args = gdb_args_new(dd, debuginfo_dirs, /*load_core:*/ true);
+    const guint common_args = args->len;
+    char *bt = NULL;
+
+    if (access(GDB_BACKTRACE_PLUGIN, R_OK) == 0)
+    {
+        /* The plugin reduces the backtrace in the same gdb session,
+         * the core and debuginfo are loaded only once */
+        gdb_args_add_plugin(args, GDB_BACKTRACE_PLUGIN);
+        gdb_args_add_command(args, g_strdup(bt_cmd));
+        g_ptr_array_add(args, NULL);
+        bt = exec_vp((char **)args->pdata, /*redirect_stderr:*/ 1, timeout_sec, NULL);
+        g_ptr_array_set_size(args, common_args);
+
+        /* gdb without python */
+        if (bt && strstr(bt, "Undefined command: \"abrt-backtrace\""))
         {
-            /* Looks like there are gigantic local structures or arrays, disable "full" bt */
-            bt_depth = 128;
-            full = "";
+            log_notice("gdb can't run '%s', falling back to a gdb run per backtrace depth",
+                       GDB_BACKTRACE_PLUGIN);
+            g_clear_pointer(&bt, free);
         }
     }
 
-    if (auto_load_base_index > 0)
+    if (bt == NULL)
     {
-        free(args[auto_load_base_index]);
-        free(args[auto_load_base_index + 2]);
+        gdb_args_add_command(args, NULL);
+        const guint bt_cmd_index = args->len - 1;
+        gdb_args_add_command(args, g_strdup("info sharedlib"));
+        /* glibc's abort() stores its message in __abort_msg variable */
+        gdb_args_add_command(args, g_strdup("print (char*)__abort_msg"));
+        gdb_args_add_command(args, g_strdup("print (char*)__glib_assert_msg"));
+        gdb_args_add_command(args, g_strdup("info all-registers"));
+        gdb_args_add_command(args, g_strdup("disassemble"));
+        const guint dis_cmd_index = args->len - 1;
+        g_ptr_array_add(args, NULL);
+
+        /* Get the backtrace, but try to cap its size */
+        /* Limit bt depth. With no limit, gdb sometimes OOMs the machine */
+        unsigned bt_depth = 1024;
+        const char *thread_apply_all = "thread apply all -ascending";
+        const char *full = "full ";
+        while (1)
+        {
+            g_free(args->pdata[bt_cmd_index]);
+            args->pdata[bt_cmd_index] = g_strdup_printf("%s backtrace %s%u", thread_apply_all, full, bt_depth);
+            bt = exec_vp((char **)args->pdata, /*redirect_stderr:*/ 1, timeout_sec, NULL);
+            if ((bt && strnlen(bt, BACKTRACE_MAX_SIZE) < BACKTRACE_MAX_SIZE) || bt_depth <= 32)
+            {
+                break;
+            }
+
+            bt_depth /= 2;
+            if (bt)
+            {
+                log_warning("Backtrace is too big (%u bytes), reducing depth to %u",
+                            (unsigned)strlen(bt), bt_depth);
+            }
+            else
+            {
+                /* (NB: in fact, current impl. of exec_vp() never returns NULL) */
+                log_warning("Failed to generate backtrace, reducing depth to %u",
+                            bt_depth);
+            }
+            g_clear_pointer(&bt, free);
+
+            /* Replace -ex disassemble (which disasms entire function $pc points to)
+             * to a version which analyzes limited, small patch of code around $pc.
+             * (Users reported a case where bare "disassemble" attempted to process
+             * entire .bss).
+             * TODO: what if "$pc-N" underflows? in my test, this happens:
+             * Dump of assembler code from 0xfffffffffffffff0 to 0x30:
+             * End of assembler dump.
+             * (IOW: "empty" dump)
+             */
+            g_free(args->pdata[dis_cmd_index]);
+            args->pdata[dis_cmd_index] = g_strdup("disassemble $pc-20, $pc+64");
+
+            if (bt_depth <= 64 && thread_apply_all[0] != '\0')
+            {
+                /* This program likely has gazillion threads, dont try to bt them all */
+                bt_depth = 128;
+                thread_apply_all = "";
+            }
+            if (bt_depth <= 64 && full[0] != '\0')
+            {
+                /* Looks like there are gigantic local structures or arrays, disable "full" bt */
+                bt_depth = 128;
+                full = "";
+            }
+        }
     }
 
-    free(args[debug_dir_cmd_index]);
-    free(args[file_cmd_index]);
-    free(args[core_cmd_index]);
+    g_ptr_array_free(args, TRUE);
     return bt;
 }
 
@@ -32,6 +32,12 @@
  */
 #define SANE_MIN_OOPS_LEN 30
 
+/* How many lines before the requested range must be replayed
+ * to get the parser into the same state as if it had read
+ * the log from its beginning. See abrt_koops_extract_oopses_from_lines_range().
+ */
+#define KOOPS_PARSER_RESYNC_LINES 256
+
 static void record_oops(GList **oops_list, const struct abrt_koops_line_info* lines_info, int oopsstart, int oopsend)
 {
     int q;
@@ -273,7 +279,7 @@ int abrt_koops_line_skip_level(const char **c)
     return linelevel;
 }
 
-void abrt_koops_extract_oopses(GList **oops_list, char *buffer, size_t buflen)
+int abrt_koops_split_lines(char *buffer, size_t buflen, struct abrt_koops_line_info **lines_info_out, bool *marker_seen)
 {
     char hostname[HOST_NAME_MAX + 1] = { 0 };
     g_autofree char *long_needle = NULL;
@@ -284,6 +290,10 @@ void abrt_koops_extract_oopses(GList **oops_list, char *buffer, size_t buflen)
     int lines_info_size = 0;
     struct abrt_koops_line_info *lines_info = NULL;
 
+    *lines_info_out = NULL;
+    if (marker_seen)
+        *marker_seen = false;
+
     if (gethostname(hostname, sizeof(hostname)) == -1)
     {
         if (ENAMETOOLONG == errno)
@@ -295,7 +305,7 @@ void abrt_koops_extract_oopses(GList **oops_list, char *buffer, size_t buflen)
              * Would only apply to extremely non-compliant systems, where
              * HOST_NAME_MAX is just a suggestion.
              */
-            g_return_if_reached();
+            g_return_val_if_reached(0);
         }
     }
 
@@ -357,7 +367,8 @@ void abrt_koops_extract_oopses(GList **oops_list, char *buffer, size_t buflen)
                     g_free(lines_info);
                     lines_info = NULL;
                     lines_info_size = 0;
-                    g_list_free_full(g_steal_pointer(oops_list), free);
+                    if (marker_seen)
+                        *marker_seen = true;
                 }
                 goto next_line;
             }
@@ -386,11 +397,50 @@ next_line:
         c = c9 + 1;
     }
 
+    *lines_info_out = lines_info;
+    return lines_info_size;
+}
+
+void abrt_koops_extract_oopses(GList **oops_list, char *buffer, size_t buflen)
+{
+    struct abrt_koops_line_info *lines_info = NULL;
+    bool marker_seen = false;
+
+    const int lines_info_size = abrt_koops_split_lines(buffer, buflen, &lines_info, &marker_seen);
+
+    /* everything before our own marker has been already reported */
+    if (marker_seen)
+        g_list_free_full(g_steal_pointer(oops_list), free);
+
     abrt_koops_extract_oopses_from_lines(oops_list, lines_info, lines_info_size);
     g_free(lines_info);
 }
 
 void abrt_koops_extract_oopses_from_lines(GList **oops_list, const struct abrt_koops_line_info *lines_info, int lines_info_size)
+{
+    abrt_koops_extract_oopses_from_lines_range(oops_list, lines_info, lines_info_size, 0, lines_info_size, NULL, NULL);
+}
+
+bool abrt_koops_parser_states_equal(const struct abrt_koops_parser_state *a, const struct abrt_koops_parser_state *b)
+{
+    return a->line == b->line
+        && a->oopsstart == b->oopsstart
+        && a->inbacktrace == b->inbacktrace
+        && a->prevlevel == b->prevlevel;
+}
+
+static void save_parser_state(struct abrt_koops_parser_state *state, int line, int oopsstart, int inbacktrace, char prevlevel)
+{
+    state->line = line;
+    state->oopsstart = oopsstart;
+    state->inbacktrace = inbacktrace;
+    state->prevlevel = prevlevel;
+}
+
+void abrt_koops_extract_oopses_from_lines_range(GList **oops_list, const struct abrt_koops_line_info *lines_info, int lines_info_size,
+                                                int begin, int end,
+                                                struct abrt_koops_parser_state *begin_state,
+                                                struct abrt_koops_parser_state *end_state)
 {
     /* Analyze lines */
 
@@ -417,9 +467,37 @@ void abrt_koops_extract_oopses_from_lines(GList **oops_list, const struct abrt_k
     /* Registers usually(?) come listed three per line in a call trace but let's play it safe and list them all */
     register_regex_rc = regcomp(&register_regex, "^\\(R[ABCD]X\\|R[SD]I\\|RBP\\|R[0-9]\\{2\\}\\): [0-9a-f]\\+ .\\+", REG_NOSUB);
 
-    i = 0;
+    /* An oops is dropped after 80 lines and the end marker is looked up
+     * 50 lines ahead, so when we are asked to start in the middle of the log,
+     * replaying some of the preceding lines usually gets the parser into
+     * the state it would have there. Oopses starting in the replayed lines
+     * are not recorded - they belong to somebody else. The callers compare
+     * the states to find out whether the replay was enough.
+     */
+    if (begin < 0)
+        begin = 0;
+    bool begin_saved = false;
+    bool end_saved = false;
+    i = MAX(0, begin - KOOPS_PARSER_RESYNC_LINES);
     while (i < lines_info_size)
     {
+        if (!begin_saved && i >= begin)
+        {
+            if (begin_state)
+                save_parser_state(begin_state, i, oopsstart, inbacktrace, prevlevel);
+            begin_saved = true;
+        }
+        if (!end_saved && i >= end)
+        {
+            if (end_state)
+                save_parser_state(end_state, i, oopsstart, inbacktrace, prevlevel);
+            end_saved = true;
+        }
+
+        /* Past our range and not inside an oops: nothing more to record */
+        if (i >= end && oopsstart < 0)
+            break;
+
         char *curline = lines_info[i].ptr;
 
         if (curline == NULL)
@@ -534,7 +612,8 @@ void abrt_koops_extract_oopses_from_lines(GList **oops_list, const struct abrt_k
             if (oopsend <= i)
             {
                 log_debug("End of oops at line %d (%d): '%s'", oopsend, i, lines_info[oopsend].ptr);
-                record_oops(oops_list, lines_info, oopsstart, oopsend);
+                if (oopsstart >= begin)
+                    record_oops(oops_list, lines_info, oopsstart, oopsend);
                 oopsstart = -1;
                 inbacktrace = 0;
             }
@@ -561,7 +640,8 @@ void abrt_koops_extract_oopses_from_lines(GList **oops_list, const struct abrt_k
                  * (MCEs, for example) don't have backtrace yet we still want to file them.
                  */
                 log_debug("One-line oops at line %d: '%s'", oopsstart, lines_info[oopsstart].ptr);
-                record_oops(oops_list, lines_info, oopsstart, oopsstart);
+                if (oopsstart >= begin)
+                    record_oops(oops_list, lines_info, oopsstart, oopsstart);
                 /*inbacktrace = 0; - already is */
                 oopsstart = -1;
                 continue;
@@ -575,8 +655,13 @@ void abrt_koops_extract_oopses_from_lines(GList **oops_list, const struct abrt_k
     regfree(&trace_regex3);
     regfree(&register_regex);
 
+    if (!begin_saved && begin_state)
+        save_parser_state(begin_state, i, oopsstart, inbacktrace, prevlevel);
+    if (!end_saved && end_state)
+        save_parser_state(end_state, i, oopsstart, inbacktrace, prevlevel);
+
     /* process last oops if we have one */
-    if (oopsstart >= 0)
+    if (oopsstart >= begin)
     {
         if (inbacktrace)
         {
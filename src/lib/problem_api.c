@@ -44,6 +44,8 @@ int for_each_problem_in_dir(const char *path,
     {
         if (libreport_dot_or_dotdot(dent->d_name))
             continue; /* skip "." and ".." */
+        if (strcmp(dent->d_name, ABRT_BLOB_STORE_DIR) == 0)
+            continue;
 
         g_autofree char *full_name = g_build_filename(path, dent->d_name, NULL);
 
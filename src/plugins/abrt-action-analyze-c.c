@@ -167,10 +167,11 @@ int main(int argc, char **argv)
 
     libreport_export_abrt_envvars(0);
 
-    char *unstrip_n_output = NULL;
-    g_autofree char *coredump_path = g_strdup_printf("%s/"FILENAME_COREDUMP, dump_dir_name);
-    if (access(coredump_path, R_OK) == 0)
-        unstrip_n_output = abrt_run_unstrip_n(dump_dir_name, /*timeout_sec:*/ 30);
+    /* Reads coredump or coredump.zst, returns NULL if there is neither.
+     * Both must give the same modules, or a cache hit, which keeps only
+     * the compressed core, would change the UUID.
+     */
+    char *unstrip_n_output = abrt_run_unstrip_n(dump_dir_name, /*timeout_sec:*/ 30);
 
     if (unstrip_n_output)
     {
@@ -0,0 +1,726 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <elf.h>
+#include <link.h>
+#include <sys/procfs.h>
+#include "libabrt.h"
+
+#include <satyr/core/stacktrace.h>
+#include <satyr/core/thread.h>
+#include <satyr/core/frame.h>
+
+#define BACKTRACE_CACHE_DIR LOCALSTATEDIR"/cache/abrt/backtrace"
+
+/* Bump when the key or the cached elements change */
+#define CACHE_KEY_VERSION 1
+
+/* Default of BacktraceCacheSize in CCpp.conf, in MiB */
+#define DEFAULT_CACHE_SIZE 16
+
+/* Stacks deeper than this aren't cached, they are rare and unlikely to
+ * repeat exactly. */
+#define MAX_STACK_SIZE (256 * 1024)
+#define MAX_NOTES_SIZE (16 * 1024 * 1024)
+
+/* Leftovers of interrupted stores older than this are removed */
+#define STALE_TMP_DIR_SEC (60 * 60)
+
+/* Only the registers of the architecture abrt runs on are known */
+#if defined(__x86_64__)
+# define CORE_MACHINE EM_X86_64
+# define REG_PC(regs) ((regs)->rip)
+# define REG_SP(regs) ((regs)->rsp)
+#elif defined(__i386__)
+# define CORE_MACHINE EM_386
+# define REG_PC(regs) ((regs)->eip)
+# define REG_SP(regs) ((regs)->esp)
+#elif defined(__aarch64__)
+# define CORE_MACHINE EM_AARCH64
+# define REG_PC(regs) ((regs)->pc)
+# define REG_SP(regs) ((regs)->sp)
+#endif
+
+/* Elements which are the same for all crashes with the same key */
+static const char *const cached_elements[] = {
+    FILENAME_CORE_BACKTRACE,
+    "exploitable",
+    NULL
+};
+
+#ifdef CORE_MACHINE
+
+struct core
+{
+    struct abrt_core_file *file;
+    ElfW(Phdr) *phdrs;
+    unsigned phnum;
+    /* NT_AUXV, a copy of the vector on the top of the main thread's stack */
+    char *auxv;
+    size_t auxv_size;
+};
+
+static int module_cmp_by_address(gconstpointer a, gconstpointer b)
+{
+    const struct abrt_core_module *ma = *(const struct abrt_core_module **)a;
+    const struct abrt_core_module *mb = *(const struct abrt_core_module **)b;
+    return ma->start < mb->start ? -1 : ma->start > mb->start;
+}
+
+/* MODULES are sorted by address */
+static const struct abrt_core_module *find_module(GPtrArray *modules, unsigned long long addr)
+{
+    unsigned lo = 0;
+    unsigned hi = modules->len;
+    while (lo < hi)
+    {
+        unsigned mid = lo + (hi - lo) / 2;
+        const struct abrt_core_module *module = modules->pdata[mid];
+        if (addr < module->start)
+            hi = mid;
+        else if (addr - module->start >= module->size)
+            lo = mid + 1;
+        else
+            return module;
+    }
+    return NULL;
+}
+
+static bool open_core(struct core *core, const char *dump_dir_name)
+{
+    core->file = abrt_core_file_open(dump_dir_name);
+    if (!core->file)
+        return false;
+
+    ElfW(Ehdr) ehdr;
+    if (!abrt_core_file_read(core->file, &ehdr, sizeof(ehdr), 0)
+     || memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0
+     || ehdr.e_ident[EI_CLASS] != (__ELF_NATIVE_CLASS == 64 ? ELFCLASS64 : ELFCLASS32)
+     || ehdr.e_type != ET_CORE
+     || ehdr.e_machine != CORE_MACHINE
+     || ehdr.e_phentsize != sizeof(ElfW(Phdr))
+     /* the real count is in section 0, cores with that many mappings aren't worth it */
+     || ehdr.e_phnum == PN_XNUM)
+    {
+        log_info("The core is not a core of this architecture");
+        return false;
+    }
+
+    core->phnum = ehdr.e_phnum;
+    core->phdrs = g_new(ElfW(Phdr), core->phnum);
+    if (!abrt_core_file_read(core->file, core->phdrs, core->phnum * sizeof(ElfW(Phdr)), ehdr.e_phoff))
+    {
+        log_info("Can't read program headers of the core");
+        return false;
+    }
+
+    return true;
+}
+
+static const ElfW(Phdr) *find_load(struct core *core, unsigned long long addr)
+{
+    for (unsigned i = 0; i < core->phnum; ++i)
+    {
+        const ElfW(Phdr) *phdr = &core->phdrs[i];
+        if (phdr->p_type == PT_LOAD && addr >= phdr->p_vaddr && addr - phdr->p_vaddr < phdr->p_filesz)
+            return phdr;
+    }
+    return NULL;
+}
+
+/* Collects NT_PRSTATUS notes of all threads, the first is the crashed one */
+static bool read_notes(struct core *core, GArray *threads, siginfo_t *siginfo)
+{
+    for (unsigned i = 0; i < core->phnum; ++i)
+    {
+        const ElfW(Phdr) *phdr = &core->phdrs[i];
+        if (phdr->p_type != PT_NOTE)
+            continue;
+        if (phdr->p_filesz > MAX_NOTES_SIZE)
+            return false;
+
+        size_t size = phdr->p_filesz;
+        g_autofree char *notes = g_malloc(size);
+        if (!abrt_core_file_read(core->file, notes, size, phdr->p_offset))
+            return false;
+
+        size_t pos = 0;
+        while (pos <= size && size - pos >= sizeof(ElfW(Nhdr)))
+        {
+            ElfW(Nhdr) nhdr;
+            memcpy(&nhdr, notes + pos, sizeof(nhdr));
+            pos += sizeof(nhdr);
+
+            const char *name = notes + pos;
+            if (nhdr.n_namesz > size - pos)
+                break;
+            pos += (nhdr.n_namesz + 3) & ~3ul;
+
+            const char *desc = notes + pos;
+            if (pos > size || nhdr.n_descsz > size - pos)
+                break;
+            pos += (nhdr.n_descsz + 3) & ~3ul;
+
+            if (nhdr.n_namesz != sizeof("CORE") || memcmp(name, "CORE", sizeof("CORE")) != 0)
+                continue;
+
+            if (nhdr.n_type == NT_PRSTATUS && nhdr.n_descsz >= sizeof(struct elf_prstatus))
+            {
+                struct elf_prstatus prstatus;
+                memcpy(&prstatus, desc, sizeof(prstatus));
+                g_array_append_val(threads, prstatus);
+            }
+            else if (nhdr.n_type == NT_SIGINFO && nhdr.n_descsz >= sizeof(*siginfo))
+                memcpy(siginfo, desc, sizeof(*siginfo));
+            else if (nhdr.n_type == NT_AUXV && !core->auxv && nhdr.n_descsz > 0)
+            {
+                core->auxv = g_malloc(nhdr.n_descsz);
+                memcpy(core->auxv, desc, nhdr.n_descsz);
+                core->auxv_size = nhdr.n_descsz;
+            }
+        }
+    }
+
+    return threads->len > 0;
+}
+
+static void key_printf(GChecksum *key, const char *format, ...)
+{
+    va_list p;
+    va_start(p, format);
+    g_autofree char *line = g_strdup_vprintf(format, p);
+    va_end(p);
+    g_checksum_update(key, (const guchar *)line, strlen(line));
+}
+
+/* Adds NAME=VALUE if the value points into a module, in a form which doesn't
+ * depend on where the module was mapped. Other values (data, pointers to the
+ * heap or to the stack) vary between runs and aren't needed to find the
+ * frames: the return addresses at their positions on the stack are.
+ */
+static bool key_add_value(GChecksum *key, GPtrArray *modules, const char *name, unsigned long long value)
+{
+    const struct abrt_core_module *module = find_module(modules, value);
+    if (!module)
+        return true;
+    if (!module->build_id)
+    {
+        log_info("0x%llx points into a module without build-id", value);
+        return false;
+    }
+    key_printf(key, "%s=%s+0x%llx\n", name, module->build_id, value - module->start);
+    return true;
+}
+
+static bool key_add_thread(GChecksum *key, struct core *core, GPtrArray *modules,
+                           const struct elf_prstatus *prstatus)
+{
+    struct user_regs_struct regs;
+    G_STATIC_ASSERT(sizeof(regs) <= sizeof(prstatus->pr_reg));
+    memcpy(&regs, &prstatus->pr_reg, sizeof(regs));
+
+    unsigned long long pc = REG_PC(&regs);
+    unsigned long long sp = REG_SP(&regs);
+    const struct abrt_core_module *module = find_module(modules, pc);
+    if (!module || !module->build_id)
+    {
+        log_info("Instruction pointer 0x%llx is not in a module with build-id", pc);
+        return false;
+    }
+
+    const ElfW(Phdr) *stack = find_load(core, sp);
+    if (!stack)
+    {
+        log_info("Stack pointer 0x%llx is not in the core", sp);
+        return false;
+    }
+    size_t size = stack->p_vaddr + stack->p_filesz - sp;
+    if (size > MAX_STACK_SIZE)
+    {
+        log_info("Stack at 0x%llx is too deep", sp);
+        return false;
+    }
+
+    key_printf(key, "thread pc=%s+0x%llx\n", module->build_id, pc - module->start);
+
+    /* The link register, ... */
+    for (unsigned i = 0; i < G_N_ELEMENTS(prstatus->pr_reg); ++i)
+    {
+        char name[sizeof("r") + sizeof(int) * 3];
+        sprintf(name, "r%u", i);
+        if (!key_add_value(key, modules, name, prstatus->pr_reg[i]))
+            return false;
+    }
+
+    g_autofree char *stack_data = g_malloc(size);
+    if (!abrt_core_file_read(core->file, stack_data, size, stack->p_offset + (sp - stack->p_vaddr)))
+        return false;
+
+    /* The main thread's stack ends with argv, the environment and the auxiliary
+     * vector, whose size differs between runs and shifts what follows it.
+     */
+    if (core->auxv)
+    {
+        const char *auxv = memmem(stack_data, size, core->auxv, core->auxv_size);
+        if (auxv)
+            size = auxv - stack_data;
+    }
+
+    /* The return addresses */
+    size_t count = size / sizeof(ElfW(Addr));
+    for (size_t i = 0; i < count; ++i)
+    {
+        ElfW(Addr) word;
+        memcpy(&word, stack_data + i * sizeof(word), sizeof(word));
+
+        char name[sizeof("sp+0x") + sizeof(size_t) * 2];
+        sprintf(name, "sp+0x%zx", i * sizeof(word));
+        if (!key_add_value(key, modules, name, word))
+            return false;
+    }
+
+    return true;
+}
+
+/* The key covers everything core_backtrace and exploitable are made of:
+ * the executable, the signal and, for each thread, the instruction pointer
+ * and the registers and stack words pointing into modules, which are the
+ * frames the unwinder will find. Modules are identified by build-id, so
+ * the key doesn't change with the address space layout.
+ *
+ * Returns the modules of the core in MODULES too, they are needed to rebase
+ * the cached frames.
+ */
+static char *compute_key(struct dump_dir *dd, GPtrArray **modules_out)
+{
+    g_autofree char *executable = dd_load_text_ext(dd, FILENAME_EXECUTABLE,
+                                                   DD_FAIL_QUIETLY_ENOENT | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
+    if (!executable)
+        return NULL;
+
+    struct core core = { 0 };
+    g_autoptr(GArray) threads = g_array_new(FALSE, FALSE, sizeof(struct elf_prstatus));
+    GPtrArray *modules = NULL;
+    g_autoptr(GChecksum) key = NULL;
+    char *result = NULL;
+
+    siginfo_t siginfo;
+    memset(&siginfo, 0, sizeof(siginfo));
+
+    if (!open_core(&core, dd->dd_dirname))
+        goto ret;
+    if (!read_notes(&core, threads, &siginfo))
+    {
+        log_info("Can't read threads from the core");
+        goto ret;
+    }
+
+    modules = abrt_core_get_modules(core.file);
+    if (!modules)
+        goto ret;
+    g_ptr_array_sort(modules, module_cmp_by_address);
+
+    const struct elf_prstatus *crashed = &g_array_index(threads, struct elf_prstatus, 0);
+    key = g_checksum_new(G_CHECKSUM_SHA256);
+    key_printf(key, "version %u\nexecutable %s\nsignal %d %d %d\n", CACHE_KEY_VERSION,
+               executable, crashed->pr_cursig, siginfo.si_signo, siginfo.si_code);
+
+    for (unsigned i = 0; i < threads->len; ++i)
+    {
+        if (!key_add_thread(key, &core, modules, &g_array_index(threads, struct elf_prstatus, i)))
+            goto ret;
+    }
+
+    result = g_strdup(g_checksum_get_string(key));
+    *modules_out = g_steal_pointer(&modules);
+ ret:
+    if (modules)
+        g_ptr_array_free(modules, TRUE);
+    abrt_core_file_close(core.file);
+    g_free(core.phdrs);
+    g_free(core.auxv);
+    return result;
+}
+
+#else /* CORE_MACHINE */
+
+static char *compute_key(struct dump_dir *dd, GPtrArray **modules_out)
+{
+    log_info("Backtrace cache is not supported on this architecture");
+    return NULL;
+}
+
+#endif /* CORE_MACHINE */
+
+/* The cached core_backtrace has the absolute addresses of the crash which
+ * stored it. The address of a frame is recomputed from the start of its
+ * module in this core; frames outside of a module with build-id (e.g. in
+ * JIT code) are not part of the key, their address is dropped.
+ */
+static char *rebase_core_backtrace(const char *json, GPtrArray *modules)
+{
+    g_autofree char *error = NULL;
+    struct sr_core_stacktrace *stacktrace = sr_core_stacktrace_from_json_text(json, &error);
+    if (!stacktrace)
+    {
+        log_info("Can't parse cached %s: %s", FILENAME_CORE_BACKTRACE, error ? error : "");
+        return NULL;
+    }
+
+    for (struct sr_core_thread *thread = stacktrace->threads; thread; thread = thread->next)
+    {
+        for (struct sr_core_frame *frame = thread->frames; frame; frame = frame->next)
+        {
+            const struct abrt_core_module *module = NULL;
+            for (unsigned i = 0; frame->build_id && i < modules->len && !module; ++i)
+            {
+                const struct abrt_core_module *m = modules->pdata[i];
+                if (m->build_id && strcmp(m->build_id, frame->build_id) == 0)
+                    module = m;
+            }
+
+            frame->address = module ? module->start + frame->build_id_offset : 0;
+        }
+    }
+
+    char *rebased = sr_core_stacktrace_to_json(stacktrace);
+    sr_core_stacktrace_free(stacktrace);
+    return rebased;
+}
+
+static void remove_entry(int cache_fd, const char *name)
+{
+    int entry_fd = openat(cache_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (entry_fd >= 0)
+    {
+        DIR *dir = fdopendir(entry_fd);
+        struct dirent *dent;
+        while ((dent = readdir(dir)) != NULL)
+        {
+            if (!libreport_dot_or_dotdot(dent->d_name))
+                unlinkat(entry_fd, dent->d_name, 0);
+        }
+        closedir(dir);
+    }
+
+    if (unlinkat(cache_fd, name, AT_REMOVEDIR) != 0 && errno != ENOENT)
+        perror_msg("Can't remove '%s/%s'", BACKTRACE_CACHE_DIR, name);
+}
+
+static bool load_entry(int cache_fd, const char *key, struct dump_dir *dd, GPtrArray *modules)
+{
+    int entry_fd = openat(cache_fd, key, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (entry_fd < 0)
+        return false;
+
+    /* Read all of them before saving anything, not to save only a part */
+    char *contents[G_N_ELEMENTS(cached_elements)] = { NULL };
+    bool found = true;
+    for (unsigned i = 0; cached_elements[i]; ++i)
+    {
+        int fd = openat(entry_fd, cached_elements[i], O_RDONLY | O_NOFOLLOW);
+        if (fd < 0)
+        {
+            /* exploitable is optional, the analyzer may save nothing */
+            if (i == 0 || errno != ENOENT)
+                found = false;
+            continue;
+        }
+        contents[i] = libreport_xmalloc_read(fd, /*maxsz:*/ NULL);
+        close(fd);
+        if (contents[i] && strcmp(cached_elements[i], FILENAME_CORE_BACKTRACE) == 0)
+        {
+            char *rebased = rebase_core_backtrace(contents[i], modules);
+            free(contents[i]);
+            contents[i] = rebased;
+        }
+        if (!contents[i])
+            found = false;
+    }
+
+    if (found)
+    {
+        for (unsigned i = 0; cached_elements[i]; ++i)
+        {
+            if (contents[i] && !dd_exist(dd, cached_elements[i]))
+                dd_save_text(dd, cached_elements[i], contents[i]);
+        }
+        /* The least recently used entries are evicted first */
+        if (futimens(entry_fd, NULL) != 0)
+            perror_msg("Can't touch '%s/%s'", BACKTRACE_CACHE_DIR, key);
+    }
+
+    for (unsigned i = 0; cached_elements[i]; ++i)
+        free(contents[i]);
+    close(entry_fd);
+    return found;
+}
+
+static bool store_entry(int cache_fd, const char *key, struct dump_dir *dd)
+{
+    if (faccessat(cache_fd, key, F_OK, AT_SYMLINK_NOFOLLOW) == 0)
+        return true;
+
+    /* Fill a temporary directory and rename it, readers see a complete entry or none */
+    char tmp_name[sizeof(".tmp.") + sizeof(pid_t) * 3];
+    sprintf(tmp_name, ".tmp.%lu", (unsigned long)getpid());
+    remove_entry(cache_fd, tmp_name);
+    if (mkdirat(cache_fd, tmp_name, 0700) != 0)
+    {
+        perror_msg("Can't create '%s/%s'", BACKTRACE_CACHE_DIR, tmp_name);
+        return false;
+    }
+
+    bool stored = false;
+    int tmp_fd = openat(cache_fd, tmp_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (tmp_fd < 0)
+        goto ret;
+
+    for (unsigned i = 0; cached_elements[i]; ++i)
+    {
+        g_autofree char *content = dd_load_text_ext(dd, cached_elements[i],
+                                                    DD_FAIL_QUIETLY_ENOENT | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
+        if (!content)
+            continue;
+
+        int fd = openat(tmp_fd, cached_elements[i], O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+        if (fd < 0)
+            goto ret;
+        size_t len = strlen(content);
+        bool written = libreport_full_write(fd, content, len) == len;
+        if (close(fd) != 0 || !written)
+            goto ret;
+    }
+
+    if (renameat(cache_fd, tmp_name, cache_fd, key) != 0)
+    {
+        /* Somebody else stored it meanwhile */
+        if (errno == EEXIST || errno == ENOTEMPTY)
+            stored = true;
+        else
+            perror_msg("Can't rename '%s/%s'", BACKTRACE_CACHE_DIR, tmp_name);
+        goto ret;
+    }
+    stored = true;
+    tmp_name[0] = '\0';
+
+ ret:
+    if (tmp_fd >= 0)
+        close(tmp_fd);
+    if (tmp_name[0])
+        remove_entry(cache_fd, tmp_name);
+    return stored;
+}
+
+struct cache_entry
+{
+    time_t mtime;
+    off_t size;
+    char name[1];
+};
+
+static int cache_entry_cmp_oldest_first(gconstpointer a, gconstpointer b)
+{
+    const struct cache_entry *ea = *(const struct cache_entry **)a;
+    const struct cache_entry *eb = *(const struct cache_entry **)b;
+    return ea->mtime < eb->mtime ? -1 : ea->mtime > eb->mtime;
+}
+
+static off_t entry_size(int cache_fd, const char *name)
+{
+    int entry_fd = openat(cache_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (entry_fd < 0)
+        return 0;
+
+    off_t size = 0;
+    DIR *dir = fdopendir(entry_fd);
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        struct stat stb;
+        if (!libreport_dot_or_dotdot(dent->d_name)
+         && fstatat(entry_fd, dent->d_name, &stb, AT_SYMLINK_NOFOLLOW) == 0)
+            size += stb.st_size;
+    }
+    closedir(dir);
+    return size;
+}
+
+/* Removes the least recently used entries until the cache fits into the budget */
+static void evict_entries(int cache_fd, off_t budget)
+{
+    int dir_fd = dup(cache_fd);
+    if (dir_fd < 0)
+        return;
+    DIR *dir = fdopendir(dir_fd);
+    if (!dir)
+    {
+        close(dir_fd);
+        return;
+    }
+    rewinddir(dir);
+
+    g_autoptr(GPtrArray) entries = g_ptr_array_new_with_free_func(free);
+    off_t total = 0;
+    time_t now = time(NULL);
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        struct stat stb;
+        if (libreport_dot_or_dotdot(dent->d_name)
+         || fstatat(cache_fd, dent->d_name, &stb, AT_SYMLINK_NOFOLLOW) != 0)
+            continue;
+
+        if (dent->d_name[0] == '.')
+        {
+            if (now - stb.st_mtime > STALE_TMP_DIR_SEC)
+                remove_entry(cache_fd, dent->d_name);
+            continue;
+        }
+
+        struct cache_entry *entry = libreport_xmalloc(sizeof(*entry) + strlen(dent->d_name));
+        entry->mtime = stb.st_mtime;
+        entry->size = entry_size(cache_fd, dent->d_name);
+        strcpy(entry->name, dent->d_name);
+        total += entry->size;
+        g_ptr_array_add(entries, entry);
+    }
+    closedir(dir);
+
+    if (total <= budget)
+        return;
+
+    g_ptr_array_sort(entries, cache_entry_cmp_oldest_first);
+    for (unsigned i = 0; i < entries->len && total > budget; ++i)
+    {
+        const struct cache_entry *entry = entries->pdata[i];
+        log_info("Evicting '%s' (%llu bytes)", entry->name, (unsigned long long)entry->size);
+        remove_entry(cache_fd, entry->name);
+        total -= entry->size;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    const char *dump_dir_name = ".";
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-v] [-d DIR] -l|-s\n"
+        "\n"
+        "Looks up core_backtrace and exploitable of problem directory DIR in the cache\n"
+        "of analyses of earlier crashes (-l), or stores them there (-s).\n"
+        "Crashes share an entry if they crashed in the same binaries with the same\n"
+        "stack. With -l, exits with 1 if no entry was found. With -s, exits with 1 only\n"
+        "if the entry can't be written, a disabled cache or a crash that can't be\n"
+        "cached is not an error."
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_d = 1 << 1,
+        OPT_l = 1 << 2,
+        OPT_s = 1 << 3,
+    };
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&libreport_g_verbose),
+        OPT_STRING('d', NULL, &dump_dir_name, "DIR", _("Problem directory")),
+        OPT_BOOL(  'l', NULL, NULL,                  _("Load the cached elements into DIR")),
+        OPT_BOOL(  's', NULL, NULL,                  _("Store the elements of DIR in the cache")),
+        OPT_END()
+    };
+    unsigned opts = libreport_parse_opts(argc, argv, program_options, program_usage_string);
+    if (!(opts & OPT_l) == !(opts & OPT_s) || argv[optind])
+        libreport_show_usage_and_die(program_usage_string, program_options);
+
+    libreport_export_abrt_envvars(0);
+
+    int cache_size = DEFAULT_CACHE_SIZE;
+    {   /* Load CCpp.conf */
+        g_autoptr(GHashTable) settings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+        abrt_load_abrt_plugin_conf_file("CCpp.conf", settings);
+        int value;
+        if (libreport_try_get_map_string_item_as_int(settings, "BacktraceCacheSize", &value) && value >= 0)
+            cache_size = value;
+    }
+    if (cache_size == 0)
+    {
+        log_info("Backtrace cache is disabled");
+        /* Nothing is found, but there is nothing to store either */
+        return (opts & OPT_l) ? 1 : 0;
+    }
+
+    struct dump_dir *dd = dd_opendir(dump_dir_name, (opts & OPT_l) ? 0 : DD_OPEN_READONLY);
+    if (!dd)
+        return 1;
+
+    if ((opts & OPT_s) && !dd_exist(dd, FILENAME_CORE_BACKTRACE))
+    {
+        log_info("No '%s' to store", FILENAME_CORE_BACKTRACE);
+        dd_close(dd);
+        return 0;
+    }
+
+    bool success = false;
+    g_autoptr(GPtrArray) modules = NULL;
+    g_autofree char *key = compute_key(dd, &modules);
+    if (!key)
+    {
+        /* The crash can't be cached, which isn't an error for -s */
+        success = (opts & OPT_s);
+        goto ret;
+    }
+    log_info("Backtrace cache key is %s", key);
+
+    if ((opts & OPT_s) && g_mkdir_with_parents(BACKTRACE_CACHE_DIR, 0700) != 0)
+    {
+        perror_msg("Can't create '%s'", BACKTRACE_CACHE_DIR);
+        goto ret;
+    }
+    int cache_fd = open(BACKTRACE_CACHE_DIR, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (cache_fd < 0)
+    {
+        log_info("Can't open '%s': %s", BACKTRACE_CACHE_DIR, strerror(errno));
+        goto ret;
+    }
+
+    if (opts & OPT_l)
+    {
+        success = load_entry(cache_fd, key, dd, modules);
+        log_notice(success ? _("Using cached backtrace analysis") : _("Backtrace analysis is not cached"));
+    }
+    else
+    {
+        success = store_entry(cache_fd, key, dd);
+        evict_entries(cache_fd, (off_t)cache_size * 1024 * 1024);
+    }
+    close(cache_fd);
+
+ ret:
+    dd_close(dd);
+    return !success;
+}
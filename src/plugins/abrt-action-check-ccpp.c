@@ -0,0 +1,290 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <systemd/sd-id128.h>
+#include "libabrt.h"
+#include "abrt-journal.h"
+
+#define FILENAME_PROC_PID_STATUS "proc_pid_status"
+#define FILENAME_VAR_LOG_MESSAGES "var_log_messages"
+
+/* The same as journalctl -b --since=-3m -n 99 */
+#define USER_LOG_SINCE_USEC (3 * 60 * G_USEC_PER_SEC)
+#define USER_LOG_MAX_LINES 99
+
+/* Debuggers have wide variety of bugs where they leak SIGTRAP to traced
+ * process and nuke it. Crashes of ptraced processes (gdb, strace, ltrace)
+ * are ignored.
+ */
+static bool is_ptraced(struct dump_dir *dd)
+{
+    g_autofree char *status = dd_load_text_ext(dd, FILENAME_PROC_PID_STATUS,
+                                               DD_FAIL_QUIETLY_ENOENT | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
+    if (status == NULL)
+        return false;
+
+    for (const char *line = status; line != NULL; line = strchr(line, '\n'))
+    {
+        if (*line == '\n')
+            ++line;
+        if (strncmp(line, "TracerPid:", strlen("TracerPid:")) != 0)
+            continue;
+
+        line += strlen("TracerPid:");
+        while (isspace(*line))
+            ++line;
+        return *line >= '1' && *line <= '9';
+    }
+
+    return false;
+}
+
+static bool is_ignored_by_environment(struct dump_dir *dd)
+{
+    g_autofree char *environ_text = dd_load_text_ext(dd, FILENAME_ENVIRON,
+                                                     DD_FAIL_QUIETLY_ENOENT | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
+    if (environ_text == NULL)
+        return false;
+
+    for (const char *line = environ_text; line != NULL; line = strchr(line, '\n'))
+    {
+        if (*line == '\n')
+            ++line;
+        if (strncmp(line, "ABRT_IGNORE_ALL=1", strlen("ABRT_IGNORE_ALL=1")) == 0
+         || strncmp(line, "ABRT_IGNORE_CCPP=1", strlen("ABRT_IGNORE_CCPP=1")) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+static void append_trimmed_line(GString *log, const char *line, size_t len)
+{
+    while (len > 0 && isspace(*line))
+        ++line, --len;
+    while (len > 0 && isspace(line[len - 1]))
+        --len;
+
+    g_string_append_len(log, line, len);
+    g_string_append_c(log, '\n');
+}
+
+/* Formats the current entry as the default "short" output of journalctl does
+ * and appends its lines to LOG. Continuation lines of multi-line messages are
+ * appended without the indentation.
+ */
+static void append_entry(abrt_journal_t *journal, GString *log)
+{
+    g_autofree char *message = abrt_journal_get_log_line(journal);
+    if (message == NULL)
+        return;
+
+    g_autoptr(GString) prefix = g_string_new(NULL);
+
+    uint64_t usec;
+    if (abrt_journal_get_realtime_usec(journal, &usec) == 0)
+    {
+        const time_t sec = usec / G_USEC_PER_SEC;
+        struct tm tm;
+        char stamp[sizeof("Mmm DD HH:MM:SS") + 16];
+        if (localtime_r(&sec, &tm) != NULL && strftime(stamp, sizeof(stamp), "%b %d %H:%M:%S", &tm) > 0)
+            g_string_append(prefix, stamp);
+    }
+
+    g_autofree char *hostname = abrt_journal_get_string_field(journal, "_HOSTNAME", NULL);
+    if (hostname != NULL)
+        g_string_append_printf(prefix, " %s", hostname);
+
+    char *identifier = abrt_journal_get_string_field(journal, "SYSLOG_IDENTIFIER", NULL);
+    if (identifier == NULL)
+        identifier = abrt_journal_get_string_field(journal, "_COMM", NULL);
+    char *pid = abrt_journal_get_string_field(journal, "SYSLOG_PID", NULL);
+    if (pid == NULL)
+        pid = abrt_journal_get_string_field(journal, "_PID", NULL);
+    if (identifier != NULL)
+        g_string_append_printf(prefix, " %s", identifier);
+    if (pid != NULL)
+        g_string_append_printf(prefix, "[%s]", pid);
+    g_free(identifier);
+    g_free(pid);
+
+    const char *line = message;
+    for (bool first = true; line != NULL; first = false)
+    {
+        const char *end = strchrnul(line, '\n');
+        g_autofree char *text = first ? g_strdup_printf("%s: %.*s", prefix->str, (int)(end - line), line)
+                                      : g_strndup(line, end - line);
+        /* Messages of the audit subsystem are useless here */
+        if (strstr(text, " audit[") == NULL)
+            append_trimmed_line(log, text, strlen(text));
+        line = *end != '\0' ? end + 1 : NULL;
+    }
+}
+
+/* Collects the messages the crashed program logged under the UID of the crashed
+ * process in the current boot during the last 3 minutes. The matches are those
+ * of: journalctl -q -b --since=-3m -n 99 _COMM=BASE_EXECUTABLE _UID=UID
+ *
+ * System logs are not collected, they must not be shared with unprivileged
+ * users (bugzilla.redhat.com/1212868).
+ */
+static char *collect_user_log(const char *base_executable, const char *uid)
+{
+    sd_id128_t boot_id;
+    int r = sd_id128_get_boot(&boot_id);
+    if (r < 0)
+    {
+        log_notice("Can't get the ID of the current boot: %s", strerror(-r));
+        return NULL;
+    }
+    char boot_id_str[SD_ID128_STRING_MAX];
+    sd_id128_to_string(boot_id, boot_id_str);
+
+    abrt_journal_t *journal;
+    if (abrt_journal_new(&journal) < 0)
+        return NULL;
+
+    g_autofree char *comm_match = g_strdup_printf("_COMM=%s", base_executable);
+    g_autofree char *uid_match = g_strdup_printf("_UID=%s", uid);
+    g_autofree char *boot_match = g_strdup_printf("_BOOT_ID=%s", boot_id_str);
+    GList *matches = NULL;
+    matches = g_list_prepend(matches, boot_match);
+    matches = g_list_prepend(matches, uid_match);
+    matches = g_list_prepend(matches, comm_match);
+
+    /* Keep only the last entries, as journalctl -n does */
+    GQueue *entries = g_queue_new();
+    if (abrt_journal_set_journal_filter(journal, matches) == 0
+     && abrt_journal_seek_realtime_usec(journal, g_get_real_time() - USER_LOG_SINCE_USEC) == 0)
+    {
+        while (abrt_journal_next(journal) > 0)
+        {
+            GString *entry = g_string_new(NULL);
+            append_entry(journal, entry);
+            g_queue_push_tail(entries, entry);
+            if (g_queue_get_length(entries) > USER_LOG_MAX_LINES)
+                g_string_free(g_queue_pop_head(entries), TRUE);
+        }
+    }
+    g_list_free(matches);
+    abrt_journal_free(journal);
+
+    GString *log = g_string_new(NULL);
+    GString *entry;
+    while ((entry = g_queue_pop_head(entries)) != NULL)
+    {
+        g_string_append_len(log, entry->str, entry->len);
+        g_string_free(entry, TRUE);
+    }
+    g_queue_free(entries);
+
+    return g_string_free(log, FALSE);
+}
+
+static void save_user_log(struct dump_dir *dd)
+{
+    g_autofree char *executable = dd_load_text_ext(dd, FILENAME_EXECUTABLE,
+                                                   DD_FAIL_QUIETLY_ENOENT | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
+    g_autofree char *uid = dd_load_text_ext(dd, FILENAME_UID,
+                                            DD_FAIL_QUIETLY_ENOENT | DD_LOAD_TEXT_RETURN_NULL_ON_FAILURE);
+    if (executable == NULL || uid == NULL)
+    {
+        log_notice("Problem directory lacks '%s' or '%s', not saving logs",
+                   FILENAME_EXECUTABLE, FILENAME_UID);
+        return;
+    }
+
+    const char *base_executable = strrchr(executable, '/');
+    base_executable = base_executable ? base_executable + 1 : executable;
+
+    g_autofree char *user_log = collect_user_log(base_executable, uid);
+    /* A single empty line isn't worth saving */
+    if (user_log == NULL || strlen(user_log) <= 1)
+    {
+        log_info("No log messages of '%s'", base_executable);
+        return;
+    }
+
+    g_autofree char *text = g_strdup_printf("User Logs:\n--%s--\n", user_log);
+    dd_save_text(dd, FILENAME_VAR_LOG_MESSAGES, text);
+    log_info("Saved log messages of '%s'", base_executable);
+}
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    const char *dump_dir_name = ".";
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-v] [-l] [-d DIR]\n"
+        "\n"
+        "Checks whether the crash in problem directory DIR should be kept. Exits\n"
+        "with 1 if the crashed process was ptraced or if ABRT_IGNORE_ALL or\n"
+        "ABRT_IGNORE_CCPP was set to 1 in its environment.\n"
+        "\n"
+        "With -l, saves the messages the crashed program logged to the journal\n"
+        "during the last 3 minutes in var_log_messages instead."
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_d = 1 << 1,
+        OPT_l = 1 << 2,
+    };
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&libreport_g_verbose),
+        OPT_STRING('d', NULL, &dump_dir_name, "DIR", _("Problem directory")),
+        OPT_BOOL(  'l', NULL, NULL,                  _("Save recent log messages of the crashed program")),
+        OPT_END()
+    };
+    unsigned opts = libreport_parse_opts(argc, argv, program_options, program_usage_string);
+    if (argv[optind])
+        libreport_show_usage_and_die(program_usage_string, program_options);
+
+    libreport_export_abrt_envvars(0);
+
+    struct dump_dir *dd = dd_opendir(dump_dir_name, /*flags:*/ 0);
+    if (!dd)
+        return 1;
+
+    int r = 0;
+    if (opts & OPT_l)
+        save_user_log(dd);
+    else if (is_ptraced(dd))
+    {
+        printf("The crashed process was ptraced - not saving the crash\n");
+        r = 1;
+    }
+    else if (is_ignored_by_environment(dd))
+    {
+        printf("ABRT_IGNORE variable is 1 - not saving the crash\n");
+        r = 1;
+    }
+
+    dd_close(dd);
+    return r;
+}
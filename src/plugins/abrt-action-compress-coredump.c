@@ -0,0 +1,190 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include <sys/syscall.h>
+#include "libabrt.h"
+
+#define FILENAME_COREDUMP_ZST FILENAME_COREDUMP".zst"
+#define FILENAME_COREDUMP_TMP FILENAME_COREDUMP".zst.tmp"
+
+/* Defaults of the CCpp.conf options */
+#define DEFAULT_COMPRESSION_LEVEL 3
+/* One thread per CPU */
+#define DEFAULT_COMPRESSION_THREADS 0
+
+/* glibc has no wrapper for ioprio_set() */
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_CLASS_SHIFT 13
+
+/* Compressing a core takes a while, it must not slow down the I/O of
+ * the rest of the system. The compression threads inherit the priority.
+ */
+static void set_idle_io_priority(void)
+{
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, /*this process*/0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0)
+        log_info("Can't set idle I/O priority: %s", strerror(errno));
+}
+
+/* Compresses SRC_NAME into a seekable coredump.zst, replacing the one there
+ * is, and removes coredump. FLAGS are those of
+ * abrt_core_file_compress_seekable().
+ */
+static bool compress_coredump(struct dump_dir *dd, const char *src_name, int flags, int level, unsigned threads)
+{
+    int src_fd = openat(dd->dd_fd, src_name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (src_fd < 0)
+    {
+        perror_msg("Can't open '%s/%s'", dd->dd_dirname, src_name);
+        return false;
+    }
+
+    /* Written under another name, so an interrupted run doesn't leave
+     * a truncated coredump.zst behind */
+    int dst_fd = openat(dd->dd_fd, FILENAME_COREDUMP_TMP, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, dd->mode);
+    if (dst_fd < 0)
+    {
+        perror_msg("Can't create '%s/%s'", dd->dd_dirname, FILENAME_COREDUMP_TMP);
+        close(src_fd);
+        return false;
+    }
+
+    bool compressed = abrt_core_file_compress_seekable(src_fd, dst_fd, flags, level, threads) == 0;
+    if (compressed && fchown(dst_fd, dd->dd_uid, dd->dd_gid) != 0)
+    {
+        perror_msg("Can't change ownership of '%s/%s'", dd->dd_dirname, FILENAME_COREDUMP_TMP);
+        compressed = false;
+    }
+    close(src_fd);
+    if (close(dst_fd) != 0)
+        compressed = false;
+
+    if (compressed && renameat(dd->dd_fd, FILENAME_COREDUMP_TMP, dd->dd_fd, FILENAME_COREDUMP_ZST) != 0)
+    {
+        perror_msg("Can't rename '%s/%s'", dd->dd_dirname, FILENAME_COREDUMP_TMP);
+        compressed = false;
+    }
+    if (!compressed)
+    {
+        unlinkat(dd->dd_fd, FILENAME_COREDUMP_TMP, 0);
+        return false;
+    }
+
+    return !dd_exist(dd, FILENAME_COREDUMP) || dd_delete_item(dd, FILENAME_COREDUMP) == 0;
+}
+
+/* Returns -1 if there is no coredump.zst, 0 if it isn't seekable, 1 if it is */
+static int coredump_zst_is_seekable(struct dump_dir *dd)
+{
+    int fd = openat(dd->dd_fd, FILENAME_COREDUMP_ZST, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    bool seekable = abrt_core_file_is_seekable(fd);
+    close(fd);
+    return seekable;
+}
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    const char *dump_dir_name = ".";
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-v] [-f] [-d DIR]\n"
+        "\n"
+        "Compresses coredump of problem directory DIR into coredump.zst, if enabled\n"
+        "by CoredumpCompression in CCpp.conf, and recompresses coredump.zst saved\n"
+        "by systemd-coredump into the seekable format. The analyzers read such\n"
+        "a core without unpacking it whole."
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_d = 1 << 1,
+        OPT_f = 1 << 2,
+    };
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&libreport_g_verbose),
+        OPT_STRING('d', NULL, &dump_dir_name, "DIR", _("Problem directory")),
+        OPT_BOOL(  'f', NULL, NULL,                  _("Compress even if disabled in CCpp.conf")),
+        OPT_END()
+    };
+    unsigned opts = libreport_parse_opts(argc, argv, program_options, program_usage_string);
+    if (argv[optind])
+        libreport_show_usage_and_die(program_usage_string, program_options);
+
+    libreport_export_abrt_envvars(0);
+
+    int enabled = 0;
+    int level = DEFAULT_COMPRESSION_LEVEL;
+    int threads = DEFAULT_COMPRESSION_THREADS;
+    {
+        g_autoptr(GHashTable) settings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+        abrt_load_abrt_plugin_conf_file("CCpp.conf", settings);
+        libreport_try_get_map_string_item_as_bool(settings, "CoredumpCompression", &enabled);
+        int value;
+        if (libreport_try_get_map_string_item_as_int(settings, "CoredumpCompressionLevel", &value))
+            level = value;
+        if (libreport_try_get_map_string_item_as_int(settings, "CoredumpCompressionThreads", &value) && value >= 0)
+            threads = value;
+    }
+    if (threads == 0)
+        threads = g_get_num_processors();
+
+    struct dump_dir *dd = dd_opendir(dump_dir_name, /*flags:*/ 0);
+    if (!dd)
+        return 1;
+
+    int r = 0;
+    const bool has_coredump = dd_exist(dd, FILENAME_COREDUMP);
+    const int seekable = coredump_zst_is_seekable(dd);
+    if (seekable == 0)
+    {
+        /* Compressed already, only the format changes. An unpacked coredump
+         * spares decompressing it. */
+        set_idle_io_priority();
+        log_notice(_("Recompressing coredump.zst into the seekable format"));
+        if (!compress_coredump(dd, has_coredump ? FILENAME_COREDUMP : FILENAME_COREDUMP_ZST,
+                               has_coredump ? 0 : ABRT_CORE_SOURCE_ZSTD,
+                               level, threads))
+            r = 1;
+    }
+    else if (!has_coredump || seekable > 0)
+        log_info("No uncompressed coredump in '%s'", dump_dir_name);
+    else if (!enabled && !(opts & OPT_f))
+        log_info("Compression of coredumps is disabled");
+    else
+    {
+        set_idle_io_priority();
+        log_notice(_("Compressing coredump"));
+        if (!compress_coredump(dd, FILENAME_COREDUMP, /*flags*/0, level, threads))
+            r = 1;
+    }
+
+    dd_close(dd);
+    return r;
+}
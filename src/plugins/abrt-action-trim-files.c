@@ -25,111 +25,539 @@
  */
 #define MAX_VICTIM_LIST_SIZE 128
 
-struct name_and_size {
+struct victim {
     off_t size;
+    time_t mtime;
     double weighted_size_and_age;
     char name[1];
 };
 
-/* Updates a list of files sorted by increasing weighted_size_and_age.
+/* Bounded min-heap: items[0] is the least bad of the kept files,
+ * so a file worse than it replaces it in O(log N).
  */
-static GList *insert_name_and_sizes(GList *list, const char *name, double wsa, off_t sz)
+struct victim_heap {
+    struct victim *items[MAX_VICTIM_LIST_SIZE];
+    unsigned len;
+};
+
+static void victim_heap_sift_up(struct victim_heap *heap, unsigned i)
 {
-    struct name_and_size *ns;
-    unsigned list_len = 0;
-    GList *cur = list;
+    while (i > 0)
+    {
+        unsigned parent = (i - 1) / 2;
+        if (heap->items[parent]->weighted_size_and_age <= heap->items[i]->weighted_size_and_age)
+            break;
+        struct victim *tmp = heap->items[parent];
+        heap->items[parent] = heap->items[i];
+        heap->items[i] = tmp;
+        i = parent;
+    }
+}
 
-    while (cur)
+static void victim_heap_sift_down(struct victim_heap *heap, unsigned i)
+{
+    for (;;)
     {
-        ns = cur->data;
-        if (ns->weighted_size_and_age >= wsa)
+        unsigned least = i;
+        unsigned child = 2 * i + 1;
+        if (child < heap->len && heap->items[child]->weighted_size_and_age < heap->items[least]->weighted_size_and_age)
+            least = child;
+        child++;
+        if (child < heap->len && heap->items[child]->weighted_size_and_age < heap->items[least]->weighted_size_and_age)
+            least = child;
+        if (least == i)
             break;
-        list_len++;
-        cur = cur->next;
+        struct victim *tmp = heap->items[least];
+        heap->items[least] = heap->items[i];
+        heap->items[i] = tmp;
+        i = least;
+    }
+}
+
+/* Takes ownership of the victim */
+static void victim_heap_offer(struct victim_heap *heap, struct victim *v)
+{
+    if (heap->len < MAX_VICTIM_LIST_SIZE)
+    {
+        heap->items[heap->len] = v;
+        victim_heap_sift_up(heap, heap->len++);
+        return;
+    }
+
+    if (v->weighted_size_and_age <= heap->items[0]->weighted_size_and_age)
+    {
+        free(v);
+        return;
+    }
+
+    free(heap->items[0]);
+    heap->items[0] = v;
+    victim_heap_sift_down(heap, 0);
+}
+
+static void victim_heap_clear(struct victim_heap *heap)
+{
+    while (heap->len > 0)
+        free(heap->items[--heap->len]);
+}
+
+static int victim_cmp_worst_first(const void *a, const void *b)
+{
+    const struct victim *va = *(const struct victim **)a;
+    const struct victim *vb = *(const struct victim **)b;
+    return (va->weighted_size_and_age < vb->weighted_size_and_age)
+         - (va->weighted_size_and_age > vb->weighted_size_and_age);
+}
+
+static struct victim *victim_new(const char *name, off_t size, time_t mtime, double wsa)
+{
+    struct victim *v = g_malloc(sizeof(*v) + strlen(name));
+    v->size = size;
+    v->mtime = mtime;
+    v->weighted_size_and_age = wsa;
+    strcpy(v->name, name);
+    return v;
+}
+
+/* Calculate "weighted" size and age
+ * w = sz_kbytes * age_mins */
+static double weighted_size_and_age(double sz, time_t mtime, time_t now)
+{
+    sz /= 1024;
+    long age = (now - mtime) / 60;
+    if (age > 1)
+        sz *= age;
+    return sz;
+}
+
+/* Account for filename and inode storage (approximately).
+ * This also makes even zero-length files to have nonzero cost.
+ */
+static double file_cost(off_t size, const char *name)
+{
+    return (double)size + strlen(name) + sizeof(struct stat);
+}
+
+/* What we know about a directory from its last walk. A directory whose inode
+ * and mtime didn't change still has the same entries, so its files need not
+ * be listed and stat'ed again. Files rewritten in place are noticed when
+ * the directory changes.
+ */
+struct dir_index {
+    char *path;
+    ino_t ino;
+    struct timespec mtime;
+    /* Cost of the files directly in the directory */
+    double files_size;
+    /* Names of the subdirectories */
+    GPtrArray *subdirs;
+    /* The worst files directly in the directory, names without path */
+    GPtrArray *victims;
+    /* Taken over from the previous walk */
+    bool reused;
+};
+
+static struct dir_index *dir_index_new(const char *path, const struct stat *st)
+{
+    struct dir_index *entry = g_new0(struct dir_index, 1);
+    entry->path = g_strdup(path);
+    if (st)
+    {
+        entry->ino = st->st_ino;
+        entry->mtime = st->st_mtim;
+    }
+    entry->subdirs = g_ptr_array_new_with_free_func(g_free);
+    entry->victims = g_ptr_array_new_with_free_func(free);
+    return entry;
+}
+
+static void dir_index_free(gpointer data)
+{
+    struct dir_index *entry = data;
+    g_ptr_array_free(entry->victims, TRUE);
+    g_ptr_array_free(entry->subdirs, TRUE);
+    g_free(entry->path);
+    g_free(entry);
+}
+
+static GHashTable *dir_index_table_new(void)
+{
+    /* The key is owned by the value */
+    return g_hash_table_new_full(g_str_hash, g_str_equal, NULL, dir_index_free);
+}
+
+static GHashTable *load_dir_index(const char *file_name)
+{
+    GHashTable *index = dir_index_table_new();
+
+    FILE *fp = fopen(file_name, "r");
+    if (fp == NULL)
+    {
+        if (errno != ENOENT)
+            perror_msg("Can't open '%s'", file_name);
+        return index;
     }
-    list_len += g_list_length(cur);
 
-    if (cur != list || list_len < MAX_VICTIM_LIST_SIZE)
+    struct dir_index *cur = NULL;
+    char *line;
+    while ((line = libreport_xmalloc_fgetline(fp)) != NULL)
     {
-        ns = g_malloc(sizeof(*ns) + strlen(name));
-        ns->weighted_size_and_age = wsa;
-        ns->size = sz;
-        strcpy(ns->name, name);
-        list = g_list_insert_before(list, cur, ns);
-        list_len++;
-        if (list_len > MAX_VICTIM_LIST_SIZE)
+        unsigned long long ino;
+        long long sec, mtime, size;
+        long nsec;
+        double files_size;
+        int name_pos = 0;
+
+        if (line[0] == 'D'
+            && sscanf(line, "D %llu %lld %ld %lf %n", &ino, &sec, &nsec, &files_size, &name_pos) == 4
+            && name_pos != 0 && line[name_pos] != '\0')
+        {
+            cur = dir_index_new(line + name_pos, NULL);
+            cur->ino = (ino_t)ino;
+            cur->mtime.tv_sec = (time_t)sec;
+            cur->mtime.tv_nsec = nsec;
+            cur->files_size = files_size;
+            g_hash_table_replace(index, cur->path, cur);
+        }
+        else if (line[0] == 'S' && line[1] == ' ' && line[2] != '\0' && cur != NULL)
+        {
+            g_ptr_array_add(cur->subdirs, g_strdup(line + 2));
+        }
+        else if (line[0] == 'F'
+            && sscanf(line, "F %lld %lld %n", &size, &mtime, &name_pos) == 2
+            && name_pos != 0 && line[name_pos] != '\0' && cur != NULL)
+        {
+            g_ptr_array_add(cur->victims, victim_new(line + name_pos, (off_t)size, (time_t)mtime, 0));
+        }
+        else
         {
-            free(list->data);
-            list = g_list_delete_link(list, list);
+            log_notice("Ignoring malformed line in '%s': %s", file_name, line);
+            /* Don't attach the following lines to a wrong directory and
+             * make sure the directory is walked again */
+            if (cur != NULL)
+                g_hash_table_remove(index, cur->path);
+            cur = NULL;
         }
+        free(line);
     }
 
-    return list;
+    fclose(fp);
+    log_debug("Loaded %u directories from '%s'", g_hash_table_size(index), file_name);
+    return index;
 }
 
-static double get_dir_size(const char *dirname,
-                GList **pp_worst_file_list,
-                GList *preserve_files_list
-) {
-    DIR *dp = opendir(dirname);
+static bool dir_index_is_storable(const struct dir_index *entry)
+{
+    if (strchr(entry->path, '\n'))
+        return false;
+    for (guint i = 0; i < entry->subdirs->len; ++i)
+        if (strchr(g_ptr_array_index(entry->subdirs, i), '\n'))
+            return false;
+    for (guint i = 0; i < entry->victims->len; ++i)
+        if (strchr(((struct victim *)g_ptr_array_index(entry->victims, i))->name, '\n'))
+            return false;
+    return true;
+}
+
+static void save_dir_index(GHashTable *index, const char *file_name)
+{
+    GString *contents = g_string_new(NULL);
+
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, index);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+    {
+        const struct dir_index *entry = value;
+        /* Not storing it just means it will be walked again */
+        if (!dir_index_is_storable(entry))
+            continue;
+
+        g_string_append_printf(contents, "D %llu %lld %ld %.0f %s\n",
+                (unsigned long long)entry->ino, (long long)entry->mtime.tv_sec,
+                (long)entry->mtime.tv_nsec, entry->files_size, entry->path);
+        for (guint i = 0; i < entry->subdirs->len; ++i)
+            g_string_append_printf(contents, "S %s\n", (const char *)g_ptr_array_index(entry->subdirs, i));
+        for (guint i = 0; i < entry->victims->len; ++i)
+        {
+            const struct victim *v = g_ptr_array_index(entry->victims, i);
+            g_string_append_printf(contents, "F %lld %lld %s\n",
+                    (long long)v->size, (long long)v->mtime, v->name);
+        }
+    }
+
+    g_autofree char *tmp_name = g_strdup_printf("%s.new", file_name);
+    int fd = open(tmp_name, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, 0600);
+    if (fd < 0)
+        perror_msg("Can't open '%s'", tmp_name);
+    else
+    {
+        const bool written = libreport_full_write(fd, contents->str, contents->len) == contents->len;
+        close(fd);
+
+        if (!written || rename(tmp_name, file_name) < 0)
+        {
+            perror_msg("Can't save '%s'", file_name);
+            unlink(tmp_name);
+        }
+    }
+
+    g_string_free(contents, TRUE);
+}
+
+struct trim_settings {
+    /* Full names of the files which are never deleted */
+    GHashTable *preserve_files;
+    /* Directory path -> struct dir_index, NULL if not indexing */
+    GHashTable *index;
+    unsigned jobs;
+};
+
+/* One walk of a directory tree. Every directory is a task: it is walked
+ * in the calling thread, or by the pool if there is one, and its results
+ * are added to the totals under the lock.
+ */
+struct trim_walk {
+    const struct trim_settings *settings;
+    /* "now" is used for weighting the files by age */
+    time_t now;
+    GThreadPool *pool;
+
+    GMutex lock;
+    GCond done;
+    unsigned pending;
+    double size;
+    struct victim_heap worst;
+    /* struct dir_index of the walked directories */
+    GPtrArray *visited;
+};
+
+static void walk_dir(struct trim_walk *walk, char *path);
+
+static void walk_dir_task(gpointer data, gpointer user_data)
+{
+    struct trim_walk *walk = user_data;
+
+    walk_dir(walk, data);
+
+    g_mutex_lock(&walk->lock);
+    if (--walk->pending == 0)
+        g_cond_signal(&walk->done);
+    g_mutex_unlock(&walk->lock);
+}
+
+/* Takes ownership of the path */
+static void walk_subdir(struct trim_walk *walk, char *path)
+{
+    if (walk->pool == NULL)
+    {
+        walk_dir(walk, path);
+        return;
+    }
+
+    g_mutex_lock(&walk->lock);
+    walk->pending++;
+    g_mutex_unlock(&walk->lock);
+
+    GError *error = NULL;
+    if (!g_thread_pool_push(walk->pool, path, &error))
+        error_msg_and_die("Can't start a worker thread: %s", error->message);
+}
+
+/* Adds the files of the directory to the totals */
+static void account_dir(struct trim_walk *walk, struct dir_index *entry)
+{
+    g_mutex_lock(&walk->lock);
+
+    walk->size += entry->files_size;
+    for (guint i = 0; i < entry->victims->len; ++i)
+    {
+        const struct victim *v = g_ptr_array_index(entry->victims, i);
+        g_autofree char *fullname = g_build_filename(entry->path, v->name, NULL);
+        /* The file could have been preserved since the index was saved */
+        if (entry->reused && g_hash_table_contains(walk->settings->preserve_files, fullname))
+            continue;
+
+        double wsa = weighted_size_and_age(file_cost(v->size, v->name), v->mtime, walk->now);
+        victim_heap_offer(&walk->worst, victim_new(fullname, v->size, v->mtime, wsa));
+    }
+
+    if (walk->visited)
+        g_ptr_array_add(walk->visited, entry);
+
+    g_mutex_unlock(&walk->lock);
+
+    if (!walk->visited)
+        dir_index_free(entry);
+}
+
+static void walk_dir(struct trim_walk *walk, char *path)
+{
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        goto out;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        goto out;
+    }
+
+    struct dir_index *cached = NULL;
+    if (walk->settings->index)
+        cached = g_hash_table_lookup(walk->settings->index, path);
+
+    if (cached && !cached->reused && cached->ino == st.st_ino
+        && cached->mtime.tv_sec == st.st_mtim.tv_sec
+        && cached->mtime.tv_nsec == st.st_mtim.tv_nsec)
+    {
+        close(fd);
+        log_debug("Reusing the index of '%s'", path);
+
+        /* No other task looks at this entry, the table itself is not
+         * modified until the walk is over */
+        cached->reused = true;
+        for (guint i = 0; i < cached->subdirs->len; ++i)
+            walk_subdir(walk, g_build_filename(path, g_ptr_array_index(cached->subdirs, i), NULL));
+        account_dir(walk, cached);
+        goto out;
+    }
+
+    DIR *dp = fdopendir(fd);
     if (!dp)
-        return 0;
+    {
+        close(fd);
+        goto out;
+    }
+
+    struct dir_index *entry = dir_index_new(path, &st);
+    struct victim_heap worst = { .len = 0 };
+    /* Full name of the current file, the directory part is reused */
+    GString *fullname = g_string_new(path);
+    if (fullname->len == 0 || fullname->str[fullname->len - 1] != '/')
+        g_string_append_c(fullname, '/');
+    const gsize dir_len = fullname->len;
 
-    /* "now" is used only if caller wants to know worst_file */
-    time_t now = pp_worst_file_list ? time(NULL) : 0;
     struct dirent *dent;
-    double size = 0;
     while ((dent = readdir(dp)) != NULL)
     {
         if (libreport_dot_or_dotdot(dent->d_name))
             continue;
 
-        g_autofree char *fullname = g_build_filename(dirname, dent->d_name, NULL);
         struct stat stats;
-        if (lstat(fullname, &stats) != 0)
-            goto next;
+        if (fstatat(dirfd(dp), dent->d_name, &stats, AT_SYMLINK_NOFOLLOW) != 0)
+            continue;
 
         if (S_ISDIR(stats.st_mode))
         {
-            double sz = get_dir_size(fullname, pp_worst_file_list, preserve_files_list);
-            size += sz;
+            g_ptr_array_add(entry->subdirs, g_strdup(dent->d_name));
+            walk_subdir(walk, g_build_filename(path, dent->d_name, NULL));
         }
         else if (S_ISREG(stats.st_mode) || S_ISLNK(stats.st_mode))
         {
-            double sz = stats.st_size;
-            /* Account for filename and inode storage (approximately).
-             * This also makes even zero-length files to have nonzero cost.
-             */
-            sz += strlen(dent->d_name) + sizeof(stats);
-            size += sz;
-
-            if (pp_worst_file_list)
-            {
-                GList *cur = preserve_files_list;
-                while (cur)
-                {
-                    //log_warning("'%s' ? '%s'", fullname, *pp);
-                    if (strcmp(fullname, (char*)cur->data) == 0)
-                        goto next;
-                    cur = cur->next;
-                }
-
-                /* Calculate "weighted" size and age
-                 * w = sz_kbytes * age_mins */
-                sz /= 1024;
-                long age = (now - stats.st_mtime) / 60;
-                if (age > 1)
-                    sz *= age;
-
-                *pp_worst_file_list = insert_name_and_sizes(*pp_worst_file_list, fullname, sz, stats.st_size);
-            }
+            double sz = file_cost(stats.st_size, dent->d_name);
+            entry->files_size += sz;
+
+            g_string_truncate(fullname, dir_len);
+            g_string_append(fullname, dent->d_name);
+            if (g_hash_table_contains(walk->settings->preserve_files, fullname->str))
+                continue;
+
+            double wsa = weighted_size_and_age(sz, stats.st_mtime, walk->now);
+            victim_heap_offer(&worst, victim_new(dent->d_name, stats.st_size, stats.st_mtime, wsa));
         }
- next:
-        continue;
     }
     closedir(dp);
+    g_string_free(fullname, TRUE);
+
+    for (unsigned i = 0; i < worst.len; ++i)
+        g_ptr_array_add(entry->victims, worst.items[i]);
+    worst.len = 0;
+
+    account_dir(walk, entry);
+ out:
+    free(path);
+}
+
+/* Replaces the index entries of the walked tree by the visited directories.
+ * Directories which were not visited are gone.
+ */
+static void update_dir_index(GHashTable *index, const char *dirname, GPtrArray *visited)
+{
+    for (guint i = 0; i < visited->len; ++i)
+    {
+        struct dir_index *entry = g_ptr_array_index(visited, i);
+        if (entry->reused)
+            g_hash_table_steal(index, entry->path);
+    }
+
+    const size_t dirname_len = strlen(dirname);
+    GHashTableIter iter;
+    gpointer key;
+    g_hash_table_iter_init(&iter, index);
+    while (g_hash_table_iter_next(&iter, &key, NULL))
+    {
+        const char *path = key;
+        if (dirname_len > 0 && strncmp(path, dirname, dirname_len) == 0
+            && (path[dirname_len] == '\0' || path[dirname_len] == '/' || dirname[dirname_len - 1] == '/'))
+            g_hash_table_iter_remove(&iter);
+    }
+
+    for (guint i = 0; i < visited->len; ++i)
+    {
+        struct dir_index *entry = g_ptr_array_index(visited, i);
+        entry->reused = false;
+        g_hash_table_replace(index, entry->path, entry);
+    }
+}
+
+/* Returns the cost of the files in the directory tree and fills the heap
+ * with the worst of them.
+ */
+static double get_dir_size(const char *dirname,
+                struct victim_heap *worst,
+                const struct trim_settings *settings
+) {
+    struct trim_walk walk = {
+        .settings = settings,
+        .now = time(NULL),
+    };
+    g_mutex_init(&walk.lock);
+    g_cond_init(&walk.done);
+    if (settings->index)
+        walk.visited = g_ptr_array_new();
+
+    if (settings->jobs > 1)
+    {
+        GError *error = NULL;
+        walk.pool = g_thread_pool_new(walk_dir_task, &walk, settings->jobs, /*exclusive*/TRUE, &error);
+        if (walk.pool == NULL)
+            error_msg_and_die("Can't create thread pool: %s", error->message);
+    }
+
+    walk_dir(&walk, g_strdup(dirname));
+
+    if (walk.pool)
+    {
+        g_mutex_lock(&walk.lock);
+        while (walk.pending != 0)
+            g_cond_wait(&walk.done, &walk.lock);
+        g_mutex_unlock(&walk.lock);
+        g_thread_pool_free(walk.pool, /*immediate*/FALSE, /*wait*/TRUE);
+    }
+
+    if (walk.visited)
+    {
+        update_dir_index(settings->index, dirname, walk.visited);
+        g_ptr_array_free(walk.visited, TRUE);
+    }
+
+    g_cond_clear(&walk.done);
+    g_mutex_clear(&walk.lock);
 
-    return size;
+    *worst = walk.worst;
+    return walk.size;
 }
 
 static const char *parse_size_pfx(double *size, const char *str)
@@ -165,40 +593,39 @@ static void delete_dirs(gpointer data, gpointer exclude_path)
     abrt_trim_problem_dirs(dir, cap_size, exclude_path);
 }
 
-static void delete_files(gpointer data, gpointer void_preserve_list)
+static void delete_files(gpointer data, gpointer void_settings)
 {
     double cap_size;
     const char *dir = parse_size_pfx(&cap_size, data);
-    GList *preserve_files_list = void_preserve_list;
+    const struct trim_settings *settings = void_settings;
 
     unsigned count = 100;
     while (--count != 0)
     {
-        GList *worst_file_list = NULL;
-        double cur_size = get_dir_size(dir, &worst_file_list, preserve_files_list);
+        struct victim_heap worst;
+        double cur_size = get_dir_size(dir, &worst, settings);
 
-        if (cur_size <= cap_size || !worst_file_list)
+        if (cur_size <= cap_size || worst.len == 0)
         {
-            g_list_free_full(g_steal_pointer(&worst_file_list), free);
+            victim_heap_clear(&worst);
             log_info("cur_size:%.0f cap_size:%.0f, no (more) trimming", cur_size, cap_size);
             break;
         }
 
-        /* Invert the list, so that largest/oldest file is first */
-        worst_file_list = g_list_reverse(worst_file_list);
+        /* Sort the victims, so that largest/oldest file is first */
+        qsort(worst.items, worst.len, sizeof(worst.items[0]), victim_cmp_worst_first);
         /* And delete (some of) them */
-        while (worst_file_list && cur_size > cap_size)
+        for (unsigned i = 0; i < worst.len && cur_size > cap_size; ++i)
         {
-            struct name_and_size *ns = worst_file_list->data;
+            const struct victim *v = worst.items[i];
             log_notice("%s is %.0f bytes (more than %.0f MB), deleting '%s' (%llu bytes)",
-                    dir, cur_size, cap_size / (1024*1024), ns->name, (long long)ns->size);
-            if (unlink(ns->name) != 0)
-                perror_msg("Can't unlink '%s'", ns->name);
+                    dir, cur_size, cap_size / (1024*1024), v->name, (long long)v->size);
+            if (unlink(v->name) != 0)
+                perror_msg("Can't unlink '%s'", v->name);
             else
-                cur_size -= ns->size;
-            free(ns);
-            worst_file_list = g_list_delete_link(worst_file_list, worst_file_list);
+                cur_size -= v->size;
         }
+        victim_heap_clear(&worst);
     }
 }
 
@@ -216,10 +643,12 @@ int main(int argc, char **argv)
     GList *dir_list = NULL;
     GList *file_list = NULL;
     char *preserve = NULL;
+    char *index_file = NULL;
+    int jobs = 1;
 
     /* Can't keep these strings/structs static: _() doesn't support that */
     const char *program_usage_string = _(
-        "& [-v] [-d SIZE:DIR]... [-f SIZE:DIR]... [-p DIR] [FILE]...\n"
+        "& [-v] [-d SIZE:DIR]... [-f SIZE:DIR]... [-p DIR] [-j NUM] [-i FILE] [FILE]...\n"
         "\n"
         "Deletes problem dirs (-d) or files (-f) in DIRs until they are smaller than SIZE.\n"
         "FILEs are preserved (never deleted)."
@@ -229,6 +658,8 @@ int main(int argc, char **argv)
         OPT_d = 1 << 1,
         OPT_f = 1 << 2,
         OPT_p = 1 << 3,
+        OPT_j = 1 << 4,
+        OPT_i = 1 << 5,
     };
     /* Keep enum above and order of options below in sync! */
     struct options program_options[] = {
@@ -236,12 +667,15 @@ int main(int argc, char **argv)
         OPT_LIST('d'  , NULL, &dir_list , "SIZE:DIR", _("Delete whole problem directories")),
         OPT_LIST('f'  , NULL, &file_list, "SIZE:DIR", _("Delete files inside this directory")),
         OPT_STRING('p', NULL, &preserve,  "DIR"     , _("Preserve this directory")),
+        OPT_INTEGER('j', NULL, &jobs,                  _("Walk -f DIRs in NUM threads (0 means one thread per CPU)")),
+        OPT_STRING('i', NULL, &index_file, "FILE"   , _("Cache sizes of directories in -f DIRs in FILE between runs")),
         OPT_END()
     };
     /*unsigned opts =*/ libreport_parse_opts(argc, argv, program_options, program_usage_string);
     argv += optind;
     if ((argv[0] && !file_list)
      || !(dir_list || file_list)
+     || jobs < 0
     ) {
         libreport_show_usage_and_die(program_usage_string, program_options);
     }
@@ -252,28 +686,34 @@ int main(int argc, char **argv)
     /* Preserve not only files specified on command line, but,
      * if they are symlinks, preserve also the real files they point to:
      */
-    GList *preserve_files_list = NULL;
+    struct trim_settings settings = {
+        .preserve_files = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, NULL),
+        .jobs = jobs > 0 ? jobs : g_get_num_processors(),
+    };
     while (*argv)
     {
         char *name = *argv++;
-        /* Since we don't bother freeing preserve_files_list on exit,
+        /* Since we don't bother freeing preserve_files on exit,
          * we take a shortcut and insert name instead of g_strdup(name)
          * in the next line:
          */
-        preserve_files_list = g_list_prepend(preserve_files_list, name);
+        g_hash_table_add(settings.preserve_files, name);
 
-        g_autofree char *rp = realpath(name, NULL);
-        if (rp)
-        {
-            if (strcmp(rp, name) != 0)
-                preserve_files_list = g_list_prepend(preserve_files_list, rp);
-        }
+        char *rp = realpath(name, NULL);
+        if (rp && strcmp(rp, name) != 0)
+            g_hash_table_add(settings.preserve_files, rp);
+        else
+            free(rp);
     }
-    /* Not really necessary, but helps to reduce confusion when debugging */
-    preserve_files_list = g_list_reverse(preserve_files_list);
+
+    if (index_file && file_list)
+        settings.index = load_dir_index(index_file);
 
     g_list_foreach(dir_list, delete_dirs, preserve);
-    g_list_foreach(file_list, delete_files, preserve_files_list);
+    g_list_foreach(file_list, delete_files, &settings);
+
+    if (settings.index)
+        save_dir_index(settings.index, index_file);
 
     return 0;
 }
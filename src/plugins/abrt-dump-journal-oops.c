@@ -16,47 +16,53 @@
 #include "abrt-journal.h"
 #include "oops-utils.h"
 
-#define ABRT_JOURNAL_WATCH_STATE_FILE VAR_STATE"/abrt-dump-journal-oops.state"
+#define ABRT_JOURNAL_WATCH_STATE_FILE ABRT_JOURNAL_KOOPS_STATE_FILE
 
 /* Limit number of buffered lines */
 #define ABRT_JOURNAL_MAX_READ_LINES (1024 * 1024)
 
-#define ABRT_JOURNAL_KOOPS_ANALYZER "abrt-journal-koops"
+/* A kernel message logged more than this after the previous one starts a new
+ * backfill batch; the watch waits the same time for all lines of an oops */
+#define ABRT_JOURNAL_BACKFILL_GAP_USEC (1000 * 1000)
 
 /*
  * Koops extractor
  */
 
-static GList* abrt_journal_extract_kernel_oops(abrt_journal_t *journal)
+struct koops_lines
 {
-    size_t lines_info_count = 0;
-    size_t lines_info_size = 32;
-    struct abrt_koops_line_info *lines_info = g_malloc(lines_info_size * sizeof(lines_info[0]));
+    size_t count;
+    size_t size;
+    struct abrt_koops_line_info *info;
+};
 
-    do
+static void abrt_journal_append_kernel_line(struct koops_lines *lines, abrt_journal_t *journal)
+{
+    char *line = abrt_journal_get_log_line(journal);
+    if (line == NULL)
+        error_msg_and_die(_("Cannot read journal data."));
+
+    if (lines->count == lines->size)
     {
-        char *line = abrt_journal_get_log_line(journal);
-        if (line == NULL)
-            error_msg_and_die(_("Cannot read journal data."));
+        lines->size = lines->size ? lines->size * 2 : 32;
+        lines->info = g_realloc(lines->info, lines->size * sizeof(lines->info[0]));
+    }
 
-        if (lines_info_count == lines_info_size)
-        {
-            lines_info_size *= 2;
-            lines_info = g_realloc(lines_info, lines_info_size * sizeof(lines_info[0]));
-        }
+    char *orig_line = line;
+    lines->info[lines->count].level = abrt_koops_line_skip_level((const char **)&line);
+    abrt_koops_line_skip_jiffies((const char **)&line);
 
-        char *orig_line = line;
-        lines_info[lines_info_count].level = abrt_koops_line_skip_level((const char **)&line);
-        abrt_koops_line_skip_jiffies((const char **)&line);
+    memmove(orig_line, line, strlen(line) + 1);
 
-        memmove(orig_line, line, strlen(line) + 1);
+    lines->info[lines->count].ptr = orig_line;
 
-        lines_info[lines_info_count].ptr = orig_line;
+    ++lines->count;
+}
 
-        ++lines_info_count;
-    }
-    while (lines_info_count < ABRT_JOURNAL_MAX_READ_LINES
-            && abrt_journal_next(journal) > 0);
+static GList *abrt_journal_extract_oopses_from_lines(struct koops_lines *lines)
+{
+    const size_t lines_info_count = lines->count;
+    struct abrt_koops_line_info *lines_info = lines->info;
 
     GList *oops_list = NULL;
     abrt_koops_extract_oopses_from_lines(&oops_list, lines_info, lines_info_count);
@@ -71,6 +77,18 @@ static GList* abrt_journal_extract_kernel_oops(abrt_journal_t *journal)
     return oops_list;
 }
 
+static GList* abrt_journal_extract_kernel_oops(abrt_journal_t *journal)
+{
+    struct koops_lines lines = { 0 };
+
+    do
+        abrt_journal_append_kernel_line(&lines, journal);
+    while (lines.count < ABRT_JOURNAL_MAX_READ_LINES
+            && abrt_journal_next(journal) > 0);
+
+    return abrt_journal_extract_oopses_from_lines(&lines);
+}
+
 /*
  * An adatapter of abrt_journal_extract_kernel_oops for abrt_journal_watch_callback
  */
@@ -117,38 +135,127 @@ static void abrt_journal_watch_extract_kernel_oops(abrt_journal_watch_t *watch,
  * Koops extractor end
  */
 
-static void watch_journald(abrt_journal_t *journal, const char *dump_location, int flags)
+/*
+ * Backfill of kernel messages logged while we were not running.
+ *
+ * Lines of an oops are logged in a quick succession, so a batch ends where
+ * the kernel was silent for a while (or rebooted) and the batches can be
+ * searched for oopses in parallel.
+ */
+static bool abrt_journal_backfill_split_kernel_lines(abrt_journal_t *previous, abrt_journal_t *entry, unsigned batch_entries, void *data)
 {
-    GList *koops_strings = abrt_koops_suspicious_strings_list();
+    if (batch_entries >= ABRT_JOURNAL_MAX_READ_LINES)
+        return true;
+
+    uint64_t previous_usec = 0;
+    uint64_t entry_usec = 0;
+    if (abrt_journal_get_realtime_usec(previous, &previous_usec) < 0
+        || abrt_journal_get_realtime_usec(entry, &entry_usec) < 0
+        || entry_usec > previous_usec + ABRT_JOURNAL_BACKFILL_GAP_USEC)
+        return true;
+
+    const char *previous_boot;
+    const char *entry_boot;
+    size_t previous_boot_len;
+    size_t entry_boot_len;
+    if (abrt_journal_get_field(previous, "_BOOT_ID", (const void **)&previous_boot, &previous_boot_len) < 0
+        || abrt_journal_get_field(entry, "_BOOT_ID", (const void **)&entry_boot, &entry_boot_len) < 0)
+        return false;
+
+    return previous_boot_len != entry_boot_len || memcmp(previous_boot, entry_boot, entry_boot_len) != 0;
+}
 
-    g_autofree char *oops_string_filter_regex = abrt_oops_string_filter_regex();
-    if (oops_string_filter_regex)
-    {
-        regex_t filter_re;
-        if (regcomp(&filter_re, oops_string_filter_regex, REG_NOSUB) != 0)
-            perror_msg_and_die(_("Failed to compile regex"));
+/* Without throttling, the workers create the problem directories in
+ * parallel; otherwise they leave the oopses to the commit call back */
+static void *abrt_journal_backfill_kernel_oops(GPtrArray *entries, void *data)
+{
+    const struct watch_journald_settings *conf = (const struct watch_journald_settings *)data;
 
-        GList *iter = koops_strings;
-        while(iter != NULL)
-        {
-            GList *next = g_list_next(iter);
+    struct koops_lines lines = { 0 };
+    for (guint i = 0; i < entries->len; ++i)
+        abrt_journal_append_kernel_line(&lines, g_ptr_array_index(entries, i));
 
-            const int reti = regexec(&filter_re, (const char *)iter->data, 0, NULL, 0);
-            if (reti == 0)
-                koops_strings = g_list_delete_link(koops_strings, iter);
-            else if (reti != REG_NOMATCH)
-            {
-                char msgbuf[100];
-                regerror(reti, &filter_re, msgbuf, sizeof(msgbuf));
-                error_msg_and_die("Regex match failed: %s", msgbuf);
-            }
+    GList *oopses = abrt_journal_extract_oopses_from_lines(&lines);
+    if ((conf->oops_utils_flags & ABRT_OOPS_THROTTLE_CREATION))
+        return oopses;
 
-            iter = next;
-        }
+    abrt_oops_process_list(oopses, conf->dump_location,
+                           ABRT_JOURNAL_KOOPS_ANALYZER, conf->oops_utils_flags);
+    g_list_free_full(oopses, (GDestroyNotify)free);
+
+    return NULL;
+}
+
+static void abrt_journal_backfill_free_oopses(void *oopses)
+{
+    g_list_free_full((GList *)oopses, (GDestroyNotify)free);
+}
+
+/* Throttles the problem directory creation the same way as
+ * abrt_oops_process_list(); the throttle sleeps of abrt_oops_process_list()
+ * would serialize the workers */
+static void abrt_journal_backfill_commit_kernel_oops(void *result, void *data)
+{
+    const struct watch_journald_settings *conf = (const struct watch_journald_settings *)data;
+    const int flags = conf->oops_utils_flags & ~ABRT_OOPS_THROTTLE_CREATION;
 
-        regfree(&filter_re);
+    GList *oopses = (GList *)result;
+    const int oops_cnt = g_list_length(oopses);
+    int terminated = 0;
+    int created = 0;
+    for (GList *oops = oopses; oops != NULL && created < ABRT_OOPS_MAX_DUMPED_COUNT; oops = oops->next)
+    {
+        /* Do not lose the oopses of a batch which is going to be committed */
+        if (created++ > 0 && !terminated)
+            terminated = abrt_journal_signaled_sleep(1000);
+
+        GList *single = g_list_append(NULL, oops->data);
+        abrt_oops_process_list(single, conf->dump_location, ABRT_JOURNAL_KOOPS_ANALYZER, flags);
+        g_list_free(single);
+    }
+
+    const int unreported_cnt = oops_cnt - ABRT_OOPS_MAX_DUMPED_COUNT;
+    if (unreported_cnt > 0 && !terminated)
+    {
+        /* Quadratic throttle time growth, but careful to not overflow in "n*n" */
+        int n = unreported_cnt > 30 ? 30 : unreported_cnt;
+        n = n * n;
+        if (n > 9)
+            log_warning(_("Sleeping for %d seconds"), n);
+        abrt_journal_signaled_sleep(n * 1000);
     }
+}
+
+/* Returns true if the whole backlog was processed */
+static bool backfill_journald(abrt_journal_t *journal, const char *dump_location, int flags, unsigned workers, unsigned since_sec)
+{
+    struct watch_journald_settings backfill_conf = {
+        .dump_location = dump_location,
+        .oops_utils_flags = flags,
+    };
+
+    const struct abrt_journal_backfill backfill = {
+        .state_file = ABRT_JOURNAL_WATCH_STATE_FILE,
+        .workers = workers,
+        .queue_size = 2 * workers,
+        .since_usec = since_sec ? g_get_real_time() - (gint64)since_sec * G_USEC_PER_SEC : 0,
+        .callback = abrt_journal_backfill_kernel_oops,
+        .commit = (flags & ABRT_OOPS_THROTTLE_CREATION) ? abrt_journal_backfill_commit_kernel_oops : NULL,
+        .result_free = abrt_journal_backfill_free_oopses,
+        .split = abrt_journal_backfill_split_kernel_lines,
+        .callback_data = &backfill_conf,
+    };
 
+    const int r = abrt_journal_backfill_run(journal, &backfill);
+    if (r < 0)
+        error_msg_and_die(_("Failed to process the journal backlog"));
+
+    return r == 0;
+}
+
+static void watch_journald(abrt_journal_t *journal, const char *dump_location, int flags)
+{
+    GList *koops_strings = abrt_oops_suspicious_strings_list_filtered();
     GList *koops_strings_blacklist = abrt_koops_suspicious_strings_blacklist();
 
     struct watch_journald_settings watch_conf = {
@@ -186,7 +293,7 @@ int main(int argc, char *argv[])
 
     /* Can't keep these strings/structs static: _() doesn't support that */
     const char *program_usage_string = _(
-        "& [-vsoxtf] [-e]/[-c CURSOR] [-d DIR]/[-D]\n"
+        "& [-vsoxtf] [-e]/[-c CURSOR] [-B NUM [-S SEC]] [-d DIR]/[-D]\n"
         "\n"
         "Extract oops from systemd-journal\n"
         "\n"
@@ -196,6 +303,9 @@ int main(int argc, char *argv[])
         "the entire journal if the last seen possition is not available.\n"
         "\n"
         "The last seen position is saved in "ABRT_JOURNAL_WATCH_STATE_FILE"\n"
+        "\n"
+        "-B makes -f process the entries logged before it started (e.g. while\n"
+        "the machine was down) by NUM parallel workers before it follows new ones.\n"
     );
     enum {
         OPT_v = 1 << 0,
@@ -210,11 +320,15 @@ int main(int argc, char *argv[])
         OPT_f = 1 << 9,
         OPT_a = 1 << 10,
         OPT_J = 1 << 11,
+        OPT_B = 1 << 12,
+        OPT_S = 1 << 13,
     };
 
     char *cursor = NULL;
     char *dump_location = NULL;
     char *journal_dir = NULL;
+    int backfill_workers = 0;
+    int backfill_since = 0;
 
     /* Keep enum above and order of options below in sync! */
     struct options program_options[] = {
@@ -233,6 +347,8 @@ int main(int argc, char *argv[])
         OPT_BOOL(  'f', NULL, NULL, _("Follow systemd-journal from the last seen position (if available)")),
         OPT_BOOL(  'a', NULL, NULL, _("Read journal files from all machines")),
         OPT_STRING('J', NULL, &journal_dir,  "PATH", _("Read all journal files from directory at PATH")),
+        OPT_INTEGER('B', NULL, &backfill_workers, _("Process the journal backlog with NUM parallel workers")),
+        OPT_INTEGER('S', NULL, &backfill_since, _("Skip backlog entries older than SEC seconds")),
         OPT_END()
     };
     unsigned opts = libreport_parse_opts(argc, argv, program_options, program_usage_string);
@@ -248,6 +364,9 @@ int main(int argc, char *argv[])
     if ((opts & OPT_c) && (opts & OPT_e))
         error_msg_and_die(_("You need to specify either -c CURSOR or -e"));
 
+    if (backfill_workers < 0 || backfill_since < 0 || ((opts & OPT_S) && !(opts & OPT_B)))
+        libreport_show_usage_and_die(program_usage_string, program_options);
+
     if (opts & OPT_D)
     {
         if (opts & OPT_d)
@@ -268,10 +387,20 @@ int main(int argc, char *argv[])
     if ((opts & OPT_o))
         oops_utils_flags |= ABRT_OOPS_PRINT_STDOUT;
 
+    /* Let systemd-journal filter out everything but kernel messages, so the
+     * watch wakes up only for entries which can be a part of an oops.
+     *
+     * It is possible to override this when need while debugging.
+     */
     const char *const env_journal_filter = getenv("ABRT_DUMP_JOURNAL_OOPS_DEBUG_FILTER");
     GList *kernel_journal_filter = NULL;
-    kernel_journal_filter = g_list_append(kernel_journal_filter,
-            (env_journal_filter ? (gpointer)env_journal_filter : (gpointer)"SYSLOG_IDENTIFIER=kernel"));
+    if (env_journal_filter)
+        kernel_journal_filter = g_list_append(kernel_journal_filter, (gpointer)env_journal_filter);
+    else
+    {
+        kernel_journal_filter = g_list_append(kernel_journal_filter, (gpointer)ABRT_JOURNAL_KOOPS_MATCH_TRANSPORT);
+        kernel_journal_filter = g_list_append(kernel_journal_filter, (gpointer)ABRT_JOURNAL_KOOPS_MATCH_IDENTIFIER);
+    }
 
     abrt_journal_t *journal = NULL;
     if ((opts & OPT_J))
@@ -317,9 +446,16 @@ int main(int argc, char *argv[])
             }
         }
 
-        watch_journald(journal, dump_location, oops_utils_flags);
+        /* An interrupted backfill leaves the journal behind entries which
+         * have not been processed yet; the position saved by the backfill is
+         * the right one then. */
+        if (backfill_workers <= 0 || (opts & OPT_e)
+            || backfill_journald(journal, dump_location, oops_utils_flags, backfill_workers, backfill_since))
+        {
+            watch_journald(journal, dump_location, oops_utils_flags);
 
-        abrt_journal_save_current_position(journal, ABRT_JOURNAL_WATCH_STATE_FILE);
+            abrt_journal_save_current_position(journal, ABRT_JOURNAL_WATCH_STATE_FILE);
+        }
     }
     else
     {
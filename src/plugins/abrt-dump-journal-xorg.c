@@ -15,32 +15,7 @@
 #include "libabrt.h"
 #include "abrt-journal.h"
 #include "xorg-utils.h"
-#define ABRT_JOURNAL_XORG_WATCH_STATE_FILE VAR_STATE"/abrt-dump-journal-xorg.state"
-#define XORG_CONF "xorg.conf"
 #define XORG_CONF_PATH PLUGINS_CONF_DIR XORG_CONF
-#define XORG_DEFAULT_JOURNAL_FILTERS "_COMM=gdm-x-session, _COMM=gnome-shell"
-
-static void
-abrt_xorg_process_list_of_crashes(GList *crashes, const char *dump_location, int flags)
-{
-    if (crashes == NULL)
-        return;
-
-    GList *list;
-    for (list = crashes; list != NULL; list = list->next)
-    {
-        xorg_crash_info_create_dump_dir(list->data, dump_location, (flags & ABRT_XORG_WORLD_READABLE));
-
-        if (flags & ABRT_XORG_PRINT_STDOUT)
-            xorg_crash_info_print_crash(list->data);
-
-        if (flags & ABRT_XORG_THROTTLE_CREATION)
-            if (abrt_xorg_signaled_sleep(1) > 0)
-                break;
-    }
-
-    return;
-}
 
 static GList *abrt_journal_extract_xorg_crashes(abrt_journal_t *journal)
 {
@@ -250,17 +225,7 @@ int main(int argc, char *argv[])
     }
     else
     {
-        g_autoptr(GHashTable) settings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
-        log_notice("Loading settings from '%s'", XORG_CONF);
-        abrt_load_abrt_plugin_conf_file(XORG_CONF, settings);
-        log_debug("Loaded '%s'", XORG_CONF);
-
-        const char *conf_journal_filters = g_hash_table_lookup(settings, "JournalFilters");
-        if (!conf_journal_filters) {
-            conf_journal_filters = XORG_DEFAULT_JOURNAL_FILTERS;
-        }
-
-        xorg_journal_filter = libreport_parse_delimited_list(conf_journal_filters, ",");
+        xorg_journal_filter = abrt_xorg_journal_filters_from_conf();
         /* list data will be free by g_list_free_full */
         free_filter_list_data = true;
         if (xorg_journal_filter)
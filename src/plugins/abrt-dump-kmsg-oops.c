@@ -0,0 +1,501 @@
+/*
+ * Copyright (C) 2026  ABRT team
+ * Copyright (C) 2026  RedHat Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include <poll.h>
+#include <syslog.h>
+#include "libabrt.h"
+#include "oops-utils.h"
+
+#define ABRT_KMSG_DEVICE "/dev/kmsg"
+#define ABRT_KMSG_WATCH_STATE_FILE VAR_STATE"/abrt-dump-kmsg-oops.state"
+#define ABRT_KMSG_WATCH_STATE_FILE_MODE 0600
+#define ABRT_KMSG_BOOT_ID_FILE "/proc/sys/kernel/random/boot_id"
+
+#define ABRT_KMSG_KOOPS_ANALYZER "abrt-kmsg-koops"
+
+/* The kernel never returns a record longer than this */
+#define ABRT_KMSG_MAX_RECORD_SIZE (8 * 1024)
+
+/* Number of lines kept before a line which looks like an oops start and
+ * the number of lines read after that line at most before the oops is
+ * extracted. An oops longer than 80 lines is dropped by the parser anyway.
+ */
+#define ABRT_KMSG_CONTEXT_LINES 256
+
+/* Kernel prints an oops at once; if nothing arrives for this long after
+ * the first line of an oops, the oops is complete. */
+#define ABRT_KMSG_QUIET_MSEC 250
+
+/*
+ * /dev/kmsg reader
+ */
+
+struct kmsg_position
+{
+    char boot_id[64];
+    unsigned long long seq;
+};
+
+static void kmsg_get_boot_id(char *boot_id, size_t size)
+{
+    g_autofree char *id = libreport_xmalloc_fopen_fgetline_fclose(ABRT_KMSG_BOOT_ID_FILE);
+    g_strlcpy(boot_id, id ? id : "", size);
+}
+
+/* Returns true if the file contains a position from the current boot */
+static bool kmsg_restore_position(struct kmsg_position *pos, const char *file_name)
+{
+    g_autofree char *state = libreport_xmalloc_fopen_fgetline_fclose(file_name);
+    if (state == NULL)
+    {
+        log_notice(_("Not restoring kmsg watch's position: cannot read file '%s'"), file_name);
+        return false;
+    }
+
+    char boot_id[sizeof(pos->boot_id)];
+    unsigned long long seq;
+    if (sscanf(state, "%63s %llu", boot_id, &seq) != 2)
+    {
+        error_msg(_("Cannot restore kmsg watch's position: file '%s' is malformed"), file_name);
+        return false;
+    }
+
+    if (strcmp(boot_id, pos->boot_id) != 0)
+    {
+        log_notice("The kmsg watch's position is from the previous boot");
+        return false;
+    }
+
+    pos->seq = seq;
+    return true;
+}
+
+static int kmsg_save_position(const struct kmsg_position *pos, const char *file_name)
+{
+    int state_fd = open(file_name,
+            O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW,
+            ABRT_KMSG_WATCH_STATE_FILE_MODE);
+
+    if (state_fd < 0)
+    {
+        perror_msg(_("Cannot save kmsg watch's position: open('%s')"), file_name);
+        return -1;
+    }
+
+    g_autofree char *state = g_strdup_printf("%s %llu\n", pos->boot_id, pos->seq);
+    libreport_full_write_str(state_fd, state);
+    close(state_fd);
+
+    return 0;
+}
+
+/* Decodes \xNN escapes the kernel uses for non-printable characters */
+static void kmsg_unescape(char *message)
+{
+    char *dst = message;
+    for (const char *src = message; *src != '\0'; ++dst)
+    {
+        if (src[0] == '\\' && src[1] == 'x' && isxdigit(src[2]) && isxdigit(src[3]))
+        {
+            *dst = (g_ascii_xdigit_value(src[2]) << 4) | g_ascii_xdigit_value(src[3]);
+            src += 4;
+        }
+        else
+            *dst = *src++;
+    }
+    *dst = '\0';
+}
+
+/*
+ * Parses a record "PRIORITY,SEQUENCE,TIMESTAMP,FLAGS[,...];MESSAGE\n"
+ * optionally followed by " KEY=VALUE\n" dictionary lines.
+ *
+ * Returns false for malformed records.
+ */
+static bool kmsg_parse_record(char *record, int *priority, unsigned long long *seq, char **message)
+{
+    char *end;
+
+    errno = 0;
+    *priority = strtol(record, &end, 10);
+    if (errno != 0 || end == record || *end != ',')
+        return false;
+
+    record = end + 1;
+    *seq = strtoull(record, &end, 10);
+    if (errno != 0 || end == record || *end != ',')
+        return false;
+
+    *message = strchr(end, ';');
+    if (*message == NULL)
+        return false;
+
+    ++*message;
+    /* cut off the dictionary */
+    char *eol = strchrnul(*message, '\n');
+    *eol = '\0';
+
+    kmsg_unescape(*message);
+    return true;
+}
+
+/*
+ * Koops extractor
+ */
+
+struct kmsg_watch
+{
+    int fd;
+    struct kmsg_position pos;
+    const char *dump_location;
+    int oops_utils_flags;
+    bool save_position;
+    unsigned errors;
+
+    /* Strings which trigger oops extraction */
+    GList *koops_strings;
+    GList *koops_strings_blacklist;
+
+    /* struct abrt_koops_line_info; the last lines of kernel log */
+    GArray *lines;
+    /* Index of the first line which looks like an oops start or -1 */
+    int trigger_line;
+};
+
+static volatile sig_atomic_t s_terminated;
+
+static void handle_signal(int signo G_GNUC_UNUSED)
+{
+    s_terminated = 1;
+}
+
+static bool is_trigger_line(const struct kmsg_watch *watch, const char *line)
+{
+    GList *cur = watch->koops_strings;
+    for (; cur; cur = g_list_next(cur))
+        if (strstr(line, cur->data) != NULL)
+            break;
+
+    if (cur == NULL)
+        return false;
+
+    for (cur = watch->koops_strings_blacklist; cur; cur = g_list_next(cur))
+        if (strstr(line, cur->data) != NULL)
+            return false;
+
+    return true;
+}
+
+static void kmsg_drop_lines(struct kmsg_watch *watch, guint count)
+{
+    for (guint i = 0; i < count; ++i)
+        g_free(g_array_index(watch->lines, struct abrt_koops_line_info, i).ptr);
+
+    g_array_remove_range(watch->lines, 0, count);
+}
+
+static void kmsg_extract_oopses(struct kmsg_watch *watch)
+{
+    GList *oopses = NULL;
+    abrt_koops_extract_oopses_from_lines(&oopses,
+            (const struct abrt_koops_line_info *)watch->lines->data, watch->lines->len);
+
+    log_debug("Extracted: %d oopses", g_list_length(oopses));
+
+    watch->errors += abrt_oops_process_list(oopses, watch->dump_location,
+                                            ABRT_KMSG_KOOPS_ANALYZER, watch->oops_utils_flags);
+    g_list_free_full(oopses, (GDestroyNotify)free);
+
+    /* All buffered lines were examined, don't report them twice */
+    kmsg_drop_lines(watch, watch->lines->len);
+    watch->trigger_line = -1;
+
+    /* In case of disaster, lets make sure we won't read the messages again. */
+    if (watch->save_position)
+        kmsg_save_position(&watch->pos, ABRT_KMSG_WATCH_STATE_FILE);
+
+    if (g_abrt_oops_sleep_woke_up_on_signal > 0)
+        s_terminated = 1;
+}
+
+static void kmsg_add_line(struct kmsg_watch *watch, const char *message, int level)
+{
+    struct abrt_koops_line_info line = {
+        .ptr = g_strdup(message),
+        .level = level,
+    };
+    g_array_append_val(watch->lines, line);
+
+    if (watch->trigger_line < 0)
+    {
+        if (is_trigger_line(watch, line.ptr))
+        {
+            log_debug("Found oops candidate: '%s'", line.ptr);
+            watch->trigger_line = watch->lines->len - 1;
+        }
+        /* Nothing interesting yet, remember only a few last lines */
+        else if (watch->lines->len > ABRT_KMSG_CONTEXT_LINES)
+            kmsg_drop_lines(watch, watch->lines->len - ABRT_KMSG_CONTEXT_LINES);
+    }
+    /* An oops cannot be longer, don't wait for the quiet period */
+    else if (watch->lines->len - watch->trigger_line > ABRT_KMSG_CONTEXT_LINES)
+        kmsg_extract_oopses(watch);
+}
+
+/*
+ * Reads all records available at the moment.
+ *
+ * Returns false on unrecoverable errors.
+ */
+static bool kmsg_read_records(struct kmsg_watch *watch, unsigned long long skip_until_seq)
+{
+    char record[ABRT_KMSG_MAX_RECORD_SIZE + 1];
+
+    while (!s_terminated)
+    {
+        const ssize_t r = read(watch->fd, record, ABRT_KMSG_MAX_RECORD_SIZE);
+        if (r < 0)
+        {
+            if (errno == EAGAIN)
+                return true;
+
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EPIPE)
+            {
+                /* The ring buffer has overwritten messages we haven't read */
+                log_notice("Some kernel messages were lost before they could be read");
+                continue;
+            }
+
+            perror_msg(_("Cannot read kernel messages"));
+            return false;
+        }
+
+        /* end of file, possible when reading a copy of /dev/kmsg */
+        if (r == 0)
+            return true;
+
+        record[r] = '\0';
+
+        int priority;
+        unsigned long long seq;
+        char *message;
+        if (!kmsg_parse_record(record, &priority, &seq, &message))
+        {
+            log_notice("Malformed kernel message record: '%s'", record);
+            continue;
+        }
+
+        if (seq <= skip_until_seq)
+            continue;
+
+        watch->pos.seq = seq;
+
+        /* Messages written to /dev/kmsg by user space (LOG_USER facility
+         * and higher) are not kernel oopses */
+        if (LOG_FAC(priority) != LOG_FAC(LOG_KERN))
+            continue;
+
+        kmsg_add_line(watch, message, LOG_PRI(priority));
+    }
+
+    return true;
+}
+
+static void watch_kmsg(struct kmsg_watch *watch, unsigned long long skip_until_seq)
+{
+    signal(SIGTERM, handle_signal);
+    signal(SIGHUP, handle_signal);
+    /* Ctrl-C for easier debugging */
+    signal(SIGINT, handle_signal);
+
+    struct pollfd pollfd = {
+        .fd = watch->fd,
+        .events = POLLIN,
+    };
+
+    while (!s_terminated)
+    {
+        if (!kmsg_read_records(watch, skip_until_seq))
+            break;
+
+        /* Wait until the kernel finishes printing the oops */
+        const int r = poll(&pollfd, 1, watch->trigger_line >= 0 ? ABRT_KMSG_QUIET_MSEC : -1);
+        if (r < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            perror_msg(_("Failed to wait for kernel messages"));
+            break;
+        }
+
+        if (r == 0 && watch->trigger_line >= 0)
+            kmsg_extract_oopses(watch);
+    }
+
+    if (watch->trigger_line >= 0)
+        kmsg_extract_oopses(watch);
+}
+
+int main(int argc, char *argv[])
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-vsoxtfe] [-k FILE] [-d DIR]/[-D]\n"
+        "\n"
+        "Extract oops from kernel log buffer (/dev/kmsg)\n"
+        "\n"
+        "Without -f, reads the messages present in the kernel log buffer and exits.\n"
+        "\n"
+        "-f follows the kernel log buffer from the last seen position if it was\n"
+        "saved during the current boot, otherwise from the beginning of the buffer.\n"
+        "If the position has never been saved, the buffer is followed from the end.\n"
+        "\n"
+        "The last seen position is saved in "ABRT_KMSG_WATCH_STATE_FILE"\n"
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_s = 1 << 1,
+        OPT_o = 1 << 2,
+        OPT_d = 1 << 3,
+        OPT_D = 1 << 4,
+        OPT_x = 1 << 5,
+        OPT_t = 1 << 6,
+        OPT_e = 1 << 7,
+        OPT_f = 1 << 8,
+        OPT_k = 1 << 9,
+    };
+
+    char *dump_location = NULL;
+    char *kmsg_file = NULL;
+
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&libreport_g_verbose),
+        OPT_BOOL(  's', NULL, NULL, _("Log to syslog")),
+        OPT_BOOL(  'o', NULL, NULL, _("Print found oopses on standard output")),
+        /* oopses don't contain any sensitive info, and even
+         * the old koops app was showing the oopses to all users
+         */
+        OPT_STRING('d', NULL, &dump_location, "DIR", _("Create new problem directory in DIR for every oops found")),
+        OPT_BOOL(  'D', NULL, NULL, _("Same as -d DumpLocation, DumpLocation is specified in abrt.conf")),
+        OPT_BOOL(  'x', NULL, NULL, _("Make the problem directory world readable")),
+        OPT_BOOL(  't', NULL, NULL, _("Throttle problem directory creation to 1 per second")),
+        OPT_BOOL(  'e', NULL, NULL, _("Start reading kernel log buffer from the end")),
+        OPT_BOOL(  'f', NULL, NULL, _("Follow kernel log buffer from the last seen position (if available)")),
+        OPT_STRING('k', NULL, &kmsg_file, "FILE", _("Read kernel log records from FILE instead of "ABRT_KMSG_DEVICE)),
+        OPT_END()
+    };
+    unsigned opts = libreport_parse_opts(argc, argv, program_options, program_usage_string);
+
+    libreport_export_abrt_envvars(0);
+
+    libreport_msg_prefix = libreport_g_progname;
+    if ((opts & OPT_s) || getenv("ABRT_SYSLOG"))
+    {
+        libreport_logmode = LOGMODE_JOURNAL;
+    }
+
+    if (opts & OPT_D)
+    {
+        if (opts & OPT_d)
+            libreport_show_usage_and_die(program_usage_string, program_options);
+        abrt_load_abrt_conf();
+        dump_location = abrt_g_settings_dump_location;
+        abrt_g_settings_dump_location = NULL;
+        abrt_free_abrt_conf_data();
+    }
+
+    int oops_utils_flags = 0;
+    if ((opts & OPT_x))
+        oops_utils_flags |= ABRT_OOPS_WORLD_READABLE;
+
+    if ((opts & OPT_t))
+        oops_utils_flags |= ABRT_OOPS_THROTTLE_CREATION;
+
+    if ((opts & OPT_o))
+        oops_utils_flags |= ABRT_OOPS_PRINT_STDOUT;
+
+    struct kmsg_watch watch = {
+        .dump_location = dump_location,
+        .oops_utils_flags = oops_utils_flags,
+        .save_position = (opts & OPT_f),
+        .koops_strings = abrt_oops_suspicious_strings_list_filtered(),
+        .koops_strings_blacklist = abrt_koops_suspicious_strings_blacklist(),
+        .lines = g_array_new(FALSE, FALSE, sizeof(struct abrt_koops_line_info)),
+        .trigger_line = -1,
+    };
+
+    if (kmsg_file == NULL)
+        kmsg_file = (char *)ABRT_KMSG_DEVICE;
+
+    watch.fd = open(kmsg_file, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (watch.fd < 0)
+        perror_msg_and_die(_("Cannot open '%s'"), kmsg_file);
+
+    kmsg_get_boot_id(watch.pos.boot_id, sizeof(watch.pos.boot_id));
+
+    /* Records with sequence number lower or equal are skipped */
+    unsigned long long skip_until_seq = 0;
+
+    if ((opts & OPT_e))
+    {
+        if (lseek(watch.fd, 0, SEEK_END) < 0)
+            perror_msg_and_die(_("Cannot seek to the end of kernel log buffer"));
+    }
+    else if ((opts & OPT_f))
+    {
+        struct stat st;
+        if (kmsg_restore_position(&watch.pos, ABRT_KMSG_WATCH_STATE_FILE))
+            skip_until_seq = watch.pos.seq;
+        /* We haven't seen this boot yet, read it from the beginning */
+        else if (stat(ABRT_KMSG_WATCH_STATE_FILE, &st) == 0)
+            skip_until_seq = 0;
+        /* We couldn't restore the position, so let's start following the buffer from the end */
+        else if (lseek(watch.fd, 0, SEEK_END) < 0)
+            perror_msg_and_die(_("Cannot seek to the end of kernel log buffer"));
+    }
+
+    if ((opts & OPT_f))
+    {
+        watch_kmsg(&watch, skip_until_seq);
+        kmsg_save_position(&watch.pos, ABRT_KMSG_WATCH_STATE_FILE);
+    }
+    else
+    {
+        kmsg_read_records(&watch, skip_until_seq);
+        if (watch.trigger_line >= 0)
+            kmsg_extract_oopses(&watch);
+    }
+
+    kmsg_drop_lines(&watch, watch.lines->len);
+    g_array_free(watch.lines, TRUE);
+    g_list_free(watch.koops_strings);
+    g_list_free(watch.koops_strings_blacklist);
+    close(watch.fd);
+
+    return watch.errors;
+}
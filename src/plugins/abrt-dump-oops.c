@@ -17,6 +17,7 @@
        Arjan van de Ven <arjan@linux.intel.com>
  */
 #include <syslog.h>
+#include <sys/mman.h>
 #include <glib/gstdio.h>
 #include "libabrt.h"
 #include "oops-utils.h"
@@ -24,6 +25,8 @@
 #define MAX_SCAN_BLOCK  (4*1024*1024)
 #define READ_AHEAD          (10*1024)
 #define ABRT_DUMP_OOPS_ANALYZER "abrt-oops"
+/* Don't bother other threads with less lines than this */
+#define MIN_SCAN_RANGE_LINES (16*1024)
 
 static void scan_syslog_file(GList **oops_list, int fd)
 {
@@ -60,6 +63,212 @@ static void scan_syslog_file(GList **oops_list, int fd)
     }
 }
 
+/*
+ * Parallel scanning of large log files (-j)
+ *
+ * The mapped file is cut at line boundaries into chunks of about
+ * MAX_SCAN_BLOCK bytes and the chunks are split into kernel lines by a pool
+ * of threads. The kernel lines are then cut into ranges which are searched
+ * for oopses by the pool too. An oops crossing the end of a range is
+ * finished by the thread which found its beginning. Results are joined in
+ * the original order.
+ *
+ * A range is parsed from the state rebuilt from a few preceding lines. If
+ * that differs from the state the previous range ended in, the lines are
+ * parsed again in one go.
+ */
+struct scan_chunk
+{
+    const char *data;       /* points into the mapped file */
+    size_t size;
+    char *lines;            /* kernel lines copied out of the chunk */
+    struct abrt_koops_line_info *lines_info;
+    int lines_info_size;
+    bool marker_seen;
+};
+
+struct scan_range
+{
+    const struct abrt_koops_line_info *lines_info;
+    int lines_info_size;
+    int begin;
+    int end;
+    GList *oops_list;
+    struct abrt_koops_parser_state begin_state;
+    struct abrt_koops_parser_state end_state;
+};
+
+static void split_chunk(gpointer data, gpointer user_data)
+{
+    struct scan_chunk *chunk = data;
+
+    /* abrt_koops_split_lines() needs writable buffer terminated by '\n' */
+    const size_t size = chunk->size + (chunk->data[chunk->size - 1] != '\n');
+    char *buffer = g_malloc(size);
+    memcpy(buffer, chunk->data, chunk->size);
+    buffer[size - 1] = '\n';
+
+    chunk->lines_info_size = abrt_koops_split_lines(buffer, size, &chunk->lines_info, &chunk->marker_seen);
+
+    /* Kernel lines are usually a small fraction of a syslog file, keep only
+     * them to not hold a copy of the whole file in memory. */
+    size_t lines_size = 1;
+    for (int i = 0; i < chunk->lines_info_size; ++i)
+        lines_size += strlen(chunk->lines_info[i].ptr) + 1;
+
+    chunk->lines = g_malloc(lines_size);
+    char *dst = chunk->lines;
+    for (int i = 0; i < chunk->lines_info_size; ++i)
+    {
+        char *const line = dst;
+        dst = stpcpy(dst, chunk->lines_info[i].ptr) + 1;
+        chunk->lines_info[i].ptr = line;
+    }
+
+    g_free(buffer);
+}
+
+static void scan_range(gpointer data, gpointer user_data)
+{
+    struct scan_range *range = data;
+
+    abrt_koops_extract_oopses_from_lines_range(&range->oops_list,
+            range->lines_info, range->lines_info_size, range->begin, range->end,
+            &range->begin_state, &range->end_state);
+}
+
+static void run_in_thread_pool(GFunc func, GArray *items, unsigned jobs)
+{
+    GError *error = NULL;
+    GThreadPool *pool = g_thread_pool_new(func, NULL, jobs, /*exclusive*/TRUE, &error);
+    if (pool == NULL)
+        error_msg_and_die("Can't create thread pool: %s", error->message);
+
+    for (guint i = 0; i < items->len; ++i)
+    {
+        if (!g_thread_pool_push(pool, items->data + i * g_array_get_element_size(items), &error))
+            error_msg_and_die("Can't start a worker thread: %s", error->message);
+    }
+
+    /* wait for all tasks */
+    g_thread_pool_free(pool, /*immediate*/FALSE, /*wait*/TRUE);
+}
+
+/* Returns false if the file cannot be mapped and must be read sequentially */
+static bool scan_syslog_file_parallel(GList **oops_list, int fd, unsigned jobs)
+{
+    struct stat st;
+    const off_t cur_pos = lseek(fd, 0, SEEK_CUR);
+    if (cur_pos < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+
+    if (st.st_size <= cur_pos)
+        return true;
+
+    const size_t map_size = st.st_size;
+    char *const map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        perror_msg("Can't map the file, reading it sequentially");
+        return false;
+    }
+
+    /* Cut the file into chunks at line boundaries */
+    GArray *chunks = g_array_new(FALSE, TRUE, sizeof(struct scan_chunk));
+    const char *const map_end = map + map_size;
+    for (const char *pos = map + cur_pos; pos < map_end; )
+    {
+        const char *chunk_end = map_end;
+        if (map_end - pos > MAX_SCAN_BLOCK)
+        {
+            const char *const nl = memchr(pos + MAX_SCAN_BLOCK, '\n', map_end - pos - MAX_SCAN_BLOCK);
+            if (nl)
+                chunk_end = nl + 1;
+        }
+
+        struct scan_chunk chunk = { .data = pos, .size = chunk_end - pos };
+        g_array_append_val(chunks, chunk);
+        pos = chunk_end;
+    }
+
+    log_debug("Splitting %zu bytes in %u chunks", (size_t)(map_size - cur_pos), chunks->len);
+    run_in_thread_pool(split_chunk, chunks, jobs);
+
+    /* Everything before our own marker has been already reported */
+    guint first_chunk = 0;
+    for (guint i = 0; i < chunks->len; ++i)
+        if (g_array_index(chunks, struct scan_chunk, i).marker_seen)
+            first_chunk = i;
+
+    int lines_info_size = 0;
+    for (guint i = first_chunk; i < chunks->len; ++i)
+        lines_info_size += g_array_index(chunks, struct scan_chunk, i).lines_info_size;
+
+    struct abrt_koops_line_info *lines_info = g_new(struct abrt_koops_line_info, MAX(lines_info_size, 1));
+    int line = 0;
+    for (guint i = first_chunk; i < chunks->len; ++i)
+    {
+        struct scan_chunk *chunk = &g_array_index(chunks, struct scan_chunk, i);
+        if (chunk->lines_info_size)
+            memcpy(lines_info + line, chunk->lines_info, chunk->lines_info_size * sizeof(lines_info[0]));
+        line += chunk->lines_info_size;
+        g_free(chunk->lines_info);
+        chunk->lines_info = NULL;
+    }
+
+    /* Let every thread get a few ranges to even out the load */
+    const int range_lines = MAX(MIN_SCAN_RANGE_LINES, lines_info_size / (jobs * 4) + 1);
+    GArray *ranges = g_array_new(FALSE, TRUE, sizeof(struct scan_range));
+    for (int begin = 0; begin < lines_info_size; begin += range_lines)
+    {
+        struct scan_range range = {
+            .lines_info = lines_info,
+            .lines_info_size = lines_info_size,
+            .begin = begin,
+            .end = MIN(begin + range_lines, lines_info_size),
+        };
+        g_array_append_val(ranges, range);
+    }
+
+    log_debug("Scanning %d kernel lines in %u ranges", lines_info_size, ranges->len);
+    run_in_thread_pool(scan_range, ranges, jobs);
+
+    bool in_sync = true;
+    for (guint i = 1; i < ranges->len && in_sync; ++i)
+    {
+        const struct scan_range *prev = &g_array_index(ranges, struct scan_range, i - 1);
+        const struct scan_range *range = &g_array_index(ranges, struct scan_range, i);
+        in_sync = abrt_koops_parser_states_equal(&prev->end_state, &range->begin_state);
+        if (!in_sync)
+            log_notice("Can't rebuild the oops parser state at line %d, scanning the lines in one thread", range->begin);
+    }
+
+    GList *range_oopses = NULL;
+    for (guint i = 0; i < ranges->len; ++i)
+        range_oopses = g_list_concat(range_oopses, g_array_index(ranges, struct scan_range, i).oops_list);
+
+    if (in_sync)
+        *oops_list = g_list_concat(*oops_list, range_oopses);
+    else
+    {
+        g_list_free_full(range_oopses, free);
+        abrt_koops_extract_oopses_from_lines(oops_list, lines_info, lines_info_size);
+    }
+
+    g_array_free(ranges, TRUE);
+    g_free(lines_info);
+    for (guint i = 0; i < chunks->len; ++i)
+    {
+        struct scan_chunk *chunk = &g_array_index(chunks, struct scan_chunk, i);
+        g_free(chunk->lines_info);
+        g_free(chunk->lines);
+    }
+    g_array_free(chunks, TRUE);
+    munmap(map, map_size);
+
+    return true;
+}
+
 int main(int argc, char **argv)
 {
     /* I18n */
@@ -73,7 +282,7 @@ int main(int argc, char **argv)
 
     /* Can't keep these strings/structs static: _() doesn't support that */
     const char *program_usage_string = _(
-        "& [-vusoxm] [-d DIR]/[-D] [FILE]\n"
+        "& [-vusoxm] [-j NUM] [-d DIR]/[-D] [FILE]\n"
         "\n"
         "Extract oops from FILE (or standard input)"
     );
@@ -87,8 +296,10 @@ int main(int argc, char **argv)
         OPT_x = 1 << 6,
         OPT_t = 1 << 7,
         OPT_m = 1 << 8,
+        OPT_j = 1 << 9,
     };
     char *problem_dir = NULL;
+    int jobs = 1;
     char *dump_location = NULL;
     /* Keep enum above and order of options below in sync! */
     struct options program_options[] = {
@@ -104,9 +315,12 @@ int main(int argc, char **argv)
         OPT_BOOL(  'x', NULL, NULL, _("Make the problem directory world readable")),
         OPT_BOOL(  't', NULL, NULL, _("Throttle problem directory creation to 1 per second")),
         OPT_BOOL(  'm', NULL, NULL, _("Print search string(s) to stdout and exit")),
+        OPT_INTEGER('j', NULL, &jobs, _("Scan FILE in NUM threads (0 means one thread per CPU)")),
         OPT_END()
     };
     unsigned opts = libreport_parse_opts(argc, argv, program_options, program_usage_string);
+    if (jobs < 0)
+        error_msg_and_die(_("Invalid number of threads: %d"), jobs);
 
     libreport_export_abrt_envvars(0);
 
@@ -161,8 +375,12 @@ int main(int argc, char **argv)
     if (argv[0])
         libreport_xmove_fd(g_open(argv[0], O_RDONLY), STDIN_FILENO);
 
+    if (jobs == 0)
+        jobs = g_get_num_processors();
+
     GList *oops_list = NULL;
-    scan_syslog_file(&oops_list, STDIN_FILENO);
+    if (jobs == 1 || !scan_syslog_file_parallel(&oops_list, STDIN_FILENO, jobs))
+        scan_syslog_file(&oops_list, STDIN_FILENO);
 
     unsigned errors = 0;
     if (opts & OPT_u)
@@ -0,0 +1,75 @@
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#include "libabrt.h"
+
+int main(int argc, char **argv)
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    const char *dump_dir_name = ".";
+    /* The value 240 was taken from abrt-action-generate-core-backtrace.c. */
+    int exec_timeout_sec = 240;
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-v] [-d DIR] [-t NUM] COMMAND...\n"
+        "\n"
+        "Runs gdb COMMANDs in the gdb session shared by the analyzers of problem\n"
+        "directory DIR and prints their output. The session is started if needed.\n"
+        "Exits with 1 if the event didn't ask for a session (ABRT_GDB_SESSION\n"
+        "is not set) or if it can't be used."
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_d = 1 << 1,
+        OPT_t = 1 << 2,
+    };
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&libreport_g_verbose),
+        OPT_STRING( 'd', NULL, &dump_dir_name   , "DIR", _("Problem directory")),
+        OPT_INTEGER('t', NULL, &exec_timeout_sec,        _("Kill gdb if a command runs for more than NUM seconds")),
+        OPT_END()
+    };
+    /*unsigned opts =*/ libreport_parse_opts(argc, argv, program_options, program_usage_string);
+    argv += optind;
+    if (!argv[0] || exec_timeout_sec <= 0)
+        libreport_show_usage_and_die(program_usage_string, program_options);
+
+    libreport_export_abrt_envvars(0);
+
+    struct dump_dir *dd = dd_opendir(dump_dir_name, DD_OPEN_READONLY);
+    if (!dd)
+        return 1;
+
+    g_autofree char *output = abrt_gdb_session_execute(dd, (const char *const *)argv, exec_timeout_sec);
+    dd_close(dd);
+    if (!output)
+        return 1;
+
+    fputs(output, stdout);
+    return 0;
+}
@@ -0,0 +1,835 @@
+/*
+ * Copyright (C) 2026  ABRT team
+ * Copyright (C) 2026  RedHat Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "libabrt.h"
+#include "abrt-journal.h"
+#include "journal-core-utils.h"
+#include "oops-utils.h"
+#include "xorg-utils.h"
+
+/* Give systemd-journal one second to suck in all lines of a crash */
+#define ABRT_JOURNAL_WATCHER_COLLECT_MSEC 1000
+
+/* Limit number of buffered lines */
+#define ABRT_JOURNAL_WATCHER_MAX_LINES (64 * 1024)
+
+/*
+ * A detector gets all journal entries passing its matches.
+ *
+ * All detectors share a single journal opened with a union of their matches.
+ * Every detector has its own state file, the same one as the corresponding
+ * abrt-dump-journal-* tool, so the watcher and the tools can replace each
+ * other.
+ */
+struct detector;
+
+struct detector_ops
+{
+    const char *name;
+
+    /* Called for every new journal entry passing the detector's matches */
+    void (*entry)(struct detector *d, abrt_journal_t *journal);
+
+    /* Called when the journal is drained; returns the number of milliseconds
+     * after which the detector wants to be called again or -1. Must process
+     * all pending entries if terminating is true. */
+    int (*idle)(struct detector *d, bool terminating);
+
+    void (*free)(struct detector *d);
+};
+
+struct detector
+{
+    const struct detector_ops *ops;
+
+    const char *state_file;
+    GList *matches;
+
+    /* Entries up to the restored position have already been seen */
+    bool catching_up;
+    char *seen_cursor;
+    uint64_t seen_usec;
+
+    /* Number of entries since the position was saved */
+    unsigned dirty;
+    /* The detector holds entries it has not processed yet, so its position
+     * must not be saved */
+    bool busy;
+};
+
+static void detector_free(struct detector *d)
+{
+    if (d == NULL)
+        return;
+
+    g_free(d->seen_cursor);
+    d->ops->free(d);
+}
+
+static bool detector_has_seen(struct detector *d, abrt_journal_t *journal)
+{
+    uint64_t usec;
+    if (abrt_journal_get_realtime_usec(journal, &usec) < 0)
+        return false;
+
+    if (usec < d->seen_usec)
+        return true;
+
+    d->catching_up = false;
+    log_debug("Detector '%s' has caught up", d->ops->name);
+
+    return d->seen_cursor != NULL && abrt_journal_test_cursor(journal, d->seen_cursor) > 0;
+}
+
+static void detector_save_position(struct detector *d, abrt_journal_t *journal)
+{
+    if (d->dirty == 0 || d->busy)
+        return;
+
+    abrt_journal_save_current_position_sync(journal, d->state_file);
+    d->dirty = 0;
+}
+
+/*
+ * Collects lines following a trigger line for a while and then processes them
+ * at once, the same way the abrt-dump-journal-* tools do. The tools read the
+ * lines by moving the journal forward, which is not possible with a shared
+ * journal.
+ *
+ * The tools throttle problem directory creation by sleeping, which would stop
+ * all detectors here. The detector queues the problems instead and submits
+ * them one by one from the idle callback.
+ */
+struct collecting_detector
+{
+    struct detector cd_detector;
+
+    const char *cd_dump_location;
+    int cd_flags;
+    bool cd_throttle;
+
+    GPtrArray *cd_lines;
+    gint64 cd_trigger_ms;
+
+    /* Problems waiting for their turn if throttling */
+    GQueue *cd_pending;
+    gint64 cd_next_submit_ms;
+    /* Additional pause after the pending problems are submitted */
+    gint64 cd_hold_ms;
+
+    /* Takes the ownership of the line if it returns true */
+    bool (*cd_is_trigger)(struct collecting_detector *cd, abrt_journal_t *journal, char **line);
+    /* Returns the list of problems found in the collected lines */
+    GList *(*cd_extract)(struct collecting_detector *cd);
+    /* Creates problem directories, must not sleep */
+    void (*cd_submit)(struct collecting_detector *cd, GList *problems);
+    GDestroyNotify cd_problem_free;
+};
+
+static void collecting_detector_submit_all(struct collecting_detector *cd, GList *problems)
+{
+    if (problems != NULL)
+        cd->cd_submit(cd, problems);
+
+    g_list_free_full(problems, cd->cd_problem_free);
+}
+
+/* Returns the number of milliseconds until the next problem can be submitted
+ * or -1 if there is nothing to submit */
+static int collecting_detector_submit_pending(struct collecting_detector *cd, bool terminating)
+{
+    if (g_queue_is_empty(cd->cd_pending))
+        return -1;
+
+    if (terminating)
+    {
+        /* Do not lose the problems, their lines have already been seen */
+        GList *problems = NULL;
+        while (!g_queue_is_empty(cd->cd_pending))
+            problems = g_list_prepend(problems, g_queue_pop_tail(cd->cd_pending));
+
+        collecting_detector_submit_all(cd, problems);
+        return -1;
+    }
+
+    const gint64 now = g_get_monotonic_time() / 1000;
+    if (now < cd->cd_next_submit_ms)
+        return cd->cd_next_submit_ms - now;
+
+    GList *problem = g_list_append(NULL, g_queue_pop_head(cd->cd_pending));
+    collecting_detector_submit_all(cd, problem);
+
+    cd->cd_next_submit_ms = now + 1000;
+    if (g_queue_is_empty(cd->cd_pending))
+    {
+        cd->cd_next_submit_ms += cd->cd_hold_ms;
+        cd->cd_hold_ms = 0;
+        return -1;
+    }
+
+    return 1000;
+}
+
+static void collecting_detector_flush(struct collecting_detector *cd)
+{
+    GList *problems = cd->cd_lines->len > 0 ? cd->cd_extract(cd) : NULL;
+
+    g_ptr_array_set_size(cd->cd_lines, 0);
+    cd->cd_trigger_ms = -1;
+
+    if (!cd->cd_throttle)
+        collecting_detector_submit_all(cd, problems);
+    else
+    {
+        for (GList *l = problems; l != NULL; l = l->next)
+            g_queue_push_tail(cd->cd_pending, l->data);
+        g_list_free(problems);
+
+        collecting_detector_submit_pending(cd, /*terminating*/false);
+    }
+
+    cd->cd_detector.busy = !g_queue_is_empty(cd->cd_pending);
+}
+
+static void collecting_detector_entry(struct detector *d, abrt_journal_t *journal)
+{
+    struct collecting_detector *cd = (struct collecting_detector *)d;
+
+    collecting_detector_submit_pending(cd, /*terminating*/false);
+
+    const gint64 now = g_get_monotonic_time() / 1000;
+    if (cd->cd_trigger_ms >= 0
+        && (now - cd->cd_trigger_ms >= ABRT_JOURNAL_WATCHER_COLLECT_MSEC
+            || cd->cd_lines->len >= ABRT_JOURNAL_WATCHER_MAX_LINES))
+        collecting_detector_flush(cd);
+
+    char *line = NULL;
+    if (cd->cd_trigger_ms < 0)
+    {
+        if (!cd->cd_is_trigger(cd, journal, &line))
+            return;
+
+        cd->cd_trigger_ms = now;
+        d->busy = true;
+    }
+
+    if (line == NULL)
+        line = abrt_journal_get_log_line(journal);
+
+    if (line == NULL)
+    {
+        error_msg(_("Cannot read journal data."));
+        return;
+    }
+
+    g_ptr_array_add(cd->cd_lines, line);
+}
+
+static int collecting_detector_idle(struct detector *d, bool terminating)
+{
+    struct collecting_detector *cd = (struct collecting_detector *)d;
+
+    int timeout = -1;
+    if (cd->cd_trigger_ms >= 0)
+    {
+        const gint64 remaining = cd->cd_trigger_ms + ABRT_JOURNAL_WATCHER_COLLECT_MSEC
+                                 - g_get_monotonic_time() / 1000;
+        if (!terminating && remaining > 0)
+            timeout = remaining;
+        else
+            collecting_detector_flush(cd);
+    }
+
+    const int submit_timeout = collecting_detector_submit_pending(cd, terminating);
+    d->busy = cd->cd_trigger_ms >= 0 || !g_queue_is_empty(cd->cd_pending);
+
+    if (submit_timeout >= 0 && (timeout < 0 || submit_timeout < timeout))
+        timeout = submit_timeout;
+
+    return timeout;
+}
+
+static void collecting_detector_init(struct collecting_detector *cd, const char *dump_location, int flags, bool throttle)
+{
+    cd->cd_dump_location = dump_location;
+    cd->cd_flags = flags;
+    cd->cd_throttle = throttle;
+    cd->cd_lines = g_ptr_array_new_with_free_func(free);
+    cd->cd_trigger_ms = -1;
+    cd->cd_pending = g_queue_new();
+}
+
+static void collecting_detector_destroy(struct collecting_detector *cd)
+{
+    g_queue_free_full(cd->cd_pending, cd->cd_problem_free);
+    g_ptr_array_free(cd->cd_lines, TRUE);
+}
+
+/*
+ * Core detector
+ */
+struct core_detector
+{
+    struct detector cod_detector;
+    abrt_watch_core_conf_t cod_conf;
+};
+
+static void core_detector_entry(struct detector *d, abrt_journal_t *journal)
+{
+    abrt_journal_core_process(journal, &((struct core_detector *)d)->cod_conf);
+}
+
+static void core_detector_free(struct detector *d)
+{
+    g_list_free(d->matches);
+    g_free(d);
+}
+
+static const struct detector_ops core_detector_ops = {
+    .name = "core",
+    .entry = core_detector_entry,
+    .free = core_detector_free,
+};
+
+static struct detector *core_detector_new(const char *dump_location, int throttle, int run_flags)
+{
+    struct core_detector *cod = g_new0(struct core_detector, 1);
+    cod->cod_detector.ops = &core_detector_ops;
+    cod->cod_detector.state_file = ABRT_JOURNAL_CORE_STATE_FILE;
+    cod->cod_detector.matches = g_list_append(cod->cod_detector.matches, (gpointer)ABRT_JOURNAL_CORE_MATCH_IDENTIFIER);
+    cod->cod_detector.matches = g_list_append(cod->cod_detector.matches, (gpointer)ABRT_JOURNAL_CORE_MATCH_MESSAGE_ID);
+    cod->cod_conf.awc_dump_location = dump_location;
+    cod->cod_conf.awc_run_flags = run_flags;
+
+    abrt_journal_core_load_throttle_conf(&cod->cod_conf);
+    if (throttle >= 0)
+        cod->cod_conf.awc_throttle = throttle;
+    if (cod->cod_conf.awc_throttle > 0)
+        cod->cod_conf.awc_throttle_state_file = ABRT_JOURNAL_CORE_THROTTLE_STATE_FILE;
+
+    return &cod->cod_detector;
+}
+
+/*
+ * Kernel oops detector
+ */
+struct koops_detector
+{
+    struct collecting_detector kd_collector;
+    GList *kd_strings;
+    GList *kd_blacklisted_strings;
+};
+
+static bool koops_detector_is_trigger(struct collecting_detector *cd, abrt_journal_t *journal, char **line)
+{
+    struct koops_detector *kd = (struct koops_detector *)cd;
+    return abrt_journal_message_contains(journal, kd->kd_strings, kd->kd_blacklisted_strings);
+}
+
+static GList *koops_detector_extract(struct collecting_detector *cd)
+{
+    GPtrArray *lines = cd->cd_lines;
+    struct abrt_koops_line_info *lines_info = g_new(struct abrt_koops_line_info, lines->len);
+
+    for (guint i = 0; i < lines->len; ++i)
+    {
+        char *orig_line = g_ptr_array_index(lines, i);
+        const char *line = orig_line;
+        lines_info[i].level = abrt_koops_line_skip_level(&line);
+        abrt_koops_line_skip_jiffies(&line);
+
+        memmove(orig_line, line, strlen(line) + 1);
+        lines_info[i].ptr = orig_line;
+    }
+
+    GList *oops_list = NULL;
+    abrt_koops_extract_oopses_from_lines(&oops_list, lines_info, lines->len);
+    g_free(lines_info);
+
+    const int oops_cnt = g_list_length(oops_list);
+    log_debug("Extracted: %d oopses", oops_cnt);
+
+    /* abrt_oops_process_list() does not report more oopses at once and sleeps
+     * after an "abrt storm" if throttling */
+    const int unreported_cnt = oops_cnt - ABRT_OOPS_MAX_DUMPED_COUNT;
+    if (cd->cd_throttle && unreported_cnt > 0)
+    {
+        log_warning("Found oopses: %d", oops_cnt);
+
+        GList *unreported = g_list_nth(oops_list, ABRT_OOPS_MAX_DUMPED_COUNT);
+        unreported->prev->next = NULL;
+        unreported->prev = NULL;
+        g_list_free_full(unreported, (GDestroyNotify)free);
+
+        /* Quadratic throttle time growth, but careful to not overflow in "n*n" */
+        int n = unreported_cnt > 30 ? 30 : unreported_cnt;
+        n = n * n;
+        if (n > 9)
+            log_warning("Pausing for %d seconds", n);
+        cd->cd_hold_ms += n * 1000;
+    }
+
+    return oops_list;
+}
+
+static void koops_detector_submit(struct collecting_detector *cd, GList *oops_list)
+{
+    abrt_oops_process_list(oops_list, cd->cd_dump_location,
+                           ABRT_JOURNAL_KOOPS_ANALYZER, cd->cd_flags);
+}
+
+static void koops_detector_free(struct detector *d)
+{
+    struct koops_detector *kd = (struct koops_detector *)d;
+
+    g_list_free(kd->kd_strings);
+    g_list_free(kd->kd_blacklisted_strings);
+    collecting_detector_destroy(&kd->kd_collector);
+    g_list_free(d->matches);
+    g_free(kd);
+}
+
+static const struct detector_ops koops_detector_ops = {
+    .name = "koops",
+    .entry = collecting_detector_entry,
+    .idle = collecting_detector_idle,
+    .free = koops_detector_free,
+};
+
+static struct detector *koops_detector_new(const char *dump_location, int oops_utils_flags, bool throttle)
+{
+    struct koops_detector *kd = g_new0(struct koops_detector, 1);
+    collecting_detector_init(&kd->kd_collector, dump_location, oops_utils_flags, throttle);
+    kd->kd_collector.cd_is_trigger = koops_detector_is_trigger;
+    kd->kd_collector.cd_extract = koops_detector_extract;
+    kd->kd_collector.cd_submit = koops_detector_submit;
+    kd->kd_collector.cd_problem_free = free;
+    kd->kd_strings = abrt_oops_suspicious_strings_list_filtered();
+    kd->kd_blacklisted_strings = abrt_koops_suspicious_strings_blacklist();
+
+    struct detector *d = &kd->kd_collector.cd_detector;
+    d->ops = &koops_detector_ops;
+    d->state_file = ABRT_JOURNAL_KOOPS_STATE_FILE;
+    d->matches = g_list_append(d->matches, (gpointer)ABRT_JOURNAL_KOOPS_MATCH_TRANSPORT);
+    d->matches = g_list_append(d->matches, (gpointer)ABRT_JOURNAL_KOOPS_MATCH_IDENTIFIER);
+
+    return d;
+}
+
+/*
+ * Xorg crash detector
+ */
+struct xorg_lines_iterator
+{
+    GPtrArray *xli_lines;
+    guint xli_next;
+};
+
+static char *xorg_lines_iterator_next(void *data)
+{
+    struct xorg_lines_iterator *iter = (struct xorg_lines_iterator *)data;
+    if (iter->xli_next >= iter->xli_lines->len)
+        return NULL;
+
+    return g_strdup(g_ptr_array_index(iter->xli_lines, iter->xli_next++));
+}
+
+static bool xorg_detector_is_trigger(struct collecting_detector *cd, abrt_journal_t *journal, char **line)
+{
+    char *message = abrt_journal_get_log_line(journal);
+    if (message == NULL || strcmp(skip_pfx(message), XORG_SEARCH_STRING) != 0)
+    {
+        free(message);
+        return false;
+    }
+
+    *line = message;
+    return true;
+}
+
+static GList *xorg_detector_extract(struct collecting_detector *cd)
+{
+    GList *crashes = NULL;
+    struct xorg_lines_iterator iter = {
+        .xli_lines = cd->cd_lines,
+        .xli_next = 0,
+    };
+
+    while (iter.xli_next < iter.xli_lines->len)
+    {
+        char *line = g_ptr_array_index(iter.xli_lines, iter.xli_next++);
+        if (strcmp(skip_pfx(line), XORG_SEARCH_STRING) != 0)
+            continue;
+
+        struct xorg_crash_info *crash_info = process_xorg_bt(xorg_lines_iterator_next, &iter);
+        if (crash_info)
+            crashes = g_list_append(crashes, crash_info);
+        else
+            log_warning(_("Failed to parse Backtrace from journal"));
+    }
+
+    log_warning("Found crashes: %d", g_list_length(crashes));
+
+    return crashes;
+}
+
+static void xorg_detector_submit(struct collecting_detector *cd, GList *crashes)
+{
+    abrt_xorg_process_list_of_crashes(crashes, cd->cd_dump_location, cd->cd_flags);
+}
+
+static void xorg_detector_free(struct detector *d)
+{
+    struct collecting_detector *cd = (struct collecting_detector *)d;
+
+    collecting_detector_destroy(cd);
+    g_list_free_full(d->matches, free);
+    g_free(cd);
+}
+
+static const struct detector_ops xorg_detector_ops = {
+    .name = "xorg",
+    .entry = collecting_detector_entry,
+    .idle = collecting_detector_idle,
+    .free = xorg_detector_free,
+};
+
+static struct detector *xorg_detector_new(const char *dump_location, int xorg_utils_flags, bool throttle, GList *journal_filters)
+{
+    struct collecting_detector *cd = g_new0(struct collecting_detector, 1);
+    collecting_detector_init(cd, dump_location, xorg_utils_flags, throttle);
+    cd->cd_is_trigger = xorg_detector_is_trigger;
+    cd->cd_extract = xorg_detector_extract;
+    cd->cd_submit = xorg_detector_submit;
+    cd->cd_problem_free = (GDestroyNotify)xorg_crash_info_free;
+
+    struct detector *d = &cd->cd_detector;
+    d->ops = &xorg_detector_ops;
+    d->state_file = ABRT_JOURNAL_XORG_WATCH_STATE_FILE;
+
+    if (journal_filters != NULL)
+    {
+        for (GList *l = journal_filters; l != NULL; l = l->next)
+            d->matches = g_list_append(d->matches, g_strdup(l->data));
+    }
+    else
+        d->matches = abrt_xorg_journal_filters_from_conf();
+
+    if (d->matches == NULL)
+        error_msg_and_die(_("Journal filter must be specified either by parameter -j or stored in /etc/abrt/plugins/xorg.conf file"));
+
+    return d;
+}
+
+/*
+ * The watcher
+ */
+struct watcher
+{
+    GList *detectors;
+    bool single;
+};
+
+static void watcher_dispatch_entry(abrt_journal_watch_t *watch, void *data)
+{
+    struct watcher *w = (struct watcher *)data;
+    abrt_journal_t *journal = abrt_journal_watch_get_journal(watch);
+
+    for (GList *l = w->detectors; l != NULL; l = l->next)
+    {
+        struct detector *d = (struct detector *)l->data;
+
+        /* journald has already filtered the entries if there is only one
+         * detector */
+        if (!w->single && !abrt_journal_entry_matches(journal, d->matches))
+            continue;
+
+        if (d->catching_up && detector_has_seen(d, journal))
+            continue;
+
+        d->ops->entry(d, journal);
+        ++d->dirty;
+    }
+}
+
+static int watcher_idle(abrt_journal_watch_t *watch, void *data)
+{
+    struct watcher *w = (struct watcher *)data;
+    abrt_journal_t *journal = abrt_journal_watch_get_journal(watch);
+
+    int timeout = -1;
+    for (GList *l = w->detectors; l != NULL; l = l->next)
+    {
+        struct detector *d = (struct detector *)l->data;
+
+        if (d->ops->idle != NULL)
+        {
+            const int t = d->ops->idle(d, /*terminating*/false);
+            if (t >= 0 && (timeout < 0 || t < timeout))
+                timeout = t;
+        }
+
+        detector_save_position(d, journal);
+    }
+
+    return timeout;
+}
+
+/*
+ * Seeks the journal to the oldest position of all detectors. Detectors
+ * without a saved position start following the journal from now.
+ */
+static void watcher_seek(struct watcher *w, abrt_journal_t *journal)
+{
+    const uint64_t now = g_get_real_time();
+    struct detector *oldest = NULL;
+
+    for (GList *l = w->detectors; l != NULL; l = l->next)
+    {
+        struct detector *d = (struct detector *)l->data;
+        d->catching_up = true;
+        d->seen_usec = now;
+
+        g_autofree char *cursor = NULL;
+        if (abrt_journal_load_position(d->state_file, &cursor) < 0)
+            continue;
+
+        uint64_t usec;
+        if (abrt_journal_set_cursor(journal, cursor) < 0
+            || abrt_journal_next(journal) <= 0
+            || abrt_journal_get_realtime_usec(journal, &usec) < 0)
+        {
+            log_notice("Detector '%s' cannot use its saved position", d->ops->name);
+            continue;
+        }
+
+        d->seen_usec = usec;
+        d->seen_cursor = g_steal_pointer(&cursor);
+        if (oldest == NULL || d->seen_usec < oldest->seen_usec)
+            oldest = d;
+    }
+
+    if (oldest == NULL)
+    {
+        if (abrt_journal_seek_tail(journal) < 0)
+            error_msg_and_die(_("Cannot seek to the end of journal"));
+    }
+    else
+    {
+        log_notice("Starting at the position of detector '%s'", oldest->ops->name);
+        if (abrt_journal_set_cursor(journal, oldest->seen_cursor) < 0)
+            error_msg_and_die(_("Failed to set systemd-journal cursor '%s'"), oldest->seen_cursor);
+    }
+}
+
+static void watcher_run(struct watcher *w, abrt_journal_t *journal)
+{
+    abrt_journal_watch_t *watch = NULL;
+    if (abrt_journal_watch_new(&watch, journal, watcher_dispatch_entry, w) < 0)
+        error_msg_and_die(_("Failed to initialize systemd-journal watch"));
+
+    abrt_journal_watch_set_idle_callback(watch, watcher_idle, w);
+    abrt_journal_watch_run_sync(watch);
+
+    for (GList *l = w->detectors; l != NULL; l = l->next)
+    {
+        struct detector *d = (struct detector *)l->data;
+        if (d->ops->idle != NULL)
+            d->ops->idle(d, /*terminating*/true);
+
+        detector_save_position(d, journal);
+    }
+
+    abrt_journal_watch_free(watch);
+}
+
+static bool plugin_conf_exists(const char *name)
+{
+    g_autofree char *path = g_build_filename(PLUGINS_CONF_DIR, name, NULL);
+    const bool exists = access(path, F_OK) == 0;
+    log_debug("Configuration '%s' %s", path, exists ? "exists" : "does not exist");
+    return exists;
+}
+
+int main(int argc, char *argv[])
+{
+    /* I18n */
+    setlocale(LC_ALL, "");
+#if ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+#endif
+
+    abrt_init(argv);
+
+    /* Can't keep these strings/structs static: _() doesn't support that */
+    const char *program_usage_string = _(
+        "& [-vsoxt] [-T INT] [-j FILTER]... [-a]/[-J PATH] [-d DIR]/[-D] [core|koops|xorg]...\n"
+        "\n"
+        "Watch systemd-journal for coredumps, kernel oopses and Xorg crashes\n"
+        "\n"
+        "Reads the journal once for all given detectors (by default core and\n"
+        "those of koops and xorg whose addons are installed).\n"
+        "Every detector saves its last seen position in the state file of the\n"
+        "corresponding abrt-dump-journal-* tool; a detector without a saved\n"
+        "position starts following the journal from now.\n"
+    );
+    enum {
+        OPT_v = 1 << 0,
+        OPT_s = 1 << 1,
+        OPT_o = 1 << 2,
+        OPT_d = 1 << 3,
+        OPT_D = 1 << 4,
+        OPT_x = 1 << 5,
+        OPT_t = 1 << 6,
+        OPT_T = 1 << 7,
+        OPT_j = 1 << 8,
+        OPT_a = 1 << 9,
+        OPT_J = 1 << 10,
+    };
+
+    char *dump_location = NULL;
+    char *journal_dir = NULL;
+    GList *xorg_journal_filters = NULL;
+    int core_throttle = -1;
+
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&libreport_g_verbose),
+        OPT_BOOL(  's', NULL, NULL, _("Log to syslog")),
+        OPT_BOOL(  'o', NULL, NULL, _("Print found problems on standard output")),
+        OPT_STRING('d', NULL, &dump_location, "DIR", _("Create new problem directory in DIR for every problem found")),
+        OPT_BOOL(  'D', NULL, NULL, _("Same as -d DumpLocation, DumpLocation is specified in abrt.conf")),
+        OPT_BOOL(  'x', NULL, NULL, _("Make the oops and Xorg problem directories world readable")),
+        OPT_BOOL(  't', NULL, NULL, _("Throttle oops and Xorg problem directory creation to 1 per second")),
+        OPT_INTEGER('T', NULL, &core_throttle, _("Initial throttle window of repeating crashes of an executable in seconds (0 disables)")),
+        OPT_LIST(  'j', NULL, &xorg_journal_filters, "FILTER", _("Xorg journal filter e.g. '_COMM=gdm-x-session' (may be given many times)")),
+        OPT_BOOL(  'a', NULL, NULL, _("Read journal files from all machines")),
+        OPT_STRING('J', NULL, &journal_dir,  "PATH", _("Read all journal files from directory at PATH")),
+        OPT_END()
+    };
+    unsigned opts = libreport_parse_opts(argc, argv, program_options, program_usage_string);
+
+    libreport_export_abrt_envvars(0);
+
+    libreport_msg_prefix = libreport_g_progname;
+    if ((opts & OPT_s) || getenv("ABRT_SYSLOG"))
+    {
+        libreport_logmode = LOGMODE_JOURNAL;
+    }
+
+    if ((opts & OPT_a) && (opts & OPT_J))
+        libreport_show_usage_and_die(program_usage_string, program_options);
+
+    abrt_load_abrt_conf();
+
+    if (opts & OPT_D)
+    {
+        if (opts & OPT_d)
+            libreport_show_usage_and_die(program_usage_string, program_options);
+        dump_location = abrt_g_settings_dump_location;
+    }
+
+    if (dump_location == NULL && !(opts & OPT_o))
+        libreport_show_usage_and_die(program_usage_string, program_options);
+
+    int oops_utils_flags = 0;
+    int xorg_utils_flags = 0;
+    int core_run_flags = 0;
+    if ((opts & OPT_x))
+    {
+        oops_utils_flags |= ABRT_OOPS_WORLD_READABLE;
+        xorg_utils_flags |= ABRT_XORG_WORLD_READABLE;
+    }
+
+    /* The detectors throttle on their own, ABRT_*_THROTTLE_CREATION would
+     * sleep and block all of them */
+    const bool throttle = (opts & OPT_t);
+
+    if ((opts & OPT_o))
+    {
+        oops_utils_flags |= ABRT_OOPS_PRINT_STDOUT;
+        xorg_utils_flags |= ABRT_XORG_PRINT_STDOUT;
+        core_run_flags |= ABRT_CORE_PRINT_STDOUT;
+    }
+
+    argv += optind;
+    const char *installed_detectors[] = { "core", NULL, NULL, NULL };
+    if (!argv[0])
+    {
+        /* The watcher comes with the core detector, the others need their
+         * addons */
+        const char **next = installed_detectors + 1;
+        if (plugin_conf_exists("oops.conf"))
+            *next++ = "koops";
+        if (plugin_conf_exists(XORG_CONF))
+            *next++ = "xorg";
+    }
+    const char *const *names = argv[0] ? (const char *const *)argv : installed_detectors;
+
+    struct watcher watcher = { 0 };
+    for (; *names; ++names)
+    {
+        struct detector *d = NULL;
+        if (strcmp(*names, "core") == 0)
+            d = core_detector_new(dump_location, core_throttle, core_run_flags);
+        else if (strcmp(*names, "koops") == 0)
+            d = koops_detector_new(dump_location, oops_utils_flags, throttle);
+        else if (strcmp(*names, "xorg") == 0)
+            d = xorg_detector_new(dump_location, xorg_utils_flags, throttle, xorg_journal_filters);
+        else
+            error_msg_and_die(_("Unknown detector '%s'"), *names);
+
+        watcher.detectors = g_list_append(watcher.detectors, d);
+    }
+    watcher.single = g_list_length(watcher.detectors) == 1;
+
+    /* The journal returns entries matching any detector */
+    GList *journal_filter = NULL;
+    for (GList *l = watcher.detectors; l != NULL; l = l->next)
+    {
+        if (journal_filter != NULL)
+            journal_filter = g_list_append(journal_filter, (gpointer)ABRT_JOURNAL_MATCH_OR);
+
+        journal_filter = g_list_concat(journal_filter, g_list_copy(((struct detector *)l->data)->matches));
+    }
+
+    abrt_journal_t *journal = NULL;
+    if ((opts & OPT_J))
+    {
+        log_debug("Using journal files from directory '%s'", journal_dir);
+
+        if (abrt_journal_open_directory(&journal, journal_dir))
+            error_msg_and_die(_("Cannot initialize systemd-journal in directory '%s'"), journal_dir);
+    }
+    else
+    {
+        if (((opts & OPT_a) ? abrt_journal_new_merged : abrt_journal_new)(&journal))
+            error_msg_and_die(_("Cannot open systemd-journal"));
+    }
+
+    if (abrt_journal_set_journal_filter(journal, journal_filter) < 0)
+        error_msg_and_die(_("Cannot filter systemd-journal"));
+
+    g_list_free(journal_filter);
+
+    watcher_seek(&watcher, journal);
+    watcher_run(&watcher, journal);
+
+    g_list_free_full(watcher.detectors, (GDestroyNotify)detector_free);
+    abrt_journal_free(journal);
+    abrt_free_abrt_conf_data();
+
+    return EXIT_SUCCESS;
+}
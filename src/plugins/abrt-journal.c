@@ -32,10 +32,18 @@
 #define ABRT_JOURNAL_WATCH_STATE_FILE_MODE 0600
 #define ABRT_JOURNAL_WATCH_STATE_FILE_MAX_SZ (4 * 1024)
 
+/* Save the position of backfill after this number of committed batches */
+#define ABRT_JOURNAL_BACKFILL_CHECKPOINT_BATCHES 32
+
 struct abrt_journal
 {
     sd_journal *j;
     int fd;
+
+    /* A copy of a single entry (see abrt_journal_dup_entry()) */
+    GHashTable *entry_fields;
+    char *entry_cursor;
+    uint64_t entry_usec;
 };
 
 static int abrt_journal_new_flags(abrt_journal_t **journal, int flags)
@@ -90,7 +98,13 @@ int abrt_journal_open_directory(abrt_journal_t **journal, const char *directory)
 
 void abrt_journal_free(abrt_journal_t *journal)
 {
-    sd_journal_close(journal->j);
+    if (journal->entry_fields != NULL)
+    {
+        g_hash_table_destroy(journal->entry_fields);
+        g_free(journal->entry_cursor);
+    }
+    else
+        sd_journal_close(journal->j);
     journal->j = (void *)0xDEADBEAF;
 
     g_free(journal);
@@ -101,6 +115,18 @@ int abrt_journal_set_journal_filter(abrt_journal_t *journal, GList *journal_filt
     for (GList *l = journal_filter_list; l != NULL; l = l->next)
     {
         const char *filter = l->data;
+        if (strcmp(filter, ABRT_JOURNAL_MATCH_OR) == 0)
+        {
+            const int r = sd_journal_add_disjunction(journal->j);
+            if (r < 0)
+            {
+                log_notice("Failed to add journal filter disjunction: %s", strerror(-r));
+                return r;
+            }
+            log_debug("Using journal match disjunction");
+            continue;
+        }
+
         const int r = sd_journal_add_match(journal->j, filter, strlen(filter));
         if (r < 0)
         {
@@ -113,9 +139,58 @@ int abrt_journal_set_journal_filter(abrt_journal_t *journal, GList *journal_filt
     return 0;
 }
 
+abrt_journal_t *abrt_journal_dup_entry(abrt_journal_t *journal)
+{
+    char *cursor = NULL;
+    uint64_t usec = 0;
+    int r = sd_journal_get_cursor(journal->j, &cursor);
+    if (r >= 0)
+        r = sd_journal_get_realtime_usec(journal->j, &usec);
+
+    if (r < 0)
+    {
+        log_notice("Failed to copy journal entry: %s", strerror(-r));
+        free(cursor);
+        return NULL;
+    }
+
+    abrt_journal_t *entry = g_malloc0(sizeof(*entry));
+    entry->fd = -1;
+    entry->entry_fields = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_bytes_unref);
+    entry->entry_cursor = g_strdup(cursor);
+    entry->entry_usec = usec;
+    free(cursor);
+
+    const void *data;
+    size_t data_len;
+    SD_JOURNAL_FOREACH_DATA(journal->j, data, data_len)
+    {
+        const char *eq = memchr(data, '=', data_len);
+        if (eq == NULL)
+            continue;
+
+        g_hash_table_replace(entry->entry_fields,
+                             g_strndup(data, eq - (const char *)data),
+                             g_bytes_new(data, data_len));
+    }
+
+    return entry;
+}
+
 int abrt_journal_get_field(abrt_journal_t *journal, const char *field, const void **value, size_t *value_len)
 {
-    const int r = sd_journal_get_data(journal->j, field, value, value_len);
+    int r = 0;
+    if (journal->entry_fields != NULL)
+    {
+        GBytes *data = g_hash_table_lookup(journal->entry_fields, field);
+        if (data == NULL)
+            r = -ENOENT;
+        else
+            *value = g_bytes_get_data(data, value_len);
+    }
+    else
+        r = sd_journal_get_data(journal->j, field, value, value_len);
+
     if (r < 0)
     {
         log_notice("Failed to read '%s' field: %s", field, strerror(-r));
@@ -257,6 +332,12 @@ char *abrt_journal_get_next_log_line(void *data)
 
 int abrt_journal_get_cursor(abrt_journal_t *journal, char **cursor)
 {
+    if (journal->entry_fields != NULL)
+    {
+        *cursor = g_strdup(journal->entry_cursor);
+        return 0;
+    }
+
     const int r = sd_journal_get_cursor(journal->j, cursor);
 
     if (r < 0)
@@ -280,6 +361,86 @@ int abrt_journal_set_cursor(abrt_journal_t *journal, const char *cursor)
     return 0;
 }
 
+int abrt_journal_test_cursor(abrt_journal_t *journal, const char *cursor)
+{
+    const int r = sd_journal_test_cursor(journal->j, cursor);
+    if (r < 0)
+        log_notice("Failed to test journal cursor '%s': %s", cursor, strerror(-r));
+
+    return r;
+}
+
+int abrt_journal_get_realtime_usec(abrt_journal_t *journal, uint64_t *usec)
+{
+    if (journal->entry_fields != NULL)
+    {
+        *usec = journal->entry_usec;
+        return 0;
+    }
+
+    const int r = sd_journal_get_realtime_usec(journal->j, usec);
+    if (r < 0)
+        log_notice("Failed to get journal entry time stamp: %s", strerror(-r));
+
+    return r;
+}
+
+/*
+ * The same logic as sd_journal_add_match() uses: the entry must match at least
+ * one value of every field in a group and at least one group must match.
+ */
+bool abrt_journal_entry_matches(abrt_journal_t *journal, GList *journal_filter_list)
+{
+    GList *group = journal_filter_list;
+    while (group != NULL)
+    {
+        bool group_matches = true;
+        GList *l = group;
+        for (; l != NULL && strcmp(l->data, ABRT_JOURNAL_MATCH_OR) != 0; l = l->next)
+        {
+            const char *filter = l->data;
+            const char *eq = strchr(filter, '=');
+            if (eq == NULL || !group_matches)
+                continue;
+
+            g_autofree char *field = g_strndup(filter, eq - filter);
+
+            /* A previous match of this field has already been evaluated */
+            bool seen = false;
+            for (GList *p = group; p != l && !seen; p = p->next)
+                seen = strncmp(p->data, filter, eq - filter + 1) == 0;
+            if (seen)
+                continue;
+
+            const void *value;
+            size_t value_len;
+            bool field_matches = false;
+            if (abrt_journal_get_field(journal, field, &value, &value_len) == 0)
+            {
+                /* Alternative values of the same field */
+                for (GList *a = l; a != NULL && strcmp(a->data, ABRT_JOURNAL_MATCH_OR) != 0 && !field_matches; a = a->next)
+                {
+                    const char *alternative = a->data;
+                    if (strncmp(alternative, filter, eq - filter + 1) != 0)
+                        continue;
+
+                    const char *expected = alternative + (eq - filter) + 1;
+                    field_matches = strlen(expected) == value_len && memcmp(expected, value, value_len) == 0;
+                }
+            }
+
+            group_matches = field_matches;
+        }
+
+        if (group_matches)
+            return true;
+
+        group = l != NULL ? l->next : NULL;
+    }
+
+    return false;
+}
+
 int abrt_journal_seek_tail(abrt_journal_t *journal)
 {
     const int r = sd_journal_seek_tail(journal->j);
@@ -294,6 +455,14 @@ int abrt_journal_seek_tail(abrt_journal_t *journal)
     return 0;
 }
 
+int abrt_journal_seek_realtime_usec(abrt_journal_t *journal, uint64_t usec)
+{
+    const int r = sd_journal_seek_realtime_usec(journal->j, usec);
+    if (r < 0)
+        log_notice("Failed to seek journal to time stamp %llu: %s", (unsigned long long)usec, strerror(-r));
+    return r;
+}
+
 int abrt_journal_next(abrt_journal_t *journal)
 {
     const int r = sd_journal_next(journal->j);
@@ -330,7 +499,66 @@ int abrt_journal_save_current_position(abrt_journal_t *journal, const char *file
     return 0;
 }
 
-int abrt_journal_restore_position(abrt_journal_t *journal, const char *file_name)
+static int abrt_journal_save_position_sync(const char *crsr, const char *file_name)
+{
+    g_autofree char *tmp_name = g_strdup_printf("%s.new", file_name);
+    int state_fd = open(tmp_name,
+            O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW,
+            ABRT_JOURNAL_WATCH_STATE_FILE_MODE);
+
+    if (state_fd < 0)
+    {
+        perror_msg(_("Cannot save journal watch's position: open('%s')"), tmp_name);
+        return -1;
+    }
+
+    if (libreport_full_write_str(state_fd, crsr) < 0 || fsync(state_fd) < 0)
+    {
+        perror_msg(_("Cannot save journal watch's position: write('%s')"), tmp_name);
+        close(state_fd);
+        unlink(tmp_name);
+        return -1;
+    }
+    close(state_fd);
+
+    if (rename(tmp_name, file_name) < 0)
+    {
+        perror_msg(_("Cannot save journal watch's position: rename('%s')"), tmp_name);
+        unlink(tmp_name);
+        return -1;
+    }
+
+    /* The rename is durable only when the directory entry is on the disk */
+    g_autofree char *dir_name = g_path_get_dirname(file_name);
+    int dir_fd = open(dir_name, O_RDONLY | O_DIRECTORY);
+    if (dir_fd < 0 || fsync(dir_fd) < 0)
+    {
+        perror_msg(_("Cannot save journal watch's position: fsync('%s')"), dir_name);
+        if (dir_fd >= 0)
+            close(dir_fd);
+        return -1;
+    }
+    close(dir_fd);
+
+    return 0;
+}
+
+int abrt_journal_save_current_position_sync(abrt_journal_t *journal, const char *file_name)
+{
+    g_autofree char *crsr = NULL;
+    const int r = abrt_journal_get_cursor(journal, &crsr);
+
+    if (r < 0)
+    {
+        /* abrt_journal_set_cursor() prints error message in verbose mode */
+        error_msg(_("Cannot save journal watch's position"));
+        return r;
+    }
+
+    return abrt_journal_save_position_sync(crsr, file_name);
+}
+
+int abrt_journal_load_position(const char *file_name, char **cursor)
 {
     struct stat buf;
     if (lstat(file_name, &buf) < 0)
@@ -377,7 +605,18 @@ int abrt_journal_restore_position(abrt_journal_t *journal, const char *file_name
     crsr[sz] = '\0';
     close(state_fd);
 
-    const int r = abrt_journal_set_cursor(journal, crsr);
+    *cursor = g_steal_pointer(&crsr);
+    return 0;
+}
+
+int abrt_journal_restore_position(abrt_journal_t *journal, const char *file_name)
+{
+    g_autofree char *crsr = NULL;
+    int r = abrt_journal_load_position(file_name, &crsr);
+    if (r < 0)
+        return r;
+
+    r = abrt_journal_set_cursor(journal, crsr);
     if (r < 0)
     {
         /* abrt_journal_set_cursor() prints error message in verbose mode */
@@ -399,6 +638,15 @@ void signal_loop_to_terminate(int signum)
     s_loop_terminated = 1;
 }
 
+int abrt_journal_signaled_sleep(unsigned msec)
+{
+    /* The signal may be delivered to any thread, so poll the flag */
+    for (unsigned slept = 0; !s_loop_terminated && slept < msec; slept += 100)
+        g_usleep(MIN(msec - slept, 100) * 1000);
+
+    return s_loop_terminated;
+}
+
 enum abrt_journal_watch_state
 {
     ABRT_JOURNAL_WATCH_READY,
@@ -412,6 +660,15 @@ struct abrt_journal_watch
 
     abrt_journal_watch_callback callback;
     void *callback_data;
+
+    abrt_journal_watch_idle_callback idle_callback;
+    void *idle_callback_data;
+
+    struct abrt_journal_watch_checkpoint checkpoint;
+    /* Number of entries processed since the last checkpoint */
+    unsigned dirty;
+    /* CLOCK_MONOTONIC of the last checkpoint in milliseconds */
+    gint64 checkpoint_ms;
 };
 
 int abrt_journal_watch_new(abrt_journal_watch_t **watch, abrt_journal_t *journal, abrt_journal_watch_callback callback, void *callback_data)
@@ -429,36 +686,87 @@ int abrt_journal_watch_new(abrt_journal_watch_t **watch, abrt_journal_t *journal
 void abrt_journal_watch_free(abrt_journal_watch_t *watch)
 {
     watch->j = (void *)0xDEADBEAF;
+    g_free((char *)watch->checkpoint.state_file);
     g_free(watch);
 }
 
+void abrt_journal_watch_set_checkpoint(abrt_journal_watch_t *watch, const struct abrt_journal_watch_checkpoint *checkpoint)
+{
+    g_free((char *)watch->checkpoint.state_file);
+
+    watch->checkpoint = *checkpoint;
+    watch->checkpoint.state_file = g_strdup(checkpoint->state_file);
+    watch->checkpoint_ms = g_get_monotonic_time() / 1000;
+}
+
+void abrt_journal_watch_set_idle_callback(abrt_journal_watch_t *watch, abrt_journal_watch_idle_callback callback, void *callback_data)
+{
+    watch->idle_callback = callback;
+    watch->idle_callback_data = callback_data;
+}
+
+static void abrt_journal_watch_save_checkpoint(abrt_journal_watch_t *watch)
+{
+    if (watch->dirty == 0)
+        return;
+
+    log_debug("Saving journal position after %u entries", watch->dirty);
+
+    if (watch->checkpoint.flags & ABRT_JOURNAL_CHECKPOINT_SYNC)
+        abrt_journal_save_current_position_sync(watch->j, watch->checkpoint.state_file);
+    else
+        abrt_journal_save_current_position(watch->j, watch->checkpoint.state_file);
+
+    /* Do not retry on errors, the next checkpoint will try again */
+    watch->dirty = 0;
+    watch->checkpoint_ms = g_get_monotonic_time() / 1000;
+}
+
+/* Returns milliseconds remaining to the next timed checkpoint or -1 if there
+ * is nothing to wait for */
+static gint64 abrt_journal_watch_checkpoint_timeout(abrt_journal_watch_t *watch)
+{
+    if (watch->dirty == 0 || watch->checkpoint.interval_ms == 0)
+        return -1;
+
+    const gint64 elapsed = g_get_monotonic_time() / 1000 - watch->checkpoint_ms;
+    return MAX(0, (gint64)watch->checkpoint.interval_ms - elapsed);
+}
+
 abrt_journal_t *abrt_journal_watch_get_journal(abrt_journal_watch_t *watch)
 {
     return watch->j;
 }
 
-int abrt_journal_watch_run_sync(abrt_journal_watch_t *watch)
+/* Fills mask with all signals but the ones which terminate the loop */
+static void abrt_journal_catch_termination_signals(sigset_t *mask)
 {
-    sigset_t mask;
-    sigfillset(&mask);
+    sigfillset(mask);
 
     /* Exit gracefully: */
     /* services usually exit on SIGTERM and SIGHUP */
-    sigdelset(&mask, SIGTERM);
+    sigdelset(mask, SIGTERM);
     signal(SIGTERM, signal_loop_to_terminate);
-    sigdelset(&mask, SIGHUP);
+    sigdelset(mask, SIGHUP);
     signal(SIGHUP, signal_loop_to_terminate);
     /* Ctrl-C for easier debugging */
-    sigdelset(&mask, SIGINT);
+    sigdelset(mask, SIGINT);
     signal(SIGINT, signal_loop_to_terminate);
 
     /* Die on kill $PID */
-    sigdelset(&mask, SIGKILL);
+    sigdelset(mask, SIGKILL);
+}
+
+int abrt_journal_watch_run_sync(abrt_journal_watch_t *watch)
+{
+    sigset_t mask;
+    abrt_journal_catch_termination_signals(&mask);
 
     struct pollfd pollfd;
     pollfd.fd = watch->j->fd;
     pollfd.events = sd_journal_get_events(watch->j->j);
 
+    const bool checkpoints = watch->checkpoint.state_file != NULL;
     int r = 0;
 
     while (!s_loop_terminated && watch->state == ABRT_JOURNAL_WATCH_READY)
@@ -471,7 +779,37 @@ int abrt_journal_watch_run_sync(abrt_journal_watch_t *watch)
         }
         else if (r == 0)
         {
-            ppoll(&pollfd, 1, NULL, &mask);
+            /* The batch is drained */
+            if (checkpoints && watch->checkpoint.interval_ms == 0)
+                abrt_journal_watch_save_checkpoint(watch);
+
+            gint64 timeout_ms = checkpoints ? abrt_journal_watch_checkpoint_timeout(watch) : -1;
+            if (watch->idle_callback != NULL)
+            {
+                const int idle_ms = watch->idle_callback(watch, watch->idle_callback_data);
+                if (idle_ms >= 0 && (timeout_ms < 0 || idle_ms < timeout_ms))
+                    timeout_ms = idle_ms;
+
+                /* The call back may have stopped the watch */
+                if (watch->state != ABRT_JOURNAL_WATCH_READY)
+                    break;
+            }
+
+            struct timespec timeout;
+            if (timeout_ms >= 0)
+            {
+                timeout.tv_sec = timeout_ms / 1000;
+                timeout.tv_nsec = (timeout_ms % 1000) * 1000000;
+            }
+
+            if (ppoll(&pollfd, 1, timeout_ms >= 0 ? &timeout : NULL, &mask) == 0)
+            {
+                /* Timed out, nothing new in journal */
+                if (checkpoints)
+                    abrt_journal_watch_save_checkpoint(watch);
+                continue;
+            }
+
             r = sd_journal_process(watch->j->j);
             if (r < 0)
             {
@@ -482,8 +820,19 @@ int abrt_journal_watch_run_sync(abrt_journal_watch_t *watch)
         }
 
         watch->callback(watch, watch->callback_data);
+
+        if (!checkpoints)
+            continue;
+
+        ++watch->dirty;
+        if ((watch->checkpoint.max_entries != 0 && watch->dirty >= watch->checkpoint.max_entries)
+            || abrt_journal_watch_checkpoint_timeout(watch) == 0)
+            abrt_journal_watch_save_checkpoint(watch);
     }
 
+    if (checkpoints)
+        abrt_journal_watch_save_checkpoint(watch);
+
     return r;
 }
 
@@ -496,30 +845,320 @@ void abrt_journal_watch_stop(abrt_journal_watch_t *watch)
  * ABRT systemd-journal watch - end
  */
 
-void abrt_journal_watch_notify_strings(abrt_journal_watch_t *watch, void *data)
+/*
+ * ABRT systemd-journal backfill
+ */
+struct abrt_journal_backfill_batch
 {
-    struct abrt_journal_watch_notify_strings *conf = (struct abrt_journal_watch_notify_strings *)data;
+    GPtrArray *entries;
+    /* The value returned by the call back for the commit call back */
+    void *result;
+    bool done;
+};
+
+struct abrt_journal_backfill_state
+{
+    const struct abrt_journal_backfill *conf;
+
+    GMutex lock;
+    /* Signalled when a batch is queued, taken or processed */
+    GCond cond;
+    /* Batches waiting for a worker */
+    GQueue queue;
+    /* Queued and running batches in the journal order */
+    GQueue inflight;
+    /* The reader has read the whole range */
+    bool finished;
+    /* A thread is calling the commit call back */
+    bool committing;
+
+    /* Cursor of the last entry of the last committed batch */
+    char *commit_cursor;
+    /* Number of batches committed since the last checkpoint */
+    unsigned uncommitted;
+    unsigned long committed;
+};
+
+static void abrt_journal_backfill_batch_free(struct abrt_journal_backfill_batch *batch)
+{
+    g_ptr_array_free(batch->entries, TRUE);
+    g_free(batch);
+}
+
+static void abrt_journal_backfill_drop_batch(struct abrt_journal_backfill_batch *batch,
+                                             const struct abrt_journal_backfill *conf)
+{
+    if (batch->result != NULL && conf->result_free != NULL)
+        conf->result_free(batch->result);
+
+    abrt_journal_backfill_batch_free(batch);
+}
+
+static void abrt_journal_backfill_save_checkpoint(struct abrt_journal_backfill_state *state)
+{
+    if (state->uncommitted == 0 || state->conf->state_file == NULL)
+        return;
+
+    log_debug("Saving journal position after %u backfill batches", state->uncommitted);
+
+    abrt_journal_save_position_sync(state->commit_cursor, state->conf->state_file);
+
+    /* Do not retry on errors, the next checkpoint will try again */
+    state->uncommitted = 0;
+}
+
+/*
+ * Moves the commit position over the processed batches at the head of the
+ * inflight queue; a batch which is still running holds back all batches
+ * behind it, so the saved position never skips an unprocessed entry.
+ *
+ * Only one thread commits at a time and it calls the commit call back without
+ * the lock, so the other workers keep processing batches meanwhile; the
+ * batches they finish are committed by the committing thread.
+ *
+ * Must be called with the lock held.
+ */
+static void abrt_journal_backfill_commit(struct abrt_journal_backfill_state *state)
+{
+    if (state->committing)
+        return;
+
+    struct abrt_journal_backfill_batch *batch;
+    while ((batch = g_queue_peek_head(&state->inflight)) != NULL && batch->done)
+    {
+        g_queue_pop_head(&state->inflight);
+
+        if (state->conf->commit != NULL)
+        {
+            state->committing = true;
+            g_mutex_unlock(&state->lock);
+
+            state->conf->commit(batch->result, state->conf->callback_data);
+
+            g_mutex_lock(&state->lock);
+            state->committing = false;
+        }
+
+        abrt_journal_t *last = g_ptr_array_index(batch->entries, batch->entries->len - 1);
+        g_free(state->commit_cursor);
+        state->commit_cursor = g_strdup(last->entry_cursor);
+
+        ++state->uncommitted;
+        ++state->committed;
+        abrt_journal_backfill_drop_batch(batch, state->conf);
+    }
 
-    char message[JOURNALD_MAX_FIELD_SIZE + 1] = "\0";
+    if (state->uncommitted >= ABRT_JOURNAL_BACKFILL_CHECKPOINT_BATCHES
+        || (state->uncommitted > 0 && g_queue_is_empty(&state->inflight)))
+        abrt_journal_backfill_save_checkpoint(state);
+}
+
+static gpointer abrt_journal_backfill_worker(gpointer user_data)
+{
+    struct abrt_journal_backfill_state *state = user_data;
 
-    if (abrt_journal_get_string_field(abrt_journal_watch_get_journal(watch), "MESSAGE", (char *)message) == NULL)
+    g_mutex_lock(&state->lock);
+    for (;;)
+    {
+        while (g_queue_is_empty(&state->queue) && !state->finished)
+            g_cond_wait(&state->cond, &state->lock);
+
+        struct abrt_journal_backfill_batch *batch = g_queue_pop_head(&state->queue);
+        if (batch == NULL)
+            break;
+
+        /* There is a free slot in the queue for the reader */
+        g_cond_broadcast(&state->cond);
+        g_mutex_unlock(&state->lock);
+
+        /* After a termination signal, the workers only drain the queue and
+         * the not processed batches stay uncommitted */
+        const bool process = !s_loop_terminated;
+        if (process)
+            batch->result = state->conf->callback(batch->entries, state->conf->callback_data);
+
+        g_mutex_lock(&state->lock);
+        batch->done = process;
+        abrt_journal_backfill_commit(state);
+    }
+    g_mutex_unlock(&state->lock);
+
+    return NULL;
+}
+
+static void abrt_journal_backfill_dispatch(struct abrt_journal_backfill_state *state, GPtrArray *entries)
+{
+    struct abrt_journal_backfill_batch *batch = g_new0(struct abrt_journal_backfill_batch, 1);
+    batch->entries = entries;
+
+    g_mutex_lock(&state->lock);
+    while (g_queue_get_length(&state->queue) >= MAX(state->conf->queue_size, 1))
+        g_cond_wait(&state->cond, &state->lock);
+
+    g_queue_push_tail(&state->queue, batch);
+    g_queue_push_tail(&state->inflight, batch);
+    g_cond_broadcast(&state->cond);
+    g_mutex_unlock(&state->lock);
+}
+
+int abrt_journal_backfill_run(abrt_journal_t *journal, const struct abrt_journal_backfill *conf)
+{
+    assert(conf->callback != NULL || !"ABRT backfill needs valid callback ptr");
+
+    sigset_t mask;
+    abrt_journal_catch_termination_signals(&mask);
+
+    struct abrt_journal_backfill_state state = { 0 };
+    state.conf = conf;
+    g_mutex_init(&state.lock);
+    g_cond_init(&state.cond);
+    g_queue_init(&state.queue);
+    g_queue_init(&state.inflight);
+
+    const unsigned workers = MAX(conf->workers, 1);
+    GThread **threads = g_new(GThread *, workers);
+    for (unsigned i = 0; i < workers; ++i)
+        threads[i] = g_thread_new("abrt-backfill", abrt_journal_backfill_worker, &state);
+
+    log_notice("Backfilling journal with %u workers", workers);
+
+    GPtrArray *batch = NULL;
+    abrt_journal_t *previous = NULL;
+    unsigned long entries = 0;
+    bool sought = conf->since_usec == 0;
+    int r = 0;
+    while (!s_loop_terminated)
+    {
+        r = sd_journal_next(journal->j);
+        if (r < 0)
+        {
+            log_warning("Failed to iterate to next entry: %s", strerror(-r));
+            break;
+        }
+        else if (r == 0)
+            /* The end of journal */
+            break;
+
+        uint64_t usec = 0;
+        r = sd_journal_get_realtime_usec(journal->j, &usec);
+        if (r < 0)
+        {
+            log_warning("Failed to get journal entry time stamp: %s", strerror(-r));
+            break;
+        }
+
+        if (usec < conf->since_usec)
+        {
+            if (sought)
+                continue;
+
+            /* Skip the old entries at once */
+            log_notice("Skipping journal entries older than %llu", (unsigned long long)conf->since_usec);
+            sought = true;
+            r = sd_journal_seek_realtime_usec(journal->j, conf->since_usec);
+            if (r < 0)
+            {
+                log_warning("Failed to seek journal to time stamp: %s", strerror(-r));
+                break;
+            }
+            continue;
+        }
+        sought = true;
+
+        if (conf->until_usec != 0 && usec > conf->until_usec)
+        {
+            /* Leave the journal at the last backfilled entry, so the following
+             * abrt_journal_next() returns the first entry out of the range */
+            sd_journal_previous(journal->j);
+            break;
+        }
+
+        abrt_journal_t *entry = abrt_journal_dup_entry(journal);
+        if (entry == NULL)
+            continue;
+
+        if (batch != NULL
+            && (conf->split == NULL || conf->split(previous, entry, batch->len, conf->callback_data)))
+        {
+            abrt_journal_backfill_dispatch(&state, batch);
+            batch = NULL;
+        }
+
+        if (batch == NULL)
+            batch = g_ptr_array_new_with_free_func((GDestroyNotify)abrt_journal_free);
+
+        g_ptr_array_add(batch, entry);
+        previous = entry;
+        ++entries;
+    }
+
+    if (batch != NULL)
+        abrt_journal_backfill_dispatch(&state, batch);
+
+    g_mutex_lock(&state.lock);
+    state.finished = true;
+    g_cond_broadcast(&state.cond);
+    g_mutex_unlock(&state.lock);
+
+    for (unsigned i = 0; i < workers; ++i)
+        g_thread_join(threads[i]);
+    g_free(threads);
+
+    log_notice("Backfilled %lu journal entries in %lu batches", entries, state.committed);
+
+    abrt_journal_backfill_save_checkpoint(&state);
+
+    /* The batches not processed (or not committed because an earlier batch
+     * was not processed) due to a termination signal */
+    struct abrt_journal_backfill_batch *unprocessed;
+    while ((unprocessed = g_queue_pop_head(&state.inflight)) != NULL)
+        abrt_journal_backfill_drop_batch(unprocessed, conf);
+    g_free(state.commit_cursor);
+    g_cond_clear(&state.cond);
+    g_mutex_clear(&state.lock);
+
+    if (r < 0)
+        return r;
+
+    return s_loop_terminated ? 1 : 0;
+}
+
+/*
+ * ABRT systemd-journal backfill - end
+ */
+
+bool abrt_journal_message_contains(abrt_journal_t *journal, GList *strings, GList *blacklisted_strings)
+{
+    /* Search the field data in place, journal data are not NULL terminated
+     * and copying them to a JOURNALD_MAX_FIELD_SIZE buffer for every entry is
+     * a waste of time. */
+    const char *message;
+    size_t message_len;
+    if (abrt_journal_get_field(journal, "MESSAGE", (const void **)&message, &message_len) < 0)
     {
         error_msg("Cannot read journal data, skipping.");
-        return;
+        return false;
     }
 
-    GList *cur = conf->strings;
+    GList *cur = strings;
     for (; cur; cur = g_list_next(cur))
-        if (strstr(message, cur->data) != NULL)
+        if (memmem(message, message_len, cur->data, strlen(cur->data)) != NULL)
             break;
 
-    GList *blacklist_cur = conf->blacklisted_strings;
+    GList *blacklist_cur = blacklisted_strings;
     if (cur)
         for (; blacklist_cur; blacklist_cur = g_list_next(blacklist_cur))
-            if (strstr(message, blacklist_cur->data) != NULL)
+            if (memmem(message, message_len, blacklist_cur->data, strlen(blacklist_cur->data)) != NULL)
                 break;
 
-    if (cur && !blacklist_cur)
+    return cur && !blacklist_cur;
+}
+
+void abrt_journal_watch_notify_strings(abrt_journal_watch_t *watch, void *data)
+{
+    struct abrt_journal_watch_notify_strings *conf = (struct abrt_journal_watch_notify_strings *)data;
+
+    if (abrt_journal_message_contains(abrt_journal_watch_get_journal(watch), conf->strings, conf->blacklisted_strings))
         conf->decorated_cb(watch, conf->decorated_cb_data);
 }
 
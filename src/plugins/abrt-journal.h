@@ -17,6 +17,7 @@
 
 #include <glib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,9 +46,27 @@ int abrt_journal_open_directory(abrt_journal_t **journal, const char *directory)
 
 void abrt_journal_free(abrt_journal_t *journal);
 
+/*
+ * Installs journal matches "FIELD=value" so that systemd-journal returns only
+ * the matching entries. Matches of different fields must all match, matches
+ * of the same field are alternatives (see sd_journal_add_match(3)).
+ *
+ * The ABRT_JOURNAL_MATCH_OR item separates groups of matches of which at least
+ * one group must match, the same way as '+' works for journalctl.
+ */
+#define ABRT_JOURNAL_MATCH_OR "+"
+
 int abrt_journal_set_journal_filter(abrt_journal_t *journal,
                                     GList *journal_filter_list);
 
+/*
+ * Copies all fields, the cursor and the time stamp of the current entry to
+ * a new object which can be passed to the field getters, get_cursor() and
+ * get_realtime_usec() from another thread. The copy cannot be iterated nor
+ * watched. Free it with abrt_journal_free().
+ */
+abrt_journal_t *abrt_journal_dup_entry(abrt_journal_t *journal);
+
 int abrt_journal_get_field(abrt_journal_t *journal,
                            const char *field,
                            const void **value,
@@ -76,16 +95,45 @@ int abrt_journal_get_cursor(abrt_journal_t *journal, char **cursor);
 
 int abrt_journal_set_cursor(abrt_journal_t *journal, const char *cursor);
 
+/* Returns a positive number if the current entry is at the cursor */
+int abrt_journal_test_cursor(abrt_journal_t *journal, const char *cursor);
+
+int abrt_journal_get_realtime_usec(abrt_journal_t *journal, uint64_t *usec);
+
+/* Evaluates matches in the format of abrt_journal_set_journal_filter() on the
+ * current entry. Useful when several consumers share a single journal with
+ * a union of their matches. */
+bool abrt_journal_entry_matches(abrt_journal_t *journal, GList *journal_filter_list);
+
+/* Returns true if MESSAGE of the current entry contains a string from strings
+ * and none from blacklisted_strings */
+bool abrt_journal_message_contains(abrt_journal_t *journal,
+                                   GList *strings,
+                                   GList *blacklisted_strings);
+
 int abrt_journal_seek_tail(abrt_journal_t *journal);
 
+/* The next call of abrt_journal_next() moves to the first entry logged at USEC
+ * or later */
+int abrt_journal_seek_realtime_usec(abrt_journal_t *journal, uint64_t usec);
+
 int abrt_journal_next(abrt_journal_t *journal);
 
 int abrt_journal_save_current_position(abrt_journal_t *journal,
                                        const char *file_name);
 
+/* Writes the position to a temporary file, fsync()s it and renames it to
+ * file_name, so file_name holds either the old or the new position even after
+ * power loss. */
+int abrt_journal_save_current_position_sync(abrt_journal_t *journal,
+                                            const char *file_name);
+
 int abrt_journal_restore_position(abrt_journal_t *journal,
                                   const char *file_name);
 
+/* Reads a cursor saved by abrt_journal_save_current_position() */
+int abrt_journal_load_position(const char *file_name, char **cursor);
+
 /*
  * A systemd-journal listener which waits for new messages a loop and notifies
  * them via a call back
@@ -103,6 +151,52 @@ int abrt_journal_watch_new(abrt_journal_watch_t **watch,
 
 void abrt_journal_watch_free(abrt_journal_watch_t *watch);
 
+/*
+ * Entries available at the time the watch wakes up are processed as a single
+ * batch. Without a checkpoint the watch does not save its position at all and
+ * the call back is responsible for it.
+ *
+ * With a checkpoint, the watch saves the cursor of the last processed entry to
+ * state_file:
+ *   - after every max_entries entries (0 means no limit),
+ *   - at the end of every batch if interval_ms is 0; otherwise at most once
+ *     per interval_ms (also when the watch is idle),
+ *   - when the loop terminates.
+ *
+ * The saved cursor never points behind an entry which has not been processed
+ * yet, so no entry is lost, but a few entries may be processed again after
+ * restart (at-least-once semantics).
+ */
+enum abrt_journal_checkpoint_flags
+{
+    /* Write the state file atomically and fsync() it. */
+    ABRT_JOURNAL_CHECKPOINT_SYNC = 1 << 0,
+};
+
+struct abrt_journal_watch_checkpoint
+{
+    const char *state_file;
+    unsigned max_entries;
+    unsigned interval_ms;
+    int flags;
+};
+
+void abrt_journal_watch_set_checkpoint(abrt_journal_watch_t *watch,
+                                       const struct abrt_journal_watch_checkpoint *checkpoint);
+
+/*
+ * Called every time the watch has processed all available entries and is
+ * about to wait for new ones. Returns the number of milliseconds after which
+ * the watch shall call it again even if no new entry comes, or -1 to wait for
+ * new entries only.
+ */
+typedef int (* abrt_journal_watch_idle_callback)(struct abrt_journal_watch *watch,
+                                                  void *data);
+
+void abrt_journal_watch_set_idle_callback(abrt_journal_watch_t *watch,
+                                          abrt_journal_watch_idle_callback callback,
+                                          void *callback_data);
+
 /*
  * Returns the watched journal.
  */
@@ -121,6 +215,71 @@ int abrt_journal_watch_run_sync(abrt_journal_watch_t *watch);
 void abrt_journal_watch_stop(abrt_journal_watch_t *watch);
 
 
+/*
+ * Processes the entries following the current position in parallel; useful
+ * to catch up with the entries logged while the watch was not running.
+ *
+ * The calling thread reads the journal up to its end (or until_usec) and
+ * groups copies of the entries (see abrt_journal_dup_entry()) to batches:
+ * a new batch starts when split returns true for the entry (NULL split makes
+ * a batch of every entry). At most queue_size batches wait for one of
+ * workers threads calling callback.
+ *
+ * Batches are committed in the journal order, so the cursor saved to
+ * state_file never skips an entry which has not been processed yet, even if
+ * a later batch finished earlier.
+ *
+ * The value returned by callback is passed to the optional commit call back,
+ * which is called in the journal order by one thread at a time right before
+ * the batch is committed. Work which must be serialized (e.g. throttling)
+ * belongs there, so it does not hold back the workers. The value is freed
+ * with result_free afterwards.
+ *
+ * Entries older than since_usec are skipped. When the function returns, the
+ * journal is at the last backfilled entry, so abrt_journal_watch_run_sync()
+ * can continue with the following ones.
+ *
+ * SIGTERM and SIGINT terminates the backfill gracefully; the function returns
+ * 1 then and the cursor saved to state_file is the only valid position, the
+ * journal position is not (the entries behind the cursor may have been read
+ * but not processed). Returns 0 if the whole range was processed.
+ */
+typedef void *(* abrt_journal_backfill_callback)(GPtrArray *entries,
+                                                 void *data);
+
+typedef void (* abrt_journal_backfill_commit_callback)(void *result,
+                                                       void *data);
+
+typedef bool (* abrt_journal_backfill_split)(abrt_journal_t *previous,
+                                             abrt_journal_t *entry,
+                                             unsigned batch_entries,
+                                             void *data);
+
+struct abrt_journal_backfill
+{
+    const char *state_file;
+    unsigned workers;
+    unsigned queue_size;
+    uint64_t since_usec;
+    uint64_t until_usec;
+
+    abrt_journal_backfill_callback callback;
+    abrt_journal_backfill_commit_callback commit;
+    GDestroyNotify result_free;
+    abrt_journal_backfill_split split;
+    void *callback_data;
+};
+
+/*
+ * Sleeps for msec milliseconds or until SIGTERM, SIGHUP or SIGINT is caught
+ * by abrt_journal_backfill_run() or abrt_journal_watch_run_sync(); returns
+ * non-zero in the latter case. Usable from any thread.
+ */
+int abrt_journal_signaled_sleep(unsigned msec);
+
+int abrt_journal_backfill_run(abrt_journal_t *journal,
+                              const struct abrt_journal_backfill *conf);
+
 /*
  * A decorator for abrt_journal_watch call backs which calls the decorated call
  * back in case where journal message contains a string from the interested
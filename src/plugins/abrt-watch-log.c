@@ -17,51 +17,175 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 #include <sys/inotify.h>
+#include <poll.h>
 #include <spawn.h>
 #include "libabrt.h"
+#include "log-scanner.h"
+#include "oops-utils.h"
+#include "xorg-utils.h"
 
 #define MAX_SCAN_BLOCK  (4*1024*1024)
 #define READ_AHEAD          (10*1024)
+/* Bytes after a found string passed to the scanner, an oops or a backtrace
+ * is far shorter */
+#define MATCH_CONTEXT       (64*1024)
+
+#define ABRT_WATCH_LOG_OOPS_ANALYZER "abrt-oops"
 
 extern char **environ;
-static unsigned page_size;
 
-static bool memstr(void *buf, unsigned size, const char *str)
+/*
+ * In-process scanners (-w SCANNER:FILE)
+ */
+struct scanner_conf
+{
+    const char *dump_location;
+    bool world_readable;
+    bool throttle;
+    bool print_stdout;
+};
+
+struct log_scanner
+{
+    const char *name;
+    /* Returns the list of strings which must be found before scan is called */
+    GList *(*strings)(void);
+    /* Extracts problems from the new data of a log */
+    void (*scan)(const char *data, size_t size, const struct scanner_conf *conf);
+};
+
+static GList *oops_scanner_strings(void)
+{
+    return abrt_oops_suspicious_strings_list_filtered();
+}
+
+static void oops_scanner_scan(const char *data, size_t size, const struct scanner_conf *conf)
+{
+    /* abrt_koops_extract_oopses() modifies the buffer */
+    g_autofree char *buffer = g_strndup(data, size);
+
+    GList *oops_list = NULL;
+    abrt_koops_extract_oopses(&oops_list, buffer, size);
+
+    int flags = 0;
+    if (conf->world_readable)
+        flags |= ABRT_OOPS_WORLD_READABLE;
+    if (conf->throttle)
+        flags |= ABRT_OOPS_THROTTLE_CREATION;
+    if (conf->print_stdout)
+        flags |= ABRT_OOPS_PRINT_STDOUT;
+
+    abrt_oops_process_list(oops_list, conf->dump_location, ABRT_WATCH_LOG_OOPS_ANALYZER, flags);
+    g_list_free_full(oops_list, free);
+}
+
+static GList *xorg_scanner_strings(void)
+{
+    return g_list_append(NULL, (gpointer)XORG_SEARCH_STRING);
+}
+
+struct buffer_lines
+{
+    const char *pos;
+    const char *end;
+};
+
+/* Same as xorg_get_next_line_from_fd() but for a buffer */
+static char *buffer_get_next_line(void *data)
+{
+    struct buffer_lines *lines = data;
+    if (lines->pos >= lines->end)
+        return NULL;
+
+    const char *eol = memchr(lines->pos, '\n', lines->end - lines->pos);
+    if (eol == NULL)
+        eol = lines->end;
+
+    char *line = g_strndup(lines->pos, eol - lines->pos);
+    lines->pos = eol < lines->end ? eol + 1 : eol;
+    return line;
+}
+
+static void xorg_scanner_scan(const char *data, size_t size, const struct scanner_conf *conf)
 {
-    int len = strlen(str);
-    while ((int)size >= len)
+    struct buffer_lines lines = { .pos = data, .end = data + size };
+
+    GList *crashes = NULL;
+    unsigned bt_count = 0;
+    char *line;
+    while ((line = buffer_get_next_line(&lines)) != NULL)
+    {
+        char *p = skip_pfx(line);
+        if (strcmp(p, XORG_SEARCH_STRING) == 0)
+        {
+            struct xorg_crash_info *crash_info = process_xorg_bt(buffer_get_next_line, &lines);
+            if (crash_info == NULL)
+                log_warning(_("Failed to parse Backtrace from log file"));
+            else if (bt_count++ < ABRT_OOPS_MAX_DUMPED_COUNT)
+                crashes = g_list_append(crashes, crash_info);
+            else
+                xorg_crash_info_free(crash_info);
+        }
+        free(line);
+    }
+
+    if (conf->dump_location != NULL)
     {
-        //log_warning("LOOKING FOR:'%s'", str);
-        char *first = memchr(buf, (unsigned char)str[0], size - len + 1);
-        if (!first)
-            break;
-        //log_warning("FOUND:'%.66s'", first);
-        first++;
-        if (len <= 1 || strncmp(first, str + 1, len - 1) == 0)
-            return true;
-        size -= (first - (char*)buf);
-        //log_warning("SKIP TO:'%.66s' %d chars", first, (int)(first - (char*)buf));
-        buf = first;
+        int flags = 0;
+        if (conf->world_readable)
+            flags |= ABRT_XORG_WORLD_READABLE;
+        if (conf->throttle)
+            flags |= ABRT_XORG_THROTTLE_CREATION;
+        if (conf->print_stdout)
+            flags |= ABRT_XORG_PRINT_STDOUT;
+
+        abrt_xorg_process_list_of_crashes(crashes, conf->dump_location, flags);
     }
-    return false;
+    else
+        g_list_foreach(crashes, (GFunc)xorg_crash_info_print_crash, NULL);
+
+    g_list_free_full(crashes, (GDestroyNotify)xorg_crash_info_free);
 }
 
-static void run_scanner_prog(int fd, struct stat *statbuf, GList *match_list, char **prog)
+static const struct log_scanner s_scanners[] = {
+    { "oops", oops_scanner_strings, oops_scanner_scan },
+    { "xorg", xorg_scanner_strings, xorg_scanner_scan },
+};
+
+static const struct log_scanner *find_scanner(const char *name, size_t len)
 {
-    pid_t pid;
-    int err;
-    int attr_set = 0, fd_actions_set = 0;
-    posix_spawnattr_t attr;
-    posix_spawn_file_actions_t fd_actions;
+    for (unsigned i = 0; i < ARRAY_SIZE(s_scanners); ++i)
+        if (strlen(s_scanners[i].name) == len && strncmp(s_scanners[i].name, name, len) == 0)
+            return &s_scanners[i];
+
+    return NULL;
+}
+
+struct scanner_region
+{
+    const struct log_scanner *scanner;
+    const struct scanner_conf *conf;
+};
 
+static void scan_region(const char *data, size_t size, void *user_data)
+{
+    const struct scanner_region *region = user_data;
+    region->scanner->scan(data, size, region->conf);
+}
+
+/*
+ * Calls the scanner on the regions of the file's growth which contain one of
+ * the scanner's strings and moves the file position to the end of the file.
+ */
+static void run_scanner_in_process(int fd, struct stat *statbuf, const abrt_string_matcher_t *matcher,
+                                   const struct log_scanner *scanner, const struct scanner_conf *conf)
+{
     /* fstat(fd, &statbuf) was just done by caller */
 
     off_t cur_pos = lseek(fd, 0, SEEK_CUR);
     if (statbuf->st_size <= cur_pos)
     {
-        /* If file was truncated, treat it as a new file.
-         * (changing inode# causes caller to think that file was closed or renamed)
-         */
+        /* If file was truncated, treat it as a new file. */
         if (statbuf->st_size < cur_pos)
             statbuf->st_ino++;
         return; /* we are at EOF, nothing to do */
@@ -72,50 +196,49 @@ static void run_scanner_prog(int fd, struct stat *statbuf, GList *match_list, ch
         (long long)(cur_pos),
         (long long)(statbuf->st_size));
 
-    if (match_list && (statbuf->st_size - cur_pos) < MAX_SCAN_BLOCK)
-    {
-        size_t length = statbuf->st_size - cur_pos;
+    struct scanner_region region = { .scanner = scanner, .conf = conf };
+    const struct abrt_log_scan scan = {
+        .matcher = matcher,
+        .context_before = READ_AHEAD,
+        .context_after = MATCH_CONTEXT,
+        .window = MAX_SCAN_BLOCK,
+        .region = scan_region,
+        .user_data = &region,
+    };
+    if (abrt_log_scan_file(&scan, fd, cur_pos, statbuf->st_size) == 0)
+        log_debug("NOT FOUND");
 
-        off_t mapofs = cur_pos & ~(off_t)(page_size - 1);
-        size_t maplen = statbuf->st_size - mapofs;
-        void *map = mmap(NULL, maplen, PROT_READ, MAP_SHARED, fd, mapofs);
+    if (lseek(fd, statbuf->st_size, SEEK_SET) < 0)
+        perror_msg_and_die("Could not seek to position in log file");
+}
 
-        if (map != MAP_FAILED)
-        {
-            char *start = (char*)map + (cur_pos & (page_size - 1));
-            for (GList *l = match_list; l; l = l->next)
-            {
-                log_debug("Searching for '%s' in '%.*s'",
-                                (char*)l->data,
-                                length > 20 ? 20 : (int)length, start
-                );
-                if (memstr(start, length, (char*)l->data))
-                {
-                    log_debug("FOUND:'%s'", (char*)l->data);
-                    goto found;
-                }
-            }
-            /* None of the strings are found */
-            log_debug("NOT FOUND");
-            munmap(map, maplen);
-            if (lseek(fd, statbuf->st_size, SEEK_SET) < 0)
-                perror_msg_and_die("Could not seek to position in log file");
-            return;
- found: ;
-            munmap(map, maplen);
-        }
-    }
+/* Runs PROG with stdin_fd as its standard input */
+static pid_t spawn_prog(char **prog, int stdin_fd)
+{
+    pid_t pid;
+    int err;
+    int attr_set = 0, fd_actions_set = 0;
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_t fd_actions;
+    sigset_t sigdefault;
+
+    /* SIGPIPE is ignored by us, but not by PROG */
+    sigemptyset(&sigdefault);
+    sigaddset(&sigdefault, SIGPIPE);
 
     fflush(NULL); /* paranoia */
 
     if ((err = posix_spawn_file_actions_init(&fd_actions)) != 0
-#ifdef POSIX_SPAWN_USEVFORK
-         || (err = posix_spawnattr_init(&attr)) != 0
+         || (fd_actions_set = 1,
+             err = posix_spawnattr_init(&attr)) != 0
          || (attr_set = 1,
-             err = posix_spawnattr_setflags(&attr, POSIX_SPAWN_USEVFORK)) != 0
+             err = posix_spawnattr_setsigdefault(&attr, &sigdefault)) != 0
+         || (err = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF
+#ifdef POSIX_SPAWN_USEVFORK
+                                                   | POSIX_SPAWN_USEVFORK
 #endif
-         || (fd_actions_set = 1,
-             err = posix_spawn_file_actions_adddup2(&fd_actions, fd, STDIN_FILENO)) != 0)
+                                                   )) != 0
+         || (err = posix_spawn_file_actions_adddup2(&fd_actions, stdin_fd, STDIN_FILENO)) != 0)
     {
         if (attr_set == 1)
             posix_spawnattr_destroy(&attr);
@@ -123,17 +246,89 @@ static void run_scanner_prog(int fd, struct stat *statbuf, GList *match_list, ch
         if (fd_actions_set == 1)
             posix_spawn_file_actions_destroy(&fd_actions);
 
+        errno = err;
         perror_msg_and_die("posix_spawn init");
     }
 
     if ((err = posix_spawnp(&pid, prog[0], &fd_actions, &attr, prog, environ)) != 0)
+    {
+        errno = err;
         perror_msg_and_die(_("Can't execute '%s'"), prog[0]);
+    }
 
     if ((err = posix_spawn_file_actions_destroy(&fd_actions)) != 0
-         || ((attr_set == 1) && ((err = posix_spawnattr_destroy(&attr)) != 0)))
-         perror_msg_and_die("posix_spawn destroy");
+         || (err = posix_spawnattr_destroy(&attr)) != 0)
+    {
+        errno = err;
+        perror_msg_and_die("posix_spawn destroy");
+    }
+
+    return pid;
+}
+
+/* Feeds a region of the log to PROG through a pipe */
+static void run_prog_on_region(const char *data, size_t size, void *user_data)
+{
+    char **prog = user_data;
+
+    int pipefd[2];
+    libreport_xpipe(pipefd);
+    libreport_close_on_exec_on(pipefd[0]);
+    libreport_close_on_exec_on(pipefd[1]);
+
+    pid_t pid = spawn_prog(prog, pipefd[0]);
+    close(pipefd[0]);
+
+    if (libreport_full_write(pipefd[1], data, size) != size)
+        log_warning("Warning, '%s' did not process its input", prog[0]);
+    close(pipefd[1]);
 
     libreport_safe_waitpid(pid, NULL, 0);
+}
+
+static void run_scanner_prog(int fd, struct stat *statbuf, const abrt_string_matcher_t *matcher, char **prog)
+{
+    /* fstat(fd, &statbuf) was just done by caller */
+
+    off_t cur_pos = lseek(fd, 0, SEEK_CUR);
+    if (statbuf->st_size <= cur_pos)
+    {
+        /* If file was truncated, treat it as a new file.
+         * (changing inode# causes caller to think that file was closed or renamed)
+         */
+        if (statbuf->st_size < cur_pos)
+            statbuf->st_ino++;
+        return; /* we are at EOF, nothing to do */
+    }
+
+    log_info("File grew by %llu bytes, from %llu to %llu",
+        (long long)(statbuf->st_size - cur_pos),
+        (long long)(cur_pos),
+        (long long)(statbuf->st_size));
+
+    if (matcher)
+    {
+        /* PROG gets only the regions around the found strings */
+        const struct abrt_log_scan scan = {
+            .matcher = matcher,
+            .context_before = READ_AHEAD,
+            .context_after = MATCH_CONTEXT,
+            .window = MAX_SCAN_BLOCK,
+            .region = run_prog_on_region,
+            .user_data = prog,
+        };
+        const int regions = abrt_log_scan_file(&scan, fd, cur_pos, statbuf->st_size);
+        if (regions == 0)
+            log_debug("NOT FOUND");
+        else if (regions > 0)
+            log_debug("FOUND %d regions", regions);
+
+        if (lseek(fd, statbuf->st_size, SEEK_SET) < 0)
+            perror_msg_and_die("Could not seek to position in log file");
+        return;
+    }
+
+    libreport_safe_waitpid(spawn_prog(prog, fd), NULL, 0);
 
     /* Check fd's position, and move to end if it wasn't advanced.
      * This means that child failed to read its stdin.
@@ -147,6 +342,96 @@ static void run_scanner_prog(int fd, struct stat *statbuf, GList *match_list, ch
     }
 }
 
+/*
+ * A watched log file
+ */
+struct watched_log
+{
+    const char *filename;
+    /* NULL means running PROG */
+    const struct log_scanner *scanner;
+    const abrt_string_matcher_t *matcher;
+    int fd;
+    int wd;
+};
+
+static void scan_log(struct watched_log *log, struct stat *statbuf, char **prog, const struct scanner_conf *conf)
+{
+    if (log->scanner != NULL)
+        run_scanner_in_process(log->fd, statbuf, log->matcher, log->scanner, conf);
+    else
+        run_scanner_prog(log->fd, statbuf, log->matcher, prog);
+}
+
+/*
+ * Scans the growth of an opened file, closes it if it was deleted or replaced
+ * and opens it if it exists again.
+ */
+static void watch_log(struct watched_log *log, int inotify_fd, char **prog, const struct scanner_conf *conf)
+{
+    struct stat statbuf;
+
+    /* If file is already opened, scan it from current pos */
+    if (log->fd >= 0)
+    {
+        memset(&statbuf, 0, sizeof(statbuf));
+        if (fstat(log->fd, &statbuf) != 0)
+            goto close_fd;
+        scan_log(log, &statbuf, prog, conf);
+
+        /* Was file deleted or replaced? */
+        ino_t fd_ino = statbuf.st_ino;
+        if (stat(log->filename, &statbuf) != 0 || statbuf.st_ino != fd_ino) /* yes */
+        {
+            log_info("Inode# changed, closing fd of '%s'", log->filename);
+ close_fd:
+            close(log->fd);
+            if (log->wd >= 0)
+                inotify_rm_watch(inotify_fd, log->wd);
+            log->fd = -1;
+            log->wd = -1;
+        }
+    }
+
+    /* If file isn't opened, try to open it and scan */
+    if (log->fd < 0)
+    {
+        log->fd = open(log->filename, O_RDONLY);
+        if (log->fd >= 0)
+        {
+            libreport_close_on_exec_on(log->fd);
+            log_info("Opened '%s'", log->filename);
+            /* For -w case, if we don't have inotify watch yet, open one */
+            if (log->wd < 0)
+            {
+                log->wd = inotify_add_watch(inotify_fd, log->filename, IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF);
+                if (log->wd < 0)
+                    perror_msg("inotify_add_watch failed on '%s'", log->filename);
+                else
+                    log_info("Added inotify watch for '%s'", log->filename);
+            }
+            if (fstat(log->fd, &statbuf) == 0)
+            {
+                /* If file is large, skip the beginning.
+                 * IOW: ignore old log messages because they are unlikely
+                 * to have sufficiently recent data to be useful.
+                 */
+                if (statbuf.st_size > (MAX_SCAN_BLOCK - READ_AHEAD)) {
+                    if (lseek(log->fd, statbuf.st_size - (MAX_SCAN_BLOCK - READ_AHEAD),
+                              SEEK_SET) < 0)
+                    {
+                        perror_msg_and_die("Could not seek to position in log file");
+                    }
+                }
+                /* Note that statbuf is filled by fstat by now,
+                 * run_scanner_prog needs that
+                 */
+                scan_log(log, &statbuf, prog, conf);
+            }
+        }
+    }
+}
+
 int main(int argc, char **argv)
 {
     /* I18n */
@@ -158,25 +443,47 @@ int main(int argc, char **argv)
 
     abrt_init(argv);
 
-    page_size = sysconf(_SC_PAGE_SIZE);
+    /* A scanned PROG can exit without reading the whole region */
+    signal(SIGPIPE, SIG_IGN);
 
     GList *match_list = NULL;
+    GList *scanned_files = NULL;
+    const char *dump_location = NULL;
 
     /* Can't keep these strings/structs static: _() doesn't support that */
     const char *program_usage_string = _(
         "& [-vs] [-F STR]... FILE PROG [ARGS]\n"
+        "or:\n"
+        "& [-vsoxt] [-F STR]... [-d DIR]/[-D] -w SCANNER:FILE...\n"
+        "\n"
+        "Watch log file FILE, run PROG when it grows or is replaced\n"
         "\n"
-        "Watch log file FILE, run PROG when it grows or is replaced"
+        "With -w, watch all FILEs in one process and search them for problems\n"
+        "by the built-in SCANNERs: oops (same as abrt-dump-oops) and xorg\n"
+        "(same as abrt-dump-xorg)"
     );
     enum {
         OPT_v = 1 << 0,
         OPT_s = 1 << 1,
+        OPT_F = 1 << 2,
+        OPT_w = 1 << 3,
+        OPT_d = 1 << 4,
+        OPT_D = 1 << 5,
+        OPT_x = 1 << 6,
+        OPT_t = 1 << 7,
+        OPT_o = 1 << 8,
     };
     /* Keep enum above and order of options below in sync! */
     struct options program_options[] = {
         OPT__VERBOSE(&libreport_g_verbose),
         OPT_BOOL('s', NULL, NULL              , _("Log to syslog")),
         OPT_LIST('F', NULL, &match_list, "STR", _("Don't run PROG if STRs aren't found")),
+        OPT_LIST('w', NULL, &scanned_files, "SCANNER:FILE", _("Watch FILE and search it by SCANNER (oops, xorg)")),
+        OPT_STRING('d', NULL, &dump_location, "DIR", _("Create new problem directory in DIR for every problem found")),
+        OPT_BOOL('D', NULL, NULL              , _("Same as -d DumpLocation, DumpLocation is specified in abrt.conf")),
+        OPT_BOOL('x', NULL, NULL              , _("Make the problem directories world readable")),
+        OPT_BOOL('t', NULL, NULL              , _("Throttle problem directory creation to 1 per second")),
+        OPT_BOOL('o', NULL, NULL              , _("Print found problems on standard output")),
         OPT_END()
     };
     unsigned opts = libreport_parse_opts(argc, argv, program_options, program_usage_string);
@@ -190,7 +497,23 @@ int main(int argc, char **argv)
     }
 
     argv += optind;
-    if (!argv[0] || !argv[1])
+    if (scanned_files != NULL)
+    {
+        if (argv[0] || ((opts & OPT_d) && (opts & OPT_D)))
+            libreport_show_usage_and_die(program_usage_string, program_options);
+
+        if (opts & OPT_D)
+        {
+            abrt_load_abrt_conf();
+            dump_location = abrt_g_settings_dump_location;
+            abrt_g_settings_dump_location = NULL;
+            abrt_free_abrt_conf_data();
+        }
+
+        if (dump_location == NULL && !(opts & OPT_o))
+            libreport_show_usage_and_die(program_usage_string, program_options);
+    }
+    else if (!argv[0] || !argv[1] || (opts & (OPT_d | OPT_D | OPT_x | OPT_t | OPT_o)))
         libreport_show_usage_and_die(program_usage_string, program_options);
 
     /* We want to support -F "`echo foo; echo bar`" -
@@ -209,76 +532,74 @@ int main(int argc, char **argv)
         l = g_list_append(l, eol); /* in fact, always returns unchanged l */
     }
 
-    const char *filename = *argv++;
+    const struct scanner_conf conf = {
+        .dump_location = dump_location,
+        .world_readable = (opts & OPT_x),
+        .throttle = (opts & OPT_t),
+        .print_stdout = (opts & OPT_o),
+    };
+
+    /* All strings are searched for in a single pass */
+    unsigned logs_count = 0;
+    struct watched_log *logs = NULL;
+    if (scanned_files == NULL)
+    {
+        logs_count = 1;
+        logs = g_new0(struct watched_log, logs_count);
+        logs[0].filename = *argv++;
+        logs[0].matcher = match_list ? abrt_string_matcher_new(match_list) : NULL;
+    }
+    else
+    {
+        abrt_string_matcher_t *matchers[ARRAY_SIZE(s_scanners)] = { NULL };
+
+        logs_count = g_list_length(scanned_files);
+        logs = g_new0(struct watched_log, logs_count);
+        struct watched_log *log = logs;
+        for (GList *l = scanned_files; l != NULL; l = l->next, ++log)
+        {
+            const char *arg = l->data;
+            const char *colon = strchr(arg, ':');
+            if (colon == NULL || colon[1] == '\0')
+                libreport_show_usage_and_die(program_usage_string, program_options);
+
+            log->scanner = find_scanner(arg, colon - arg);
+            if (log->scanner == NULL)
+                error_msg_and_die(_("Unknown scanner '%.*s'"), (int)(colon - arg), arg);
+            log->filename = colon + 1;
+
+            const unsigned idx = log->scanner - s_scanners;
+            if (matchers[idx] == NULL)
+            {
+                GList *strings = log->scanner->strings();
+                strings = g_list_concat(strings, g_list_copy(match_list));
+                matchers[idx] = abrt_string_matcher_new(strings);
+                g_list_free(strings);
+            }
+            log->matcher = matchers[idx];
+        }
+    }
+
+    for (unsigned i = 0; i < logs_count; ++i)
+    {
+        logs[i].fd = -1;
+        logs[i].wd = -1;
+    }
 
     int inotify_fd = inotify_init();
     if (inotify_fd == -1)
         perror_msg_and_die("inotify_init failed");
     libreport_close_on_exec_on(inotify_fd);
 
-    struct stat statbuf;
-    int file_fd = -1;
-    int wd = -1;
-
     while (1)
     {
-        /* If file is already opened, scan it from current pos */
-        if (file_fd >= 0)
+        bool all_opened = true;
+        bool any_watched = false;
+        for (unsigned i = 0; i < logs_count; ++i)
         {
-            memset(&statbuf, 0, sizeof(statbuf));
-            if (fstat(file_fd, &statbuf) != 0)
-                goto close_fd;
-            run_scanner_prog(file_fd, &statbuf, match_list, argv);
-
-            /* Was file deleted or replaced? */
-            ino_t fd_ino = statbuf.st_ino;
-            if (stat(filename, &statbuf) != 0 || statbuf.st_ino != fd_ino) /* yes */
-            {
-                log_info("Inode# changed, closing fd");
- close_fd:
-                close(file_fd);
-                if (wd >= 0)
-                    inotify_rm_watch(inotify_fd, wd);
-                file_fd = -1;
-                wd = -1;
-            }
-        }
-
-        /* If file isn't opened, try to open it and scan */
-        if (file_fd < 0)
-        {
-            file_fd = open(filename, O_RDONLY);
-            if (file_fd >= 0)
-            {
-                log_info("Opened '%s'", filename);
-                /* For -w case, if we don't have inotify watch yet, open one */
-                if (wd < 0)
-                {
-                    wd = inotify_add_watch(inotify_fd, filename, IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF);
-                    if (wd < 0)
-                        perror_msg("inotify_add_watch failed on '%s'", filename);
-                    else
-                        log_info("Added inotify watch for '%s'", filename);
-                }
-                if (fstat(file_fd, &statbuf) == 0)
-                {
-                    /* If file is large, skip the beginning.
-                     * IOW: ignore old log messages because they are unlikely
-                     * to have sufficiently recent data to be useful.
-                     */
-                    if (statbuf.st_size > (MAX_SCAN_BLOCK - READ_AHEAD)) {
-                        if (lseek(file_fd, statbuf.st_size - (MAX_SCAN_BLOCK - READ_AHEAD),
-                                  SEEK_SET) < 0)
-                        {
-                            perror_msg_and_die("Could not seek to position in log file");
-                        }
-                    }
-                    /* Note that statbuf is filled by fstat by now,
-                     * run_scanner_prog needs that
-                     */
-                    run_scanner_prog(file_fd, &statbuf, match_list, argv);
-                }
-            }
+            watch_log(&logs[i], inotify_fd, argv, &conf);
+            all_opened &= logs[i].fd >= 0;
+            any_watched |= logs[i].wd >= 0;
         }
 
         /* Even if log file grows all the time, say, a new line every 5 ms,
@@ -286,26 +607,36 @@ int main(int argc, char **argv)
          * in bigger increments.
          * Sleep longer if file does not exist.
          */
-        sleep(file_fd >= 0 ? 1 : 59);
+        sleep(1);
 
-        /* Now wait for it to change, be moved or deleted */
-        if (wd >= 0)
+        /* Now wait for a file to change, be moved or deleted */
+        if (any_watched)
         {
+            struct pollfd pollfd = { .fd = inotify_fd, .events = POLLIN };
+
+            log_debug("Waiting for watched files to change");
+            /* We block here, unless a file has to be opened yet: */
+            const int r = poll(&pollfd, 1, all_opened ? -1 : 58 * 1000);
+            if (r < 0 && errno != EINTR) /* I saw EINTR here on strace attach */
+                perror_msg("Error polling inotify fd");
+            if (r <= 0)
+                continue;
+
             char buf[4096];
-            log_debug("Waiting for '%s' to change", filename);
-            /* We block here: */
             int len = read(inotify_fd, buf, sizeof(buf));
-            if (len < 0 && errno != EINTR) /* I saw EINTR here on strace attach */
+            if (len < 0 && errno != EINTR)
                 perror_msg("Error reading inotify fd");
-            /* we don't actually check what happened to file -
+            /* we don't actually check what happened to files -
              * the code will handle all possibilities.
              */
-            log_debug("Change in '%s' detected", filename);
+            log_debug("Change in watched files detected");
             /* Let them finish writing to the log file. otherwise
              * we may end up trying to analyze partial oops.
              */
             sleep(1);
         }
+        else
+            sleep(58);
 
     } /* while (1) */
 
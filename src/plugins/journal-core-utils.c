@@ -0,0 +1,625 @@
+/*
+ * Copyright (C) 2014  ABRT team
+ * Copyright (C) 2014  RedHat Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "journal-core-utils.h"
+
+/*
+ * A journal message is a set of key value pairs in the following format:
+ *   FIELD_NAME=${binary data}
+ *
+ * A journal message contains many fields useful in syslog but ABRT doesn't
+ * need all of them. So the following list defines mapping between journal
+ * fields and ABRT problem items.
+ *
+ * ABRT goes through the list and for each item reads journal field called
+ * 'item.name' and saves its contents in $DUMP_DIRECTORY/'item.file'.
+ */
+static struct field_mapping {
+    const char *name;
+    const char *file;
+} fields [] = {
+    { .name = "COREDUMP_EXE",               .file = FILENAME_EXECUTABLE, },
+    { .name = "COREDUMP_CMDLINE",           .file = FILENAME_CMDLINE, },
+    { .name = "COREDUMP_PROC_STATUS",       .file = FILENAME_PROC_PID_STATUS, },
+    { .name = "COREDUMP_PROC_MAPS",         .file = FILENAME_MAPS, },
+    { .name = "COREDUMP_PROC_LIMITS",       .file = FILENAME_LIMITS, },
+    { .name = "COREDUMP_PROC_CGROUP",       .file = FILENAME_CGROUP, },
+    { .name = "COREDUMP_ENVIRON",           .file = FILENAME_ENVIRON, },
+    { .name = "COREDUMP_CWD",               .file = FILENAME_PWD, },
+    { .name = "COREDUMP_ROOT",              .file = FILENAME_ROOTDIR, },
+    { .name = "COREDUMP_OPEN_FDS",          .file = FILENAME_OPEN_FDS, },
+    { .name = "COREDUMP_UID",               .file = FILENAME_UID, },
+    //{ .name = "COREDUMP_GID",               .file = FILENAME_GID, },
+    { .name = "COREDUMP_PID",               .file = FILENAME_PID, },
+    { .name = "COREDUMP_PROC_MOUNTINFO",    .file = FILENAME_MOUNTINFO, },
+};
+
+/*
+ * Something like 'struct problem_data' but optimized for copying data from
+ * journald to ABRT.
+ *
+ * 'struct problem_data' allocates a new memory for every single item and I
+ * found that very inefficient in this case.
+ *
+ * The following structure holds data that we already retreived from journald
+ * so we won't need to retrieve the data again.
+ *
+ * Why we retrieve data before we store them? Because we do some checking
+ * before we start saving data in ABRT. We check whether the signal is one of
+ * those we are interested in or whether the executable crashes too often to
+ * ignore the current crash ...
+ */
+struct crash_info
+{
+    abrt_journal_t *ci_journal;
+
+    int ci_signal_no;
+    const char *ci_signal_name;
+    char *ci_executable_path;          ///< /full/path/to/executable
+    const char *ci_executable_name;    ///< executable
+    uid_t ci_uid;
+    pid_t ci_pid;
+
+    struct field_mapping *ci_mapping;
+    size_t ci_mapping_items;
+
+    unsigned ci_suppressed;            ///< number of throttled crashes of the executable
+};
+
+
+/*
+ * Throttling of repeating crashes of a single executable.
+ *
+ * A saved crash opens a window of awc_throttle seconds in which other crashes
+ * of the executable are only counted. A crash coming within twice the window
+ * after the last saved one is considered to be a part of a crash loop and
+ * doubles the window up to awc_throttle_max seconds. The number of the
+ * suppressed crashes is saved in the next problem of the executable.
+ *
+ * The table is kept in a state file, so restarts do not reset the windows.
+ * The file is rewritten when a crash changes a window. A suppressed crash
+ * only counts, so a crash loop writes the counters at most once in
+ * OCCURRENCES_SAVE_INTERVAL seconds.
+ */
+struct occurrence
+{
+    time_t oc_last_saved;      ///< time stamp of the last saved crash
+    unsigned oc_window;        ///< current throttle window in seconds
+    unsigned oc_suppressed;    ///< crashes suppressed since oc_last_saved
+};
+
+#define OCCURRENCES_SAVE_INTERVAL 60
+
+/* executable path -> struct occurrence */
+static GHashTable *s_occurrences;
+/* Time stamp of the last write of the state file */
+static time_t s_occurrences_saved;
+/* Backfill workers process cores in parallel */
+static GMutex s_occurrences_lock;
+
+static void
+abrt_journal_load_occurrences(const char *file_name)
+{
+    FILE *fp = fopen(file_name, "r");
+    if (fp == NULL)
+    {
+        if (errno != ENOENT)
+            perror_msg("Can't open '%s'", file_name);
+        return;
+    }
+
+    char *line;
+    while ((line = libreport_xmalloc_fgetline(fp)) != NULL)
+    {
+        long long last_saved;
+        unsigned window;
+        unsigned suppressed;
+        int executable_pos = 0;
+        if (sscanf(line, "%lld %u %u %n", &last_saved, &window, &suppressed, &executable_pos) != 3
+            || executable_pos == 0 || line[executable_pos] != '/')
+        {
+            log_notice("Ignoring malformed line in '%s': %s", file_name, line);
+            free(line);
+            continue;
+        }
+
+        struct occurrence *oc = g_new(struct occurrence, 1);
+        oc->oc_last_saved = (time_t)last_saved;
+        oc->oc_window = window;
+        oc->oc_suppressed = suppressed;
+        g_hash_table_replace(s_occurrences, g_strdup(line + executable_pos), oc);
+        free(line);
+    }
+
+    fclose(fp);
+    log_debug("Loaded %u executables from '%s'", g_hash_table_size(s_occurrences), file_name);
+}
+
+static void
+abrt_journal_save_occurrences(const char *file_name)
+{
+    GString *contents = g_string_new(NULL);
+
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, s_occurrences);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        const struct occurrence *oc = value;
+        g_string_append_printf(contents, "%lld %u %u %s\n",
+                (long long)oc->oc_last_saved, oc->oc_window, oc->oc_suppressed, (const char *)key);
+    }
+
+    g_autofree char *tmp_name = g_strdup_printf("%s.new", file_name);
+    int fd = open(tmp_name, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, 0600);
+    if (fd < 0)
+        perror_msg("Can't open '%s'", tmp_name);
+    else
+    {
+        const bool written = libreport_full_write(fd, contents->str, contents->len) == contents->len;
+        close(fd);
+
+        if (!written || rename(tmp_name, file_name) < 0)
+        {
+            perror_msg("Can't save '%s'", file_name);
+            unlink(tmp_name);
+        }
+    }
+
+    g_string_free(contents, TRUE);
+}
+
+static void
+abrt_journal_init_occurrences(const abrt_watch_core_conf_t *conf)
+{
+    if (s_occurrences != NULL)
+        return;
+
+    s_occurrences = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    if (conf->awc_throttle_state_file != NULL)
+        abrt_journal_load_occurrences(conf->awc_throttle_state_file);
+}
+
+/*
+ * Forgets executables whose window has expired; if there is no such
+ * executable, forgets the one with the oldest saved crash.
+ */
+static void
+abrt_journal_make_room_for_occurrence(const abrt_watch_core_conf_t *conf, time_t current)
+{
+    if (g_hash_table_size(s_occurrences) < MAX(conf->awc_throttle_capacity, 1))
+        return;
+
+    const char *oldest = NULL;
+    time_t oldest_stamp = 0;
+
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, s_occurrences);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        const struct occurrence *oc = value;
+        if (oc->oc_suppressed == 0 && difftime(current, oc->oc_last_saved) >= 2.0 * oc->oc_window)
+        {
+            g_hash_table_iter_remove(&iter);
+            continue;
+        }
+
+        if (oldest == NULL || oc->oc_last_saved < oldest_stamp)
+        {
+            oldest = key;
+            oldest_stamp = oc->oc_last_saved;
+        }
+    }
+
+    if (g_hash_table_size(s_occurrences) >= MAX(conf->awc_throttle_capacity, 1))
+    {
+        log_info("Forgetting crashes of '%s'", oldest);
+        g_hash_table_remove(s_occurrences, oldest);
+    }
+}
+
+/*
+ * Returns true if the crash shall be suppressed; otherwise stores the number
+ * of already suppressed crashes in suppressed.
+ */
+static bool
+abrt_journal_throttle_occurrence(const abrt_watch_core_conf_t *conf, const char *executable, time_t current, unsigned *suppressed)
+{
+    *suppressed = 0;
+
+    struct occurrence *oc = g_hash_table_lookup(s_occurrences, executable);
+    if (oc == NULL)
+        return false;
+
+    if (current < oc->oc_last_saved)
+    {
+        log_notice("Time went backwards, resetting throttling of '%s'", executable);
+        oc->oc_last_saved = current;
+        oc->oc_window = 0;
+    }
+
+    const double sub = difftime(current, oc->oc_last_saved);
+    if (sub < oc->oc_window)
+    {
+        ++oc->oc_suppressed;
+        error_msg(_("Not saving repeating crash after %.0fs (limit is %us, %u suppressed)"),
+                  sub, oc->oc_window, oc->oc_suppressed);
+        return true;
+    }
+
+    *suppressed = oc->oc_suppressed;
+    return false;
+}
+
+static void
+abrt_journal_update_occurrence(const abrt_watch_core_conf_t *conf, const char *executable, time_t current)
+{
+    struct occurrence *oc = g_hash_table_lookup(s_occurrences, executable);
+    if (oc == NULL)
+    {
+        abrt_journal_make_room_for_occurrence(conf, current);
+
+        oc = g_new0(struct occurrence, 1);
+        g_hash_table_insert(s_occurrences, g_strdup(executable), oc);
+    }
+    else if (oc->oc_window > 0 && difftime(current, oc->oc_last_saved) < 2.0 * oc->oc_window)
+    {
+        /* Crash loop, back off */
+        oc->oc_window = MIN(oc->oc_window * 2, (unsigned)MAX(conf->awc_throttle_max, conf->awc_throttle));
+        oc->oc_last_saved = current;
+        oc->oc_suppressed = 0;
+        return;
+    }
+
+    oc->oc_window = conf->awc_throttle;
+    oc->oc_last_saved = current;
+    oc->oc_suppressed = 0;
+}
+
+/*
+ * Converts a journal message into an intermediate ABRT problem (struct crash_info).
+ *
+ * Refuses to create the problem in the following cases:
+ * - the crashed executable has 'abrt' prefix
+ * - the signals is not fatal (see signal_is_fatal())
+ * - the journal message misses one of the following fields
+ *   - COREDUMP_SIGNAL
+ *   - COREDUMP_EXE
+ *   - COREDUMP_UID
+ *   - COREDUMP_PROC_STATUS
+ * - if any data does not have an expected format
+ */
+static int
+abrt_journal_core_retrieve_information(abrt_journal_t *journal, struct crash_info *info)
+{
+    if (!abrt_journal_get_int(journal, "COREDUMP_SIGNAL", &info->ci_signal_no) != 0)
+    {
+        log_info("Failed to get signal number from journal message");
+        return -EINVAL;
+    }
+
+    if (!signal_is_fatal(info->ci_signal_no, &(info->ci_signal_name)))
+    {
+        log_info("Signal '%d' is not fatal: ignoring crash", info->ci_signal_no);
+        return 1;
+    }
+
+    info->ci_executable_path = abrt_journal_get_string_field(journal, "COREDUMP_EXE", NULL);
+    if (info->ci_executable_path == NULL)
+    {
+        log_notice("Could not get crashed 'executable'.");
+        return -ENOENT;
+    }
+
+    info->ci_executable_name = strrchr(info->ci_executable_path, '/');
+    if (info->ci_executable_name == NULL)
+    {
+        info->ci_executable_name = info->ci_executable_path;
+    }
+    else if(strncmp(++(info->ci_executable_name), "abrt", 4) == 0)
+    {
+        error_msg("Ignoring crash of ABRT executable '%s'", info->ci_executable_path);
+        return 1;
+    }
+
+    if (!abrt_journal_get_uid(journal, "COREDUMP_UID", &info->ci_uid))
+    {
+        log_info("Failed to get UID from journal message");
+        return -EINVAL;
+    }
+
+    /* This is not fatal, the pid is used only in dumpdir name */
+    if (!abrt_journal_get_pid(journal, "COREDUMP_PID", &info->ci_pid))
+    {
+        log_notice("Failed to get PID from journal message.");
+        info->ci_pid = getpid();
+    }
+
+    char *proc_status = abrt_journal_get_string_field(journal, "COREDUMP_PROC_STATUS", NULL);
+    if (proc_status == NULL)
+    {
+        log_info("Failed to get /proc/[pid]/status from journal message");
+        return -ENOENT;
+    }
+
+    int tmp_fsuid = libreport_get_fsuid(proc_status);
+    if (tmp_fsuid < 0)
+        return -EINVAL;
+
+    if ((uid_t)tmp_fsuid != info->ci_uid)
+    {
+        /* use root for suided apps unless it's explicitly set to UNSAFE */
+        info->ci_uid = (dump_suid_policy() != DUMP_SUID_UNSAFE) ? 0 : tmp_fsuid;
+    }
+
+    return 0;
+}
+
+/*
+ * Initializes ABRT problem directory and save the relevant journal message
+ * fileds in that directory.
+ */
+static int
+save_systemd_coredump_in_dump_directory(struct dump_dir *dd, struct crash_info *info)
+{
+    char coredump_path[PATH_MAX + 1] = { '\0' };
+    if (coredump_path != abrt_journal_get_string_field(info->ci_journal, "COREDUMP_FILENAME", coredump_path))
+        log_debug("Processing coredumpctl entry without a real file");
+
+    if (strlen(coredump_path) > 0)
+    {
+        // Copy the likely compressed coredump file to the problem directory
+        const char *dd_coredump_filename = FILENAME_COREDUMP;
+        g_autofree char *filename_with_extension = NULL;
+
+        const char *file_extension = strrchr(coredump_path, '.');
+
+        if (file_extension && file_extension != coredump_path) {
+            filename_with_extension = g_strconcat(FILENAME_COREDUMP, file_extension, NULL);
+            dd_coredump_filename = filename_with_extension;
+        }
+        if (dd_copy_file(dd, dd_coredump_filename, coredump_path))
+            return -1;
+    }
+    else
+    {
+        const char *data = NULL;
+        size_t data_len = 0;
+        int r = abrt_journal_get_field(info->ci_journal, "COREDUMP", (const void **)&data, &data_len);
+        if (r < 0)
+        {
+            log_info("Ignoring coredumpctl entry without core dump file.");
+            return -1;
+        }
+
+        dd_save_binary(dd, FILENAME_COREDUMP, data, data_len);
+    }
+
+    dd_save_text(dd, FILENAME_ABRT_VERSION, VERSION);
+    dd_save_text(dd, FILENAME_TYPE, "CCpp");
+    dd_save_text(dd, FILENAME_ANALYZER, "abrt-journal-core");
+
+    g_autofree char *reason = NULL;
+    if (info->ci_signal_name == NULL)
+        reason = g_strdup_printf("%s killed by signal %d", info->ci_executable_name, info->ci_signal_no);
+    else
+        reason = g_strdup_printf("%s killed by SIG%s", info->ci_executable_name, info->ci_signal_name);
+
+    dd_save_text(dd, FILENAME_REASON, reason);
+
+    if (info->ci_suppressed > 0)
+    {
+        char suppressed_str[sizeof(unsigned) * 3 + 2];
+        sprintf(suppressed_str, "%u", info->ci_suppressed);
+        dd_save_text(dd, FILENAME_SUPPRESSED_COUNT, suppressed_str);
+    }
+
+    g_autofree char *cursor = NULL;
+    if (abrt_journal_get_cursor(info->ci_journal, &cursor) == 0)
+        dd_save_text(dd, "journald_cursor", cursor);
+
+    const char *data = NULL;
+    size_t data_len = 0;
+
+    /* This journal field is not present most of the time, because it is
+     * created only for coredumps from processes running in a container.
+     *
+     * Printing out the log message would be confusing hence.
+     *
+     * If we find more similar fields, we should not add more if statements
+     * but encode this in the struct field_mapping.
+     *
+     * For now, it would be just vasting of memory and time.
+     */
+    if (!abrt_journal_get_field(info->ci_journal, "COREDUMP_CONTAINER_CMDLINE", (const void **)&data, &data_len))
+    {
+        dd_save_binary(dd, FILENAME_CONTAINER_CMDLINE, data, data_len);
+    }
+
+    for (size_t i = 0; i < info->ci_mapping_items; ++i)
+    {
+        const char *data;
+        size_t data_len;
+        struct field_mapping *f = info->ci_mapping + i;
+
+        if (abrt_journal_get_field(info->ci_journal, f->name, (const void **)&data, &data_len))
+        {
+            log_info("systemd-coredump journald message misses field: '%s'", f->name);
+            continue;
+        }
+
+        dd_save_binary(dd, f->file, data, data_len);
+    }
+
+    return 0;
+}
+
+static int
+abrt_journal_core_to_abrt_problem(struct crash_info *info, const char *dump_location)
+{
+    struct dump_dir *dd = create_dump_dir_ext(dump_location, "ccpp", info->ci_pid, /*fs owner*/0,
+            (save_data_call_back)save_systemd_coredump_in_dump_directory, info);
+
+    if (dd != NULL)
+    {
+        g_autofree char *path = g_strdup(dd->dd_dirname);
+        dd_close(dd);
+        abrt_notify_new_path(path);
+        log_debug("ABRT daemon has been notified about directory: '%s'", path);
+    }
+
+    return dd == NULL;
+}
+
+/*
+ * Prints a core info to stdout.
+ */
+static int
+abrt_journal_core_to_stdout(struct crash_info *info)
+{
+    printf(_("UID=%9i; SIG=%2i (%4s); EXE=%s\n"),
+           info->ci_uid,
+           info->ci_signal_no,
+           info->ci_signal_name,
+           info->ci_executable_path);
+    return 0;
+}
+
+/*
+ * Creates an abrt problem from a journal message
+ */
+int
+abrt_journal_core_dump(abrt_journal_t *journal, const char *dump_location, int run_flags)
+{
+    struct crash_info info = { 0 };
+    info.ci_journal = journal;
+    info.ci_mapping = fields;
+    info.ci_mapping_items = sizeof(fields)/sizeof(*fields);
+
+    int r = abrt_journal_core_retrieve_information(journal, &info);
+    if (r != 0)
+    {
+        if (r < 0)
+            error_msg(_("Failed to obtain all required information from journald"));
+
+        goto dump_cleanup;
+    }
+
+    if ((run_flags & ABRT_CORE_PRINT_STDOUT))
+        r = abrt_journal_core_to_stdout(&info);
+    else
+        r = abrt_journal_core_to_abrt_problem(&info, dump_location);
+
+dump_cleanup:
+    if (info.ci_executable_path != NULL)
+        g_free(info.ci_executable_path);
+
+    return r;
+}
+
+/*
+ * A function called when a new journal core is detected.
+ *
+ * The function retrieves information from journal, checks the throttle window
+ * of the crashed executable and if the crash is not in the window updates the
+ * window and creates an ABRT problem from the journal message.
+ *
+ * Thread safe, journal can be a copy of an entry made by a backfill.
+ */
+void
+abrt_journal_core_process(abrt_journal_t *journal, const abrt_watch_core_conf_t *conf)
+{
+    struct crash_info info = { 0 };
+    info.ci_journal = journal;
+    info.ci_mapping = fields;
+    info.ci_mapping_items = sizeof(fields)/sizeof(*fields);
+
+    int r = abrt_journal_core_retrieve_information(journal, &info);
+    if (r)
+    {
+        if (r < 0)
+            error_msg(_("Failed to obtain all required information from journald"));
+
+        goto watch_cleanup;
+    }
+
+    // do not dump too often
+    //   the window is updated before the problem is created, so a concurrent
+    //   crash of the same executable is throttled too
+    if (conf->awc_throttle > 0)
+    {
+        const time_t current = time(NULL);
+
+        g_mutex_lock(&s_occurrences_lock);
+        abrt_journal_init_occurrences(conf);
+
+        const bool suppress = abrt_journal_throttle_occurrence(conf, info.ci_executable_path, current, &info.ci_suppressed);
+        if (!suppress)
+            abrt_journal_update_occurrence(conf, info.ci_executable_path, current);
+
+        if (conf->awc_throttle_state_file != NULL
+            && (!suppress || difftime(current, s_occurrences_saved) >= OCCURRENCES_SAVE_INTERVAL))
+        {
+            abrt_journal_save_occurrences(conf->awc_throttle_state_file);
+            s_occurrences_saved = current;
+        }
+        g_mutex_unlock(&s_occurrences_lock);
+
+        if (suppress)
+            goto watch_cleanup;
+    }
+
+    if ((conf->awc_run_flags & ABRT_CORE_PRINT_STDOUT))
+    {
+        if (abrt_journal_core_to_stdout(&info))
+        {
+            error_msg(_("Failed to print detect problem data to stdout"));
+            goto watch_cleanup;
+        }
+    }
+    else
+    {
+        if (abrt_journal_core_to_abrt_problem(&info, conf->awc_dump_location))
+        {
+            error_msg(_("Failed to save detect problem data in abrt database"));
+            goto watch_cleanup;
+        }
+    }
+
+watch_cleanup:
+    if (info.ci_executable_path != NULL)
+        g_free(info.ci_executable_path);
+
+    return;
+}
+
+void
+abrt_journal_core_load_throttle_conf(abrt_watch_core_conf_t *conf)
+{
+    g_autoptr(GHashTable) settings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    abrt_load_abrt_plugin_conf_file("CCpp.conf", settings);
+
+    conf->awc_throttle = ABRT_JOURNAL_CORE_THROTTLE_DEFAULT;
+    conf->awc_throttle_max = ABRT_JOURNAL_CORE_THROTTLE_MAX_DEFAULT;
+    conf->awc_throttle_capacity = ABRT_JOURNAL_CORE_THROTTLE_CAPACITY_DEFAULT;
+
+    int value;
+    if (libreport_try_get_map_string_item_as_int(settings, "JournalThrottle", &value) && value >= 0)
+        conf->awc_throttle = value;
+    if (libreport_try_get_map_string_item_as_int(settings, "JournalThrottleMax", &value) && value >= 0)
+        conf->awc_throttle_max = value;
+    if (libreport_try_get_map_string_item_as_int(settings, "JournalThrottleCapacity", &value) && value > 0)
+        conf->awc_throttle_capacity = value;
+}
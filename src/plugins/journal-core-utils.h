@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2014  ABRT team
+ * Copyright (C) 2014  RedHat Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef _ABRT_JOURNAL_CORE_UTILS_H_
+#define _ABRT_JOURNAL_CORE_UTILS_H_
+
+#include "libabrt.h"
+#include "abrt-journal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ABRT_JOURNAL_CORE_STATE_FILE VAR_STATE"/abrt-dump-journal-core.state"
+
+/* SD_MESSAGE_COREDUMP from <systemd/sd-messages.h> */
+#define ABRT_JOURNAL_CORE_MESSAGE_ID "fc2e22bc6ee647b6b90729ab34a250b1"
+
+/* systemd-coredump creates journal messages with SYSLOG_IDENTIFIER equals
+ * 'systemd-coredump' and we are interested only in the systemd-coredump
+ * messages announcing a core dump (the other ones, e.g. about disabled
+ * core dumps, do not carry any COREDUMP_ fields).
+ */
+#define ABRT_JOURNAL_CORE_MATCH_IDENTIFIER "SYSLOG_IDENTIFIER=systemd-coredump"
+#define ABRT_JOURNAL_CORE_MATCH_MESSAGE_ID "MESSAGE_ID="ABRT_JOURNAL_CORE_MESSAGE_ID
+
+enum {
+    ABRT_CORE_PRINT_STDOUT = 1 << 0,
+};
+
+/* Crash throttling of an executable, see abrt-CCpp.conf(5) */
+#define ABRT_JOURNAL_CORE_THROTTLE_STATE_FILE VAR_STATE"/abrt-dump-journal-core.throttle"
+#define ABRT_JOURNAL_CORE_THROTTLE_DEFAULT 10
+#define ABRT_JOURNAL_CORE_THROTTLE_MAX_DEFAULT 3600
+#define ABRT_JOURNAL_CORE_THROTTLE_CAPACITY_DEFAULT 1024
+
+/*
+ * ABRT watch core configuration
+ */
+typedef struct
+{
+    const char *awc_dump_location;
+    int awc_throttle;                     ///< initial throttle window in seconds, 0 disables throttling
+    int awc_throttle_max;                 ///< the window of a crash loop doubles up to this limit
+    unsigned awc_throttle_capacity;       ///< number of remembered executables
+    const char *awc_throttle_state_file;  ///< NULL means the throttling is not persistent
+    int awc_run_flags;
+}
+abrt_watch_core_conf_t;
+
+/*
+ * Loads the throttle settings from CCpp.conf
+ */
+void abrt_journal_core_load_throttle_conf(abrt_watch_core_conf_t *conf);
+
+/*
+ * Creates an abrt problem from the current journal message
+ */
+int abrt_journal_core_dump(abrt_journal_t *journal, const char *dump_location, int run_flags);
+
+/*
+ * Creates an abrt problem from the current journal message unless the crashed
+ * executable is in its throttle window.
+ */
+void abrt_journal_core_process(abrt_journal_t *journal, const abrt_watch_core_conf_t *conf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*_ABRT_JOURNAL_CORE_UTILS_H_*/
@@ -0,0 +1,325 @@
+/*
+ * Copyright (C) 2026  ABRT team
+ * Copyright (C) 2026  RedHat Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include "log-scanner.h"
+
+#define MATCHER_ALPHABET 256
+#define MATCHER_NO_STATE UINT_MAX
+
+/*
+ * The trie of the strings with all failure links resolved, so every byte of
+ * data costs exactly one table look up.
+ */
+struct abrt_string_matcher
+{
+    unsigned states;
+    /* states x MATCHER_ALPHABET next states */
+    unsigned *delta;
+    /* non-zero if a string ends in the state */
+    unsigned char *accept;
+};
+
+abrt_string_matcher_t *abrt_string_matcher_new(GList *strings)
+{
+    size_t max_states = 1;
+    for (GList *l = strings; l != NULL; l = l->next)
+        max_states += strlen(l->data);
+
+    abrt_string_matcher_t *matcher = g_new0(abrt_string_matcher_t, 1);
+    matcher->delta = g_new(unsigned, max_states * MATCHER_ALPHABET);
+    matcher->accept = g_new0(unsigned char, max_states);
+    matcher->states = 1;
+
+    for (size_t i = 0; i < max_states * MATCHER_ALPHABET; ++i)
+        matcher->delta[i] = MATCHER_NO_STATE;
+
+    /* The trie */
+    for (GList *l = strings; l != NULL; l = l->next)
+    {
+        const unsigned char *str = l->data;
+        if (*str == '\0')
+            continue;
+
+        unsigned state = ABRT_STRING_MATCHER_START;
+        for (; *str != '\0'; ++str)
+        {
+            unsigned *next = &matcher->delta[state * MATCHER_ALPHABET + *str];
+            if (*next == MATCHER_NO_STATE)
+                *next = matcher->states++;
+            state = *next;
+        }
+        matcher->accept[state] = 1;
+    }
+
+    /* Breadth-first resolution of the failure links: a missing transition
+     * continues from the longest proper suffix which is also a prefix of
+     * a string. */
+    unsigned *fail = g_new0(unsigned, matcher->states);
+    unsigned *queue = g_new(unsigned, matcher->states);
+    unsigned head = 0;
+    unsigned tail = 0;
+
+    for (unsigned c = 0; c < MATCHER_ALPHABET; ++c)
+    {
+        unsigned *next = &matcher->delta[ABRT_STRING_MATCHER_START * MATCHER_ALPHABET + c];
+        if (*next == MATCHER_NO_STATE)
+            *next = ABRT_STRING_MATCHER_START;
+        else
+        {
+            fail[*next] = ABRT_STRING_MATCHER_START;
+            queue[tail++] = *next;
+        }
+    }
+
+    while (head < tail)
+    {
+        const unsigned state = queue[head++];
+        for (unsigned c = 0; c < MATCHER_ALPHABET; ++c)
+        {
+            unsigned *next = &matcher->delta[state * MATCHER_ALPHABET + c];
+            const unsigned fallback = matcher->delta[fail[state] * MATCHER_ALPHABET + c];
+            if (*next == MATCHER_NO_STATE)
+                *next = fallback;
+            else
+            {
+                fail[*next] = fallback;
+                matcher->accept[*next] |= matcher->accept[fallback];
+                queue[tail++] = *next;
+            }
+        }
+    }
+
+    g_free(queue);
+    g_free(fail);
+
+    matcher->delta = g_renew(unsigned, matcher->delta, matcher->states * MATCHER_ALPHABET);
+
+    log_debug("String matcher has %u states", matcher->states);
+
+    return matcher;
+}
+
+void abrt_string_matcher_free(abrt_string_matcher_t *matcher)
+{
+    if (matcher == NULL)
+        return;
+
+    g_free(matcher->delta);
+    g_free(matcher->accept);
+    g_free(matcher);
+}
+
+size_t abrt_string_matcher_find(const abrt_string_matcher_t *matcher, unsigned *state, const char *data, size_t size)
+{
+    const unsigned *const delta = matcher->delta;
+    const unsigned char *const accept = matcher->accept;
+
+    unsigned s = *state;
+    for (size_t i = 0; i < size; ++i)
+    {
+        s = delta[s * MATCHER_ALPHABET + (unsigned char)data[i]];
+        if (accept[s])
+        {
+            *state = s;
+            return i + 1;
+        }
+    }
+
+    *state = s;
+    return 0;
+}
+
+struct mapped_range
+{
+    void *map;
+    size_t maplen;
+    const char *data;
+    size_t size;
+};
+
+static int map_range(struct mapped_range *range, int fd, off_t offset, size_t size)
+{
+    const off_t mapofs = offset & ~((off_t)sysconf(_SC_PAGE_SIZE) - 1);
+
+    range->maplen = size + (offset - mapofs);
+    range->map = mmap(NULL, range->maplen, PROT_READ, MAP_SHARED, fd, mapofs);
+    if (range->map == MAP_FAILED)
+    {
+        perror_msg("Could not map log file");
+        return -1;
+    }
+
+    range->data = (char *)range->map + (offset - mapofs);
+    range->size = size;
+    return 0;
+}
+
+static void unmap_range(struct mapped_range *range)
+{
+    munmap(range->map, range->maplen);
+}
+
+struct log_region
+{
+    off_t begin;
+    off_t end;
+    /* The ends of the first and the last occurrence in the region */
+    off_t first_match;
+    off_t last_match;
+    /* The region starts at the beginning of a line */
+    bool line_start;
+};
+
+/*
+ * Passes the region to the callback without the incomplete lines at its
+ * edges, unless the line containing an occurrence would be cut. Stores the
+ * offset following the passed bytes in next and whether a line starts there
+ * in next_line_start.
+ */
+static int emit_region(const struct abrt_log_scan *scan, int fd, const struct log_region *region,
+                       off_t scan_end, off_t *next, bool *next_line_start)
+{
+    struct mapped_range range;
+    if (map_range(&range, fd, region->begin, region->end - region->begin) != 0)
+        return -1;
+
+    const char *data = range.data;
+    size_t size = range.size;
+
+    /* The end of an occurrence is never the line's new line character */
+    if (!region->line_start && region->first_match - region->begin > 1)
+    {
+        const char *eol = memchr(data, '\n', region->first_match - region->begin - 1);
+        if (eol != NULL)
+        {
+            size -= eol + 1 - data;
+            data = eol + 1;
+        }
+    }
+
+    *next_line_start = region->end == scan_end;
+    if (region->end < scan_end)
+    {
+        const char *match = range.data + (region->last_match - region->begin);
+        const char *eol = data + size;
+        while (eol > match && eol[-1] != '\n')
+            --eol;
+        if (eol > match)
+        {
+            size = eol - data;
+            *next_line_start = true;
+        }
+        else
+            *next_line_start = data[size - 1] == '\n';
+    }
+
+    *next = region->begin + (data - range.data) + size;
+
+    log_debug("Region of %zu bytes at %llu", size, (long long)(*next - size));
+    scan->region(data, size, scan->user_data);
+
+    unmap_range(&range);
+    return 0;
+}
+
+int abrt_log_scan_file(const struct abrt_log_scan *scan, int fd, off_t begin, off_t end)
+{
+    int regions = 0;
+    unsigned state = ABRT_STRING_MATCHER_START;
+
+    /* The region being collected, none if region.begin < 0 */
+    struct log_region region = { .begin = -1 };
+    /* Where the previous region ended */
+    off_t next = begin;
+    bool next_line_start = true;
+
+    for (off_t pos = begin; pos < end; )
+    {
+        struct mapped_range window;
+        if (map_range(&window, fd, pos, MIN((off_t)scan->window, end - pos)) != 0)
+            return -1;
+
+        /* The incomplete last line is carried over to the next window, so
+         * every line of an occurrence is whole in the window, unless the line
+         * is longer than half of the window */
+        size_t scan_size = window.size;
+        if (pos + (off_t)window.size < end)
+        {
+            const char *limit = window.data + window.size / 2;
+            const char *last_line = window.data + window.size;
+            while (last_line > limit && last_line[-1] != '\n')
+                --last_line;
+            if (last_line > limit)
+                scan_size = last_line - window.data;
+        }
+
+        size_t offset = 0;
+        size_t found;
+        while (offset < scan_size
+               && (found = abrt_string_matcher_find(scan->matcher, &state,
+                                                    window.data + offset, scan_size - offset)) != 0)
+        {
+            offset += found;
+
+            const off_t match = pos + offset;
+
+            /* The context is extended to the whole line of the occurrence */
+            const char *line = window.data + offset - 1;
+            while (line > window.data && line[-1] != '\n')
+                --line;
+            const char *eol = memchr(window.data + offset, '\n', window.size - offset);
+            const off_t line_begin = pos + (line - window.data);
+            const off_t line_end = pos + (off_t)(eol ? eol + 1 - window.data : window.size);
+
+            const off_t match_begin = MIN(line_begin, match - (off_t)scan->context_before);
+            const off_t match_end = MIN(end, MAX(line_end, match + (off_t)scan->context_after));
+
+            if (region.begin >= 0
+                && match_begin <= region.end
+                && line_end <= region.begin + (off_t)scan->window)
+            {
+                region.end = MIN(MAX(region.end, match_end), region.begin + (off_t)scan->window);
+                region.last_match = match;
+                continue;
+            }
+
+            if (region.begin >= 0)
+            {
+                if (emit_region(scan, fd, &region, end, &next, &next_line_start) != 0)
+                {
+                    unmap_range(&window);
+                    return -1;
+                }
+                ++regions;
+            }
+
+            region.begin = MAX(next, match_begin);
+            region.end = MIN(match_end, region.begin + (off_t)scan->window);
+            region.first_match = region.last_match = match;
+            region.line_start = region.begin == next && next_line_start;
+        }
+
+        unmap_range(&window);
+        pos += scan_size;
+    }
+
+    if (region.begin >= 0)
+    {
+        if (emit_region(scan, fd, &region, end, &next, &next_line_start) != 0)
+            return -1;
+        ++regions;
+    }
+
+    return regions;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2026  ABRT team
+ * Copyright (C) 2026  RedHat Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef _ABRT_LOG_SCANNER_H_
+#define _ABRT_LOG_SCANNER_H_
+
+#include "libabrt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Multi-pattern string matcher
+ *
+ * Finds the first occurrence of any of the strings in a single pass over the
+ * data (Aho-Corasick automaton). The state of the matcher is kept by the
+ * caller, so a string split between two consecutive buffers is found too.
+ */
+struct abrt_string_matcher;
+typedef struct abrt_string_matcher abrt_string_matcher_t;
+
+/* The state before the first byte of data */
+#define ABRT_STRING_MATCHER_START 0
+
+/*
+ * Creates a matcher for the strings, empty strings are ignored.
+ *
+ * @param strings list of char *
+ */
+abrt_string_matcher_t *abrt_string_matcher_new(GList *strings);
+
+void abrt_string_matcher_free(abrt_string_matcher_t *matcher);
+
+/*
+ * Searches data for the strings.
+ *
+ * @param state the state after the previous data or ABRT_STRING_MATCHER_START,
+ *        updated to the state after the returned position
+ * @returns the number of bytes up to and including the end of the first
+ *          occurrence of a string or 0 if no string occurs in data
+ */
+size_t abrt_string_matcher_find(const abrt_string_matcher_t *matcher,
+                                unsigned *state,
+                                const char *data,
+                                size_t size);
+
+/*
+ * Streaming scan of a part of a file
+ *
+ * The part is read in windows of bounded size and searched by the matcher.
+ * The state of the matcher is carried from a window to the next one, so
+ * strings crossing the boundaries are found too. Every occurrence is extended
+ * by the context before and after to whole lines. Overlapping regions are
+ * merged, but no region grows beyond the window size.
+ */
+struct abrt_log_scan
+{
+    const abrt_string_matcher_t *matcher;
+    /* Number of bytes before and after the end of an occurrence included in
+     * its region */
+    size_t context_before;
+    size_t context_after;
+    /* Maximal number of bytes of the file mapped at once */
+    size_t window;
+    /* Called for every region in the order of the file */
+    void (*region)(const char *data, size_t size, void *user_data);
+    void *user_data;
+};
+
+/*
+ * Scans bytes from begin to end of fd.
+ *
+ * @returns the number of regions found or -1 if the file couldn't be mapped
+ */
+int abrt_log_scan_file(const struct abrt_log_scan *scan, int fd, off_t begin, off_t end);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*_ABRT_LOG_SCANNER_H_*/
@@ -24,6 +24,10 @@
 
 int g_abrt_oops_sleep_woke_up_on_signal;
 
+/* Index of the next problem directory, unique within the process even if
+ * several threads create the directories in the same second */
+static gint s_dump_dir_idx;
+
 int abrt_oops_process_list(GList *oops_list, const char *dump_location, const char *analyzer, int flags)
 {
     unsigned errors = 0;
@@ -96,14 +100,18 @@ unsigned abrt_oops_create_dump_dirs(GList *oops_list, const char *dump_location,
     g_autofree char *proc_modules = libreport_xmalloc_open_read_close("/proc/modules", /*maxsize:*/ NULL);
     g_autofree char *suspend_stats = libreport_xmalloc_open_read_close("/sys/kernel/debug/suspend_stats", /*maxsize:*/ NULL);
 
+    /* libreport_iso_date_string() returns a static buffer, backfill workers
+     * call this function in parallel */
     time_t t = time(NULL);
-    const char *iso_date = libreport_iso_date_string(&t);
+    struct tm tm;
+    char iso_date[sizeof("YYYY-MM-DD-hh:mm:ss")];
+    strftime(iso_date, sizeof(iso_date), "%Y-%m-%d-%H:%M:%S", localtime_r(&t, &tm));
 
     pid_t my_pid = getpid();
-    unsigned idx = 0;
     unsigned errors = 0;
-    for (GList *oops = oops_list; oops != NULL; oops = oops->next, ++idx)
+    for (GList *oops = oops_list; oops != NULL; oops = oops->next)
     {
+        const unsigned idx = (unsigned)g_atomic_int_add(&s_dump_dir_idx, 1);
         char base[sizeof("oops-YYYY-MM-DD-hh:mm:ss-%lu-%lu") + 2 * sizeof(long)*3];
         sprintf(base, "oops-%s-%lu-%lu", iso_date, (long)my_pid, (long)idx);
         g_autofree char *path = g_build_filename(dump_location ? dump_location : "", base, NULL);
@@ -305,3 +313,38 @@ char *abrt_oops_string_filter_regex(void)
 
     return NULL;
 }
+
+GList *abrt_oops_suspicious_strings_list_filtered(void)
+{
+    GList *koops_strings = abrt_koops_suspicious_strings_list();
+
+    g_autofree char *oops_string_filter_regex = abrt_oops_string_filter_regex();
+    if (oops_string_filter_regex)
+    {
+        regex_t filter_re;
+        if (regcomp(&filter_re, oops_string_filter_regex, REG_NOSUB) != 0)
+            perror_msg_and_die(_("Failed to compile regex"));
+
+        GList *iter = koops_strings;
+        while(iter != NULL)
+        {
+            GList *next = g_list_next(iter);
+
+            const int reti = regexec(&filter_re, (const char *)iter->data, 0, NULL, 0);
+            if (reti == 0)
+                koops_strings = g_list_delete_link(koops_strings, iter);
+            else if (reti != REG_NOMATCH)
+            {
+                char msgbuf[100];
+                regerror(reti, &filter_re, msgbuf, sizeof(msgbuf));
+                error_msg_and_die("Regex match failed: %s", msgbuf);
+            }
+
+            iter = next;
+        }
+
+        regfree(&filter_re);
+    }
+
+    return koops_strings;
+}
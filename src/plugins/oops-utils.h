@@ -23,6 +23,14 @@
  */
 #define ABRT_OOPS_MAX_DUMPED_COUNT  5
 
+#define ABRT_JOURNAL_KOOPS_STATE_FILE VAR_STATE"/abrt-dump-journal-oops.state"
+#define ABRT_JOURNAL_KOOPS_ANALYZER "abrt-journal-koops"
+
+/* _TRANSPORT is a trusted field and cannot be forged by a user space process
+ * logging with SYSLOG_IDENTIFIER=kernel. */
+#define ABRT_JOURNAL_KOOPS_MATCH_TRANSPORT "_TRANSPORT=kernel"
+#define ABRT_JOURNAL_KOOPS_MATCH_IDENTIFIER "SYSLOG_IDENTIFIER=kernel"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -40,6 +48,9 @@ unsigned abrt_oops_create_dump_dirs(GList *oops_list, const char *dump_location,
 void abrt_oops_save_data_in_dump_dir(struct dump_dir *dd, char *oops, const char *proc_modules);
 int abrt_oops_signaled_sleep(int seconds);
 char *abrt_oops_string_filter_regex(void);
+/* abrt_koops_suspicious_strings_list() without the strings filtered out by
+ * oops.conf */
+GList *abrt_oops_suspicious_strings_list_filtered(void);
 
 #ifdef __cplusplus
 }
@@ -258,3 +258,40 @@ struct xorg_crash_info *process_xorg_bt(char *(*get_next_line)(void *), void *da
 
     return NULL;
 }
+
+void
+abrt_xorg_process_list_of_crashes(GList *crashes, const char *dump_location, int flags)
+{
+    if (crashes == NULL)
+        return;
+
+    GList *list;
+    for (list = crashes; list != NULL; list = list->next)
+    {
+        xorg_crash_info_create_dump_dir(list->data, dump_location, (flags & ABRT_XORG_WORLD_READABLE));
+
+        if (flags & ABRT_XORG_PRINT_STDOUT)
+            xorg_crash_info_print_crash(list->data);
+
+        if (flags & ABRT_XORG_THROTTLE_CREATION)
+            if (abrt_xorg_signaled_sleep(1) > 0)
+                break;
+    }
+
+    return;
+}
+
+GList *abrt_xorg_journal_filters_from_conf(void)
+{
+    g_autoptr(GHashTable) settings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    log_notice("Loading settings from '%s'", XORG_CONF);
+    abrt_load_abrt_plugin_conf_file(XORG_CONF, settings);
+    log_debug("Loaded '%s'", XORG_CONF);
+
+    const char *conf_journal_filters = g_hash_table_lookup(settings, "JournalFilters");
+    if (!conf_journal_filters) {
+        conf_journal_filters = XORG_DEFAULT_JOURNAL_FILTERS;
+    }
+
+    return libreport_parse_delimited_list(conf_journal_filters, ",");
+}
@@ -29,6 +29,10 @@ extern "C" {
 
 #define XORG_SEARCH_STRING "Backtrace:"
 
+#define ABRT_JOURNAL_XORG_WATCH_STATE_FILE VAR_STATE"/abrt-dump-journal-xorg.state"
+#define XORG_CONF "xorg.conf"
+#define XORG_DEFAULT_JOURNAL_FILTERS "_COMM=gdm-x-session, _COMM=gnome-shell"
+
 enum {
     ABRT_XORG_THROTTLE_CREATION = 1 << 0,
     ABRT_XORG_WORLD_READABLE    = 1 << 1,
@@ -112,6 +116,22 @@ int xorg_crash_info_save_in_dump_dir(struct xorg_crash_info *crash_info, struct
 void xorg_crash_info_create_dump_dir(struct xorg_crash_info *crash_info, const char *dump_location,
                                      bool world_readable);
 
+/*
+ * Creates dump dirs for all crashes in the list
+ *
+ * @param crashes list of struct xorg_crash_info
+ * @param dump_location where the dump dirs will be created
+ * @param flags ABRT_XORG_* flags
+ */
+void abrt_xorg_process_list_of_crashes(GList *crashes, const char *dump_location, int flags);
+
+/*
+ * Loads JournalFilters from xorg.conf
+ *
+ * @returns list of malloced journal matches (see abrt-journal.h)
+ */
+GList *abrt_xorg_journal_filters_from_conf(void);
+
 #ifdef __cplusplus
 }
 #endif
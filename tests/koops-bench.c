@@ -0,0 +1,306 @@
+/* -*- tab-width: 8 -*- */
+
+/*
+    Copyright (C) 2026  ABRT team
+    Copyright (C) 2026  RedHat Inc
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+/*
+ * Throughput benchmark of the kernel oops parser.
+ *
+ * Replays the given example logs (usually tests/examples/\*.test) and
+ * a synthetic syslog made of the example oopses and generated noise through
+ * abrt_koops_extract_oopses(), abrt_koops_extract_oopses_from_lines() and
+ * abrt_koops_hash_str(). Prints lines per second and number of allocations
+ * for every stage. The peak RSS is kept by the kernel for the whole process,
+ * so a stage gets the amount it raised the peak by and the process peak
+ * is printed next to it.
+ *
+ * Run it via 'make -C tests bench'.
+ */
+
+#include <sys/resource.h>
+#include <time.h>
+#include "libabrt.h"
+
+/* Count allocations of the whole process including libabrt and GLib. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static unsigned long s_allocations;
+
+void *malloc(size_t size)
+{
+    __atomic_add_fetch(&s_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    __atomic_add_fetch(&s_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    __atomic_add_fetch(&s_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+}
+
+struct bench
+{
+    const char *name;
+    struct timespec start;
+    unsigned long allocations;
+    long maxrss;
+};
+
+static long get_maxrss(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static void bench_start(struct bench *b, const char *name)
+{
+    b->name = name;
+    b->allocations = __atomic_load_n(&s_allocations, __ATOMIC_RELAXED);
+    b->maxrss = get_maxrss();
+    clock_gettime(CLOCK_MONOTONIC, &b->start);
+}
+
+static void bench_stop(struct bench *b, unsigned long lines, unsigned long oopses)
+{
+    struct timespec stop;
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    const unsigned long allocations = __atomic_load_n(&s_allocations, __ATOMIC_RELAXED) - b->allocations;
+
+    const double secs = (stop.tv_sec - b->start.tv_sec) + (stop.tv_nsec - b->start.tv_nsec) / 1e9;
+
+    const long maxrss = get_maxrss();
+
+    printf("%-28s %10lu lines %8lu oopses %8.3f s %12.0f lines/s %10lu allocs %+8ld KiB peak RSS (process %ld KiB)\n",
+            b->name, lines, oopses, secs, secs > 0 ? lines / secs : 0.0,
+            allocations, maxrss - b->maxrss, maxrss);
+}
+
+static unsigned long count_lines(const char *buffer, size_t size)
+{
+    unsigned long lines = 0;
+    for (const char *c = buffer; (c = memchr(c, '\n', buffer + size - c)) != NULL; ++c)
+        ++lines;
+    return lines;
+}
+
+/* Kernel and user space chatter of an ordinary host */
+static const char *const s_kernel_noise[] = {
+    "e1000e 0000:00:19.0 eth0: Link is Up 1000 Mbps Full Duplex, Flow Control: None",
+    "audit: type=1130 audit(1539851654.123:412): pid=1 uid=0 auid=4294967295 ses=4294967295 msg='unit=systemd-tmpfiles-clean comm=\"systemd\" exe=\"/usr/lib/systemd/systemd\" hostname=? addr=? terminal=? res=success'",
+    "usb 2-1.4: new high-speed USB device number 5 using ehci-pci",
+    "EXT4-fs (dm-1): mounted filesystem with ordered data mode. Opts: (null)",
+    "IPv6: ADDRCONF(NETDEV_CHANGE): wlp3s0: link becomes ready",
+    "pci 0000:15:00.0: PME# disabled",
+};
+
+static const char *const s_user_noise[] = {
+    "systemd[1]: Started Session 42 of user root.",
+    "NetworkManager[812]: <info>  [1539851654.1234] dhcp4 (eth0): state changed bound -> bound",
+    "dbus-daemon[790]: [system] Successfully activated service 'org.freedesktop.nm_dispatcher'",
+    "chronyd[745]: Selected source 10.5.26.10",
+    "sshd[31337]: Accepted publickey for root from 10.0.0.1 port 52202 ssh2",
+    "crond[2001]: (root) CMD (run-parts /etc/cron.hourly)",
+};
+
+/*
+ * Builds a syslog of approximately 'lines' lines where every oops from the
+ * examples is followed by 'noise' lines of which 'kernel_percent' percent are
+ * kernel messages.
+ */
+static char *build_synthetic_log(GList *oopses, unsigned long lines, unsigned noise, unsigned kernel_percent, size_t *size)
+{
+    char hostname[HOST_NAME_MAX + 1] = { 0 };
+    gethostname(hostname, sizeof(hostname) - 1);
+
+    GString *log = g_string_new(NULL);
+    unsigned long written = 0;
+    unsigned seed = 1;
+    GList *oops = oopses;
+    while (written < lines)
+    {
+        for (unsigned i = 0; i < noise && written < lines; ++i, ++written)
+        {
+            seed = seed * 1103515245 + 12345;
+            if ((seed >> 16) % 100 < kernel_percent)
+                g_string_append_printf(log, "Oct 18 12:34:56 %s kernel: [%5lu.%06lu] %s\n", hostname,
+                        written / 1000, written % 1000000, s_kernel_noise[(seed >> 8) % ARRAY_SIZE(s_kernel_noise)]);
+            else
+                g_string_append_printf(log, "Oct 18 12:34:56 %s %s\n", hostname,
+                        s_user_noise[(seed >> 8) % ARRAY_SIZE(s_user_noise)]);
+        }
+
+        if (oops == NULL)
+        {
+            if (noise == 0)
+                break;
+            continue;
+        }
+
+        /* the oops must be of one log level */
+        char *line = (char *)oops->data;
+        for (char *eol; *line != '\0'; line = eol + 1, ++written)
+        {
+            eol = strchrnul(line, '\n');
+            g_string_append_printf(log, "Oct 18 12:34:57 %s kernel: <4>%.*s\n", hostname, (int)(eol - line), line);
+            if (*eol == '\0')
+                break;
+        }
+
+        oops = oops->next ? oops->next : oopses;
+    }
+
+    *size = log->len;
+    return g_string_free(log, FALSE);
+}
+
+int main(int argc, char **argv)
+{
+    abrt_init(argv);
+
+    const char *program_usage_string =
+        "& [-v] [-n NUM] [-l NUM] [-r NUM] [-k NUM] FILE...\n"
+        "\n"
+        "Measures throughput of the kernel oops parser on the example FILEs\n"
+        "(usually tests/examples/\\*.test) and on a synthetic syslog built from them";
+
+    enum {
+        OPT_v = 1 << 0,
+        OPT_n = 1 << 1,
+        OPT_l = 1 << 2,
+        OPT_r = 1 << 3,
+        OPT_k = 1 << 4,
+    };
+    int iterations = 100;
+    int synthetic_lines = 1000000;
+    int noise = 2000;
+    int kernel_percent = 10;
+    /* Keep enum above and order of options below in sync! */
+    struct options program_options[] = {
+        OPT__VERBOSE(&libreport_g_verbose),
+        OPT_INTEGER('n', NULL, &iterations,      "Replay the examples NUM times (default 100)"),
+        OPT_INTEGER('l', NULL, &synthetic_lines, "Build the synthetic log of NUM lines (default 1000000)"),
+        OPT_INTEGER('r', NULL, &noise,           "Put NUM noise lines after each oops in the synthetic log (default 2000)"),
+        OPT_INTEGER('k', NULL, &kernel_percent,  "Make NUM percent of the noise kernel messages (default 10)"),
+        OPT_END()
+    };
+    libreport_parse_opts(argc, argv, program_options, program_usage_string);
+
+    argv += optind;
+    if (!argv[0] || iterations <= 0 || synthetic_lines < 0 || noise < 0
+        || kernel_percent < 0 || kernel_percent > 100)
+        libreport_show_usage_and_die(program_usage_string, program_options);
+
+    struct bench b;
+
+    /* Replay of the examples */
+    GList *examples = NULL;
+    GList *example_oopses = NULL;
+    unsigned long example_lines = 0;
+    for (char **file = argv; *file; ++file)
+    {
+        char *content = libreport_xmalloc_open_read_close(*file, /*maxsize:*/ NULL);
+        if (!content)
+            return 1;
+
+        example_lines += count_lines(content, strlen(content));
+        examples = g_list_prepend(examples, content);
+
+        g_autofree char *copy = g_strdup(content);
+        abrt_koops_extract_oopses(&example_oopses, copy, strlen(copy));
+    }
+
+    unsigned long found = 0;
+    bench_start(&b, "extract_oopses (examples)");
+    for (int i = 0; i < iterations; ++i)
+    {
+        for (GList *e = examples; e; e = e->next)
+        {
+            g_autofree char *copy = g_strdup(e->data);
+            GList *oops_list = NULL;
+            abrt_koops_extract_oopses(&oops_list, copy, strlen(copy));
+            found += g_list_length(oops_list);
+            g_list_free_full(oops_list, free);
+        }
+    }
+    bench_stop(&b, example_lines * iterations, found);
+
+    /* Re-extract the oopses without the version line to have bare kernel
+     * lines for the synthetic log */
+    GList *bare_oopses = NULL;
+    for (GList *o = example_oopses; o; o = o->next)
+    {
+        const char *oops = strchr(o->data, '\n');
+        bare_oopses = g_list_prepend(bare_oopses, g_strdup(oops ? oops + 1 : o->data));
+    }
+    bare_oopses = g_list_reverse(bare_oopses);
+
+    /* Synthetic log */
+    size_t log_size = 0;
+    g_autofree char *synthetic_log = build_synthetic_log(bare_oopses, synthetic_lines, noise, kernel_percent, &log_size);
+    const unsigned long log_lines = count_lines(synthetic_log, log_size);
+
+    GList *oops_list = NULL;
+    {
+        g_autofree char *copy = g_strndup(synthetic_log, log_size);
+        bench_start(&b, "extract_oopses (synthetic)");
+        abrt_koops_extract_oopses(&oops_list, copy, log_size);
+        bench_stop(&b, log_lines, g_list_length(oops_list));
+    }
+
+    {
+        g_autofree char *copy = g_strndup(synthetic_log, log_size);
+        struct abrt_koops_line_info *lines_info = NULL;
+        const int lines_info_size = abrt_koops_split_lines(copy, log_size, &lines_info, NULL);
+
+        GList *line_oopses = NULL;
+        bench_start(&b, "extract_oopses_from_lines");
+        abrt_koops_extract_oopses_from_lines(&line_oopses, lines_info, lines_info_size);
+        bench_stop(&b, lines_info_size, g_list_length(line_oopses));
+
+        g_list_free_full(line_oopses, free);
+        g_free(lines_info);
+    }
+
+    unsigned long hashed = 0;
+    unsigned long oops_lines = 0;
+    bench_start(&b, "hash_str");
+    for (GList *o = oops_list; o; o = o->next)
+    {
+        g_autofree char *hash = abrt_koops_hash_str(o->data);
+        hashed += hash != NULL;
+        oops_lines += count_lines(o->data, strlen(o->data));
+    }
+    bench_stop(&b, oops_lines, hashed);
+
+    g_list_free_full(oops_list, free);
+    g_list_free_full(bare_oopses, free);
+    g_list_free_full(example_oopses, free);
+    g_list_free_full(examples, free);
+
+    return 0;
+}
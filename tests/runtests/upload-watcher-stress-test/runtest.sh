@@ -30,6 +30,7 @@
 
 TEST="upload-watcher-stress-test"
 PACKAGE="abrt"
+ABRT_CONF="/etc/abrt/abrt.conf"
 
 flood()
 {
@@ -52,11 +53,13 @@ rlJournalStart
         # the upload watcher is not installed by default, but we need it for this test
         upload_watch_pkg="abrt-addon-upload-watch"
         rlRun "rpm -q $upload_watch_pkg >/dev/null || dnf install $upload_watch_pkg -y"
-        # Adding $PWD to PATH in order to override abrt-handle-upload
-        # by a local script
+        # The flood consists of broken archives which are rejected and
+        # deleted, so the test measures only the queueing
+        rlFileBackup "$ABRT_CONF"
+        rlRun "augtool set /files${ABRT_CONF}/DeleteUploaded yes" 0
         # Use 60 workers and in the worst case 1GiB for cache
         ERR_LOG="err.log"
-        PATH="$PWD:$PATH:/usr/sbin" abrt-upload-watch -w 60 -c 1024 -v $WATCHED_DIR > out.log 2>$ERR_LOG &
+        PATH="$PATH:/usr/sbin" abrt-upload-watch -w 60 -c 1024 -v $WATCHED_DIR > out.log 2>$ERR_LOG &
         PID_OF_WATCH=$!
     rlPhaseEnd
 
@@ -112,6 +115,7 @@ rlJournalStart
 
     rlPhaseStartCleanup
         rm -rf $WATCHED_DIR
+        rlFileRestore
     rlPhaseEnd
     rlJournalPrintText
 rlJournalEnd